@@ -9,5 +9,6 @@ AC_DEFUN([GP_CHECK_DEBUGGER],
         debugger/Makefile
         debugger/src/Makefile
         debugger/img/Makefile
+        debugger/tests/Makefile
     ])
 ])
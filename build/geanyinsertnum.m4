@@ -5,5 +5,6 @@ AC_DEFUN([GP_CHECK_GEANYINSERTNUM],
     AC_CONFIG_FILES([
         geanyinsertnum/Makefile
         geanyinsertnum/src/Makefile
+        geanyinsertnum/tests/Makefile
     ])
 ])
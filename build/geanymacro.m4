@@ -6,5 +6,6 @@ AC_DEFUN([GP_CHECK_GEANYMACRO],
     AC_CONFIG_FILES([
         geanymacro/Makefile
         geanymacro/src/Makefile
+        geanymacro/tests/Makefile
     ])
 ])
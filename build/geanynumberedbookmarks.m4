@@ -6,5 +6,6 @@ AC_DEFUN([GP_CHECK_GEANYNUMBEREDBOOKMARKS],
     AC_CONFIG_FILES([
         geanynumberedbookmarks/Makefile
         geanynumberedbookmarks/src/Makefile
+        geanynumberedbookmarks/tests/Makefile
     ])
 ])
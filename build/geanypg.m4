@@ -26,5 +26,6 @@ AC_DEFUN([GP_CHECK_GEANYPG],
     AC_CONFIG_FILES([
         geanypg/Makefile
         geanypg/src/Makefile
+        geanypg/tests/Makefile
     ])
 ])
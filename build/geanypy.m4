@@ -24,5 +24,6 @@ AC_DEFUN([GP_CHECK_GEANYPY],
         geanypy/src/Makefile
         geanypy/geany/Makefile
         geanypy/plugins/Makefile
+        geanypy/tests/Makefile
     ])
 ])
@@ -20,5 +20,6 @@ AC_DEFUN([GP_CHECK_SCOPE],
         scope/data/Makefile
         scope/docs/Makefile
         scope/src/Makefile
+        scope/tests/Makefile
     ])
 ])
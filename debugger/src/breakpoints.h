@@ -34,6 +34,7 @@ typedef enum _break_state {
 
 typedef void	(*move_to_line_cb)(const char* file, int line);
 typedef void	(*select_frame_cb)(int frame_number);
+typedef void	(*more_frames_cb)(void);
 
 gboolean		breaks_init(move_to_line_cb callback);
 void			breaks_destroy(void);
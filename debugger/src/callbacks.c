@@ -154,21 +154,45 @@ void on_document_open(GObject *obj, GeanyDocument *doc, gpointer user_data)
 		debug_on_file_open(doc);
 }
 
+/* editor and position of a requested calltip, mouse leave handler for the editor */
+static ScintillaObject *calltip_sci = NULL;
+static int calltip_position;
+static gulong leave_signal = 0;
+
 /*
- * 	Handles mouse leave event to check if a calltip is still present and hides it if yes 
+ * 	Cancels a calltip request and hides a calltip if it is shown
  */
-static gint leave_signal;
-static gboolean on_mouse_leave(GtkWidget *widget, GdkEvent *event, gpointer user_data)
+static void hide_calltip(void)
 {
-	ScintillaObject *so = (ScintillaObject*)widget;
-	if (scintilla_send_message (so, SCI_CALLTIPACTIVE, 0, 0))
+	debug_cancel_calltip();
+
+	if (leave_signal)
 	{
-		g_signal_handler_disconnect(G_OBJECT(widget), leave_signal);
-		scintilla_send_message (so, SCI_CALLTIPCANCEL, 0, 0);
+		if (scintilla_send_message (calltip_sci, SCI_CALLTIPACTIVE, 0, 0))
+			scintilla_send_message (calltip_sci, SCI_CALLTIPCANCEL, 0, 0);
+
+		g_signal_handler_disconnect(G_OBJECT(calltip_sci), leave_signal);
+		leave_signal = 0;
 	}
+}
+
+/*
+ * 	Handles mouse leave event to cancel a calltip request and hide a calltip
+ */
+static gboolean on_mouse_leave(GtkWidget *widget, GdkEvent *event, gpointer user_data)
+{
+	hide_calltip();
 	return FALSE;
 }
 
+/*
+ * 	Shows a calltip evaluated by the debugger
+ */
+static void show_calltip(const gchar *calltip)
+{
+	scintilla_send_message (calltip_sci, SCI_CALLTIPSHOW, calltip_position, (long)calltip);
+}
+
 /*
  * 	Occures on notify from editor.
  * 	Handles margin click to set/remove breakpoint 
@@ -220,12 +244,14 @@ gboolean on_editor_notify(
 			word = get_word_at_position(editor->sci, nt->position);
 			if (word->len)
 			{
-				gchar *calltip = debug_get_calltip_for_expression(word->str);
-				if (calltip)
-				{
-					leave_signal = g_signal_connect(G_OBJECT(editor->sci), "leave-notify-event", G_CALLBACK(on_mouse_leave), NULL);
-					scintilla_send_message (editor->sci, SCI_CALLTIPSHOW, nt->position, (long)calltip);
-				}
+				hide_calltip();
+
+				/* the calltip is shown when evaluated, unless the mouse leaves or moves */
+				calltip_sci = editor->sci;
+				calltip_position = nt->position;
+				leave_signal = g_signal_connect(G_OBJECT(editor->sci), "leave-notify-event", G_CALLBACK(on_mouse_leave), NULL);
+
+				debug_request_calltip(word->str, show_calltip);
 			}
 				
 			g_string_free(word, TRUE);
@@ -234,14 +260,7 @@ gboolean on_editor_notify(
 		}
 		case SCN_DWELLEND:
 		{
-			if (DBS_STOPPED != debug_get_state ())
-				break;
-
-			if (scintilla_send_message (editor->sci, SCI_CALLTIPACTIVE, 0, 0))
-			{
-				g_signal_handler_disconnect(G_OBJECT(editor->sci), leave_signal);
-				scintilla_send_message (editor->sci, SCI_CALLTIPCANCEL, 0, 0);
-			}
+			hide_calltip();
 			break;
 		}
 		case SCN_MODIFYATTEMPTRO:
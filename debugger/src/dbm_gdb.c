@@ -38,6 +38,7 @@ extern GeanyData		*geany_data;
 
 #include "breakpoint.h"
 #include "debug_module.h"
+#include "gdb_mi.h"
 
 /* module features */
 #define MODULE_FEATURES MF_ASYNC_BREAKS
@@ -50,6 +51,9 @@ extern GeanyData		*geany_data;
 /* GDB prompt */
 #define GDB_PROMPT "(gdb) \n"
 
+/* maximum number of the calltip GDB variables kept */
+#define MAX_CALLTIP_VARS 100
+
 /* enumeration for GDB command execution status */
 typedef enum _result_class {
 	RC_DONE,
@@ -57,6 +61,29 @@ typedef enum _result_class {
 	RC_ERROR
 } result_class;
 
+/* function to call with the result of a background command */
+typedef void (*background_callback)(result_class rc, gdb_mi_record *record, gpointer data);
+
+/* structure to keep a command that is executed in background while the target is stopped */
+typedef struct _background_command {
+	gchar *command;
+	background_callback callback;
+	gpointer data;
+} background_command;
+
+/* structure to keep a calltip evaluation state between background commands */
+typedef struct _calltip_request {
+	gchar *expression;
+	int max_children;
+	calltip_callback callback;
+	gboolean cancelled;
+	/* evaluated variable, its children count
+	 * and whether the children are requested with a range */
+	variable *var;
+	int numchild;
+	gboolean ranged;
+} calltip_request;
+
 /* structure to keep async command data (command line, messages) */
 typedef struct _queue_item {
 	GString *message;
@@ -118,15 +145,39 @@ static GList *files = NULL;
 and it's nessesary to refresh files list */
 static gboolean file_refresh_needed = FALSE;
 
+/* set to true when files list has been refreshed
+and it's not yet been taken by get_files */
+static gboolean files_changed_flag = FALSE;
+
 /* current frame number */
 static int active_frame = 0;
 
+/* background commands queue, the first one is being executed */
+static GList *background_commands = NULL;
+
+/* output event source id of the background command being executed, 0 if none is sent */
+static guint background_id = 0;
+
+/* output lines of the background command being executed */
+static GList *background_lines = NULL;
+
+/* set while a background command callback is called */
+static gboolean background_completing = FALSE;
+
+/* calltip evaluation in progress */
+static calltip_request *current_calltip = NULL;
+
+/* calltip GDB variables ("expression -> name") kept to check whether calltips have changed */
+static GHashTable *calltip_vars = NULL;
+
 /* forward declarations */
 static void stop(void);
 static variable* add_watch(gchar* expression);
 static void update_watches(void);
 static void update_autos(void);
 static void update_files(void);
+static void finish_background_commands(void);
+static void clear_background_commands(void);
 
 /*
  * print message using color, based on message type
@@ -191,6 +242,9 @@ static void on_gdb_exit(GPid pid, gint status, gpointer data)
 	g_list_foreach(files, (GFunc)g_free, NULL);
 	g_list_free(files);
 	files = NULL;
+
+	/* drop background commands and calltip variables */
+	clear_background_commands();
 	
 	g_source_remove(gdb_src_id);
 	
@@ -319,7 +373,7 @@ static gboolean on_read_async_output(GIOChannel * src, GIOCondition cond, gpoint
 
 		GList *lines;
 		GList *commands = (GList*)data;
-		gchar *coma;
+		gdb_mi_record *record = gdb_mi_record_parse(line);
 
 		g_source_remove(gdb_id_out);
 
@@ -327,16 +381,7 @@ static gboolean on_read_async_output(GIOChannel * src, GIOCondition cond, gpoint
 		g_list_foreach(lines, (GFunc)g_free, NULL);
 		g_list_free (lines);
 
-		coma = strchr(line, ',');
-		if (coma)
-		{
-			*coma = '\0';
-			coma++;
-		}
-		else
-			coma = line + strlen(line);
-		
-		if (!strcmp(line, "^done"))
+		if (gdb_mi_record_matches(record, '^', "done"))
 		{
 			/* command completed succesfully - run next command if exists */
 			if (commands->next)
@@ -379,14 +424,13 @@ static gboolean on_read_async_output(GIOChannel * src, GIOCondition cond, gpoint
 			{
 				if (item->format_error_message)
 				{
-					gchar* gdb_msg = g_strcompress(strstr(coma, "msg=\"") + strlen("msg=\""));
+					const gchar *gdb_msg = record ? gdb_mi_record_get_string(record, "msg") : NULL;
 
 					GString *msg = g_string_new("");
-					g_string_printf(msg, item->error_message->str, gdb_msg);
+					g_string_printf(msg, item->error_message->str, gdb_msg ? gdb_msg : "");
 					dbg_cbs->report_error(msg->str);
 
-					g_free(gdb_msg);
-					g_string_free(msg, FALSE);
+					g_string_free(msg, TRUE);
 				}
 				else
 				{
@@ -399,6 +443,8 @@ static gboolean on_read_async_output(GIOChannel * src, GIOCondition cond, gpoint
 
 			stop();
 		}
+
+		gdb_mi_record_free(record);
 	}
 
 	g_free(line);
@@ -406,6 +452,15 @@ static gboolean on_read_async_output(GIOChannel * src, GIOCondition cond, gpoint
 	return TRUE;
 }
 
+/*
+ * returns integer value of a string field, 0 if there is no such field
+ */
+static int get_int(const gdb_mi_value *first, const gchar *name)
+{
+	const gchar *value = gdb_mi_value_get_string(first, name);
+	return value ? atoi(value) : 0;
+}
+
 /*
  * asyncronous gdb output reader
  * looks for a stopped event, then notifies "debug" module and removes async handler
@@ -416,6 +471,7 @@ static gboolean on_read_from_gdb(GIOChannel * src, GIOCondition cond, gpointer d
 	gchar *line;
 	gsize length;
 	gboolean prompt;
+	gdb_mi_record *record;
 	
 	if (G_IO_STATUS_NORMAL != g_io_channel_read_line(src, &line, NULL, &length, NULL))
 		return TRUE;		
@@ -438,142 +494,115 @@ static gboolean on_read_from_gdb(GIOChannel * src, GIOCondition cond, gpointer d
 		}
 	}
 		
-	if (!target_pid && g_str_has_prefix(line, "=thread-group-created"))
+	record = gdb_mi_record_parse(line);
+
+	if (!target_pid && (gdb_mi_record_matches(record, '=', "thread-group-created") ||
+		gdb_mi_record_matches(record, '=', "thread-group-started")))
 	{
-		*(strrchr(line, '\"')) = '\0';
-		target_pid = atoi(line + strlen("=thread-group-created,id=\""));
+		/* older GDB versions use the pid as a thread group id */
+		const gchar *pid = gdb_mi_record_get_string(record, "pid");
+		if (!pid)
+			pid = gdb_mi_record_get_string(record, "id");
+		if (pid)
+			target_pid = atoi(pid);
 	}
-	else if (!target_pid && g_str_has_prefix(line, "=thread-group-started"))
+	else if (gdb_mi_record_matches(record, '=', "thread-created"))
 	{
-		*(strrchr(line, '\"')) = '\0';
-		target_pid = atoi(strrchr(line, '\"') + 1);
+		dbg_cbs->add_thread(get_int(record->first, "id"));
 	}
-	else if (g_str_has_prefix(line, "=thread-created"))
+	else if (gdb_mi_record_matches(record, '=', "thread-exited"))
 	{
-		int thread_id;
-
-		*(strrchr(line, ',') - 1) = '\0';
-		thread_id = atoi(line + strlen("=thread-created,id=\""));
-		dbg_cbs->add_thread(thread_id);
+		dbg_cbs->remove_thread(get_int(record->first, "id"));
 	}
-	else if (g_str_has_prefix(line, "=thread-exited"))
+	else if (gdb_mi_record_matches(record, '=', "library-loaded") || gdb_mi_record_matches(record, '=', "library-unloaded"))
 	{
-		int thread_id;
-
-		*(strrchr(line, ',') - 1) = '\0';
-		thread_id = atoi(line + strlen("=thread-exited,id=\""));
-		dbg_cbs->remove_thread(thread_id);
+		file_refresh_needed = TRUE;
 	}
-	else if (g_str_has_prefix(line, "=library-loaded") || g_str_has_prefix(line, "=library-unloaded"))
+	else if (gdb_mi_record_matches(record, '*', "running"))
 	{
-		file_refresh_needed = TRUE;
+		dbg_cbs->set_run();
 	}
-	else if (*line == '*')
+	else if (gdb_mi_record_matches(record, '*', "stopped"))
 	{
-		/* asyncronous record found */
-		char *record = NULL;
-		if ( (record = strchr(line, ',')) )
+		const gchar *reason;
+
+		/* removing read callback (will pulling all output left manually) */
+		g_source_remove(gdb_id_out);
+
+		/* looking for a reason to stop */
+		reason = gdb_mi_record_get_string(record, "reason");
+		if (reason)
 		{
-			*record = '\0';
-			record++;
+			if (!strcmp(reason, "breakpoint-hit"))
+				stop_reason = SR_BREAKPOINT_HIT;
+			else if (!strcmp(reason, "end-stepping-range"))
+				stop_reason = SR_END_STEPPING_RANGE;
+			else if (!strcmp(reason, "signal-received"))
+				stop_reason = SR_SIGNAL_RECIEVED;
+			else if (!strcmp(reason, "exited-normally"))
+				stop_reason = SR_EXITED_NORMALLY;
+			else if (!strcmp(reason, "exited-signalled"))
+				stop_reason = SR_EXITED_SIGNALLED;
+			else if (!strcmp(reason, "exited"))
+				stop_reason = SR_EXITED_WITH_CODE;
 		}
 		else
-			record = line + strlen(line);
+		{
+			/* somehow, sometimes there can be no stop reason */
+			stop_reason = SR_EXITED_NORMALLY;
+		}
 		
-		if (!strcmp(line, "*running"))
-			dbg_cbs->set_run();
-		else if (!strcmp(line, "*stopped"))
+		if (SR_BREAKPOINT_HIT == stop_reason || SR_END_STEPPING_RANGE == stop_reason || SR_SIGNAL_RECIEVED == stop_reason)
 		{
-			char *reason;
-
-			/* removing read callback (will pulling all output left manually) */
-			g_source_remove(gdb_id_out);
+			int thread_id = get_int(record->first, "thread-id");
+			
+			active_frame = 0;
 
-			/* looking for a reason to stop */
-			reason = strstr(record, "reason=\"");
-			if (reason)
+			if (SR_BREAKPOINT_HIT == stop_reason || SR_END_STEPPING_RANGE == stop_reason)
 			{
-				char *next;
-
-				reason += strlen("reason=\"");
-				next = strstr(reason, "\"") + 1;
-				*(next - 1) = '\0';
-				if (!strcmp(reason, "breakpoint-hit"))
-					stop_reason = SR_BREAKPOINT_HIT;
-				else if (!strcmp(reason, "end-stepping-range"))
-					stop_reason = SR_END_STEPPING_RANGE;
-				else if (!strcmp(reason, "signal-received"))
-					stop_reason = SR_SIGNAL_RECIEVED;
-				else if (!strcmp(reason, "exited-normally"))
-					stop_reason = SR_EXITED_NORMALLY;
-				else if (!strcmp(reason, "exited-signalled"))
-					stop_reason = SR_EXITED_SIGNALLED;
-				else if (!strcmp(reason, "exited"))
-					stop_reason = SR_EXITED_WITH_CODE;
+				/* update autos */
+				update_autos();
+		
+				/* update watches */
+				update_watches();
+		
+				/* update files */
+				if (file_refresh_needed)
+				{
+					update_files();
+					file_refresh_needed = FALSE;
+				}
+
+				dbg_cbs->set_stopped(thread_id);
 			}
 			else
 			{
-				/* somehow, sometimes there can be no stop reason */
-				stop_reason = SR_EXITED_NORMALLY;
-			}
-			
-			if (SR_BREAKPOINT_HIT == stop_reason || SR_END_STEPPING_RANGE == stop_reason || SR_SIGNAL_RECIEVED == stop_reason)
-			{
-				gchar *thread_id = strstr(reason + strlen(reason) + 1,"thread-id=\"") + strlen("thread-id=\"");
-				*(strchr(thread_id, '\"')) = '\0'; 
-				
-				active_frame = 0;
-
-				if (SR_BREAKPOINT_HIT == stop_reason || SR_END_STEPPING_RANGE == stop_reason)
-				{
-					/* update autos */
-					update_autos();
-			
-					/* update watches */
-					update_watches();
-			
-					/* update files */
-					if (file_refresh_needed)
-					{
-						update_files();
-						file_refresh_needed = FALSE;
-					}
-
-					dbg_cbs->set_stopped(atoi(thread_id));
-				}
+				if (!requested_interrupt)
+					dbg_cbs->report_error(_("Program received a signal"));
 				else
-				{
-					if (!requested_interrupt)
-						dbg_cbs->report_error(_("Program received a signal"));
-					else
-						requested_interrupt = FALSE;
-						
-					dbg_cbs->set_stopped(atoi(thread_id));
-				}
+					requested_interrupt = FALSE;
+					
+				dbg_cbs->set_stopped(thread_id);
 			}
-			else if (stop_reason == SR_EXITED_NORMALLY || stop_reason == SR_EXITED_SIGNALLED || stop_reason == SR_EXITED_WITH_CODE)
+		}
+		else if (stop_reason == SR_EXITED_NORMALLY || stop_reason == SR_EXITED_SIGNALLED || stop_reason == SR_EXITED_WITH_CODE)
+		{
+			if (stop_reason == SR_EXITED_WITH_CODE)
 			{
-				if (stop_reason == SR_EXITED_WITH_CODE)
-				{
-					gchar *code;
-					gchar *message;
-
-					code = strstr(reason + strlen(reason) + 1,"exit-code=\"") + strlen("exit-code=\"");
-					*(strchr(code, '\"')) = '\0';
-					message = g_strdup_printf(_("Program exited with code \"%i\""), (int)(char)strtol(code, NULL, 8));
-					dbg_cbs->report_error(message);
-
-					g_free(message);
-				}
+				const gchar *code = gdb_mi_record_get_string(record, "exit-code");
+				gchar *message = g_strdup_printf(_("Program exited with code \"%i\""), code ? (int)(char)strtol(code, NULL, 8) : 0);
+				dbg_cbs->report_error(message);
 
-				stop();
+				g_free(message);
 			}
+
+			stop();
 		}
 	}
-	else if (g_str_has_prefix (line, "^error"))
+	else if (gdb_mi_record_matches(record, '^', "error"))
 	{
 		GList *lines, *iter;
-		char *msg;
+		const gchar *msg;
 
 		/* removing read callback (will pulling all output left manually) */
 		g_source_remove(gdb_id_out);
@@ -581,16 +610,11 @@ static gboolean on_read_from_gdb(GIOChannel * src, GIOCondition cond, gpointer d
 		/* set debugger stopped if is running */
 		if (DBS_STOPPED != debug_get_state())
 		{
-			gchar *thread_id = strstr(line + strlen(line) + 1,"thread-id=\"");
-			*(strchr(thread_id, '\"')) = '\0'; 
-
-			dbg_cbs->set_stopped(atoi(thread_id));
+			dbg_cbs->set_stopped(get_int(record->first, "thread-id"));
 		}
 
 		/* get message */
-		msg = strstr(line, "msg=\"") + strlen("msg=\"");
-		*strrchr(msg, '\"') = '\0';
-		msg = g_strcompress(msg);
+		msg = gdb_mi_record_get_string(record, "msg");
 		
 		/* reading until prompt */
 		lines = read_until_prompt();
@@ -604,11 +628,10 @@ static gboolean on_read_from_gdb(GIOChannel * src, GIOCondition cond, gpointer d
 		g_list_free (lines);
 
 		/* send error message */
-		dbg_cbs->report_error(msg);
-
-		g_free(msg);
+		dbg_cbs->report_error(msg ? msg : "");
 	}
 
+	gdb_mi_record_free(record);
 	g_free(line);
 
 	return TRUE;
@@ -622,6 +645,8 @@ static gboolean on_read_from_gdb(GIOChannel * src, GIOCondition cond, gpointer d
  */ 
 static void exec_async_command(const gchar* command)
 {
+	finish_background_commands();
+
 #ifdef DEBUG_OUTPUT
 	dbg_cbs->send_message(command, "red");
 #endif
@@ -637,15 +662,21 @@ static void exec_async_command(const gchar* command)
  * i.e. reading output right
  * after execution
  */ 
-static result_class exec_sync_command(const gchar* command, gboolean wait4prompt, gchar** command_record)
+static result_class parse_command_output(GList *lines, gdb_mi_record** command_record);
+static result_class exec_sync_command(const gchar* command, gboolean wait4prompt, gdb_mi_record** command_record)
 {
-	GList *lines, *iter;
+	GList *lines;
 	result_class rc;
 
+	finish_background_commands();
+
 #ifdef DEBUG_OUTPUT
 	dbg_cbs->send_message(command, "red");
 #endif
 
+	if (command_record)
+		*command_record = NULL;
+
 	/* write command to gdb input channel */
 	gdb_input_write_line(command);
 	
@@ -653,6 +684,25 @@ static result_class exec_sync_command(const gchar* command, gboolean wait4prompt
 		return RC_DONE;
 	
 	lines = read_until_prompt();
+	rc = parse_command_output(lines, command_record);
+
+	g_list_foreach(lines, (GFunc)g_free, NULL);
+	g_list_free(lines);
+	
+	return rc;
+}
+
+/*
+ * gets a command result from its output lines,
+ * the result record is returned in "command_record" if it isn't NULL
+ */
+static result_class parse_command_output(GList *lines, gdb_mi_record** command_record)
+{
+	GList *iter;
+	result_class rc;
+
+	if (command_record)
+		*command_record = NULL;
 
 #ifdef DEBUG_OUTPUT
 	for (iter = lines; iter; iter = iter->next)
@@ -669,34 +719,28 @@ static result_class exec_sync_command(const gchar* command, gboolean wait4prompt
 
 		if ('^' == line[0])
 		{
-			gchar* coma = strchr(line, ',');
-			if (coma)
-			{
-				*coma = '\0';
-				coma++;
-			}
-			else
-				coma = line + strlen(line);
-			
-			if (command_record)
-			{
-				*command_record = (gchar*)g_malloc(strlen(coma) + 1);
-				strcpy(*command_record, coma);
-			}
-			
-			if (!strcmp(line, "^done"))
+			gdb_mi_record *record = gdb_mi_record_parse(line);
+
+			if (gdb_mi_record_matches(record, '^', "done"))
 				rc = RC_DONE;
-			else if (!strcmp(line, "^error"))
+			else if (gdb_mi_record_matches(record, '^', "error"))
 			{
 				/* save error message */
-				gchar* msg = g_strcompress(strstr(coma, "msg=\"") + strlen("msg=\""));
-				strcpy(err_message, msg);
-				g_free(msg);
+				const gchar *msg = gdb_mi_record_get_string(record, "msg");
+				g_strlcpy(err_message, msg ? msg : "", sizeof(err_message));
 				
 				rc = RC_ERROR;
 			}
-			else if (!strcmp(line, "^exit"))
+			else if (gdb_mi_record_matches(record, '^', "exit"))
 				rc = RC_EXIT;
+
+			if (command_record)
+			{
+				gdb_mi_record_free(*command_record);
+				*command_record = record;
+			}
+			else
+				gdb_mi_record_free(record);
 		}
 		else if ('&' != line[0])
 		{
@@ -704,12 +748,176 @@ static result_class exec_sync_command(const gchar* command, gboolean wait4prompt
 		}
 	}
 	
-	g_list_foreach(lines, (GFunc)g_free, NULL);
-	g_list_free(lines);
-	
 	return rc;
 }
 
+/*
+ * removes the first background command from the queue and calls its callback
+ */
+static void complete_background_command(result_class rc, gdb_mi_record *record)
+{
+	background_command *bc = (background_command*)background_commands->data;
+	background_commands = g_list_delete_link(background_commands, background_commands);
+
+	if (bc->callback)
+	{
+		background_completing = TRUE;
+		bc->callback(rc, record, bc->data);
+		background_completing = FALSE;
+	}
+
+	g_free(bc->command);
+	g_free(bc);
+}
+
+/*
+ * background commands output reader,
+ * collects the output of a command until a prompt and calls the command callback
+ */
+static void start_background_command(void);
+static gboolean on_read_background_output(GIOChannel * src, GIOCondition cond, gpointer data)
+{
+	gchar *line;
+	gsize terminator;
+	gdb_mi_record *record;
+	result_class rc;
+
+	if (G_IO_STATUS_NORMAL != g_io_channel_read_line(src, &line, NULL, &terminator, NULL))
+		return TRUE;
+
+	if (strcmp(GDB_PROMPT, line))
+	{
+		line[terminator] = '\0';
+		background_lines = g_list_append(background_lines, line);
+		return TRUE;
+	}
+	g_free(line);
+
+	/* command completed, the reader is removed */
+	background_id = 0;
+
+	rc = parse_command_output(background_lines, &record);
+	g_list_foreach(background_lines, (GFunc)g_free, NULL);
+	g_list_free(background_lines);
+	background_lines = NULL;
+
+	complete_background_command(rc, record);
+	gdb_mi_record_free(record);
+
+	/* callback could have queued other commands */
+	if (background_commands)
+	{
+		start_background_command();
+	}
+
+	return FALSE;
+}
+
+/*
+ * sends the first queued background command to GDB
+ */
+static void start_background_command(void)
+{
+	background_command *bc = (background_command*)background_commands->data;
+
+#ifdef DEBUG_OUTPUT
+	dbg_cbs->send_message(bc->command, "red");
+#endif
+
+	gdb_input_write_line(bc->command);
+	background_id = g_io_add_watch(gdb_ch_out, G_IO_IN, on_read_background_output, NULL);
+}
+
+/*
+ * execute "command" in background while the target is stopped,
+ * "callback" is called with the result from the main loop.
+ * Commands are executed one by one, any synchronous or asyncronous command
+ * waits for the background ones to complete
+ */
+static void exec_background_command(const gchar *command, background_callback callback, gpointer data)
+{
+	background_command *bc = g_malloc(sizeof(background_command));
+	bc->command = g_strdup(command);
+	bc->callback = callback;
+	bc->data = data;
+
+	/* the next command is started by the reader after a callback */
+	background_commands = g_list_append(background_commands, bc);
+	if (!background_commands->next && !background_completing)
+	{
+		start_background_command();
+	}
+}
+
+/*
+ * waits for the background commands to complete,
+ * the calltip evaluation is cancelled so that no more commands are queued
+ */
+static void cancel_calltip(void);
+static void finish_background_commands(void)
+{
+	cancel_calltip();
+
+	while (background_commands)
+	{
+		GList *lines;
+		gdb_mi_record *record;
+		result_class rc;
+
+		if (background_id)
+		{
+			/* the command is sent, read the rest of its output */
+			g_source_remove(background_id);
+			background_id = 0;
+		}
+		else
+		{
+			background_command *bc = (background_command*)background_commands->data;
+			gdb_input_write_line(bc->command);
+		}
+
+		lines = g_list_concat(background_lines, read_until_prompt());
+		background_lines = NULL;
+
+		rc = parse_command_output(lines, &record);
+		g_list_foreach(lines, (GFunc)g_free, NULL);
+		g_list_free(lines);
+
+		complete_background_command(rc, record);
+		gdb_mi_record_free(record);
+	}
+}
+
+/*
+ * drops background commands without executing them, used when GDB has exited
+ */
+static void clear_background_commands(void)
+{
+	cancel_calltip();
+
+	if (background_id)
+	{
+		g_source_remove(background_id);
+		background_id = 0;
+	}
+
+	g_list_foreach(background_lines, (GFunc)g_free, NULL);
+	g_list_free(background_lines);
+	background_lines = NULL;
+
+	/* callbacks free their data */
+	while (background_commands)
+	{
+		complete_background_command(RC_EXIT, NULL);
+	}
+
+	if (calltip_vars)
+	{
+		g_hash_table_destroy(calltip_vars);
+		calltip_vars = NULL;
+	}
+}
+
 /*
  * starts gdb, collects commands and start the first one
  */
@@ -953,45 +1161,25 @@ static void execute_until(const gchar *file, int line)
  */
 static int get_break_number(char* file, int line)
 {
-	gchar *record, *bstart;
+	gdb_mi_record *record;
+	const gdb_mi_value *bkpt;
+	gchar *location = g_strdup_printf("\"%s\":%i", file, line);
+	int number = -1;
 
 	exec_sync_command("-break-list", TRUE, &record);
-	bstart = record;
+	bkpt = record ? gdb_mi_value_get_path(record->first, "BreakpointTable/body") : NULL;
 
-	while ( (bstart = strstr(bstart, "bkpt=")) )
+	for (bkpt = bkpt ? bkpt->children : NULL; bkpt && -1 == number; bkpt = bkpt->next)
 	{
-		gchar *fname, *file_quoted;
-		int num, bline;
-		gboolean break_found;
-
-		bstart += strlen("bkpt={number=\"");
-		*strchr(bstart, '\"') = '\0';
-		num = atoi(bstart);
-		
-		bstart += strlen(bstart) + 1;
-		bstart = strstr(bstart, "original-location=\"") + strlen("original-location=\"");
-		*strchr(bstart, ':') = '\0';
-		fname = bstart;
-		
-		bstart += strlen(bstart) + 1;
-		*strchr(bstart, '\"') = '\0';
-		bline = atoi(bstart);
-		
-		file_quoted = g_strdup_printf("\\\"%s\\\"", file);
-		break_found = !strcmp(fname, file_quoted) && bline == line;
-		g_free(file_quoted);
+		const gchar *original = gdb_mi_value_get_string(bkpt->children, "original-location");
+		if (original && !strcmp(original, location))
+			number = get_int(bkpt->children, "number");
+	}
 
-		if (break_found)
-		{
-			return num;
-		}
-		
-		bstart += strlen(bstart) + 1;
-	} 
-	
-	free(record);
+	g_free(location);
+	gdb_mi_record_free(record);
 	
-	return -1;
+	return number;
 }
 
 /*
@@ -1004,27 +1192,26 @@ static gboolean set_break(breakpoint* bp, break_set_activity bsa)
 	{
 		/* new breakpoint */
 
-		char *pos;
 		int number;
-		gchar *record = NULL;
+		gdb_mi_record *record = NULL;
+		const gchar *bkpt_number;
 
 		/* 1. insert breakpoint */
 		sprintf (command, "-break-insert \"\\\"%s\\\":%i\"", bp->file, bp->line);
 		if (RC_DONE != exec_sync_command(command, TRUE, &record))
 		{
-			g_free(record);
+			gdb_mi_record_free(record);
 			sprintf (command, "-break-insert -f \"\\\"%s\\\":%i\"", bp->file, bp->line);
 			if (RC_DONE != exec_sync_command(command, TRUE, &record))
 			{
-				g_free(record);
+				gdb_mi_record_free(record);
 				return FALSE;
 			}
 		}
 		/* lookup break-number */
-		pos = strstr(record, "number=\"") + strlen("number=\"");
-		*strchr(pos, '\"') = '\0';
-		number = atoi(pos);
-		g_free(record);
+		bkpt_number = gdb_mi_value_get_path_string(record->first, "bkpt/number");
+		number = bkpt_number ? atoi(bkpt_number) : 0;
+		gdb_mi_record_free(record);
 		/* 2. set hits count if differs from 0 */
 		if (bp->hitscount)
 		{
@@ -1111,108 +1298,64 @@ static void set_active_frame(int frame_number)
 }
 
 /*
- * gets stack
+ * gets count stack frames starting from the frame number first
  */
-static GList* get_stack(void)
+static GList* get_stack(int first, int count)
 {
-	gchar* record = NULL;
+	gdb_mi_record *record = NULL;
+	const gdb_mi_value *value;
 	GList *stack = NULL;
-	gchar **frames, **next;
 	result_class rc;
+	gchar command[100];
 
-	rc = exec_sync_command("-stack-list-frames", TRUE, &record);
+	sprintf(command, "-stack-list-frames %i %i", first, first + count - 1);
+	rc = exec_sync_command(command, TRUE, &record);
 	if (RC_DONE != rc)
+	{
+		gdb_mi_record_free(record);
 		return NULL;
+	}
 
-	frames = g_strsplit(record, "frame=", 0);
-	next = frames + 1;
-	while (*next)
+	value = gdb_mi_record_get(record, "stack");
+	for (value = value ? value->children : NULL; value; value = value->next)
 	{
 		frame *f = frame_new();
-		int line;
-		gchar *pos, *fullname, *file, *from;
-		
-		/* adresss */
-		pos = strstr(*next, "addr=\"") + strlen("addr=\"");
-		*strchr(pos, '\"') = '\0';
-		f->address = g_strdup(pos);
-		pos += strlen(pos) + 1;
-
-		/* function */
-		pos = strstr(pos, "func=\"") + strlen("func=\"");
-		*strchr(pos, '\"') = '\0';
-		f->function = g_strdup(pos);
-		pos += strlen(pos) + 1;
+		const gdb_mi_value *fields = value->children;
+		const gchar *address = gdb_mi_value_get_string(fields, "addr");
+		const gchar *function = gdb_mi_value_get_string(fields, "func");
+		const gchar *fullname = gdb_mi_value_get_string(fields, "fullname");
+		const gchar *file = gdb_mi_value_get_string(fields, "file");
+		const gchar *from = gdb_mi_value_get_string(fields, "from");
+
+		f->address = g_strdup(address ? address : "");
+		f->function = g_strdup(function ? function : "");
 
 		/* file: fullname | file | from */
-		fullname = strstr(pos, "fullname=\"");
-		file = strstr(pos, "file=\"");
-		from = strstr(pos, "from=\"");
-		
-		if (fullname)
-		{
-			fullname += strlen("fullname=\"");
-			pos = fullname;
-			*strchr(pos, '\"') = '\0';
-			f->file = g_strdup(pos);
-			pos += strlen(pos) + 1;
-		}
-		else if (file)
-		{
-			file += strlen("file=\"");
-			pos = file;
-			*strchr(pos, '\"') = '\0';
-			f->file = g_strdup(pos);
-			pos += strlen(pos) + 1;
-		}
-		else if (from)
-		{
-			from += strlen("from=\"");
-			pos = from;
-			*strchr(pos, '\"') = '\0';
-			f->file = g_strdup(pos);
-			pos += strlen(pos) + 1;
-		}
-		else
-		{
-			f->file = g_strdup("");
-		}
+		f->file = g_strdup(fullname ? fullname : file ? file : from ? from : "");
 		
 		/* whether source is available */
 		f->have_source = fullname ? TRUE : FALSE;
 
 		/* line */
-		line = 0;
-		pos = strstr(pos, "line=\"");
-		if (pos)
-		{
-			pos += strlen("line=\"");
-			*strchr(pos, '\"') = '\0';
-			line = atoi(pos);
-			pos += strlen(pos) + 1;
-		}
-		f->line = line;
+		f->line = get_int(fields, "line");
 
-		stack = g_list_append(stack, f);
-
-		next++;
+		stack = g_list_prepend(stack, f);
 	}
-	g_strfreev(frames);	
 	
-	free(record);
+	gdb_mi_record_free(record);
 	
-	return stack;
+	return g_list_reverse(stack);
 }
 
 /*
  * unescapes hex values (\0xXXX) to readable chars
  * converting it from wide character value to char
  */
-static gchar* unescape_hex_values(gchar *src)
+static gchar* unescape_hex_values(const gchar *src)
 {
 	GString *dest = g_string_new("");
 	
-	gchar *slash;
+	const gchar *slash;
 	while ( (slash = strstr(src, "\\x")) )
 	{
 		char hex[4] = { 0, 0, 0, '\0' };
@@ -1259,7 +1402,7 @@ static gchar* unescape_hex_values(gchar *src)
  * checks if pc pointer points to the 
  * valid printable charater
  */
-static gboolean isvalidcharacter(gchar *pc, gboolean utf8)
+static gboolean isvalidcharacter(const gchar *pc, gboolean utf8)
 {
 	if (utf8)
 		return -1 != g_utf8_get_char_validated(pc, -1);
@@ -1270,14 +1413,13 @@ static gboolean isvalidcharacter(gchar *pc, gboolean utf8)
 /*
  * unescapes string, handles octal characters representations
  */
-static gchar* unescape_octal_values(gchar *text)
+static gchar* unescape_octal_values(const gchar *text)
 {
 	GString *value = g_string_new("");
 	
 	gboolean utf8 = g_str_has_suffix(getenv("LANG"), "UTF-8");
 
-	gchar *tmp = g_strdup(text);
-	gchar *unescaped = g_strcompress(tmp);
+	gchar *unescaped = g_strcompress(text);
 
 	gchar *pos = unescaped;
 	while (*pos)
@@ -1313,34 +1455,42 @@ static gchar* unescape_octal_values(gchar *text)
 		}
 	}
 
-	g_free(tmp);
+	g_free(unescaped);
 
 	return g_string_free (value, FALSE);
 }
 
 /*
- * unescapes value string, handles hexidecimal and octal characters representations
+ * unescapes value string, handles hexidecimal and octal characters representations;
+ * the MI quoting is already removed by the record parser
  */
-static gchar *unescape(gchar *text)
+static gchar *unescape(const gchar *text)
 {
-	gchar *retval = NULL;
-
-	/* create string copy */
-	gchar *value = g_strdup(text);
-
-	/* make first unescaping */
-	gchar *tmp = g_strcompress(value);
-
-	/* make first unescaping */
-	if (strstr(tmp, "\\x"))
-		retval = unescape_hex_values(tmp);
+	if (!text)
+		return g_strdup("");
+	if (strstr(text, "\\x"))
+		return unescape_hex_values(text);
 	else
-		retval = unescape_octal_values(tmp);
+		return unescape_octal_values(text);
+}
+
+/*
+ * executes command and returns a copy of the string field name
+ * of the result record, NULL if there is no such field
+ */
+static gchar *get_result_string(const gchar *command, const gchar *name)
+{
+	gdb_mi_record *record;
+	gchar *value = NULL;
 
-	g_free(tmp);
-	g_free(value);
+	exec_sync_command(command, TRUE, &record);
+	if (record)
+	{
+		value = g_strdup(gdb_mi_record_get_string(record, name));
+		gdb_mi_record_free(record);
+	}
 
-	return retval;
+	return value;
 }
 
 /*
@@ -1355,56 +1505,42 @@ static void get_variables (GList *vars)
 		variable *var = (variable*)vars->data;
 
 		gchar *varname = var->internal->str;
-		gchar *record = NULL;
-		gchar *pos;
+		gchar *field;
 		gchar *expression;
-		int numchild;
 		gchar *value;
 
 		/* path expression */
 		sprintf(command, "-var-info-path-expression \"%s\"", varname);
-		exec_sync_command(command, TRUE, &record);
-		pos = strstr(record, "path_expr=\"") + strlen("path_expr=\"");
-		*(strrchr(pos, '\"')) = '\0';
-		expression = unescape(pos);
+		field = get_result_string(command, "path_expr");
+		expression = unescape(field);
 		g_string_assign(var->expression, expression);
 		g_free(expression);
-		g_free(record);
+		g_free(field);
 		
 		/* children number */
 		sprintf(command, "-var-info-num-children \"%s\"", varname);
-		exec_sync_command(command, TRUE, &record);
-		pos = strstr(record, "numchild=\"") + strlen("numchild=\"");
-		*(strchr(pos, '\"')) = '\0';
-		numchild = atoi(pos);
-		var->has_children = numchild > 0;
-		g_free(record);
+		field = get_result_string(command, "numchild");
+		var->has_children = field && atoi(field) > 0;
+		g_free(field);
 
 		/* value */
 		sprintf(command, "-data-evaluate-expression \"%s\"", var->expression->str);
-		exec_sync_command(command, TRUE, &record);
-		pos = strstr(record, "value=\"");
-		if (!pos)
+		field = get_result_string(command, "value");
+		if (!field)
 		{
-			g_free(record);
 			sprintf(command, "-var-evaluate-expression \"%s\"", varname);
-			exec_sync_command(command, TRUE, &record);
-			pos = strstr(record, "value=\"");
+			field = get_result_string(command, "value");
 		}
-		pos +=  + strlen("value=\"");
-		*(strrchr(pos, '\"')) = '\0';
-		value = unescape(pos);
+		value = unescape(field);
 		g_string_assign(var->value, value);
 		g_free(value);
-		g_free(record);
+		g_free(field);
 
 		/* type */
 		sprintf(command, "-var-info-type \"%s\"", varname);
-		exec_sync_command(command, TRUE, &record);
-		pos = strstr(record, "type=\"") + strlen("type=\"");
-		*(strchr(pos, '\"')) = '\0';
-		g_string_assign(var->type, pos);
-		g_free(record);
+		field = get_result_string(command, "type");
+		g_string_assign(var->type, field ? field : "");
+		g_free(field);
 
 		vars = vars->next;
 	}
@@ -1416,8 +1552,8 @@ static void get_variables (GList *vars)
 static void update_files(void)
 {
 	GHashTable *ht = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, NULL);
-	gchar *record = NULL;
-	gchar *pos;
+	gdb_mi_record *record = NULL;
+	const gdb_mi_value *value;
 
 	if (files)
 	{
@@ -1428,22 +1564,21 @@ static void update_files(void)
 	}
 
 	exec_sync_command("-file-list-exec-source-files", TRUE, &record);
-	pos = record;
-	while ( (pos = strstr(pos, "fullname=\"")) )
+	value = record ? gdb_mi_record_get(record, "files") : NULL;
+	for (value = value ? value->children : NULL; value; value = value->next)
 	{
-		pos += strlen("fullname=\"");
-		*(strchr(pos, '\"')) = '\0';
-		if (!g_hash_table_lookup(ht, pos))
+		const gchar *fullname = gdb_mi_value_get_string(value->children, "fullname");
+		if (fullname && !g_hash_table_lookup(ht, fullname))
 		{
-			g_hash_table_insert(ht, (gpointer)pos, (gpointer)1);
-			files = g_list_append(files, g_strdup(pos));
+			g_hash_table_insert(ht, (gpointer)fullname, (gpointer)1);
+			files = g_list_prepend(files, g_strdup(fullname));
 		}
-			
-		pos += strlen(pos) + 1;
 	}
+	files = g_list_reverse(files);
+	files_changed_flag = TRUE;
 
 	g_hash_table_destroy(ht);
-	g_free(record);
+	gdb_mi_record_free(record);
 }
 
 /*
@@ -1475,8 +1610,8 @@ static void update_watches(void)
 	for (iter = watches; iter; iter = iter->next)
 	{
 		variable *var = (variable*)iter->data;
-		gchar *record = NULL;
-		gchar *pos;
+		gdb_mi_record *record = NULL;
+		const gchar *name;
 		gchar *escaped;
 
 		/* try to create variable */
@@ -1484,21 +1619,20 @@ static void update_watches(void)
 		sprintf(command, "-var-create - * \"%s\"", escaped);
 		g_free(escaped);
 
-		if (RC_DONE != exec_sync_command(command, TRUE, &record))
+		if (RC_DONE != exec_sync_command(command, TRUE, &record) ||
+			!(name = gdb_mi_record_get_string(record, "name")))
 		{
 			/* do not include to updating list, move to next watch */
 			var->evaluated = FALSE;
 			g_string_assign(var->internal, "");
-			g_free(record);
+			gdb_mi_record_free(record);
 			
 			continue;
 		}
 		
-		/* find and assign internal name */
-		pos = strstr(record, "name=\"") + strlen("name=\"");
-		*strchr(pos, '\"') = '\0'; 
-		g_string_assign(var->internal, pos);
-		g_free(record);			
+		/* assign internal name */
+		g_string_assign(var->internal, name);
+		gdb_mi_record_free(record);
 		
 		var->evaluated = TRUE;
 
@@ -1542,38 +1676,50 @@ static void update_autos(void)
 	gdb_commands[1] = "-stack-list-locals 0";
 	for (i = 0; i < sizeof (gdb_commands) / sizeof(*gdb_commands); i++)
 	{
-		gchar *record = NULL, *pos;
+		gdb_mi_record *record = NULL;
+		const gdb_mi_value *value;
 
 		result_class rc = exec_sync_command(gdb_commands[i], TRUE, &record);
 		if (RC_DONE != rc)
+		{
+			gdb_mi_record_free(record);
 			break;
+		}
 
-		pos = record;
-		while ((pos = strstr(pos, "name=\"")))
+		if (i)
+			value = gdb_mi_record_get(record, "locals");
+		else
+			value = gdb_mi_value_get_path(record->first, "stack-args/frame/args");
+
+		for (value = value ? value->children : NULL; value; value = value->next)
 		{
 			variable *var;
-			gchar *create_record = NULL, *escaped;
+			gdb_mi_record *create_record = NULL;
+			const gchar *name, *intname;
+			gchar *escaped;
 
-			pos += strlen("name=\"");
-			*(strchr(pos, '\"')) = '\0';
+			/* name="x" or {name="x",...}, depending on the print values argument */
+			if (GDB_MI_VAL_TUPLE == value->type)
+				name = gdb_mi_value_get_string(value->children, "name");
+			else
+				name = value->name && !strcmp(value->name, "name") ? value->string : NULL;
+			if (!name)
+				continue;
 
-			var = variable_new(pos, i ? VT_LOCAL : VT_ARGUMENT);
+			var = variable_new((gchar*)name, i ? VT_LOCAL : VT_ARGUMENT);
 
 			/* create new gdb variable */
-			escaped = g_strescape(pos, NULL);
+			escaped = g_strescape(name, NULL);
 			sprintf(command, "-var-create - * \"%s\"", escaped);
 			g_free(escaped);
 
 			/* form new variable */
-			if (RC_DONE == exec_sync_command(command, TRUE, &create_record))
+			if (RC_DONE == exec_sync_command(command, TRUE, &create_record) &&
+				(intname = gdb_mi_record_get_string(create_record, "name")))
 			{
-				gchar *intname = strstr(create_record, "name=\"") + strlen ("name=\"");
-				*strchr(intname, '\"') = '\0';
 				var->evaluated = TRUE;
 				g_string_assign(var->internal, intname);
 				autos = g_list_append(autos, var);
-
-				g_free(create_record);
 			}
 			else
 			{
@@ -1581,10 +1727,10 @@ static void update_autos(void)
 				g_string_assign(var->internal, "");
 				unevaluated = g_list_append(unevaluated, var);
 			}
-			
-			pos += strlen(pos) + 1;
+
+			gdb_mi_record_free(create_record);
 		}
-		g_free(record);
+		gdb_mi_record_free(record);
 	}
 	g_free((void*)gdb_commands[0]);
 	
@@ -1616,9 +1762,18 @@ static GList* get_watches (void)
  */
 static GList* get_files (void)
 {
+	files_changed_flag = FALSE;
 	return g_list_copy(files);
 }
 
+/*
+ * checks whether files list has changed since the last get_files call
+ */
+static gboolean files_changed (void)
+{
+	return files_changed_flag;
+}
+
 /*
  * get list of children 
  */
@@ -1628,56 +1783,43 @@ static GList* get_children (gchar* path)
 	
 	gchar command[1000];
 	result_class rc;
-	gchar *record = NULL;
-	gchar *pos = NULL;
-	int numchild;
+	gdb_mi_record *record = NULL;
+	const gdb_mi_value *value;
+	gchar *numchild;
 
 	/* children number */
 	sprintf(command, "-var-info-num-children \"%s\"", path);
-	rc = exec_sync_command(command, TRUE, &record);
-	if (RC_DONE != rc)
-		return NULL;
-	pos = strstr(record, "numchild=\"") + strlen("numchild=\"");
-	*(strchr(pos, '\"')) = '\0';
-	numchild = atoi(pos);
-	g_free(record);
-	if (!numchild)
+	numchild = get_result_string(command, "numchild");
+	if (!numchild || !atoi(numchild))
+	{
+		g_free(numchild);
 		return NULL;
+	}
+	g_free(numchild);
 	
 	/* recursive get children and put into list */
 	sprintf(command, "-var-list-children \"%s\"", path);
 	rc = exec_sync_command(command, TRUE, &record);
 	if (RC_DONE == rc)
 	{
-		pos = record;
-		while ( (pos = strstr(pos, "child={")) )
+		value = gdb_mi_record_get(record, "children");
+		for (value = value ? value->children : NULL; value; value = value->next)
 		{
-			gchar *name, *internal;
+			const gchar *internal = gdb_mi_value_get_string(value->children, "name");
+			const gchar *name = gdb_mi_value_get_string(value->children, "exp");
 			variable *var;
+
+			if (!internal || !name)
+				continue;
 			
-			/* name */
-			pos = strstr(pos, "name=\"") + strlen("name=\"");
-			*(strstr(pos, "\",exp=\"")) = '\0';
-			internal = pos;
-			pos += strlen(pos) + 1;
-
-			/* exp */
-			pos = strstr(pos, "exp=\"") + strlen("exp=\"");
-			*(strstr(pos, "\",numchild=\"")) = '\0';
-			
-			name = g_strcompress(pos);
-			
-			var = variable_new2(name, internal, VT_CHILD);
+			var = variable_new2((gchar*)name, (gchar*)internal, VT_CHILD);
 			var->evaluated = TRUE;
 			
-			pos += strlen(pos) + 1;
-
-			children = g_list_append(children, var);
-		
-			g_free(name);
+			children = g_list_prepend(children, var);
 		}
+		children = g_list_reverse(children);
 	}
-	g_free(record);
+	gdb_mi_record_free(record);
 	
 	get_variables(children);
 
@@ -1690,7 +1832,9 @@ static GList* get_children (gchar* path)
 static variable* add_watch(gchar* expression)
 {
 	gchar command[1000];
-	gchar *record = NULL, *escaped, *pos;
+	gdb_mi_record *record = NULL;
+	gchar *escaped;
+	const gchar *name;
 	GList *vars = NULL;
 	variable *var = variable_new(expression, VT_WATCH);
 
@@ -1701,21 +1845,20 @@ static variable* add_watch(gchar* expression)
 	sprintf(command, "-var-create - * \"%s\"", escaped);
 	g_free(escaped);
 
-	if (RC_DONE != exec_sync_command(command, TRUE, &record))
+	if (RC_DONE != exec_sync_command(command, TRUE, &record) ||
+		!(name = gdb_mi_record_get_string(record, "name")))
 	{
-		g_free(record);
+		gdb_mi_record_free(record);
 		return var;
 	}
 	
-	pos = strstr(record, "name=\"") + strlen("name=\"");
-	*strchr(pos, '\"') = '\0'; 
-	g_string_assign(var->internal, pos);
+	g_string_assign(var->internal, name);
 	var->evaluated = TRUE;
+	gdb_mi_record_free(record);
 
 	vars = g_list_append(NULL, var);
 	get_variables(vars);
 
-	g_free(record);
 	g_list_free(vars);
 
 	return var;	
@@ -1747,23 +1890,281 @@ static void remove_watch(gchar* internal)
  */
 static gchar *evaluate_expression(gchar *expression)
 {
-	gchar *record = NULL, *pos;
+	gdb_mi_record *record = NULL;
+	const gchar *value;
+	gchar *result = NULL;
 	char command[1000];
 	result_class rc;
 
 	sprintf (command, "-data-evaluate-expression \"%s\"", expression);
 	rc = exec_sync_command(command, TRUE, &record);
 	
-	if (RC_DONE != rc)
+	if (RC_DONE == rc && (value = gdb_mi_record_get_string(record, "value")))
+		result = unescape(value);
+
+	gdb_mi_record_free(record);
+
+	return result;
+}
+
+/*
+ * deletes a calltip GDB variable in background
+ */
+static void delete_calltip_var(gpointer expression, gpointer name, gpointer data)
+{
+	gchar *command = g_strdup_printf("-var-delete %s", (gchar*)name);
+	exec_background_command(command, NULL, NULL);
+	g_free(command);
+}
+
+/*
+ * remembers a calltip GDB variable,
+ * all of them are deleted when there are too many
+ */
+static void add_calltip_var(const gchar *expression, const gchar *name)
+{
+	gchar *previous;
+
+	if (!calltip_vars)
 	{
-		g_free(record);
-		return NULL;
+		calltip_vars = g_hash_table_new_full(g_str_hash, g_str_equal, (GDestroyNotify)g_free, (GDestroyNotify)g_free);
+	}
+	else if (g_hash_table_size(calltip_vars) >= MAX_CALLTIP_VARS)
+	{
+		g_hash_table_foreach(calltip_vars, delete_calltip_var, NULL);
+		g_hash_table_remove_all(calltip_vars);
+	}
+
+	/* a variable created for a cancelled calltip */
+	if ((previous = g_hash_table_lookup(calltip_vars, expression)))
+	{
+		delete_calltip_var(NULL, previous, NULL);
 	}
 
-	pos = strstr(record, "value=\"") + strlen("value=\"");
-	*(strrchr(pos, '\"')) = '\0';
+	g_hash_table_insert(calltip_vars, g_strdup(expression), g_strdup(name));
+}
+
+/*
+ * frees a calltip request, clearing the current one
+ */
+static void free_calltip_request(calltip_request *request)
+{
+	if (current_calltip == request)
+	{
+		current_calltip = NULL;
+	}
+
+	g_free(request->expression);
+	if (request->var)
+	{
+		variable_free(request->var);
+	}
+	g_free(request);
+}
 
-	return unescape(pos);
+/*
+ * children of a calltip variable have been listed
+ */
+static void list_calltip_children(calltip_request *request);
+static void on_calltip_children(result_class rc, gdb_mi_record *record, gpointer data)
+{
+	calltip_request *request = (calltip_request*)data;
+
+	if (!request->cancelled)
+	{
+		GList *children = NULL;
+		const gdb_mi_value *value;
+		const gchar *has_more;
+		int count = 0;
+		gboolean more;
+
+		if (RC_ERROR == rc && request->ranged)
+		{
+			/* GDB versions before 7.1 don't take a range of children */
+			request->ranged = FALSE;
+			list_calltip_children(request);
+			return;
+		}
+
+		value = RC_DONE == rc ? gdb_mi_record_get(record, "children") : NULL;
+		for (value = value ? value->children : NULL; value && count < request->max_children; value = value->next)
+		{
+			const gchar *internal = gdb_mi_value_get_string(value->children, "name");
+			const gchar *name = gdb_mi_value_get_string(value->children, "exp");
+			const gchar *numchild = gdb_mi_value_get_string(value->children, "numchild");
+			const gchar *type = gdb_mi_value_get_string(value->children, "type");
+			gchar *unescaped;
+			variable *var;
+
+			if (!internal || !name)
+				continue;
+
+			var = variable_new2((gchar*)name, (gchar*)internal, VT_CHILD);
+			var->evaluated = TRUE;
+			var->has_children = numchild && atoi(numchild) > 0;
+			g_string_assign(var->type, type ? type : "");
+
+			unescaped = unescape(gdb_mi_value_get_string(value->children, "value"));
+			g_string_assign(var->value, unescaped);
+			g_free(unescaped);
+
+			children = g_list_prepend(children, var);
+			count++;
+		}
+		children = g_list_reverse(children);
+
+		/* dynamic variables tell about more children with "has_more" */
+		has_more = RC_DONE == rc ? gdb_mi_record_get_string(record, "has_more") : NULL;
+		more = value || request->numchild > count || (has_more && atoi(has_more));
+		request->callback(request->expression, CS_EVALUATED, request->var, children, more);
+
+		g_list_foreach(children, (GFunc)variable_free, NULL);
+		g_list_free(children);
+	}
+
+	free_calltip_request(request);
+}
+
+/*
+ * requests the first children of a calltip variable
+ */
+static void list_calltip_children(calltip_request *request)
+{
+	gchar *command = request->ranged ?
+		g_strdup_printf("-var-list-children --all-values %s 0 %i", request->var->internal->str, request->max_children) :
+		g_strdup_printf("-var-list-children --all-values %s", request->var->internal->str);
+	exec_background_command(command, on_calltip_children, request);
+	g_free(command);
+}
+
+/*
+ * a calltip variable has been created
+ */
+static void on_calltip_created(result_class rc, gdb_mi_record *record, gpointer data)
+{
+	calltip_request *request = (calltip_request*)data;
+	const gchar *name = RC_DONE == rc ? gdb_mi_record_get_string(record, "name") : NULL;
+
+	if (name)
+	{
+		add_calltip_var(request->expression, name);
+
+		if (!request->cancelled)
+		{
+			const gchar *numchild = gdb_mi_record_get_string(record, "numchild");
+			const gchar *type = gdb_mi_record_get_string(record, "type");
+			gchar *unescaped = unescape(gdb_mi_record_get_string(record, "value"));
+
+			request->var = variable_new2(request->expression, (gchar*)name, VT_WATCH);
+			request->var->evaluated = TRUE;
+			g_string_assign(request->var->type, type ? type : "");
+			g_string_assign(request->var->value, unescaped);
+			g_free(unescaped);
+
+			request->numchild = numchild ? atoi(numchild) : 0;
+			request->var->has_children = request->numchild > 0;
+
+			if (request->var->has_children && request->max_children)
+			{
+				list_calltip_children(request);
+				return;
+			}
+
+			request->callback(request->expression, CS_EVALUATED, request->var, NULL, request->var->has_children);
+		}
+	}
+	else if (!request->cancelled)
+	{
+		request->callback(request->expression, CS_ERROR, NULL, NULL, FALSE);
+	}
+
+	free_calltip_request(request);
+}
+
+/*
+ * creates a calltip variable anew, deleting the previous one if exists
+ */
+static void create_calltip_var(calltip_request *request)
+{
+	gchar *name, *escaped, *command;
+
+	if (calltip_vars && (name = g_hash_table_lookup(calltip_vars, request->expression)))
+	{
+		delete_calltip_var(NULL, name, NULL);
+		g_hash_table_remove(calltip_vars, request->expression);
+	}
+
+	/* floating variable, it is evaluated in the current frame on every update */
+	escaped = g_strescape(request->expression, NULL);
+	command = g_strdup_printf("-var-create - @ \"%s\"", escaped);
+	exec_background_command(command, on_calltip_created, request);
+	g_free(command);
+	g_free(escaped);
+}
+
+/*
+ * a calltip variable has been updated, an empty change list means
+ * that the calltip hasn't changed
+ */
+static void on_calltip_updated(result_class rc, gdb_mi_record *record, gpointer data)
+{
+	calltip_request *request = (calltip_request*)data;
+
+	if (!request->cancelled)
+	{
+		const gdb_mi_value *changes = RC_DONE == rc ? gdb_mi_record_get(record, "changelist") : NULL;
+		if (!changes || changes->children)
+		{
+			create_calltip_var(request);
+			return;
+		}
+
+		request->callback(request->expression, CS_UNCHANGED, NULL, NULL, FALSE);
+	}
+
+	free_calltip_request(request);
+}
+
+/*
+ * starts calltip evaluation in background, the previous one is cancelled.
+ * If "cached" is set, the calltip variable is only checked for changes if exists.
+ */
+static void request_calltip(const gchar *expression, gboolean cached, int max_children, calltip_callback callback)
+{
+	calltip_request *request;
+	gchar *name;
+
+	cancel_calltip();
+
+	request = g_malloc0(sizeof(calltip_request));
+	request->expression = g_strdup(expression);
+	request->max_children = max_children;
+	request->callback = callback;
+	request->ranged = TRUE;
+	current_calltip = request;
+
+	if (cached && calltip_vars && (name = g_hash_table_lookup(calltip_vars, expression)))
+	{
+		gchar *command = g_strdup_printf("-var-update --all-values %s", name);
+		exec_background_command(command, on_calltip_updated, request);
+		g_free(command);
+	}
+	else
+	{
+		create_calltip_var(request);
+	}
+}
+
+/*
+ * cancels calltip evaluation, the callback won't be called
+ */
+static void cancel_calltip(void)
+{
+	if (current_calltip)
+	{
+		current_calltip->cancelled = TRUE;
+		current_calltip = NULL;
+	}
 }
 
 /*
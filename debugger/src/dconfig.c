@@ -24,6 +24,7 @@
  *		Plugin panel and debug session configs
  */
  
+#include <string.h>
 #include <unistd.h>
 #include <sys/stat.h>
 
@@ -43,22 +44,28 @@ extern GeanyData *geany_data;
 #include "wtree.h"
 #include "tpage.h"
 #include "bptree.h"
+#include "journal.h"
 
 /* keyfile debug group name */
 #define DEBUGGER_GROUP "debugger"
-/* saving interval */
-#define SAVING_INTERVAL 2000000
+/* saving interval (milliseconds) */
+#define SAVING_INTERVAL 2000
 
 /* check button for a configure dialog */
 static GtkWidget *save_to_project_btn = NULL;
 
-/* plugin config file path */
+/* plugin config directory and file path */
+static gchar *config_dir = NULL;
 static gchar *plugin_config_path = NULL;
 
 /* current debug session store */
 static debug_store dstore = DEBUG_STORE_PLUGIN;
 
-/* GKeyFile's for a project and plugin config */
+/* journals for a project and plugin config, changes are written on their own threads */
+static journal *journal_plugin = NULL;
+static journal *journal_project = NULL;
+
+/* GKeyFile's for a project and plugin config (owned by the journals) */
 static GKeyFile *keyfile_plugin = NULL;
 static GKeyFile *keyfile_project = NULL;
 
@@ -66,32 +73,15 @@ static GKeyFile *keyfile_project = NULL;
  * to prevent change state to modified from GUI callbacks */
 static gboolean debug_config_loading = FALSE;
 
-/* saving thread staff */
-static GMutex *change_config_mutex;
-static GCond *cond;
-static GThread *saving_thread;
-
-/* flags that indicate that part of a config has been changed and
- * is going to be saved on the savng thread */
-static gboolean debug_config_changed = FALSE;
-static gboolean panel_config_changed = FALSE;
-
-/*
- *	creates a copy of a specified keyfile
- */
-static GKeyFile *create_copy_keyfile(GKeyFile *keyfile)
-{
-	GKeyFile *copy;
-	gchar *data;
-	gsize length;
+/* saving timer source */
+static guint saving_source = 0;
 
-	data = g_key_file_to_data(keyfile, &length, NULL);
-	copy = g_key_file_new();
-	g_key_file_load_from_data(copy, data, length, G_KEY_FILE_NONE, NULL);
-	g_free(data);
+/* source that tells the project journal Geany has written the project file */
+static guint project_saved_source = 0;
 
-	return copy;
-}
+/* flag that indicates that debug session has been changed and
+ * is going to be saved on the saving timer */
+static gboolean debug_config_changed = FALSE;
 
 /*
  * loads debug session from a keyfile and updates GUI 
@@ -175,22 +165,35 @@ static void debug_load_from_keyfile(GKeyFile *keyfile)
 }
 
 /*
- * saves debug session to a keyfile using values from GUI 
+ * removes keys of the items from count up to previous_count
  */
-static void save_to_keyfile(GKeyFile *keyfile)
+static void remove_stale_keys(journal *j, const gchar *format, int count, int previous_count)
 {
+	int i;
+	for (i = count; i < previous_count; i++)
+	{
+		gchar *id = g_strdup_printf(format, i);
+		journal_remove_key(j, DEBUGGER_GROUP, id);
+		g_free(id);
+	}
+}
+
+/*
+ * saves debug session to a journal using values from GUI,
+ * only the values changed are written
+ */
+static void save_to_journal(journal *j)
+{
+	GKeyFile *keyfile = journal_get_keyfile(j);
 	GList *_env, *watches, *_breaks, *iter;
-	int env_index, watch_index, bp_index;
+	int env_index, watch_index, bp_index, previous_count;
 	
-	g_key_file_remove_group(keyfile, DEBUGGER_GROUP, NULL);
-	
-	g_key_file_set_string(keyfile, DEBUGGER_GROUP, "target", tpage_get_target());
-	g_key_file_set_string(keyfile, DEBUGGER_GROUP, "debugger", tpage_get_debugger());
-	g_key_file_set_string(keyfile, DEBUGGER_GROUP, "arguments", tpage_get_commandline());
+	journal_set_string(j, DEBUGGER_GROUP, "target", tpage_get_target());
+	journal_set_string(j, DEBUGGER_GROUP, "debugger", tpage_get_debugger());
+	journal_set_string(j, DEBUGGER_GROUP, "arguments", tpage_get_commandline());
 	
 	/* environment */
 	_env = tpage_get_environment();
-	g_key_file_set_integer(keyfile, DEBUGGER_GROUP, "envvar_count", g_list_length(_env) / 2);
 	iter = _env;
 	env_index = 0;
 	while(iter)
@@ -203,8 +206,8 @@ static void save_to_keyfile(GKeyFile *keyfile)
 		iter = iter->next;
 		value = (gchar*)iter->data;
 
-		g_key_file_set_string(keyfile, DEBUGGER_GROUP, env_name_id, name);
-		g_key_file_set_string(keyfile, DEBUGGER_GROUP, env_value_id, value);
+		journal_set_string(j, DEBUGGER_GROUP, env_name_id, name);
+		journal_set_string(j, DEBUGGER_GROUP, env_value_id, value);
 
 		g_free(env_name_id);
 		g_free(env_value_id);
@@ -214,17 +217,21 @@ static void save_to_keyfile(GKeyFile *keyfile)
 	}
 	g_list_foreach(_env, (GFunc)g_free, NULL);
 	g_list_free(_env);
+
+	previous_count = g_key_file_get_integer(keyfile, DEBUGGER_GROUP, "envvar_count", NULL);
+	remove_stale_keys(j, "envvar_%i_name", env_index, previous_count);
+	remove_stale_keys(j, "envvar_%i_value", env_index, previous_count);
+	journal_set_integer(j, DEBUGGER_GROUP, "envvar_count", env_index);
 	
 	/* watches */
 	watches = wtree_get_watches();
-	g_key_file_set_integer(keyfile, DEBUGGER_GROUP, "watches_count", g_list_length(watches));
 	watch_index = 0;
 	for (iter = watches; iter; iter = iter->next)
 	{
 		gchar *watch = (gchar*)iter->data;
 		gchar *watch_id = g_strdup_printf("watch_%i", watch_index);
 		
-		g_key_file_set_string(keyfile, DEBUGGER_GROUP, watch_id, watch);
+		journal_set_string(j, DEBUGGER_GROUP, watch_id, watch);
 
 		g_free(watch_id);
 
@@ -233,9 +240,12 @@ static void save_to_keyfile(GKeyFile *keyfile)
 	g_list_foreach(watches, (GFunc)g_free, NULL);
 	g_list_free(watches);
 
+	previous_count = g_key_file_get_integer(keyfile, DEBUGGER_GROUP, "watches_count", NULL);
+	remove_stale_keys(j, "watch_%i", watch_index, previous_count);
+	journal_set_integer(j, DEBUGGER_GROUP, "watches_count", watch_index);
+
 	/* breakpoints */
 	_breaks = breaks_get_all();
-	g_key_file_set_integer(keyfile, DEBUGGER_GROUP, "breaks_count", g_list_length(_breaks));
 	bp_index = 0;
 	for (iter = _breaks; iter; iter = iter->next)
 	{
@@ -247,11 +257,11 @@ static void save_to_keyfile(GKeyFile *keyfile)
 		gchar *break_hits_id = g_strdup_printf("break_%i_hits_count", bp_index);
 		gchar *break_enabled_id = g_strdup_printf("break_%i_enabled", bp_index);
 		
-		g_key_file_set_string(keyfile, DEBUGGER_GROUP, break_file_id, bp->file);
-		g_key_file_set_integer(keyfile, DEBUGGER_GROUP, break_line_id, bp->line);
-		g_key_file_set_string(keyfile, DEBUGGER_GROUP, break_condition_id, bp->condition);
-		g_key_file_set_integer(keyfile, DEBUGGER_GROUP, break_hits_id, bp->hitscount);
-		g_key_file_set_boolean(keyfile, DEBUGGER_GROUP, break_enabled_id, bp->enabled);
+		journal_set_string(j, DEBUGGER_GROUP, break_file_id, bp->file);
+		journal_set_integer(j, DEBUGGER_GROUP, break_line_id, bp->line);
+		journal_set_string(j, DEBUGGER_GROUP, break_condition_id, bp->condition);
+		journal_set_integer(j, DEBUGGER_GROUP, break_hits_id, bp->hitscount);
+		journal_set_boolean(j, DEBUGGER_GROUP, break_enabled_id, bp->enabled);
 		
 		g_free(break_file_id);
 		g_free(break_line_id);
@@ -262,75 +272,50 @@ static void save_to_keyfile(GKeyFile *keyfile)
 		bp_index++;
 	}
 	g_list_free(_breaks);
+
+	previous_count = g_key_file_get_integer(keyfile, DEBUGGER_GROUP, "breaks_count", NULL);
+	remove_stale_keys(j, "break_%i_file", bp_index, previous_count);
+	remove_stale_keys(j, "break_%i_line", bp_index, previous_count);
+	remove_stale_keys(j, "break_%i_condition", bp_index, previous_count);
+	remove_stale_keys(j, "break_%i_hits_count", bp_index, previous_count);
+	remove_stale_keys(j, "break_%i_enabled", bp_index, previous_count);
+	journal_set_integer(j, DEBUGGER_GROUP, "breaks_count", bp_index);
 }
 
 /*
- * function for config files background saving
+ * saves debug session if it has been changed,
+ * the journal of the current store is written on its own thread
  */
-static gpointer saving_thread_func(gpointer data)
+static void save_debug_changes(void)
 {
-	GTimeVal interval;
-	GMutex *m = g_mutex_new();
-	do
+	if (debug_config_changed)
 	{
-		g_mutex_lock(change_config_mutex);
-		
-		if (
-			panel_config_changed ||
-			(debug_config_changed && DEBUG_STORE_PLUGIN == dstore)
-		)
-		{
-			gchar *config_data;
-
-			/* if all saving is going to be done to a plugin keyfile */
-			if (debug_config_changed)
-			{
-				save_to_keyfile(keyfile_plugin);
-				debug_config_changed = FALSE;
-			}
-			
-			config_data = g_key_file_to_data(keyfile_plugin, NULL, NULL);
-			g_file_set_contents(plugin_config_path, config_data, -1, NULL);
-			g_free(config_data);
-
-			panel_config_changed = FALSE;
-		}
-		
-		if (debug_config_changed && DEBUG_STORE_PROJECT == dstore)
+		journal *j = DEBUG_STORE_PROJECT == dstore ? journal_project : journal_plugin;
+		if (j)
 		{
-			gchar *config_data;
-
-			/* if debug is saved into a project and has been changed */
-			save_to_keyfile(keyfile_project);
-
-			config_data = g_key_file_to_data(keyfile_project, NULL, NULL);
-			g_file_set_contents(geany_data->app->project->file_name, config_data, -1, NULL);
-			g_free(config_data);
-		
-			debug_config_changed = FALSE;
+			save_to_journal(j);
 		}
-		
-		g_mutex_unlock(change_config_mutex);
-
-		g_get_current_time(&interval);
-		g_time_val_add(&interval, SAVING_INTERVAL);
+		debug_config_changed = FALSE;
 	}
-	while (!g_cond_timed_wait(cond, m, &interval));
-	g_mutex_free(m);
-	
-	return NULL;
 }
 
 /*
- * set "debug changed" flag to save it on "saving_thread" thread
+ * saving timer function
+ */
+static gboolean on_saving_timer(gpointer data)
+{
+	save_debug_changes();
+	return TRUE;
+}
+
+/*
+ * set "debug changed" flag to save it on the saving timer
  */
 void config_set_debug_changed(void)
 {
 	if (!debug_config_loading)
 	{
-		g_mutex_lock(change_config_mutex);
 		debug_config_changed = TRUE;
-		g_mutex_unlock(change_config_mutex);
 	}
 }
 
@@ -341,8 +326,6 @@ void config_set_panel(int config_part, gpointer config_value, ...)
 {
 	va_list ap;
 	
-	g_mutex_lock(change_config_mutex);
-	
 	va_start(ap, config_value);
 	
 	while(config_part)
@@ -351,40 +334,40 @@ void config_set_panel(int config_part, gpointer config_value, ...)
 		{
 			case CP_TABBED_MODE:
 			{
-				g_key_file_set_boolean(keyfile_plugin, "tabbed_mode", "enabled", *((gboolean*)config_value));
+				journal_set_boolean(journal_plugin, "tabbed_mode", "enabled", *((gboolean*)config_value));
 				break;
 			}
 			case CP_OT_TABS:
 			{
 				int *array = (int*)config_value;
-				g_key_file_set_integer_list(keyfile_plugin, "one_panel_mode", "tabs", array + 1, array[0]);
+				journal_set_integer_list(journal_plugin, "one_panel_mode", "tabs", array + 1, array[0]);
 				break;
 			}
 			case CP_OT_SELECTED:
 			{
-				g_key_file_set_integer(keyfile_plugin, "one_panel_mode", "selected_tab_index", *((int*)config_value));
+				journal_set_integer(journal_plugin, "one_panel_mode", "selected_tab_index", *((int*)config_value));
 				break;
 			}
 			case CP_TT_LTABS:
 			{
 				int *array = (int*)config_value;
-				g_key_file_set_integer_list(keyfile_plugin, "two_panels_mode", "left_tabs", array + 1, array[0]);
+				journal_set_integer_list(journal_plugin, "two_panels_mode", "left_tabs", array + 1, array[0]);
 				break;
 			}
 			case CP_TT_LSELECTED:
 			{
-				g_key_file_set_integer(keyfile_plugin, "two_panels_mode", "left_selected_tab_index", *((int*)config_value));
+				journal_set_integer(journal_plugin, "two_panels_mode", "left_selected_tab_index", *((int*)config_value));
 				break;
 			}
 			case CP_TT_RTABS:
 			{
 				int *array = (int*)config_value;
-				g_key_file_set_integer_list(keyfile_plugin, "two_panels_mode", "right_tabs", array + 1, array[0]);
+				journal_set_integer_list(journal_plugin, "two_panels_mode", "right_tabs", array + 1, array[0]);
 				break;
 			}
 			case CP_TT_RSELECTED:
 			{
-				g_key_file_set_integer(keyfile_plugin, "two_panels_mode", "right_selected_tab_index", *((int*)config_value));
+				journal_set_integer(journal_plugin, "two_panels_mode", "right_selected_tab_index", *((int*)config_value));
 				break;
 			}
 		}
@@ -395,9 +378,8 @@ void config_set_panel(int config_part, gpointer config_value, ...)
 			config_value = va_arg(ap, gpointer);
 		}
 	}
-	
-	panel_config_changed = TRUE;
-	g_mutex_unlock(change_config_mutex);
+
+	va_end(ap);
 }
 
 /*
@@ -415,26 +397,72 @@ static void config_set_debug_defaults(GKeyFile *keyfile)
 }
 
 /*
- *	set default panel config values in a GKeyFile
+ *	copies debug session values from one keyfile to another
+ */
+static void config_copy_debug_group(GKeyFile *from, GKeyFile *to)
+{
+	gchar **keys = g_key_file_get_keys(from, DEBUGGER_GROUP, NULL, NULL);
+	if (keys)
+	{
+		gchar **key;
+
+		g_key_file_remove_group(to, DEBUGGER_GROUP, NULL);
+		for (key = keys; *key; key++)
+		{
+			gchar *value = g_key_file_get_value(from, DEBUGGER_GROUP, *key, NULL);
+			g_key_file_set_value(to, DEBUGGER_GROUP, *key, value);
+			g_free(value);
+		}
+		g_strfreev(keys);
+	}
+}
+
+/*
+ *	Geany has written the project file with the debug group, the journal can drop the changes in it
  */
-static void config_set_panel_defaults(GKeyFile *keyfile)
+static gboolean on_project_saved(gpointer data)
+{
+	project_saved_source = 0;
+	if (journal_project)
+	{
+		journal_saved(journal_project);
+	}
+	return FALSE;
+}
+
+/*
+ *	tells the project journal about a finished project save right away, before it is closed
+ */
+static void finish_project_save(void)
+{
+	if (project_saved_source)
+	{
+		g_source_remove(project_saved_source);
+		on_project_saved(NULL);
+	}
+}
+
+/*
+ *	set default panel config values in a journal
+ */
+static void config_set_panel_defaults(journal *j)
 {
 	int all_tabs[] = { TID_TARGET, TID_BREAKS, TID_AUTOS, TID_WATCH, TID_STACK, TID_TERMINAL, TID_MESSAGES };
 	int left_tabs[] = { TID_TARGET, TID_BREAKS, TID_AUTOS, TID_WATCH };
 	int right_tabs[] = { TID_STACK, TID_TERMINAL, TID_MESSAGES };
 
-	g_key_file_set_boolean(keyfile_plugin, "tabbed_mode", "enabled", FALSE);
+	journal_set_boolean(j, "tabbed_mode", "enabled", FALSE);
 	/* all tabs */
-	g_key_file_set_integer_list(keyfile, "one_panel_mode", "tabs", all_tabs, sizeof(all_tabs) / sizeof(int));
-	g_key_file_set_integer(keyfile, "one_panel_mode", "selected_tab_index", 0);
+	journal_set_integer_list(j, "one_panel_mode", "tabs", all_tabs, sizeof(all_tabs) / sizeof(int));
+	journal_set_integer(j, "one_panel_mode", "selected_tab_index", 0);
 	/* left tabs */
-	g_key_file_set_integer_list(keyfile, "two_panels_mode", "left_tabs", left_tabs, sizeof(left_tabs) / sizeof(int));
-	g_key_file_set_integer(keyfile, "two_panels_mode", "left_selected_tab_index", 0);
+	journal_set_integer_list(j, "two_panels_mode", "left_tabs", left_tabs, sizeof(left_tabs) / sizeof(int));
+	journal_set_integer(j, "two_panels_mode", "left_selected_tab_index", 0);
 	/* right tabs */
-	g_key_file_set_integer_list(keyfile, "two_panels_mode", "right_tabs", right_tabs, sizeof(right_tabs) / sizeof(int));
-	g_key_file_set_integer(keyfile, "two_panels_mode", "right_selected_tab_index", 0);
+	journal_set_integer_list(j, "two_panels_mode", "right_tabs", right_tabs, sizeof(right_tabs) / sizeof(int));
+	journal_set_integer(j, "two_panels_mode", "right_selected_tab_index", 0);
 
-	g_key_file_set_boolean(keyfile, "saving_settings", "save_to_project", FALSE);
+	journal_set_boolean(j, "saving_settings", "save_to_project", FALSE);
 }
 
 /*
@@ -442,27 +470,25 @@ static void config_set_panel_defaults(GKeyFile *keyfile)
  */
 void config_init(void)
 {
+	gchar *journal_path;
+
 	/* read config */
-	gchar *config_dir = g_build_path(G_DIR_SEPARATOR_S, geany_data->app->configdir, "plugins", "debugger", NULL);
+	config_dir = g_build_path(G_DIR_SEPARATOR_S, geany_data->app->configdir, "plugins", "debugger", NULL);
 	plugin_config_path = g_build_path(G_DIR_SEPARATOR_S, config_dir, "debugger.conf", NULL);
 	
 	g_mkdir_with_parents(config_dir, S_IRUSR | S_IWUSR | S_IXUSR);
-	g_free(config_dir);
 
-	keyfile_plugin = g_key_file_new();
-	if (!g_key_file_load_from_file(keyfile_plugin, plugin_config_path, G_KEY_FILE_NONE, NULL))
-	{
-		gchar *data;
+	journal_path = g_strconcat(plugin_config_path, ".journal", NULL);
+	journal_plugin = journal_open(plugin_config_path, journal_path, NULL);
+	keyfile_plugin = journal_get_keyfile(journal_plugin);
+	g_free(journal_path);
 
-		config_set_panel_defaults(keyfile_plugin);
-		data = g_key_file_to_data(keyfile_plugin, NULL, NULL);
-		g_file_set_contents(plugin_config_path, data, -1, NULL);
-		g_free(data);
+	if (!g_key_file_has_group(keyfile_plugin, "one_panel_mode"))
+	{
+		config_set_panel_defaults(journal_plugin);
 	}
 
-	change_config_mutex = g_mutex_new();
-	cond = g_cond_new();
-	saving_thread = g_thread_create(saving_thread_func, NULL, TRUE, NULL);
+	saving_source = g_timeout_add(SAVING_INTERVAL, on_saving_timer, NULL);
 }	
 
 /*
@@ -470,19 +496,23 @@ void config_init(void)
  */
 void config_destroy(void)
 {
-	g_cond_signal(cond);
-	/* ??? g_thread_join(saving_thread); */	
-	
-	g_mutex_free(change_config_mutex);
-	g_cond_free(cond);
-
-	g_free(plugin_config_path);
-	
-	g_key_file_free(keyfile_plugin);
-	if(keyfile_project)
+	g_source_remove(saving_source);
+	save_debug_changes();
+
+	/* wait for the changes to be saved */
+	finish_project_save();
+	journal_close(journal_plugin);
+	journal_plugin = NULL;
+	keyfile_plugin = NULL;
+	if(journal_project)
 	{
-		g_key_file_free(keyfile_project);
+		journal_close(journal_project);
+		journal_project = NULL;
+		keyfile_project = NULL;
 	}
+
+	g_free(plugin_config_path);
+	g_free(config_dir);
 }
 
 /*
@@ -529,7 +559,10 @@ int	config_get_right_selected_tab_index(void)
  */
 void config_set_debug_store(debug_store store)
 {
-	GKeyFile *keyfile;
+	journal *j;
+
+	/* save the changes to the store being left */
+	save_debug_changes();
 
 	dstore = store;
 
@@ -537,21 +570,14 @@ void config_set_debug_store(debug_store store)
 	wtree_remove_all();
 	breaks_remove_all();
 
-	keyfile = DEBUG_STORE_PROJECT == dstore ? keyfile_project : keyfile_plugin;
-	if (!g_key_file_has_group(keyfile, DEBUGGER_GROUP))
+	j = DEBUG_STORE_PROJECT == dstore ? journal_project : journal_plugin;
+	if (!g_key_file_has_group(journal_get_keyfile(j), DEBUGGER_GROUP))
 	{
-		gchar *data, *file;
-
-		config_set_debug_defaults(keyfile);
-		data = g_key_file_to_data(keyfile, NULL, NULL);
-
-		file = DEBUG_STORE_PROJECT == dstore ? geany_data->app->project->file_name : plugin_config_path;
-		g_file_set_contents(file, data, -1, NULL);
-
-		g_free(data);
+		/* the cleared GUI values are the defaults */
+		save_to_journal(j);
 	}
 	
-	debug_load_from_keyfile(keyfile);
+	debug_load_from_keyfile(journal_get_keyfile(j));
 }
 
 /*
@@ -559,12 +585,31 @@ void config_set_debug_store(debug_store store)
  */
 void config_update_project_keyfile(void)
 {
-	if (keyfile_project)
+	const gchar *groups[] = { DEBUGGER_GROUP, NULL };
+	gchar *checksum, *name, *journal_path;
+
+	if (journal_project)
 	{
-		g_key_file_free(keyfile_project);
+		if (DEBUG_STORE_PROJECT == dstore)
+		{
+			save_debug_changes();
+		}
+		finish_project_save();
+		journal_close(journal_project);
 	}
-	keyfile_project = g_key_file_new();
-	g_key_file_load_from_file(keyfile_project, geany_data->app->project->file_name, G_KEY_FILE_NONE, NULL);
+
+	/* project journals are kept in the plugin config directory */
+	checksum = g_compute_checksum_for_string(G_CHECKSUM_MD5, geany_data->app->project->file_name, -1);
+	name = g_strconcat("project-", checksum, ".journal", NULL);
+	journal_path = g_build_path(G_DIR_SEPARATOR_S, config_dir, name, NULL);
+
+	/* only the debugger group is saved, the rest of a project file belongs to Geany */
+	journal_project = journal_open(geany_data->app->project->file_name, journal_path, groups);
+	keyfile_project = journal_get_keyfile(journal_project);
+
+	g_free(journal_path);
+	g_free(name);
+	g_free(checksum);
 }
 
 /*
@@ -585,6 +630,11 @@ void config_on_project_open(GObject *obj, GKeyFile *config, gpointer user_data)
  */
 void config_on_project_close(GObject *obj, gpointer user_data)
 {
+	if (!journal_project)
+	{
+		return;
+	}
+
 	if (config_get_save_to_project())
 	{
 		if (DBS_IDLE != debug_get_state())
@@ -600,6 +650,12 @@ void config_on_project_close(GObject *obj, gpointer user_data)
 
 		config_set_debug_store(DEBUG_STORE_PLUGIN);
 	}
+
+	/* Geany has written the project file before closing it */
+	finish_project_save();
+	journal_close(journal_project);
+	journal_project = NULL;
+	keyfile_project = NULL;
 }
 
 /*
@@ -623,13 +679,31 @@ void config_on_project_save(GObject *obj, GKeyFile *config, gpointer user_data)
 			/* set default debug values */
 			config_set_debug_defaults(config);
 		}
+		else if (journal_project && DEBUG_STORE_PROJECT == dstore)
+		{
+			save_debug_changes();
+		}
 
-		/* update local keyfile */
-		if (keyfile_project)
+		/* open a journal for a new project */
+		if (!journal_project || strcmp(journal_get_path(journal_project), geany_data->app->project->file_name))
 		{
-			g_key_file_free(keyfile_project);
+			config_update_project_keyfile();
+			debug_config_changed = TRUE;
+		}
+	}
+
+	/* The project file is only written here, on the main thread, as Geany writes the
+	 * whole file: the debug group goes along with Geany's values, and the journal
+	 * drops the changes it holds once the file is written */
+	if (journal_project && g_key_file_has_group(keyfile_project, DEBUGGER_GROUP) &&
+		!strcmp(journal_get_path(journal_project), geany_data->app->project->file_name))
+	{
+		config_copy_debug_group(keyfile_project, config);
+		journal_saving(journal_project);
+		if (!project_saved_source)
+		{
+			project_saved_source = g_idle_add(on_project_saved, NULL);
 		}
-		keyfile_project = create_copy_keyfile(config);
 	}
 }
 
@@ -641,11 +715,7 @@ static void on_configure_response(GtkDialog* dialog, gint response, gpointer use
 	gboolean newvalue = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(save_to_project_btn));
 	if (newvalue ^ config_get_save_to_project())
 	{
-		g_key_file_set_boolean(keyfile_plugin, "saving_settings", "save_to_project", newvalue);
-
-		g_mutex_lock(change_config_mutex);
-		panel_config_changed = TRUE;
-		g_mutex_unlock(change_config_mutex);
+		journal_set_boolean(journal_plugin, "saving_settings", "save_to_project", newvalue);
 
 		if (geany_data->app->project)
 		{
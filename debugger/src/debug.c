@@ -135,10 +135,20 @@ static GtkWidget **sensitive_widget[] = {&stree, &wtree, &atree, NULL};
  */
 static GList* stack = NULL;
 
+/* number of frames in the stack list */
+static int stack_depth = 0;
+
+/* flag indicating whether all frames have been loaded */
+static gboolean stack_complete = FALSE;
+
+/* number of frames to load at once, the rest is loaded when scrolled to */
+#define STACK_PAGE_SIZE 100
+
 /*
  * pages which are loaded in debugger and therefore, are set readonly
+ * (a set of file names)
  */
-static GList *read_only_pages = NULL;
+static GHashTable *read_only_pages = NULL;
 
 /* available modules */
 static module_description modules[] = 
@@ -147,9 +157,23 @@ static module_description modules[] =
 	{ NULL, NULL }
 };
 
-/* calltips cache  */
+/* calltips cache entry */
+typedef struct _calltip_entry {
+	gchar *text;
+	/* the stop at which the calltip was checked for changes */
+	guint stop;
+} calltip_entry;
+
+/* calltips cache, kept between stops, a debug module checks
+ * whether a calltip has changed before it is shown again */
 static GHashTable *calltips = NULL;
 
+/* incremented on every stop, frame change and added watch */
+static guint calltips_stop = 0;
+
+/* function to show the requested calltip, NULL if nothing is requested */
+static calltip_cb calltip_requested = NULL;
+
 /* 
  * remove stack margin markers
  */
@@ -180,15 +204,16 @@ static void remove_stack_markers(void)
 }
 
 /* 
- * add stack margin markers
+ * add stack margin markers for frames,
+ * first is the number of the first frame in the list
  */
-static void add_stack_markers(void)
+static void add_stack_markers(GList *frames, int first)
 {
 	int active_frame_index = active_module->get_active_frame();
 	
 	GList *iter;
 	int frame_index;
-	for (iter = stack, frame_index = 0; iter; iter = iter->next, frame_index++)
+	for (iter = frames, frame_index = first; iter; iter = iter->next, frame_index++)
 	{
 		if (iter)
 		{
@@ -208,6 +233,134 @@ static void add_stack_markers(void)
 	}
 }
 
+/* 
+ * remove stack markers and free stack frames
+ */
+static void clear_stack(void)
+{
+	if (stack)
+	{
+		remove_stack_markers();
+		g_list_foreach(stack, (GFunc)frame_free, NULL);
+		g_list_free(stack);
+		stack = NULL;
+	}
+	stack_depth = 0;
+	stack_complete = FALSE;
+}
+
+/* 
+ * load next page of stack frames and put in the tree view,
+ * returns the list of the frames loaded (a part of the stack list)
+ */
+static GList* load_stack_page(void)
+{
+	GList *page = active_module->get_stack(stack_depth, STACK_PAGE_SIZE);
+	GList *iter;
+	int count = 0;
+
+	for (iter = page; iter; iter = iter->next, count++)
+	{
+		frame *f = (frame*)iter->data;
+		stree_add(f);
+	}
+
+	stack = g_list_concat(stack, page);
+	stack_depth += count;
+
+	/* a short page means the outermost frame has been reached */
+	stack_complete = count < STACK_PAGE_SIZE;
+	stree_set_more_frames(!stack_complete);
+
+	return page;
+}
+
+/* 
+ * called from the stack tree when the "more frames" row is shown
+ */
+static void on_more_frames(void)
+{
+	if (DBS_STOPPED == debug_state && !stack_complete)
+	{
+		int first = stack_depth;
+		GList *page = load_stack_page();
+		add_stack_markers(page, first);
+	}
+}
+
+/* 
+ * set a readonly page writable
+ */
+static void set_page_writable(gpointer key, gpointer value, gpointer user_data)
+{
+	GeanyDocument *doc = document_find_by_real_path((const gchar*)key);
+	if (doc)
+		scintilla_send_message(doc->editor->sci, SCI_SETREADONLY, 0, 0);
+}
+
+/* 
+ * removes a page from the readonly set and makes it writable
+ * if it's not in the current files set passed as user_data
+ */
+static gboolean remove_stale_page(gpointer key, gpointer value, gpointer user_data)
+{
+	if (!g_hash_table_lookup((GHashTable*)user_data, key))
+	{
+		set_page_writable(key, value, NULL);
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* 
+ * make the files of the module files list readonly
+ * and those that are not in the list anymore writable again
+ */
+static void update_read_only_pages(void)
+{
+	GList *files = active_module->get_files();
+	GHashTable *current = g_hash_table_new(g_str_hash, g_str_equal);
+	GList *iter;
+
+	for (iter = files; iter; iter = iter->next)
+		g_hash_table_insert(current, iter->data, iter->data);
+
+	/* remove from the set and make writable those files,
+	that are not in the current list */
+	g_hash_table_foreach_remove(read_only_pages, remove_stale_page, current);
+
+	/* add to the set and make readonly those files
+	from the current list that are new */
+	for (iter = files; iter; iter = iter->next)
+	{
+		if (!g_hash_table_lookup(read_only_pages, iter->data))
+		{
+			gchar *file = g_strdup((gchar*)iter->data);
+
+			/* set document readonly */
+			GeanyDocument *doc = document_find_by_real_path(file);
+			if (doc)
+				scintilla_send_message(doc->editor->sci, SCI_SETREADONLY, 1, 0);
+
+			g_hash_table_insert(read_only_pages, file, file);
+		}
+	}
+
+	g_hash_table_destroy(current);
+	g_list_free(files);
+}
+
+/* 
+ * adds a run-time watch, evaluating a watch expression can change
+ * the debuggee (e.g. "i = 0"), so calltips have to be checked for changes
+ */
+static variable* add_module_watch(gchar *expression)
+{
+	calltips_stop++;
+	return active_module->add_watch(expression);
+}
+
 /* 
  * Handlers for GUI maked changes in watches
  */
@@ -279,7 +432,7 @@ static void on_watch_changed(GtkCellRendererText *renderer, gchar *path, gchar *
 			variable *newvar;
 
 			active_module->remove_watch(internal);
-			newvar = active_module->add_watch(striped);
+			newvar = add_module_watch(striped);
 			change_watch(GTK_TREE_VIEW(wtree), is_empty_row ? &newiter : &iter, newvar);
 		}
 		
@@ -357,7 +510,7 @@ static void on_watch_dragged_callback(GtkWidget *wgt, GdkDragContext *context, i
 	 *  if not - just set new expession in the tree view */ 
 	if (DBS_STOPPED == debug_state)
 	{
-		variable *var = active_module->add_watch(expression);
+		variable *var = add_module_watch(expression);
 		change_watch(GTK_TREE_VIEW(wtree), &newvar, var);
 	}
 	else
@@ -533,7 +686,7 @@ static gboolean on_watch_button_pressed_callback(GtkWidget *treeview, GdkEventBu
 				 *  if not - just set new expession in the tree view */ 
 				if (DBS_STOPPED == debug_state)
 				{
-					variable *var = active_module->add_watch(expression);
+					variable *var = add_module_watch(expression);
 					change_watch(GTK_TREE_VIEW(wtree), &newvar, var);
 				}
 				else
@@ -629,11 +782,7 @@ static void on_debugger_run (void)
 	/* if curren instruction marker was set previously - remove it */
 	if (stack)
 	{
-		remove_stack_markers();
-		g_list_foreach(stack, (GFunc)frame_free, NULL);
-		g_list_free(stack);
-		stack = NULL;
-
+		clear_stack();
 		stree_remove_frames();
 	}
 
@@ -650,7 +799,7 @@ static void on_debugger_run (void)
  */
 static void on_debugger_stopped (int thread_id)
 {
-	GList *iter, *files, *autos, *watches;
+	GList *autos, *watches;
 
 	/* update debug state */
 	debug_state = DBS_STOPPED;
@@ -661,8 +810,8 @@ static void on_debugger_stopped (int thread_id)
 		btnpanel_set_debug_state(debug_state);
 	}
 
-	/* clear calltips cache */
-	g_hash_table_remove_all(calltips);
+	/* calltips have to be checked for changes */
+	calltips_stop++;
 
 	/* if a stop was requested for asyncronous exiting -
 	 * stop debug module and exit */
@@ -687,63 +836,15 @@ static void on_debugger_stopped (int thread_id)
 	/* clear stack tree view */
 	stree_set_active_thread_id(thread_id);
 
-	/* get current stack trace and put in the tree view */
-	stack = active_module->get_stack();
-	for (iter = stack; iter; iter = iter->next)
-	{
-		frame *f = (frame*)iter->data;
-		stree_add(f);
-	}
+	/* get the first page of the stack trace and put in the tree view,
+	the next pages are loaded as the tree is scrolled */
+	clear_stack();
+	load_stack_page();
 	stree_select_first_frame(TRUE);
 
-	/* files */
-	files = active_module->get_files();
-	/* remove from list and make writable those files,
-	that are not in the current list */
-	iter = read_only_pages;
-	while (iter)
-	{
-		if (!g_list_find_custom(files, iter->data, (GCompareFunc)g_strcmp0))
-		{
-			GList *next;
-
-			/* set document writable */
-			GeanyDocument *doc = document_find_by_real_path((const gchar*)iter->data);
-			if (doc)
-				scintilla_send_message(doc->editor->sci, SCI_SETREADONLY, 0, 0);
-
-			/* free file name */
-			g_free(iter->data);
-			/* save next item pointer */
-			next = iter->next;
-			/* remove current item */
-			read_only_pages = g_list_delete_link(read_only_pages, iter);
-
-			/* set next item and continue */
-			iter = next;
-			continue;
-		}
-
-		iter = iter->next;
-	}
-	/* add to the list and make readonly those files
-	from the current list that are new */
-	iter = files;
-	while (iter)
-	{
-		if (!g_list_find_custom(read_only_pages, iter->data, (GCompareFunc)g_strcmp0))
-		{
-			/* set document readonly */
-			GeanyDocument *doc = document_find_by_real_path((const gchar*)iter->data);
-			if (doc)
-				scintilla_send_message(doc->editor->sci, SCI_SETREADONLY, 1, 0);
-
-			/* add new file to the list */
-			read_only_pages = g_list_append(read_only_pages, g_strdup((gchar*)iter->data));
-		}
-		iter = iter->next;
-	}
-	g_list_free(files);
+	/* files, the list is only refreshed by the module when libraries are loaded */
+	if (active_module->files_changed())
+		update_read_only_pages();
 
 	/* autos */
 	autos = active_module->get_autos();
@@ -764,7 +865,7 @@ static void on_debugger_stopped (int thread_id)
 		}
 
 		/* add current instruction marker */
-		add_stack_markers();
+		add_stack_markers(stack, 0);
 	}
 
 	/* enable widgets */
@@ -782,16 +883,9 @@ static void on_debugger_exited (int code)
 {
 	GtkTextIter start, end;
 	GtkTextBuffer *buffer;
-	GList *iter;
 
 	/* remove marker for current instruction if was set */
-	if (stack)
-	{
-		remove_stack_markers();
-		g_list_foreach(stack, (GFunc)frame_free, NULL);
-		g_list_free(stack);
-		stack = NULL;
-	}
+	clear_stack();
 	
 	/* clear watch page */
 	clear_watch_values(GTK_TREE_VIEW(wtree));
@@ -818,21 +912,16 @@ static void on_debugger_exited (int code)
 		bptree_set_readonly(FALSE);
 	
 	/* set files that was readonly during debug writable */
-	for (iter = read_only_pages; iter; iter = iter->next)
-	{
-		GeanyDocument *doc = document_find_by_real_path((const gchar*)iter->data);
-		if (doc)
-			scintilla_send_message(doc->editor->sci, SCI_SETREADONLY, 0, 0);
-
-		/* free file name */
-		g_free(iter->data);
-	}
-	g_list_free(read_only_pages);
-	read_only_pages = NULL;
+	g_hash_table_foreach(read_only_pages, set_page_writable, NULL);
+	g_hash_table_remove_all(read_only_pages);
 
 	/* clear and destroy calltips cache */
-	g_hash_table_destroy(calltips);
-	calltips = NULL;
+	if (calltips)
+	{
+		g_hash_table_destroy(calltips);
+		calltips = NULL;
+	}
+	calltip_requested = NULL;
 
 	/* enable widgets */
 	enable_sensitive_widgets(TRUE);
@@ -926,8 +1015,8 @@ static void on_select_frame(int frame_number)
 
 	active_module->set_active_frame(frame_number);
 	
-	/* clear calltips cache */
-	g_hash_table_remove_all(calltips);
+	/* calltips have to be checked for changes */
+	calltips_stop++;
 	
 	/* autos */
 	autos = active_module->get_autos();
@@ -984,8 +1073,11 @@ void debug_init(void)
 		GTK_POLICY_AUTOMATIC);
 	gtk_container_add(GTK_CONTAINER(tab_autos), atree);
 	
+	/* create readonly pages set */
+	read_only_pages = g_hash_table_new_full(g_str_hash, g_str_equal, (GDestroyNotify)g_free, NULL);
+
 	/* create stack trace page */
-	stree = stree_init(editor_open_position, on_select_frame);
+	stree = stree_init(editor_open_position, on_select_frame, on_more_frames);
 	tab_call_stack = gtk_scrolled_window_new(
 		gtk_tree_view_get_hadjustment(GTK_TREE_VIEW(stree )),
 		gtk_tree_view_get_vadjustment(GTK_TREE_VIEW(stree ))
@@ -1057,15 +1149,12 @@ void debug_destroy(void)
 	close(pty_slave);
 
 	/* remove stack markers if present */
-	if (stack)
-	{
-		remove_stack_markers();
-		g_list_foreach(stack, (GFunc)frame_free, NULL);
-		g_list_free(stack);
-		stack = NULL;
-	}
+	clear_stack();
 	
 	stree_destroy();
+
+	g_hash_table_destroy(read_only_pages);
+	read_only_pages = NULL;
 }
 
 /*
@@ -1313,55 +1402,113 @@ gchar* debug_evaluate_expression(gchar *expression)
 }
 
 /*
- * return list of strings for the calltip
+ * frees a calltips cache entry
+ */
+static void free_calltip_entry(calltip_entry *entry)
+{
+	g_free(entry->text);
+	g_free(entry);
+}
+
+/*
+ * return text for the calltip
  * first line is a header, others should be shifted right with tab
  */
-gchar* debug_get_calltip_for_expression(gchar* expression)
+static gchar *format_calltip(variable *var, GList *children, gboolean more)
 {
-	gchar *calltip = NULL;
-	if (!calltips || !(calltip = g_hash_table_lookup(calltips, expression)))
+	GString *calltip_str = get_calltip_line(var, TRUE);
+	
+	for (; children; children = children->next)
 	{
-		GString *calltip_str = NULL;
-		variable *var = active_module->add_watch(expression);
-		if (var)
-		{
-			calltip_str = get_calltip_line(var, TRUE);
-			if (var->has_children)
-			{
-				int lines_left = MAX_CALLTIP_HEIGHT - 1;
-				GList* children = active_module->get_children(var->internal->str); 
-				GList* child = children;
-				while(child && lines_left)
-				{
-					variable *varchild = (variable*)child->data;
-					GString *child_string = get_calltip_line(varchild, FALSE);
-					g_string_append_printf(calltip_str, "\n%s", child_string->str);
-					g_string_free(child_string, TRUE);
+		variable *varchild = (variable*)children->data;
+		GString *child_string = get_calltip_line(varchild, FALSE);
+		g_string_append_printf(calltip_str, "\n%s", child_string->str);
+		g_string_free(child_string, TRUE);
+	}
+	if (more)
+	{
+		g_string_append(calltip_str, "\n\t\t........");
+	}
 
-					child = child->next;
-					lines_left--;
-				}
-				if (!lines_left && child)
-				{
-					g_string_append(calltip_str, "\n\t\t........");
-				}
-				g_list_foreach(children, (GFunc)variable_free, NULL);
-				g_list_free(children);
-			}
+	return g_string_free(calltip_str, FALSE);
+}
+
+/*
+ * a calltip has been evaluated by the debug module
+ */
+static void on_calltip_evaluated(const gchar *expression, calltip_status status, variable *var, GList *children, gboolean more)
+{
+	calltip_entry *entry = calltips ? g_hash_table_lookup(calltips, expression) : NULL;
 
-			active_module->remove_watch(var->internal->str);
+	if (CS_EVALUATED == status)
+	{
+		if (!calltips)
+		{
+			calltips = g_hash_table_new_full(g_str_hash, g_str_equal, (GDestroyNotify)g_free, (GDestroyNotify)free_calltip_entry);
+		}
+		if (!entry)
+		{
+			entry = g_malloc0(sizeof(calltip_entry));
+			g_hash_table_insert(calltips, g_strdup(expression), entry);
+		}
 
-			calltip = g_string_free(calltip_str, FALSE);
+		g_free(entry->text);
+		entry->text = format_calltip(var, children, more);
+	}
+	else if (CS_ERROR == status && entry)
+	{
+		g_hash_table_remove(calltips, expression);
+		entry = NULL;
+	}
 
-			if (!calltips)
-			{
-				calltips = g_hash_table_new_full(g_str_hash, g_str_equal, (GDestroyNotify)g_free, (GDestroyNotify)g_free);
-			}
-			g_hash_table_insert(calltips, g_strdup(expression), calltip);
+	if (entry)
+	{
+		entry->stop = calltips_stop;
+	}
+
+	if (calltip_requested)
+	{
+		calltip_cb cb = calltip_requested;
+		calltip_requested = NULL;
+		
+		if (entry)
+		{
+			cb(entry->text);
 		}
 	}
+}
 
-	return calltip;
+/*
+ * requests a calltip for the expression, "cb" is called when it is evaluated,
+ * at once if the calltip is cached and nothing has changed since
+ */
+void debug_request_calltip(gchar* expression, calltip_cb cb)
+{
+	calltip_entry *entry = calltips ? g_hash_table_lookup(calltips, expression) : NULL;
+
+	debug_cancel_calltip();
+
+	if (entry && entry->stop == calltips_stop)
+	{
+		cb(entry->text);
+	}
+	else
+	{
+		calltip_requested = cb;
+		active_module->request_calltip(expression, NULL != entry, MAX_CALLTIP_HEIGHT - 1, on_calltip_evaluated);
+	}
+}
+
+/*
+ * cancels a calltip request
+ */
+void debug_cancel_calltip(void)
+{
+	if (calltip_requested)
+	{
+		calltip_requested = NULL;
+		active_module->cancel_calltip();
+	}
 }
 
 /*
@@ -1390,7 +1537,7 @@ void debug_jump_to_current_instruction(void)
 void debug_on_file_open(GeanyDocument *doc)
 {
 	const gchar *file = DOC_FILENAME(doc);
-	if (g_list_find_custom(read_only_pages, (gpointer)file, (GCompareFunc)g_strcmp0))
+	if (file && g_hash_table_lookup(read_only_pages, file))
 		scintilla_send_message(doc->editor->sci, SCI_SETREADONLY, 1, 0);
 }
 
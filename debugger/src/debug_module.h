@@ -86,6 +86,17 @@ typedef struct _frame {
 	gboolean have_source;
 } frame;
 
+/* calltip evaluation results */
+typedef enum _calltip_status {
+	CS_ERROR,
+	CS_UNCHANGED,
+	CS_EVALUATED
+} calltip_status;
+
+/* type of the function that receives a calltip evaluated in background,
+ * for CS_EVALUATED - a variable, its first children and whether there are more of them */
+typedef void (*calltip_callback)(const gchar *expression, calltip_status status, variable *var, GList *children, gboolean more);
+
 /* enumeration for module features */
 typedef enum _module_features
 {
@@ -116,7 +127,7 @@ typedef struct _dbg_module {
 	gboolean (*set_break) (breakpoint* bp, break_set_activity bsa);
 	gboolean (*remove_break) (breakpoint* bp);
 
-	GList* (*get_stack) (void);
+	GList* (*get_stack) (int first, int count);
 
 	void (*set_active_frame)(int frame_number);
 	int (*get_active_frame)(void);
@@ -125,12 +136,16 @@ typedef struct _dbg_module {
 	GList* (*get_watches) (void);
 	
 	GList* (*get_files) (void);
+	gboolean (*files_changed) (void);
 
 	GList* (*get_children) (gchar* path);
 	variable* (*add_watch)(gchar* expression);
 	void (*remove_watch)(gchar* path);
 
 	gchar* (*evaluate_expression)(gchar *expression);
+
+	void (*request_calltip)(const gchar *expression, gboolean cached, int max_children, calltip_callback callback);
+	void (*cancel_calltip)(void);
 	
 	gboolean (*request_interrupt) (void);
 	gchar* (*error_message) (void);
@@ -157,10 +172,13 @@ typedef struct _dbg_module {
 	get_autos, \
 	get_watches, \
 	get_files, \
+	files_changed, \
 	get_children, \
 	add_watch, \
 	remove_watch, \
 	evaluate_expression, \
+	request_calltip, \
+	cancel_calltip, \
 	request_interrupt, \
 	error_message, \
 	MODULE_FEATURES }
@@ -0,0 +1,356 @@
+/*
+ *      gdb_mi.c
+ *
+ *      Copyright 2010 Alexander Petukhov <devel(at)apetukhov.ru>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ */
+
+/*
+ * 		GDB/MI output record parser
+ *
+ * 		A record is parsed in a single pass over a private copy of the line.
+ * 		Names and strings are terminated and unescaped in place, so the values
+ * 		of the tree point into that copy and nothing is allocated per value
+ * 		except the tree nodes, which come from a few blocks.
+ */
+
+#include <string.h>
+
+#include "gdb_mi.h"
+
+/* number of nodes in the first block, every next block is twice as large */
+#define FIRST_BLOCK_SIZE 32
+
+/*
+ * allocates a tree node
+ */
+static gdb_mi_value *new_value(gdb_mi_record *record, gdb_mi_value_type type, const gchar *name)
+{
+	gdb_mi_value *value;
+
+	if (!record->free_nodes)
+	{
+		record->block_size = record->block_size ? 2 * record->block_size : FIRST_BLOCK_SIZE;
+		record->blocks = g_slist_prepend(record->blocks, g_new(gdb_mi_value, record->block_size));
+		record->free_nodes = record->block_size;
+	}
+
+	value = (gdb_mi_value*)record->blocks->data + record->block_size - record->free_nodes--;
+	value->type = type;
+	value->name = name;
+	value->string = NULL;
+	value->children = value->next = NULL;
+
+	return value;
+}
+
+/*
+ * unescapes the c-string starting at the opening quote at *pos in place,
+ * the same way as g_strcompress(), and moves *pos past the closing quote
+ */
+static gchar *parse_cstring(gchar **pos)
+{
+	gchar *src = *pos + 1, *dest = src, *start = src;
+
+	while (*src != '"')
+	{
+		if (!*src)
+			return NULL;
+
+		if (*src == '\\')
+		{
+			src++;
+			switch (*src)
+			{
+				case '\0':
+					return NULL;
+				case 'b': *dest++ = '\b'; src++; break;
+				case 'f': *dest++ = '\f'; src++; break;
+				case 'n': *dest++ = '\n'; src++; break;
+				case 'r': *dest++ = '\r'; src++; break;
+				case 't': *dest++ = '\t'; src++; break;
+				case 'v': *dest++ = '\v'; src++; break;
+				case '0': case '1': case '2': case '3':
+				case '4': case '5': case '6': case '7':
+				{
+					gint digits = 0, c = 0;
+					while (digits < 3 && *src >= '0' && *src <= '7')
+					{
+						c = c * 8 + *src++ - '0';
+						digits++;
+					}
+					*dest++ = (gchar)c;
+					break;
+				}
+				default:
+					*dest++ = *src++;
+			}
+		}
+		else
+			*dest++ = *src++;
+	}
+
+	*dest = '\0';
+	*pos = src + 1;
+
+	return start;
+}
+
+static gdb_mi_value *parse_value(gdb_mi_record *record, gchar **pos, const gchar *name);
+
+/*
+ * parses the results or values of a tuple or list up to the closing bracket;
+ * gdb puts both results and bare values in either of them
+ */
+static gboolean parse_elements(gdb_mi_record *record, gchar **pos, gdb_mi_value *parent, gchar close)
+{
+	gdb_mi_value **last = &parent->children;
+
+	if (**pos == close)
+	{
+		(*pos)++;
+		return TRUE;
+	}
+
+	for (;;)
+	{
+		gchar *name = NULL;
+		gdb_mi_value *value;
+
+		if (**pos != '"' && **pos != '{' && **pos != '[')
+		{
+			name = *pos;
+			*pos += strcspn(*pos, "=,{}[]\"");
+			if (**pos != '=' || *pos == name)
+				return FALSE;
+			*(*pos)++ = '\0';
+		}
+
+		if (!(value = parse_value(record, pos, name)))
+			return FALSE;
+		*last = value;
+		last = &value->next;
+
+		if (**pos == close)
+		{
+			(*pos)++;
+			return TRUE;
+		}
+		if (**pos != ',')
+			return FALSE;
+		(*pos)++;
+	}
+}
+
+/*
+ * parses a value at *pos
+ */
+static gdb_mi_value *parse_value(gdb_mi_record *record, gchar **pos, const gchar *name)
+{
+	gdb_mi_value *value;
+
+	switch (**pos)
+	{
+		case '"':
+		{
+			gchar *string = parse_cstring(pos);
+			if (!string)
+				return NULL;
+			value = new_value(record, GDB_MI_VAL_STRING, name);
+			value->string = string;
+			return value;
+		}
+		case '{':
+		case '[':
+		{
+			gchar close = **pos == '{' ? '}' : ']';
+			value = new_value(record, close == '}' ? GDB_MI_VAL_TUPLE : GDB_MI_VAL_LIST, name);
+			(*pos)++;
+			return parse_elements(record, pos, value, close) ? value : NULL;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * parses an MI output line, returns NULL if it's not a valid record
+ */
+gdb_mi_record *gdb_mi_record_parse(const gchar *line)
+{
+	gdb_mi_record *record = g_new0(gdb_mi_record, 1);
+	gchar *pos, *token;
+	gboolean ok = FALSE;
+
+	pos = record->text = g_strdup(line);
+	g_strchomp(pos);
+
+	token = pos;
+	while (g_ascii_isdigit(*pos))
+		pos++;
+
+	record->type = *pos;
+	switch (record->type)
+	{
+		case '~':
+		case '@':
+		case '&':
+		{
+			gchar *string;
+			pos++;
+			if (*pos == '"' && (string = parse_cstring(&pos)) && !*pos)
+			{
+				record->first = new_value(record, GDB_MI_VAL_STRING, NULL);
+				record->first->string = string;
+				ok = TRUE;
+			}
+			break;
+		}
+		case '^':
+		case '*':
+		case '+':
+		case '=':
+		{
+			gdb_mi_value **last = &record->first;
+
+			*pos++ = '\0';
+			record->token = *token ? token : NULL;
+			record->klass = pos;
+			pos += strcspn(pos, ",");
+			ok = TRUE;
+
+			while (ok && *pos == ',')
+			{
+				gchar *name;
+				gdb_mi_value *value;
+
+				*pos++ = '\0';
+				name = pos;
+				pos += strcspn(pos, "=,{}[]\"");
+				if (*pos != '=' || pos == name)
+				{
+					ok = FALSE;
+					break;
+				}
+				*pos++ = '\0';
+
+				if ((value = parse_value(record, &pos, name)))
+				{
+					*last = value;
+					last = &value->next;
+				}
+				else
+					ok = FALSE;
+			}
+			ok = ok && !*pos;
+			break;
+		}
+	}
+
+	if (!ok)
+	{
+		gdb_mi_record_free(record);
+		return NULL;
+	}
+
+	return record;
+}
+
+/*
+ * frees a parsed record and all of its values
+ */
+void gdb_mi_record_free(gdb_mi_record *record)
+{
+	if (record)
+	{
+		g_slist_foreach(record->blocks, (GFunc)g_free, NULL);
+		g_slist_free(record->blocks);
+		g_free(record->text);
+		g_free(record);
+	}
+}
+
+/*
+ * checks record type and class, klass can be NULL to match any
+ */
+gboolean gdb_mi_record_matches(const gdb_mi_record *record, gchar type, const gchar *klass)
+{
+	return record && record->type == type &&
+		(!klass || (record->klass && !strcmp(record->klass, klass)));
+}
+
+/*
+ * finds the first value named name among first and its siblings
+ */
+const gdb_mi_value *gdb_mi_value_get(const gdb_mi_value *first, const gchar *name)
+{
+	for (; first; first = first->next)
+	{
+		if (first->name && !strcmp(first->name, name))
+			return first;
+	}
+
+	return NULL;
+}
+
+/*
+ * returns the string named name among first and its siblings,
+ * NULL if there is no such value or it's not a string
+ */
+const gchar *gdb_mi_value_get_string(const gdb_mi_value *first, const gchar *name)
+{
+	const gdb_mi_value *value = gdb_mi_value_get(first, name);
+
+	return value && value->type == GDB_MI_VAL_STRING ? value->string : NULL;
+}
+
+/*
+ * finds a value by a path of names separated by '/', such as "frame/fullname",
+ * descending into the named tuples and lists
+ */
+const gdb_mi_value *gdb_mi_value_get_path(const gdb_mi_value *first, const gchar *path)
+{
+	const gdb_mi_value *value = NULL;
+
+	for (;;)
+	{
+		const gchar *slash = strchr(path, '/');
+		gsize length = slash ? (gsize)(slash - path) : strlen(path);
+
+		for (value = first; value; value = value->next)
+		{
+			if (value->name && !strncmp(value->name, path, length) && !value->name[length])
+				break;
+		}
+
+		if (!value || !slash)
+			return value;
+
+		first = value->children;
+		path = slash + 1;
+	}
+}
+
+/*
+ * returns the string at path, see gdb_mi_value_get_path()
+ */
+const gchar *gdb_mi_value_get_path_string(const gdb_mi_value *first, const gchar *path)
+{
+	const gdb_mi_value *value = gdb_mi_value_get_path(first, path);
+
+	return value && value->type == GDB_MI_VAL_STRING ? value->string : NULL;
+}
@@ -0,0 +1,76 @@
+/*
+ *      gdb_mi.h
+ *
+ *      Copyright 2010 Alexander Petukhov <devel(at)apetukhov.ru>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ */
+
+#ifndef GDB_MI_H
+#define GDB_MI_H
+
+#include <glib.h>
+
+/* GDB/MI value types */
+typedef enum _gdb_mi_value_type {
+	GDB_MI_VAL_STRING,
+	GDB_MI_VAL_TUPLE,
+	GDB_MI_VAL_LIST
+} gdb_mi_value_type;
+
+/* a value of an MI record, a node of the record tree */
+typedef struct _gdb_mi_value {
+	gdb_mi_value_type type;
+	/* variable name for results, NULL for bare values in lists */
+	const gchar *name;
+	/* unescaped c-string contents for GDB_MI_VAL_STRING */
+	const gchar *string;
+	/* first element for GDB_MI_VAL_TUPLE and GDB_MI_VAL_LIST */
+	struct _gdb_mi_value *children;
+	/* next element of the enclosing tuple or list */
+	struct _gdb_mi_value *next;
+} gdb_mi_value;
+
+/* a parsed MI output record */
+typedef struct _gdb_mi_record {
+	/* '^' result, '*' exec, '+' status, '=' notify, '~' console, '@' target, '&' log */
+	gchar type;
+	/* token preceding the record, NULL if none */
+	const gchar *token;
+	/* result or async class ("done", "stopped", ...), NULL for stream records */
+	const gchar *klass;
+	/* results of the record, or the string value of a stream record */
+	gdb_mi_value *first;
+	/* private */
+	gchar *text;
+	GSList *blocks;
+	guint block_size;
+	guint free_nodes;
+} gdb_mi_record;
+
+gdb_mi_record*			gdb_mi_record_parse(const gchar *line);
+void					gdb_mi_record_free(gdb_mi_record *record);
+gboolean				gdb_mi_record_matches(const gdb_mi_record *record, gchar type, const gchar *klass);
+
+const gdb_mi_value*		gdb_mi_value_get(const gdb_mi_value *first, const gchar *name);
+const gchar*			gdb_mi_value_get_string(const gdb_mi_value *first, const gchar *name);
+const gdb_mi_value*		gdb_mi_value_get_path(const gdb_mi_value *first, const gchar *path);
+const gchar*			gdb_mi_value_get_path_string(const gdb_mi_value *first, const gchar *path);
+
+#define gdb_mi_record_get(record, name) gdb_mi_value_get((record)->first, (name))
+#define gdb_mi_record_get_string(record, name) gdb_mi_value_get_string((record)->first, (name))
+
+#endif /* guard */
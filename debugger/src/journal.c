@@ -0,0 +1,534 @@
+/*
+ *      journal.c
+ *
+ *      Copyright 2011 Alexander Petukhov <devel(at)apetukhov.ru>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ */
+
+/*
+ * 		Journaled keyfile
+ *
+ * 		Changes made to the keyfile are formatted as records and passed to
+ * 		a writing thread, which appends them to the journal file. When the
+ * 		journal grows larger than the keyfile, the writing thread saves the
+ * 		whole keyfile and empties the journal. On open, the records of the
+ * 		journal are replayed on the keyfile.
+ *
+ * 		A keyfile with groups owned by the journal belongs to someone else,
+ * 		who writes it from the main thread. The writing thread never saves
+ * 		it, as the two writes would race; the owner saves the groups along
+ * 		with its own and tells the journal, which then drops the records
+ * 		that were saved.
+ *
+ * 		A record is a line "checksum op[group]key=value", where op is '=' to
+ * 		set a key, '-' to remove a key and '!' to remove a group. A record
+ * 		with a wrong checksum or without a line end, left by a crash in the
+ * 		middle of a write, ends the replay. Replaying records that are
+ * 		already in the keyfile (a crash between saving the keyfile and
+ * 		emptying the journal) does no harm.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <glib/gstdio.h>
+
+#include "journal.h"
+
+/* a journal smaller than this is never compacted */
+#define COMPACT_SIZE (64 * 1024)
+
+struct _journal {
+	/* keyfile path */
+	gchar *path;
+	/* journal file path */
+	gchar *journal_path;
+	/* groups of the keyfile owned by the journal, NULL if the journal saves the whole keyfile */
+	gchar **groups;
+	/* keyfile, used from the calling thread only */
+	GKeyFile *keyfile;
+	/* records to write */
+	GAsyncQueue *queue;
+	/* writing thread */
+	GThread *thread;
+	/* flush requests and completions */
+	GMutex *mutex;
+	GCond *flushed;
+	guint flush_requests;
+	guint flush_completions;
+};
+
+/* control records */
+static gchar flush_record[] = "flush";
+static gchar quit_record[] = "quit";
+static gchar saving_record[] = "saving";
+static gchar saved_record[] = "saved";
+
+/*
+ * FNV-1a hash of a record body
+ */
+static guint32 checksum(const gchar *text, gsize length)
+{
+	guint32 hash = 2166136261U;
+	gsize i;
+
+	for (i = 0; i < length; i++)
+	{
+		hash ^= (guchar)text[i];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+/*
+ * formats a record line
+ */
+static gchar *format_record(gchar op, const gchar *group, const gchar *key, const gchar *value)
+{
+	gchar *body = g_strdup_printf("%c[%s]%s%s%s", op, group, key ? key : "",
+		value ? "=" : "", value ? value : "");
+	gchar *record = g_strdup_printf("%08x %s\n", checksum(body, strlen(body)), body);
+
+	g_free(body);
+
+	return record;
+}
+
+/*
+ * applies a record line of length bytes (without the line end) to a keyfile,
+ * returns FALSE if the record is damaged
+ */
+static gboolean apply_record(GKeyFile *keyfile, const gchar *line, gsize length)
+{
+	gchar *body, *group, *key;
+	gchar sum[9];
+	gboolean ok = FALSE;
+
+	if (length < 12 || line[8] != ' ' || line[10] != '[')
+		return FALSE;
+
+	g_snprintf(sum, sizeof(sum), "%08x", checksum(line + 9, length - 9));
+	if (memcmp(line, sum, 8))
+		return FALSE;
+
+	body = g_strndup(line + 9, length - 9);
+	group = body + 2;
+	if ((key = strchr(group, ']')))
+	{
+		*key++ = '\0';
+		switch (*body)
+		{
+			case '=':
+			{
+				gchar *value = strchr(key, '=');
+				if (value)
+				{
+					*value++ = '\0';
+					g_key_file_set_value(keyfile, group, key, value);
+					ok = TRUE;
+				}
+				break;
+			}
+			case '-':
+				g_key_file_remove_key(keyfile, group, key, NULL);
+				ok = TRUE;
+				break;
+			case '!':
+				g_key_file_remove_group(keyfile, group, NULL);
+				ok = TRUE;
+				break;
+		}
+	}
+	g_free(body);
+
+	return ok;
+}
+
+/*
+ * loads a keyfile and replays the journal on it, sets *size to the size of the valid records;
+ * returns FALSE if the journal has a damaged tail
+ */
+static gboolean load_keyfile(journal *j, GKeyFile *keyfile, gsize *size)
+{
+	gchar *data, *pos, *end;
+	gsize length;
+	gboolean ok = TRUE;
+
+	g_key_file_load_from_file(keyfile, j->path, G_KEY_FILE_KEEP_COMMENTS | G_KEY_FILE_KEEP_TRANSLATIONS, NULL);
+
+	*size = 0;
+	if (!g_file_get_contents(j->journal_path, &data, &length, NULL))
+		return TRUE;
+
+	for (pos = data; pos < data + length; pos = end + 1)
+	{
+		end = memchr(pos, '\n', data + length - pos);
+		if (!end || !apply_record(keyfile, pos, end - pos))
+		{
+			ok = FALSE;
+			break;
+		}
+	}
+	*size = pos - data;
+	g_free(data);
+
+	return ok;
+}
+
+/*
+ * saves the keyfile and empties the journal
+ */
+static gboolean compact(journal *j, GKeyFile *keyfile, int fd)
+{
+	gsize length;
+	gchar *data = g_key_file_to_data(keyfile, &length, NULL);
+	/* the keyfile is replaced atomically, the journal can be emptied afterwards */
+	gboolean ok = g_file_set_contents(j->path, data, length, NULL) && (fd == -1 || !ftruncate(fd, 0));
+
+	g_free(data);
+
+	return ok;
+}
+
+/*
+ * writes a buffer to a file
+ */
+static gboolean write_all(int fd, const gchar *buffer, gsize length)
+{
+	while (length)
+	{
+		gssize written = write(fd, buffer, length);
+		if (written < 0)
+		{
+			if (EINTR == errno)
+				continue;
+			return FALSE;
+		}
+		buffer += written;
+		length -= written;
+	}
+
+	return TRUE;
+}
+
+/*
+ * appends the batch to the journal and empties it, adds the bytes written to *size
+ */
+static void write_batch(journal *j, int fd, GString *batch, gsize *size)
+{
+	if (batch->len)
+	{
+		if (fd != -1 && write_all(fd, batch->str, batch->len))
+			*size += batch->len;
+		else if (!j->groups)
+			/* couldn't append, save the keyfile instead */
+			*size = G_MAXSIZE;
+		g_string_truncate(batch, 0);
+	}
+}
+
+/*
+ * drops the first saved bytes of the journal, which the owner of the keyfile has saved,
+ * and subtracts them from *size; returns the descriptor to append to
+ */
+static int drop_saved(journal *j, int fd, gsize saved, gsize *size)
+{
+	gsize length = *size - saved;
+	gchar *tail;
+	gboolean ok;
+
+	if (fd == -1 || *size == G_MAXSIZE)
+		return fd;
+	if (!length)
+	{
+		if (!ftruncate(fd, 0))
+			*size = 0;
+		return fd;
+	}
+
+	/* keep the records written since, replacing the journal atomically */
+	tail = g_malloc(length);
+	ok = pread(fd, tail, length, saved) == (gssize)length &&
+		g_file_set_contents(j->journal_path, tail, length, NULL);
+	g_free(tail);
+	if (ok)
+	{
+		close(fd);
+		fd = g_open(j->journal_path, O_RDWR | O_APPEND, 0600);
+		*size = length;
+	}
+
+	return fd;
+}
+
+/*
+ * writing thread function
+ */
+static gpointer writing_thread_func(gpointer data)
+{
+	journal *j = (journal*)data;
+	GKeyFile *keyfile = g_key_file_new();
+	GString *batch = g_string_new(NULL);
+	gsize size, saved_size, saving_size;
+	gboolean quit = FALSE;
+	int fd;
+
+	/* the thread keeps its own copy of the keyfile to save */
+	gboolean ok = load_keyfile(j, keyfile, &size);
+	saved_size = 0;
+	/* journal size when the owner of the keyfile started saving it */
+	saving_size = G_MAXSIZE;
+
+	fd = g_open(j->journal_path, O_RDWR | O_APPEND | O_CREAT, 0600);
+	if (!ok && fd != -1 && ftruncate(fd, size))
+	{
+		/* damaged tail must not be followed by new records */
+		close(fd);
+		fd = -1;
+	}
+
+	while (!quit)
+	{
+		gchar *record = (gchar*)g_async_queue_pop(j->queue);
+		gboolean flush = FALSE;
+
+		/* take all the records queued */
+		do
+		{
+			if (flush_record == record)
+				flush = TRUE;
+			else if (quit_record == record)
+				quit = TRUE;
+			else if (saving_record == record)
+			{
+				/* the records before are being saved, the ones after are not */
+				write_batch(j, fd, batch, &size);
+				saving_size = size;
+			}
+			else if (saved_record == record)
+			{
+				write_batch(j, fd, batch, &size);
+				if (saving_size != G_MAXSIZE)
+					fd = drop_saved(j, fd, saving_size, &size);
+				saving_size = G_MAXSIZE;
+			}
+			else
+			{
+				apply_record(keyfile, record, strlen(record) - 1);
+				g_string_append(batch, record);
+				g_free(record);
+			}
+		}
+		while (!quit && (record = (gchar*)g_async_queue_try_pop(j->queue)));
+
+		write_batch(j, fd, batch, &size);
+
+		/* the keyfile of an owner is only saved by the owner */
+		if (!j->groups && size && (quit || (size > COMPACT_SIZE && size > saved_size)))
+		{
+			if (compact(j, keyfile, fd))
+			{
+				struct stat st;
+				saved_size = g_stat(j->path, &st) ? 0 : st.st_size;
+				size = 0;
+			}
+		}
+
+		if (flush)
+		{
+			g_mutex_lock(j->mutex);
+			j->flush_completions++;
+			g_cond_broadcast(j->flushed);
+			g_mutex_unlock(j->mutex);
+		}
+	}
+
+	if (fd != -1)
+		close(fd);
+	/* everything is in the keyfile now */
+	if (!size)
+		g_unlink(j->journal_path);
+
+	g_string_free(batch, TRUE);
+	g_key_file_free(keyfile);
+
+	return NULL;
+}
+
+/*
+ * opens the keyfile at path with the journal at journal_path and starts the writing thread;
+ * if groups is not NULL, the keyfile belongs to someone else, who saves those groups
+ * and calls journal_saving() and journal_saved()
+ */
+journal *journal_open(const gchar *path, const gchar *journal_path, const gchar **groups)
+{
+	journal *j = g_new0(journal, 1);
+	gsize size;
+
+	j->path = g_strdup(path);
+	j->journal_path = g_strdup(journal_path);
+	j->groups = groups ? g_strdupv((gchar**)groups) : NULL;
+	j->keyfile = g_key_file_new();
+	load_keyfile(j, j->keyfile, &size);
+
+	if (!g_thread_supported())
+		g_thread_init(NULL);
+
+	j->queue = g_async_queue_new();
+	j->mutex = g_mutex_new();
+	j->flushed = g_cond_new();
+	j->thread = g_thread_create(writing_thread_func, j, TRUE, NULL);
+
+	return j;
+}
+
+/*
+ * waits until all the changes are written
+ */
+void journal_flush(journal *j)
+{
+	guint request;
+
+	g_mutex_lock(j->mutex);
+	request = ++j->flush_requests;
+	g_async_queue_push(j->queue, flush_record);
+	while (j->flush_completions < request)
+		g_cond_wait(j->flushed, j->mutex);
+	g_mutex_unlock(j->mutex);
+}
+
+/*
+ * tells that the owner of the keyfile is saving the groups with all the changes made so far
+ */
+void journal_saving(journal *j)
+{
+	g_async_queue_push(j->queue, saving_record);
+}
+
+/*
+ * tells that the save started by journal_saving() is on disk,
+ * so the journal can drop the changes it holds
+ */
+void journal_saved(journal *j)
+{
+	g_async_queue_push(j->queue, saved_record);
+}
+
+/*
+ * saves all the changes to the keyfile (unless it has an owner), stops the writing thread and frees the journal
+ */
+void journal_close(journal *j)
+{
+	g_async_queue_push(j->queue, quit_record);
+	g_thread_join(j->thread);
+
+	g_async_queue_unref(j->queue);
+	g_mutex_free(j->mutex);
+	g_cond_free(j->flushed);
+	g_key_file_free(j->keyfile);
+	g_strfreev(j->groups);
+	g_free(j->journal_path);
+	g_free(j->path);
+	g_free(j);
+}
+
+/*
+ * gets the keyfile, it must not be changed directly
+ */
+GKeyFile *journal_get_keyfile(journal *j)
+{
+	return j->keyfile;
+}
+
+/*
+ * gets the keyfile path
+ */
+const gchar *journal_get_path(journal *j)
+{
+	return j->path;
+}
+
+/*
+ * queues a record if the value of a key has been changed,
+ * takes the ownership of the previous value
+ */
+static void key_changed(journal *j, const gchar *group, const gchar *key, gchar *previous)
+{
+	gchar *value = g_key_file_get_value(j->keyfile, group, key, NULL);
+
+	if (g_strcmp0(previous, value))
+		g_async_queue_push(j->queue, format_record('=', group, key, value));
+
+	g_free(value);
+	g_free(previous);
+}
+
+/*
+ * value setters
+ */
+void journal_set_string(journal *j, const gchar *group, const gchar *key, const gchar *value)
+{
+	gchar *previous = g_key_file_get_value(j->keyfile, group, key, NULL);
+	g_key_file_set_string(j->keyfile, group, key, value ? value : "");
+	key_changed(j, group, key, previous);
+}
+void journal_set_integer(journal *j, const gchar *group, const gchar *key, gint value)
+{
+	gchar *previous = g_key_file_get_value(j->keyfile, group, key, NULL);
+	g_key_file_set_integer(j->keyfile, group, key, value);
+	key_changed(j, group, key, previous);
+}
+void journal_set_boolean(journal *j, const gchar *group, const gchar *key, gboolean value)
+{
+	gchar *previous = g_key_file_get_value(j->keyfile, group, key, NULL);
+	g_key_file_set_boolean(j->keyfile, group, key, value);
+	key_changed(j, group, key, previous);
+}
+void journal_set_integer_list(journal *j, const gchar *group, const gchar *key, gint *list, gsize length)
+{
+	gchar *previous = g_key_file_get_value(j->keyfile, group, key, NULL);
+	g_key_file_set_integer_list(j->keyfile, group, key, list, length);
+	key_changed(j, group, key, previous);
+}
+
+/*
+ * removes a key
+ */
+void journal_remove_key(journal *j, const gchar *group, const gchar *key)
+{
+	if (g_key_file_has_key(j->keyfile, group, key, NULL))
+	{
+		g_key_file_remove_key(j->keyfile, group, key, NULL);
+		g_async_queue_push(j->queue, format_record('-', group, key, NULL));
+	}
+}
+
+/*
+ * removes a group
+ */
+void journal_remove_group(journal *j, const gchar *group)
+{
+	if (g_key_file_has_group(j->keyfile, group))
+	{
+		g_key_file_remove_group(j->keyfile, group, NULL);
+		g_async_queue_push(j->queue, format_record('!', group, NULL, NULL));
+	}
+}
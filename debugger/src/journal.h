@@ -0,0 +1,46 @@
+/*
+ *      journal.h
+ *
+ *      Copyright 2011 Alexander Petukhov <devel(at)apetukhov.ru>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ */
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <glib.h>
+
+/* a keyfile which changes are appended to a journal on a writing thread */
+typedef struct _journal journal;
+
+journal*		journal_open(const gchar *path, const gchar *journal_path, const gchar **groups);
+void			journal_close(journal *j);
+void			journal_flush(journal *j);
+void			journal_saving(journal *j);
+void			journal_saved(journal *j);
+
+GKeyFile*		journal_get_keyfile(journal *j);
+const gchar*	journal_get_path(journal *j);
+
+void			journal_set_string(journal *j, const gchar *group, const gchar *key, const gchar *value);
+void			journal_set_integer(journal *j, const gchar *group, const gchar *key, gint value);
+void			journal_set_boolean(journal *j, const gchar *group, const gchar *key, gboolean value);
+void			journal_set_integer_list(journal *j, const gchar *group, const gchar *key, gint *list, gsize length);
+void			journal_remove_key(journal *j, const gchar *group, const gchar *key);
+void			journal_remove_group(journal *j, const gchar *group);
+
+#endif /* guard */
@@ -50,6 +50,7 @@ enum
    S_HAVE_SOURCE,
    S_THREAD_ID,
    S_ACTIVE,
+   S_MORE,
    S_N_COLUMNS
 };
 
@@ -63,6 +64,14 @@ static int active_frame_index = 0;
 /* callbacks */
 static select_frame_cb select_frame = NULL;
 static move_to_line_cb move_to_line = NULL;
+static more_frames_cb more_frames = NULL;
+
+/* "more frames" row at the end of the active thread frames, if the stack is not loaded completely */
+static GtkTreeRowReference *more_frames_row = NULL;
+/* idle source to check whether "more frames" row is visible */
+static guint more_frames_source = 0;
+/* vertical adjustment the tree scrolling is watched on */
+static GtkAdjustment *watched_adjustment = NULL;
 
 /* tree view, model and store handles */
 static GtkWidget *tree = NULL;
@@ -155,7 +164,9 @@ static void on_render_arrow(GtkTreeViewColumn *tree_column, GtkCellRenderer *cel
 	GtkTreeIter *iter, gpointer data)
 {
 	GtkTreePath *tpath = gtk_tree_model_get_path(model, iter);
-	g_object_set(cell, "visible", 1 != gtk_tree_path_get_depth(tpath), NULL);
+	gboolean more;
+	gtk_tree_model_get(model, iter, S_MORE, &more, -1);
+	g_object_set(cell, "visible", 1 != gtk_tree_path_get_depth(tpath) && !more, NULL);
 	gtk_tree_path_free(tpath);
 }
 
@@ -166,8 +177,10 @@ static void on_render_line(GtkTreeViewColumn *tree_column, GtkCellRenderer *cell
 	GtkTreeIter *iter, gpointer data)
 {
 	GtkTreePath *tpath = gtk_tree_model_get_path(model, iter);
+	gboolean more;
+	gtk_tree_model_get(model, iter, S_MORE, &more, -1);
 
-	if (1 == gtk_tree_path_get_depth(tpath))
+	if (1 == gtk_tree_path_get_depth(tpath) || more)
 	{
 		g_object_set(cell, "text", "", NULL);
 	}
@@ -205,6 +218,74 @@ static void on_render_filename(GtkTreeViewColumn *tree_column, GtkCellRenderer *
 	gtk_tree_path_free(tpath);
 }
 
+/*
+ *  checks whether "more frames" row is within the visible range of the tree
+ */
+static gboolean is_more_frames_visible(void)
+{
+	gboolean visible = FALSE;
+	GtkTreePath *start, *end;
+
+	if (more_frames_row && gtk_tree_row_reference_valid(more_frames_row) &&
+		gtk_tree_view_get_visible_range(GTK_TREE_VIEW(tree), &start, &end))
+	{
+		GtkTreePath *more = gtk_tree_row_reference_get_path(more_frames_row);
+		visible = gtk_tree_path_compare(more, end) <= 0;
+
+		gtk_tree_path_free(more);
+		gtk_tree_path_free(start);
+		gtk_tree_path_free(end);
+	}
+
+	return visible;
+}
+
+/*
+ *  requests the next frames page if "more frames" row has been scrolled into view
+ */
+static gboolean on_check_more_frames(gpointer data)
+{
+	more_frames_source = 0;
+	if (is_more_frames_visible())
+	{
+		more_frames();
+	}
+
+	return FALSE;
+}
+
+/*
+ *  requests the next frames page unconditionally
+ */
+static gboolean on_load_more_frames(gpointer data)
+{
+	more_frames_source = 0;
+	more_frames();
+
+	return FALSE;
+}
+
+/*
+ *  schedules the check of "more frames" row visibility (or the load of the next frames if force is set),
+ *  the check is done when the tree has been laid out
+ */
+static void check_more_frames(gboolean force)
+{
+	if (!more_frames_source && more_frames_row)
+	{
+		more_frames_source = g_idle_add_full(G_PRIORITY_LOW,
+			force ? on_load_more_frames : on_check_more_frames, NULL, NULL);
+	}
+}
+
+/*
+ *  tree scrolled callback
+ */
+static void on_scrolled(GtkAdjustment *adjustment, gpointer user_data)
+{
+	check_more_frames(FALSE);
+}
+
 /*
  *  Handles same tree row click to open frame position
  */
@@ -283,7 +364,7 @@ static void on_selection_changed(GtkTreeSelection *treeselection, gpointer user_
 
 	if (2 == gtk_tree_path_get_depth(path))
 	{
-		gboolean have_source;
+		gboolean have_source, more;
 		GtkTreeIter iter;
 
 		gtk_tree_model_get_iter (
@@ -294,10 +375,16 @@ static void on_selection_changed(GtkTreeSelection *treeselection, gpointer user_
 			gtk_tree_view_get_model(GTK_TREE_VIEW(tree)),
 			&iter,
 			S_HAVE_SOURCE, &have_source,
+			S_MORE, &more,
 			-1);
 		
+		/* load next frames if "more frames" row has been selected */
+		if (more)
+		{
+			check_more_frames(TRUE);
+		}
 		/* check if file name is not empty and we have source files for the frame */
-		if (have_source)
+		else if (have_source)
 		{
 			gchar *file;
 			gint line;
@@ -320,13 +407,14 @@ static void on_selection_changed(GtkTreeSelection *treeselection, gpointer user_
 /*
  *	inits stack trace tree
  */
-GtkWidget* stree_init(move_to_line_cb ml, select_frame_cb sf)
+GtkWidget* stree_init(move_to_line_cb ml, select_frame_cb sf, more_frames_cb mf)
 {
 	GtkTreeViewColumn *column;
 	GtkCellRenderer *renderer;
 
 	move_to_line = ml;
 	select_frame = sf;
+	more_frames = mf;
 
 	/* create tree view */
 	store = gtk_tree_store_new (
@@ -338,6 +426,7 @@ GtkWidget* stree_init(move_to_line_cb ml, select_frame_cb sf)
 		G_TYPE_STRING,
 		G_TYPE_INT,
 		G_TYPE_INT,
+		G_TYPE_INT,
 		G_TYPE_INT);
 		
 	model = GTK_TREE_MODEL(store);
@@ -424,7 +513,20 @@ void stree_add(frame *f)
 	gtk_tree_model_get_iter(model, &thread_iter, path);
 	gtk_tree_path_free(path);
 
-	gtk_tree_store_insert_before(store, &frame_iter, &thread_iter, 0);
+	if (more_frames_row)
+	{
+		/* keep "more frames" row last */
+		GtkTreeIter more_iter;
+		path = gtk_tree_row_reference_get_path(more_frames_row);
+		gtk_tree_model_get_iter(model, &more_iter, path);
+		gtk_tree_path_free(path);
+
+		gtk_tree_store_insert_before(store, &frame_iter, &thread_iter, &more_iter);
+	}
+	else
+	{
+		gtk_tree_store_insert_before(store, &frame_iter, &thread_iter, 0);
+	}
 
 	gtk_tree_store_set (store, &frame_iter,
                     S_ADRESS, f->address,
@@ -440,6 +542,7 @@ void stree_add(frame *f)
  */
 void stree_clear(void)
 {
+	stree_set_more_frames(FALSE);
 	gtk_tree_store_clear(store);
 	g_hash_table_remove_all(threads);
 }
@@ -484,6 +587,14 @@ void stree_select_first_frame(gboolean make_active)
  */
 void stree_destroy(void)
 {
+	stree_set_more_frames(FALSE);
+	if (watched_adjustment)
+	{
+		g_signal_handlers_disconnect_by_func(watched_adjustment, on_scrolled, NULL);
+		g_object_unref(watched_adjustment);
+		watched_adjustment = NULL;
+	}
+
 	if (threads)
 	{
 		g_hash_table_destroy(threads);
@@ -554,6 +665,11 @@ void stree_remove_thread(int thread_id)
 	GtkTreeIter iter;
 	gtk_tree_model_get_iter(model, &iter, tpath);
 
+	if (thread_id == active_thread_id)
+	{
+		stree_set_more_frames(FALSE);
+	}
+
 	gtk_tree_store_remove(store, &iter);
 
 	g_hash_table_remove(threads, (gpointer)(glong)thread_id);
@@ -573,6 +689,8 @@ void stree_remove_frames(void)
 	gtk_tree_model_get_iter(model, &thread_iter, tpath);
 	gtk_tree_path_free(tpath);
 
+	stree_set_more_frames(FALSE);
+
 	if (gtk_tree_model_iter_children(model, &child, &thread_iter))
 	{
 		while(gtk_tree_store_remove(GTK_TREE_STORE(model), &child))
@@ -587,3 +705,67 @@ void stree_set_active_thread_id(int thread_id)
 {
 	active_thread_id = thread_id;
 }
+
+/*
+ *	add or remove "more frames" row at the end of the active thread frames,
+ *	the next frames are requested when the row is scrolled into view or selected
+ */
+void stree_set_more_frames(gboolean more)
+{
+	if (more && !more_frames_row)
+	{
+		GtkTreeRowReference *reference = (GtkTreeRowReference*)g_hash_table_lookup(threads, (gpointer)active_thread_id);
+		GtkTreePath *tpath = gtk_tree_row_reference_get_path(reference);
+		GtkTreeIter thread_iter, more_iter;
+		GtkAdjustment *adjustment;
+
+		gtk_tree_model_get_iter(model, &thread_iter, tpath);
+		gtk_tree_path_free(tpath);
+
+		gtk_tree_store_append(store, &more_iter, &thread_iter);
+		gtk_tree_store_set (store, &more_iter,
+						S_ADRESS, _("More frames..."),
+						S_MORE, TRUE,
+						-1);
+
+		tpath = gtk_tree_model_get_path(model, &more_iter);
+		more_frames_row = gtk_tree_row_reference_new(model, tpath);
+		gtk_tree_path_free(tpath);
+
+		/* the scrolled window sets its own adjustment to the tree */
+		adjustment = gtk_tree_view_get_vadjustment(GTK_TREE_VIEW(tree));
+		if (adjustment != watched_adjustment)
+		{
+			if (watched_adjustment)
+			{
+				g_signal_handlers_disconnect_by_func(watched_adjustment, on_scrolled, NULL);
+				g_object_unref(watched_adjustment);
+			}
+			watched_adjustment = g_object_ref(adjustment);
+			g_signal_connect(G_OBJECT(adjustment), "value-changed", G_CALLBACK(on_scrolled), NULL);
+			/* the tree has been resized or shown */
+			g_signal_connect(G_OBJECT(adjustment), "changed", G_CALLBACK(on_scrolled), NULL);
+		}
+	}
+	else if (!more && more_frames_row)
+	{
+		if (gtk_tree_row_reference_valid(more_frames_row))
+		{
+			GtkTreePath *tpath = gtk_tree_row_reference_get_path(more_frames_row);
+			GtkTreeIter iter;
+
+			gtk_tree_model_get_iter(model, &iter, tpath);
+			gtk_tree_store_remove(store, &iter);
+			gtk_tree_path_free(tpath);
+		}
+		gtk_tree_row_reference_free(more_frames_row);
+		more_frames_row = NULL;
+	}
+
+	if (more_frames_source)
+	{
+		g_source_remove(more_frames_source);
+		more_frames_source = 0;
+	}
+	check_more_frames(FALSE);
+}
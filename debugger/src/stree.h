@@ -28,7 +28,7 @@
 #include "breakpoints.h"
 #include "debug_module.h"
 
-GtkWidget*		stree_init(move_to_line_cb ml, select_frame_cb sf);
+GtkWidget*		stree_init(move_to_line_cb ml, select_frame_cb sf, more_frames_cb mf);
 void			stree_destroy(void);
 
 void 			stree_add(frame *f);
@@ -39,6 +39,7 @@ void 			stree_remove_thread(int thread_id);
 
 void 			stree_select_first_frame(gboolean make_active);
 void 			stree_remove_frames(void);
+void			stree_set_more_frames(gboolean more);
 
 void			stree_set_active_thread_id(int thread_id);
 
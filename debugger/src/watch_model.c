@@ -82,71 +82,113 @@ inline static void add_stub(GtkTreeStore *store, GtkTreeIter *parent)
 }
 
 /*
- * insert all "vars" members to "parent" iterator in the "tree" as new children
- * mark_changed specifies whether to mark new items as beed changed
- * expand specifies whether to expand to the added children
+ * checks whether two iterators point to the same row,
+ * tree store iterators persist while the row exists
  */
-inline static void append_variables(GtkTreeView *tree, GtkTreeIter *parent, GList *vars,
-	gboolean mark_changed, gboolean expand)
+inline static gboolean same_row(GtkTreeIter *a, GtkTreeIter *b)
+{
+	return a->user_data == b->user_data;
+}
+
+/*
+ * creates a "name -> row iterator" index of all named children of "parent"
+ */
+static GHashTable *index_rows(GtkTreeModel *model, GtkTreeIter *parent)
 {
-	int current_position = 0;
-	GtkTreeModel *model = gtk_tree_view_get_model(tree);
-	GtkTreeStore *store = GTK_TREE_STORE(model);
 	GtkTreeIter child;
-	GHashTable *ht = NULL;
+	GHashTable *ht = g_hash_table_new_full(g_str_hash, g_str_equal, (GDestroyNotify)g_free, (GDestroyNotify)g_free);
 
-	/* get existing rows */
-	if (gtk_tree_model_iter_n_children(model, parent))
+	if (gtk_tree_model_iter_children(model, &child, parent))
 	{
-		/* collect all existing rows */
-		gtk_tree_model_iter_children(model, &child, parent);
-		
-		ht = g_hash_table_new_full(g_str_hash, g_str_equal, (GDestroyNotify)g_free, (GDestroyNotify)gtk_tree_row_reference_free);
-		
 		do
 		{
 			gchar *name = NULL;
 			gtk_tree_model_get(model, &child, W_NAME, &name, -1);
 			if (name && strlen(name))
 			{
-				GtkTreePath *path = gtk_tree_model_get_path(model, &child);
-				g_hash_table_insert(ht, name, gtk_tree_row_reference_new(model, path));
-				gtk_tree_path_free(path);
+				g_hash_table_insert(ht, name, g_memdup(&child, sizeof(GtkTreeIter)));
+			}
+			else
+			{
+				g_free(name);
 			}
 		}
 		while(gtk_tree_model_iter_next(model, &child));
 	}
-	
+
+	return ht;
+}
+
+/*
+ * creates a "name -> variable" index of the "vars" list,
+ * the first variable wins if names repeat
+ */
+static GHashTable *index_variables(GList *vars)
+{
+	GHashTable *ht = g_hash_table_new(g_str_hash, g_str_equal);
+	for (; vars; vars = vars->next)
+	{
+		variable *v = (variable*)vars->data;
+		if (!g_hash_table_lookup(ht, v->name->str))
+		{
+			g_hash_table_insert(ht, v->name->str, v);
+		}
+	}
+
+	return ht;
+}
+
+/*
+ * insert all "vars" members to "parent" iterator in the "tree" as new children
+ * mark_changed specifies whether to mark new items as beed changed
+ * expand specifies whether to expand to the added children
+ */
+inline static void append_variables(GtkTreeView *tree, GtkTreeIter *parent, GList *vars,
+	gboolean mark_changed, gboolean expand)
+{
+	GtkTreeModel *model = gtk_tree_view_get_model(tree);
+	GtkTreeStore *store = GTK_TREE_STORE(model);
+	GtkTreeIter child, previous;
+	gboolean has_previous = FALSE;
+
+	/* existing rows by name, iterators stay valid while rows are moved and inserted */
+	GHashTable *ht = index_rows(model, parent);
+
 	while (vars)
 	{
 		variable *v = vars->data;
-		
-		GtkTreeRowReference *reference = NULL;
-		if (ht && (reference = g_hash_table_lookup (ht, v->name->str)))
+		GtkTreeIter *row = g_hash_table_lookup(ht, v->name->str);
+
+		if (row)
 		{
-			GtkTreePath *path = gtk_tree_row_reference_get_path(reference);
-			if (current_position != gtk_tree_path_get_indices(path)[0])
+			/* a repeated name refers to the row that has just been placed */
+			if (!has_previous || !same_row(row, &previous))
 			{
-				/* move a row if not at it's place */
-				GtkTreeIter iter;
-				gtk_tree_model_get_iter(model, &iter, path);
-				if (current_position)
+				/* the row expected at the current position */
+				GtkTreeIter expected;
+				gboolean at_place;
+				if (has_previous)
 				{
-					GtkTreeIter insert_after;	
-					gtk_tree_model_iter_nth_child(model, &insert_after, parent, current_position - 1);
-					gtk_tree_store_move_after(store, &iter, &insert_after);
+					expected = previous;
+					at_place = gtk_tree_model_iter_next(model, &expected);
 				}
 				else
 				{
-					gtk_tree_store_move_after(store, &iter, NULL);
+					at_place = gtk_tree_model_iter_children(model, &expected, parent);
+				}
+
+				/* move a row if not at it's place */
+				if (!at_place || !same_row(row, &expected))
+				{
+					gtk_tree_store_move_after(store, row, has_previous ? &previous : NULL);
 				}
 			}
 
-			gtk_tree_path_free(path);
+			child = *row;
 		}
 		else
 		{
-			gtk_tree_store_insert(store, &child, parent, current_position);
+			gtk_tree_store_insert_after(store, &child, parent, has_previous ? &previous : NULL);
 			gtk_tree_store_set (store, &child,
 				W_NAME, v->name->str,
 				W_VALUE, v->value->str,
@@ -157,7 +199,7 @@ inline static void append_variables(GtkTreeView *tree, GtkTreeIter *parent, GLis
 				W_CHANGED, mark_changed,
 				W_VT, v->vt,
 				-1);
-			
+
 			/* expand to row if we were asked to */
 			if (expand)
 			{
@@ -165,38 +207,19 @@ inline static void append_variables(GtkTreeView *tree, GtkTreeIter *parent, GLis
 				gtk_tree_view_expand_row(tree, path, FALSE);
 				gtk_tree_path_free(path);
 			}
-			
+
 			/* add stub if added child also have children */
 			if (v->has_children)
 				add_stub(store, &child);
 		}
-		
+
 		/* move to next variable */
+		previous = child;
+		has_previous = TRUE;
 		vars = vars->next;
-		current_position++;
 	}
-	
-	if (ht)
-	{
-		g_hash_table_destroy(ht);
-	}
-}
 
-/*
- * looks up a variable with corresponding name in the list
- */
-inline static GList *lookup_variable(GList *vars, gchar *name)
-{
-	GList *var = vars;
-	while (var)
-	{
-		variable *v = (variable*)var->data; 
-		if (!strcmp(v->name->str, name))
-			break;
-		var = var->next;
-	}
-	
-	return var;
+	g_hash_table_destroy(ht);
 }
 
 /*
@@ -227,6 +250,40 @@ static void update_variable(GtkTreeStore *store, GtkTreeIter *iter, variable *va
 		-1);
 } 
 
+/*
+ * checks whether a row already shows a variable the way update_variable() sets it,
+ * every update emits "row-changed" so unchanged rows are left alone
+ */
+static gboolean is_row_up_to_date(GtkTreeModel *model, GtkTreeIter *iter, variable *var, gboolean changed)
+{
+	gchar *value, *type, *internal, *expression;
+	gboolean stub, row_changed, up_to_date;
+	gint vt;
+
+	gtk_tree_model_get (model, iter,
+		W_VALUE, &value,
+		W_TYPE, &type,
+		W_INTERNAL, &internal,
+		W_EXPRESSION, &expression,
+		W_STUB, &stub,
+		W_CHANGED, &row_changed,
+		W_VT, &vt,
+		-1);
+
+	up_to_date = !stub && !row_changed == !changed && vt == (gint)var->vt &&
+		!strcmp(value, var->evaluated ? var->value->str : _("Can't evaluate expression")) &&
+		!strcmp(type, var->type->str) &&
+		!strcmp(internal, var->internal->str) &&
+		!strcmp(expression, var->expression->str);
+
+	g_free(value);
+	g_free(type);
+	g_free(internal);
+	g_free(expression);
+
+	return up_to_date;
+}
+
 /*
  * remove stub item and add vars to parent iterator
  */
@@ -302,13 +359,15 @@ void update_variables(GtkTreeView *tree, GtkTreeIter *parent, GList *vars)
 	/* walk through all children of "parent" iterator */
 	if (haschildren)
 	{
+		/* variables by name, to find each row's variable at once */
+		GHashTable *index = index_variables(vars);
+
 		/* if have children - lets check and update their values */
 		while (TRUE)
 		{
 			gchar *name;
 			gchar *internal;
 			gchar *value;
-			GList *var;
 			variable *v;
 			gboolean changed;
 
@@ -325,16 +384,24 @@ void update_variables(GtkTreeView *tree, GtkTreeIter *parent, GList *vars)
 				
 			/* miss empty row in watch tree */
 			if (!strlen(name))
+			{
+				g_free(name);
+				g_free(internal);
+				g_free(value);
 				break;
+			}
 			
 			/* 2. find this path is "vars" list */
-			var = lookup_variable(vars, name);
+			v = g_hash_table_lookup(index, name);
 
 			/* 3. check if we have found currect iterator */
-			if (!var)
+			if (!v)
 			{
 				/* if we haven't - remove current and try to move to the next one
 				in the same level */
+				g_free(name);
+				g_free(internal);
+				g_free(value);
 				
 				/* if gtk_tree_store_remove returns "true" - child is set to the next iterator,
 				if "false" - it was the last - then, exit the loop */
@@ -345,9 +412,9 @@ void update_variables(GtkTreeView *tree, GtkTreeIter *parent, GList *vars)
 			}
 			
 			/* 4. update variable (type, value) */
-			v = (variable*)var->data;
-			changed = parent_changed || strcmp(value, v->value->str);
-			update_variable(store, &child, v, changed && v->evaluated);
+			changed = (parent_changed || strcmp(value, v->value->str)) && v->evaluated;
+			if (!is_row_up_to_date(model, &child, v, changed))
+				update_variable(store, &child, v, changed);
 			
 			/* 5. if item have children - process them */ 		
 			if (gtk_tree_model_iter_has_child(model, &child))
@@ -396,6 +463,8 @@ void update_variables(GtkTreeView *tree, GtkTreeIter *parent, GList *vars)
 			if (!gtk_tree_model_iter_next(model, &child))
 				break;
 		}
+
+		g_hash_table_destroy(index);
 	}
 
 	/* insert items that are left in "vars" list */
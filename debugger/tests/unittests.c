@@ -0,0 +1,906 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <check.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+#include "gdb_mi.h"
+#include "journal.h"
+#include "debug_module.h"
+#include "watch_model.h"
+
+
+/* MI records as written by gdb 7.x */
+static const gchar *corpus[] =
+{
+	"~\"GNU gdb (GDB) 7.4.1\\n\"",
+	"=thread-group-added,id=\"i1\"",
+	"=thread-group-started,id=\"i1\",pid=\"12345\"",
+	"=thread-created,id=\"1\",group-id=\"i1\"",
+	"=library-loaded,id=\"/lib64/ld-linux-x86-64.so.2\",target-name=\"/lib64/ld-linux-x86-64.so.2\",host-name=\"/lib64/ld-linux-x86-64.so.2\",symbols-loaded=\"0\",thread-group=\"i1\"",
+	"^running",
+	"*running,thread-id=\"all\"",
+	"*stopped,reason=\"breakpoint-hit\",disp=\"keep\",bkptno=\"1\",frame={addr=\"0x00000000004004f8\",func=\"main\",args=[{name=\"argc\",value=\"1\"},{name=\"argv\",value=\"0x7fffffffe0d8\"}],file=\"test.c\",fullname=\"/home/user/test.c\",line=\"5\"},thread-id=\"1\",stopped-threads=\"all\",core=\"0\"",
+	"*stopped,reason=\"exited\",exit-code=\"01\"",
+	"*stopped,reason=\"exited-normally\"",
+	"=thread-exited,id=\"1\",group-id=\"i1\"",
+	"^done,stack=[frame={level=\"0\",addr=\"0x00000000004004f8\",func=\"inner\",file=\"test.c\",fullname=\"/home/user/test.c\",line=\"4\"},frame={level=\"1\",addr=\"0x00007ffff7a3c76d\",func=\"__libc_start_main\",from=\"/lib/x86_64-linux-gnu/libc.so.6\"}]",
+	"^done,BreakpointTable={nr_rows=\"2\",nr_cols=\"6\",hdr=[{width=\"7\",alignment=\"-1\",col_name=\"number\",colhdr=\"Num\"},{width=\"14\",alignment=\"-1\",col_name=\"type\",colhdr=\"Type\"}],body=[bkpt={number=\"1\",type=\"breakpoint\",disp=\"keep\",enabled=\"y\",addr=\"0x00000000004004f8\",func=\"main\",file=\"test.c\",fullname=\"/home/user/test.c\",line=\"5\",times=\"0\",original-location=\"\\\"/home/user/test.c\\\":5\"},bkpt={number=\"2\",type=\"breakpoint\",disp=\"keep\",enabled=\"y\",addr=\"0x0000000000400510\",func=\"main\",file=\"test.c\",fullname=\"/home/user/test.c\",line=\"9\",times=\"0\",script={\"silent\",\"continue\"},original-location=\"\\\"/home/user/test.c\\\":9\"}]}",
+	"^done,files=[{file=\"test.c\",fullname=\"/home/user/test.c\"},{file=\"/usr/include/stdio.h\",fullname=\"/usr/include/stdio.h\"},{file=\"test.c\",fullname=\"/home/user/test.c\"}]",
+	"^done,stack-args=[frame={level=\"0\",args=[name=\"argc\",name=\"argv\"]}]",
+	"^done,locals=[name=\"i\",name=\"str\"]",
+	"^done,numchild=\"2\",children=[child={name=\"var1.a\",exp=\"a\",numchild=\"0\",type=\"int\"},child={name=\"var1.b\",exp=\"b\",numchild=\"0\",type=\"char *\"}],has_more=\"0\"",
+	"^done,value=\"0x4005f4 \\\"hello, \\\\\\\"world\\\\\\\"\\\\n\\\"\"",
+	"^done,name=\"var1\",numchild=\"0\",value=\"1\",type=\"int\",thread-id=\"1\",has_more=\"0\"",
+	"^done,thread-ids={thread-id=\"2\",thread-id=\"1\"},current-thread-id=\"1\",number-of-threads=\"2\"",
+	"^error,msg=\"No symbol \\\"foo\\\" in current context.\"",
+	"&\"warning: Error disabling address space randomization: Operation not permitted\\n\"",
+	"12^done",
+	"^exit",
+	NULL
+};
+
+
+START_TEST(test_corpus)
+{
+	const gchar **line;
+
+	for (line = corpus; *line; line++)
+	{
+		gdb_mi_record *record = gdb_mi_record_parse(*line);
+		fail_unless(record != NULL, "failed to parse %s", *line);
+		gdb_mi_record_free(record);
+	}
+}
+
+END_TEST;
+
+START_TEST(test_stream)
+{
+	gdb_mi_record *record = gdb_mi_record_parse(corpus[0]);
+
+	fail_unless(record->type == '~');
+	fail_unless(record->klass == NULL);
+	fail_unless(record->first->type == GDB_MI_VAL_STRING);
+	fail_unless(strcmp(record->first->string, "GNU gdb (GDB) 7.4.1\n") == 0);
+	gdb_mi_record_free(record);
+}
+
+END_TEST;
+
+START_TEST(test_stopped)
+{
+	gdb_mi_record *record = gdb_mi_record_parse(corpus[7]);
+	const gdb_mi_value *args;
+
+	fail_unless(gdb_mi_record_matches(record, '*', "stopped"));
+	fail_unless(gdb_mi_record_matches(record, '*', NULL));
+	fail_unless(!gdb_mi_record_matches(record, '^', "stopped"));
+	fail_unless(!gdb_mi_record_matches(record, '*', "stop"));
+	fail_unless(strcmp(gdb_mi_record_get_string(record, "reason"), "breakpoint-hit") == 0);
+	fail_unless(strcmp(gdb_mi_record_get_string(record, "thread-id"), "1") == 0);
+	fail_unless(strcmp(gdb_mi_value_get_path_string(record->first, "frame/fullname"),
+			   "/home/user/test.c") == 0);
+	/* a tuple is not a string */
+	fail_unless(gdb_mi_record_get_string(record, "frame") == NULL);
+	fail_unless(gdb_mi_record_get_string(record, "missing") == NULL);
+	fail_unless(gdb_mi_value_get_path(record->first, "frame/missing") == NULL);
+
+	args = gdb_mi_value_get_path(record->first, "frame/args");
+	fail_unless(args->type == GDB_MI_VAL_LIST);
+	fail_unless(args->children->type == GDB_MI_VAL_TUPLE);
+	fail_unless(args->children->name == NULL);
+	fail_unless(strcmp(gdb_mi_value_get_string(args->children->next->children, "value"),
+			   "0x7fffffffe0d8") == 0);
+	fail_unless(args->children->next->next == NULL);
+	gdb_mi_record_free(record);
+}
+
+END_TEST;
+
+START_TEST(test_stack)
+{
+	gdb_mi_record *record = gdb_mi_record_parse(corpus[11]);
+	const gdb_mi_value *frame = gdb_mi_record_get(record, "stack")->children;
+
+	fail_unless(gdb_mi_record_matches(record, '^', "done"));
+	fail_unless(strcmp(frame->name, "frame") == 0);
+	fail_unless(strcmp(gdb_mi_value_get_string(frame->children, "func"), "inner") == 0);
+	fail_unless(strcmp(gdb_mi_value_get_string(frame->children, "line"), "4") == 0);
+	frame = frame->next;
+	fail_unless(gdb_mi_value_get_string(frame->children, "fullname") == NULL);
+	fail_unless(strcmp(gdb_mi_value_get_string(frame->children, "from"),
+			   "/lib/x86_64-linux-gnu/libc.so.6") == 0);
+	fail_unless(frame->next == NULL);
+	gdb_mi_record_free(record);
+}
+
+END_TEST;
+
+START_TEST(test_breakpoints)
+{
+	gdb_mi_record *record = gdb_mi_record_parse(corpus[12]);
+	const gdb_mi_value *bkpt = gdb_mi_value_get_path(record->first, "BreakpointTable/body");
+	const gdb_mi_value *script;
+
+	bkpt = bkpt->children;
+	fail_unless(strcmp(gdb_mi_value_get_string(bkpt->children, "original-location"),
+			   "\"/home/user/test.c\":5") == 0);
+	bkpt = bkpt->next;
+	fail_unless(strcmp(gdb_mi_value_get_string(bkpt->children, "number"), "2") == 0);
+	/* bare values in a tuple */
+	script = gdb_mi_value_get(bkpt->children, "script");
+	fail_unless(script->type == GDB_MI_VAL_TUPLE);
+	fail_unless(script->children->name == NULL);
+	fail_unless(strcmp(script->children->string, "silent") == 0);
+	fail_unless(strcmp(script->children->next->string, "continue") == 0);
+	fail_unless(strcmp(gdb_mi_value_get_string(bkpt->children, "original-location"),
+			   "\"/home/user/test.c\":9") == 0);
+	gdb_mi_record_free(record);
+}
+
+END_TEST;
+
+START_TEST(test_lists)
+{
+	gdb_mi_record *record;
+	const gdb_mi_value *value;
+
+	/* results in a list */
+	record = gdb_mi_record_parse(corpus[15]);
+	value = gdb_mi_record_get(record, "locals")->children;
+	fail_unless(strcmp(value->name, "name") == 0 && strcmp(value->string, "i") == 0);
+	fail_unless(strcmp(value->next->string, "str") == 0);
+	gdb_mi_record_free(record);
+
+	record = gdb_mi_record_parse(corpus[14]);
+	value = gdb_mi_value_get_path(record->first, "stack-args/frame/args");
+	fail_unless(strcmp(value->children->next->string, "argv") == 0);
+	gdb_mi_record_free(record);
+
+	/* repeated names in a tuple, the first one is found */
+	record = gdb_mi_record_parse(corpus[19]);
+	fail_unless(strcmp(gdb_mi_value_get_path_string(record->first, "thread-ids/thread-id"),
+			   "2") == 0);
+	gdb_mi_record_free(record);
+
+	/* empty list and tuple */
+	record = gdb_mi_record_parse("^done,a=[],b={},c=\"\"");
+	fail_unless(gdb_mi_record_get(record, "a")->children == NULL);
+	fail_unless(gdb_mi_record_get(record, "b")->type == GDB_MI_VAL_TUPLE);
+	fail_unless(strcmp(gdb_mi_record_get_string(record, "c"), "") == 0);
+	gdb_mi_record_free(record);
+}
+
+END_TEST;
+
+START_TEST(test_escapes)
+{
+	gdb_mi_record *record;
+
+	/* only the MI quoting is removed, the value keeps the C quoting of gdb */
+	record = gdb_mi_record_parse(corpus[17]);
+	fail_unless(strcmp(gdb_mi_record_get_string(record, "value"),
+			   "0x4005f4 \"hello, \\\"world\\\"\\n\"") == 0);
+	gdb_mi_record_free(record);
+
+	record = gdb_mi_record_parse(corpus[20]);
+	fail_unless(gdb_mi_record_matches(record, '^', "error"));
+	fail_unless(strcmp(gdb_mi_record_get_string(record, "msg"),
+			   "No symbol \"foo\" in current context.") == 0);
+	gdb_mi_record_free(record);
+
+	record = gdb_mi_record_parse("^done,value=\"\\101\\t\\033[0m\\\\\"");
+	fail_unless(strcmp(gdb_mi_record_get_string(record, "value"), "A\t\033[0m\\") == 0);
+	gdb_mi_record_free(record);
+
+	/* names inside values are not fields */
+	record = gdb_mi_record_parse("^done,value=\"frame={fullname=\\\"x\\\"}\",name=\"v\"");
+	fail_unless(gdb_mi_record_get(record, "fullname") == NULL);
+	fail_unless(gdb_mi_record_get(record, "frame") == NULL);
+	fail_unless(strcmp(gdb_mi_record_get_string(record, "name"), "v") == 0);
+	gdb_mi_record_free(record);
+}
+
+END_TEST;
+
+START_TEST(test_token)
+{
+	gdb_mi_record *record = gdb_mi_record_parse(corpus[22]);
+
+	fail_unless(gdb_mi_record_matches(record, '^', "done"));
+	fail_unless(strcmp(record->token, "12") == 0);
+	fail_unless(record->first == NULL);
+	gdb_mi_record_free(record);
+
+	record = gdb_mi_record_parse("^done\n");
+	fail_unless(record->token == NULL);
+	fail_unless(gdb_mi_record_matches(record, '^', "done"));
+	gdb_mi_record_free(record);
+}
+
+END_TEST;
+
+START_TEST(test_malformed)
+{
+	static const gchar *lines[] =
+	{
+		"(gdb) ",
+		"",
+		"^done,stack=[frame={level=\"0\"",
+		"^done,value=\"unterminated",
+		"^done,value=\"trailing\\",
+		"^done,=\"x\"",
+		"^done,value",
+		"^done,value=x",
+		"^done,a={b=\"1\"]",
+		"^done,a=\"1\"junk",
+		"~\"a\" b",
+		"~unquoted",
+		"some program output",
+		NULL
+	};
+	const gchar **line;
+
+	for (line = lines; *line; line++)
+		fail_unless(gdb_mi_record_parse(*line) == NULL, "parsed %s", *line);
+	gdb_mi_record_matches(NULL, '^', "done");
+}
+
+END_TEST;
+
+#define BENCHMARK_FRAMES 10000
+#define BENCHMARK_RUNS 20
+
+/* parses a 10k-frame backtrace and reads all frames */
+START_TEST(test_benchmark_backtrace)
+{
+	GString *line = g_string_new("^done,stack=[");
+	GTimer *timer = g_timer_new();
+	gint i, run;
+
+	for (i = 0; i < BENCHMARK_FRAMES; i++)
+	{
+		g_string_append_printf(line, "%sframe={level=\"%d\",addr=\"0x%016x\",func=\"recurse\","
+			"file=\"recurse.c\",fullname=\"/home/user/recurse.c\",line=\"%d\"}",
+			i ? "," : "", i, 0x400500 + i, 10 + i % 7);
+	}
+	g_string_append(line, "]");
+
+	for (run = 0; run < BENCHMARK_RUNS; run++)
+	{
+		gdb_mi_record *record = gdb_mi_record_parse(line->str);
+		const gdb_mi_value *frame = gdb_mi_record_get(record, "stack")->children;
+		gint count = 0, lines = 0;
+
+		for (; frame; frame = frame->next, count++)
+		{
+			fail_unless(gdb_mi_value_get_string(frame->children, "addr") != NULL);
+			fail_unless(gdb_mi_value_get_string(frame->children, "fullname") != NULL);
+			lines += atoi(gdb_mi_value_get_string(frame->children, "line"));
+		}
+		fail_unless(count == BENCHMARK_FRAMES);
+		fail_unless(lines > 0);
+		gdb_mi_record_free(record);
+	}
+
+	printf("%d frames (%u bytes) parsed in %.2f ms\n", BENCHMARK_FRAMES, (guint) line->len,
+		g_timer_elapsed(timer, NULL) * 1000 / BENCHMARK_RUNS);
+	g_timer_destroy(timer);
+	g_string_free(line, TRUE);
+}
+
+END_TEST;
+
+#define JOURNAL_KEYS 50
+
+/* temporary keyfile and journal paths */
+static gchar *journal_dir, *keyfile_path, *journal_path;
+
+static void journal_setup(void)
+{
+	journal_dir = g_strdup("/tmp/debugger-journal-XXXXXX");
+	fail_unless(mkdtemp(journal_dir) != NULL);
+	keyfile_path = g_build_filename(journal_dir, "debugger.conf", NULL);
+	journal_path = g_build_filename(journal_dir, "debugger.conf.journal", NULL);
+}
+
+static void journal_teardown(void)
+{
+	g_unlink(keyfile_path);
+	g_unlink(journal_path);
+	g_rmdir(journal_dir);
+	g_free(keyfile_path);
+	g_free(journal_path);
+	g_free(journal_dir);
+}
+
+/* the child increments "counter" from the value it finds count times or forever,
+ * and before each counter value i sets the key "k<i % JOURNAL_KEYS>" to i */
+static void journal_writer(gint count)
+{
+	journal *j = journal_open(keyfile_path, journal_path, NULL);
+	gint i = g_key_file_get_integer(journal_get_keyfile(j), "test", "counter", NULL);
+	gint last = i + count;
+
+	for (i++; !count || i <= last; i++)
+	{
+		gchar key[20];
+		sprintf(key, "k%d", i % JOURNAL_KEYS);
+		journal_set_integer(j, "test", key, i);
+		journal_set_integer(j, "test", "counter", i);
+	}
+	/* crash without closing */
+	journal_flush(j);
+	_exit(0);
+}
+
+/* checks that the keyfile is a state the writer has been in, returns the counter */
+static gint check_journal_state(void)
+{
+	journal *j = journal_open(keyfile_path, journal_path, NULL);
+	GKeyFile *keyfile = journal_get_keyfile(j);
+	gint counter = g_key_file_get_integer(keyfile, "test", "counter", NULL);
+	gint m;
+
+	for (m = 0; m < JOURNAL_KEYS; m++)
+	{
+		gchar key[20];
+		gint expected = counter - (counter - m + JOURNAL_KEYS) % JOURNAL_KEYS;
+		gint value;
+
+		sprintf(key, "k%d", m);
+		value = g_key_file_get_integer(keyfile, "test", key, NULL);
+		/* the key of the next counter value may have been set already */
+		fail_unless(value == MAX(expected, 0) || value == counter + 1,
+			"counter %d, %s = %d", counter, key, value);
+	}
+	journal_close(j);
+
+	return counter;
+}
+
+START_TEST(test_journal_replay)
+{
+	journal *j;
+	GKeyFile *keyfile;
+	gint list[] = { 3, 1, 2 };
+	gint *read_list;
+	gsize length;
+	gchar *value;
+	pid_t pid;
+
+	journal_setup();
+
+	/* crash after writing */
+	if (!(pid = fork()))
+	{
+		j = journal_open(keyfile_path, journal_path, NULL);
+		journal_set_string(j, "debugger", "target", "/home/user/a.out");
+		journal_set_string(j, "debugger", "arguments", "-v \"x\"\nnext line");
+		journal_set_boolean(j, "tabbed_mode", "enabled", TRUE);
+		journal_set_integer_list(j, "one_panel_mode", "tabs", list, 3);
+		journal_set_integer(j, "debugger", "breaks_count", 2);
+		journal_set_integer(j, "debugger", "watches_count", 1);
+		journal_remove_key(j, "debugger", "watches_count");
+		journal_set_string(j, "removed", "key", "value");
+		journal_remove_group(j, "removed");
+		journal_flush(j);
+		_exit(0);
+	}
+	waitpid(pid, NULL, 0);
+	fail_unless(g_file_test(journal_path, G_FILE_TEST_EXISTS));
+
+	j = journal_open(keyfile_path, journal_path, NULL);
+	keyfile = journal_get_keyfile(j);
+	value = g_key_file_get_string(keyfile, "debugger", "arguments", NULL);
+	fail_unless(strcmp(value, "-v \"x\"\nnext line") == 0);
+	g_free(value);
+	fail_unless(g_key_file_get_boolean(keyfile, "tabbed_mode", "enabled", NULL));
+	read_list = g_key_file_get_integer_list(keyfile, "one_panel_mode", "tabs", &length, NULL);
+	fail_unless(length == 3 && read_list[0] == 3 && read_list[2] == 2);
+	g_free(read_list);
+	fail_unless(g_key_file_get_integer(keyfile, "debugger", "breaks_count", NULL) == 2);
+	fail_unless(!g_key_file_has_key(keyfile, "debugger", "watches_count", NULL));
+	fail_unless(!g_key_file_has_group(keyfile, "removed"));
+	journal_close(j);
+
+	/* closing saves the keyfile and removes the journal */
+	fail_unless(!g_file_test(journal_path, G_FILE_TEST_EXISTS));
+	keyfile = g_key_file_new();
+	fail_unless(g_key_file_load_from_file(keyfile, keyfile_path, G_KEY_FILE_NONE, NULL));
+	fail_unless(g_key_file_get_integer(keyfile, "debugger", "breaks_count", NULL) == 2);
+	g_key_file_free(keyfile);
+
+	journal_teardown();
+}
+
+END_TEST;
+
+/* reads a key of the keyfile at path */
+static gchar *saved_value(const gchar *group, const gchar *key)
+{
+	GKeyFile *keyfile = g_key_file_new();
+	gchar *value;
+
+	g_key_file_load_from_file(keyfile, keyfile_path, G_KEY_FILE_NONE, NULL);
+	value = g_key_file_get_value(keyfile, group, key, NULL);
+	g_key_file_free(keyfile);
+
+	return value ? value : g_strdup("");
+}
+
+/* a keyfile with an owner is never written by the journal, only replayed */
+START_TEST(test_journal_groups)
+{
+	const gchar *groups[] = { "debugger", NULL };
+	const gchar *owners = "[project]\nname=changed\n[debugger]\ntarget=old\nstale=1\n";
+	GKeyFile *keyfile;
+	gchar *data, *value;
+	journal *j;
+	gint i;
+
+	journal_setup();
+	g_file_set_contents(keyfile_path, "[project]\nname=test\n[debugger]\ntarget=old\nstale=1\n", -1, NULL);
+
+	j = journal_open(keyfile_path, journal_path, groups);
+	journal_set_string(j, "debugger", "target", "new");
+	journal_remove_key(j, "debugger", "stale");
+	/* more than would make the journal compact a keyfile of its own */
+	for (i = 0; i < 2000; i++)
+		journal_set_integer(j, "debugger", "counter", i);
+	journal_flush(j);
+
+	/* the owner changes the file meanwhile */
+	g_file_set_contents(keyfile_path, owners, -1, NULL);
+	journal_close(j);
+
+	fail_unless(g_file_get_contents(keyfile_path, &data, NULL, NULL));
+	fail_unless(strcmp(data, owners) == 0, "the journal wrote the keyfile");
+	g_free(data);
+	fail_unless(g_file_test(journal_path, G_FILE_TEST_EXISTS));
+
+	j = journal_open(keyfile_path, journal_path, groups);
+	keyfile = journal_get_keyfile(j);
+	value = g_key_file_get_value(keyfile, "project", "name", NULL);
+	fail_unless(strcmp(value, "changed") == 0);
+	g_free(value);
+	value = g_key_file_get_value(keyfile, "debugger", "target", NULL);
+	fail_unless(strcmp(value, "new") == 0);
+	g_free(value);
+	fail_unless(!g_key_file_has_key(keyfile, "debugger", "stale", NULL));
+	journal_close(j);
+
+	journal_teardown();
+}
+
+END_TEST;
+
+/* the owner saves the groups, the journal keeps only the changes made since */
+START_TEST(test_journal_owner_saves)
+{
+	const gchar *groups[] = { "debugger", NULL };
+	journal *j;
+	gchar *value;
+	GStatBuf st;
+
+	journal_setup();
+	g_file_set_contents(keyfile_path, "[project]\nname=test\n", -1, NULL);
+
+	j = journal_open(keyfile_path, journal_path, groups);
+	journal_set_string(j, "debugger", "target", "saved");
+	journal_set_string(j, "debugger", "arguments", "saved");
+	/* the owner saves what it has now, and the target changes before the save is done */
+	journal_saving(j);
+	journal_set_string(j, "debugger", "target", "after");
+	g_file_set_contents(keyfile_path, "[project]\nname=test\n[debugger]\ntarget=saved\narguments=saved\n", -1, NULL);
+	journal_saved(j);
+	journal_flush(j);
+
+	fail_unless(g_stat(journal_path, &st) == 0);
+	fail_unless(st.st_size > 0 && st.st_size < 40, "journal of %d bytes", (gint)st.st_size);
+	journal_close(j);
+
+	/* the change made during the save is still replayed */
+	j = journal_open(keyfile_path, journal_path, groups);
+	value = g_key_file_get_value(journal_get_keyfile(j), "debugger", "target", NULL);
+	fail_unless(strcmp(value, "after") == 0, "target is \"%s\"", value);
+	g_free(value);
+	value = g_key_file_get_value(journal_get_keyfile(j), "debugger", "arguments", NULL);
+	fail_unless(strcmp(value, "saved") == 0);
+	g_free(value);
+
+	/* saved without changes in between, nothing is left to replay */
+	journal_saving(j);
+	g_file_set_contents(keyfile_path, "[project]\nname=test\n[debugger]\ntarget=after\narguments=saved\n", -1, NULL);
+	journal_saved(j);
+	journal_close(j);
+	fail_unless(!g_file_test(journal_path, G_FILE_TEST_EXISTS));
+	value = saved_value("debugger", "target");
+	fail_unless(strcmp(value, "after") == 0);
+	g_free(value);
+
+	/* a save the owner never finished drops nothing */
+	j = journal_open(keyfile_path, journal_path, groups);
+	journal_set_string(j, "debugger", "target", "unsaved");
+	journal_saving(j);
+	journal_close(j);
+	j = journal_open(keyfile_path, journal_path, groups);
+	value = g_key_file_get_value(journal_get_keyfile(j), "debugger", "target", NULL);
+	fail_unless(strcmp(value, "unsaved") == 0);
+	g_free(value);
+	journal_close(j);
+
+	journal_teardown();
+}
+
+END_TEST;
+
+/* truncates and damages the journal at every position */
+START_TEST(test_journal_damaged)
+{
+	gchar *data;
+	gsize length, cut;
+	pid_t pid;
+
+	journal_setup();
+
+	if (!(pid = fork()))
+		journal_writer(30);
+	waitpid(pid, NULL, 0);
+	fail_unless(g_file_get_contents(journal_path, &data, &length, NULL));
+
+	for (cut = 0; cut <= length; cut++)
+	{
+		gint records = 0, counter;
+		gsize i;
+
+		for (i = 0; i < cut; i++)
+			records += '\n' == data[i];
+
+		/* a cut record, a damaged one, or garbage */
+		g_unlink(keyfile_path);
+		g_file_set_contents(journal_path, data, cut, NULL);
+		if (cut < length && cut % 3)
+		{
+			gchar *damaged = g_strdup(data);
+			damaged[cut] ^= cut % 2 ? 0x20 : 0x01;
+			g_file_set_contents(journal_path, damaged, length, NULL);
+			g_free(damaged);
+		}
+
+		/* the writer drops the damaged tail and goes on */
+		if (!(pid = fork()))
+			journal_writer(3);
+		waitpid(pid, NULL, 0);
+		counter = check_journal_state();
+		fail_unless(counter == records / 2 + 3, "cut at %u: counter %d, %d records", (guint)cut, counter, records);
+	}
+	g_free(data);
+
+	journal_teardown();
+}
+
+END_TEST;
+
+/* kills the writer at random moments, including compactions */
+START_TEST(test_journal_kill)
+{
+	gint run, counter = 0;
+
+	journal_setup();
+	srand(1);
+
+	for (run = 0; run < 30; run++)
+	{
+		pid_t pid = fork();
+		gint recovered;
+
+		if (!pid)
+			journal_writer(0);
+		g_usleep(5000 + rand() % 50000);
+		kill(pid, SIGKILL);
+		waitpid(pid, NULL, 0);
+
+		recovered = check_journal_state();
+		fail_unless(recovered >= counter, "counter went back from %d to %d", counter, recovered);
+		counter = recovered;
+	}
+	printf("%d journal records survived 30 kills\n", counter);
+	fail_unless(counter > 0);
+
+	journal_teardown();
+}
+
+END_TEST;
+
+#define BENCHMARK_MEMBERS 10000
+
+/* debug module the watch model gets children from */
+dbg_module *active_module;
+static dbg_module watch_module;
+
+/* children returned by the debug module: count, a generation that is a part
+ * of the values, and steps for the members that change and are renamed */
+static gint members_count, members_generation, members_changed_step, members_renamed_step;
+
+static variable *new_variable(const gchar *name, const gchar *value, gboolean has_children)
+{
+	variable *var = variable_new2((gchar*)name, (gchar*)name, VT_LOCAL);
+	g_string_assign(var->value, value);
+	var->has_children = has_children;
+	var->evaluated = TRUE;
+	return var;
+}
+
+static GList *get_members(gchar *path)
+{
+	GList *vars = NULL;
+	gint i;
+
+	for (i = members_count - 1; i >= 0; i--)
+	{
+		gchar *name, *value;
+		if (members_renamed_step && !(i % members_renamed_step))
+			name = g_strdup_printf("renamed_%d_%d", i, members_generation);
+		else
+			name = g_strdup_printf("member_%d", i);
+		value = g_strdup_printf("%d", i / 2 + (i % members_changed_step ? 0 : members_generation));
+
+		vars = g_list_prepend(vars, new_variable(name, value, FALSE));
+
+		g_free(name);
+		g_free(value);
+	}
+
+	return vars;
+}
+
+static GtkTreeView *new_watch_tree(void)
+{
+	GtkTreeStore *store = gtk_tree_store_new(W_N_COLUMNS,
+		G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING,
+		G_TYPE_INT, G_TYPE_INT, G_TYPE_INT);
+	GtkWidget *tree = gtk_tree_view_new_with_model(GTK_TREE_MODEL(store));
+
+	g_object_unref(store);
+	g_object_ref_sink(tree);
+
+	watch_module.get_children = get_members;
+	active_module = &watch_module;
+
+	return GTK_TREE_VIEW(tree);
+}
+
+/* updates the root items of the tree with "vars" and frees them */
+static void update_roots(GtkTreeView *tree, GList *vars)
+{
+	update_variables(tree, NULL, g_list_copy(vars));
+	free_variables_list(vars);
+}
+
+/* returns "name=value*" for the children of "parent", '*' marks changed rows */
+static gchar *dump_level(GtkTreeView *tree, GtkTreeIter *parent)
+{
+	GtkTreeModel *model = gtk_tree_view_get_model(tree);
+	GString *dump = g_string_new("");
+	GtkTreeIter child;
+
+	if (gtk_tree_model_iter_children(model, &child, parent))
+	{
+		do
+		{
+			gchar *name, *value;
+			gboolean changed;
+			gtk_tree_model_get(model, &child, W_NAME, &name, W_VALUE, &value, W_CHANGED, &changed, -1);
+			g_string_append_printf(dump, "%s%s=%s%s", dump->len ? " " : "", name, value, changed ? "*" : "");
+			g_free(name);
+			g_free(value);
+		}
+		while (gtk_tree_model_iter_next(model, &child));
+	}
+
+	return g_string_free(dump, FALSE);
+}
+
+/* root items are updated, reordered, removed and added in place */
+START_TEST(test_watch_update)
+{
+	GtkTreeView *tree = new_watch_tree();
+	GList *vars = NULL;
+	gchar *dump;
+
+	vars = g_list_append(vars, new_variable("a", "1", FALSE));
+	vars = g_list_append(vars, new_variable("b", "2", FALSE));
+	vars = g_list_append(vars, new_variable("c", "3", FALSE));
+	update_roots(tree, vars);
+
+	dump = dump_level(tree, NULL);
+	fail_unless(!strcmp(dump, "a=1* b=2* c=3*"), "got \"%s\"", dump);
+	g_free(dump);
+
+	vars = NULL;
+	vars = g_list_append(vars, new_variable("c", "3", FALSE));
+	vars = g_list_append(vars, new_variable("a", "5", FALSE));
+	vars = g_list_append(vars, new_variable("d", "4", FALSE));
+	update_roots(tree, vars);
+
+	dump = dump_level(tree, NULL);
+	fail_unless(!strcmp(dump, "c=3 a=5* d=4*"), "got \"%s\"", dump);
+	g_free(dump);
+
+	/* the same name twice shows the first variable */
+	vars = NULL;
+	vars = g_list_append(vars, new_variable("d", "4", FALSE));
+	vars = g_list_append(vars, new_variable("d", "6", FALSE));
+	update_roots(tree, vars);
+
+	dump = dump_level(tree, NULL);
+	fail_unless(!strcmp(dump, "d=4"), "got \"%s\"", dump);
+	g_free(dump);
+
+	g_object_unref(tree);
+}
+
+END_TEST;
+
+/* expanded children are updated from the debug module */
+START_TEST(test_watch_children)
+{
+	GtkTreeView *tree = new_watch_tree();
+	GtkTreeModel *model = gtk_tree_view_get_model(tree);
+	GtkTreeIter root;
+	GtkTreePath *path;
+	gchar *dump;
+
+	update_roots(tree, g_list_append(NULL, new_variable("s", "{...}", TRUE)));
+	fail_unless(gtk_tree_model_get_iter_first(model, &root));
+
+	dump = dump_level(tree, &root);
+	fail_unless(!strcmp(dump, "...="), "got \"%s\"", dump);
+	g_free(dump);
+
+	members_count = 4;
+	members_generation = 0;
+	members_changed_step = 1;
+	members_renamed_step = 0;
+	{
+		GList *children = get_members(NULL);
+		expand_stub(tree, &root, children);
+		free_variables_list(children);
+	}
+	path = gtk_tree_model_get_path(model, &root);
+	gtk_tree_view_expand_row(tree, path, FALSE);
+	gtk_tree_path_free(path);
+
+	dump = dump_level(tree, &root);
+	fail_unless(!strcmp(dump, "member_0=0* member_1=0* member_2=1* member_3=1*"), "got \"%s\"", dump);
+	g_free(dump);
+
+	/* member_0 and member_3 are renamed, the values of the others change,
+	 * new rows of an unchanged parent aren't marked */
+	members_generation = 1;
+	members_renamed_step = 3;
+	update_roots(tree, g_list_append(NULL, new_variable("s", "{...}", TRUE)));
+
+	dump = dump_level(tree, &root);
+	fail_unless(!strcmp(dump, "renamed_0_1=1 member_1=1* member_2=2* renamed_3_1=2"), "got \"%s\"", dump);
+	g_free(dump);
+
+	g_object_unref(tree);
+}
+
+END_TEST;
+
+/* refreshes an expanded structure with 10k members */
+START_TEST(test_benchmark_watch_struct)
+{
+	GtkTreeView *tree = new_watch_tree();
+	GtkTreeModel *model = gtk_tree_view_get_model(tree);
+	GtkTreeIter root;
+	GtkTreePath *path;
+	GTimer *timer;
+	gint run;
+
+	members_count = BENCHMARK_MEMBERS;
+	members_generation = 0;
+	members_changed_step = 10;
+	members_renamed_step = 0;
+
+	update_roots(tree, g_list_append(NULL, new_variable("s", "{...}", TRUE)));
+	gtk_tree_model_get_iter_first(model, &root);
+	{
+		GList *children = get_members(NULL);
+		expand_stub(tree, &root, children);
+		free_variables_list(children);
+	}
+	path = gtk_tree_model_get_path(model, &root);
+	gtk_tree_view_expand_row(tree, path, FALSE);
+	gtk_tree_path_free(path);
+
+	/* every refresh changes every 10th value and renames every 100th member */
+	members_renamed_step = 100;
+	timer = g_timer_new();
+	for (run = 1; run <= BENCHMARK_RUNS; run++)
+	{
+		members_generation = run;
+		update_roots(tree, g_list_append(NULL, new_variable("s", "{...}", TRUE)));
+	}
+	printf("%d members refreshed in %.2f ms\n", BENCHMARK_MEMBERS,
+		g_timer_elapsed(timer, NULL) * 1000 / BENCHMARK_RUNS);
+	g_timer_destroy(timer);
+
+	fail_unless(gtk_tree_model_iter_n_children(model, &root) == BENCHMARK_MEMBERS);
+	{
+		gchar *dump = dump_level(tree, &root), *expected;
+		expected = g_strdup_printf("renamed_0_%d=%d member_1=0 member_2=1 ", BENCHMARK_RUNS, BENCHMARK_RUNS);
+		fail_unless(g_str_has_prefix(dump, expected), "got \"%.60s\"", dump);
+		g_free(expected);
+		expected = g_strdup_printf(" member_10=%d* member_11=5 ", 5 + BENCHMARK_RUNS);
+		fail_unless(strstr(dump, expected) != NULL);
+		g_free(expected);
+		g_free(dump);
+	}
+
+	g_object_unref(tree);
+}
+
+END_TEST;
+
+Suite *
+my_suite(void)
+{
+	Suite *s = suite_create("Debugger");
+	TCase *tc_core = tcase_create("gdb_mi");
+
+	suite_add_tcase(s, tc_core);
+	tcase_add_test(tc_core, test_corpus);
+	tcase_add_test(tc_core, test_stream);
+	tcase_add_test(tc_core, test_stopped);
+	tcase_add_test(tc_core, test_stack);
+	tcase_add_test(tc_core, test_breakpoints);
+	tcase_add_test(tc_core, test_lists);
+	tcase_add_test(tc_core, test_escapes);
+	tcase_add_test(tc_core, test_token);
+	tcase_add_test(tc_core, test_malformed);
+	tcase_add_test(tc_core, test_benchmark_backtrace);
+
+	TCase *tc_journal = tcase_create("journal");
+	tcase_set_timeout(tc_journal, 120);
+	suite_add_tcase(s, tc_journal);
+	tcase_add_test(tc_journal, test_journal_replay);
+	tcase_add_test(tc_journal, test_journal_groups);
+	tcase_add_test(tc_journal, test_journal_owner_saves);
+	tcase_add_test(tc_journal, test_journal_damaged);
+	tcase_add_test(tc_journal, test_journal_kill);
+
+	/* the watch model needs a tree view */
+	if (gtk_init_check(NULL, NULL))
+	{
+		TCase *tc_watch = tcase_create("watch_model");
+		tcase_set_timeout(tc_watch, 60);
+		suite_add_tcase(s, tc_watch);
+		tcase_add_test(tc_watch, test_watch_update);
+		tcase_add_test(tc_watch, test_watch_children);
+		tcase_add_test(tc_watch, test_benchmark_watch_struct);
+	}
+
+	return s;
+}
+
+int
+main(void)
+{
+	int nf;
+	Suite *s = my_suite();
+	SRunner *sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	nf = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return (nf == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
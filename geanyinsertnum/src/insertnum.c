@@ -27,6 +27,7 @@
 #include <string.h>
 
 #include "geanyplugin.h"
+#include "numbers.h"
 
 #ifndef GTK_COMPAT_H
 #define GtkComboBoxText GtkComboBox
@@ -59,7 +60,7 @@ PLUGIN_KEY_GROUP(insert_numbers, COUNT_KB)
 #define RANGE_MAX 2147483647
 #define RANGE_LEN 11
 #define RANGE_TOOLTIP "-2147483648..2147483647"
-#define MAX_LINES 250000
+#define MAX_LINES 1000000
 
 typedef struct _InsertNumbersDialog
 {
@@ -119,8 +120,17 @@ static void update_display(void)
 
 #define sci_point_x_from_position(sci, position) \
 	scintilla_send_message(sci, SCI_POINTXFROMPOSITION, 0, position)
-#define sci_get_pos_at_line_sel_start(sci, line) \
-	scintilla_send_message(sci, SCI_GETLINESELSTARTPOSITION, line, 0)
+#define sci_get_selections(sci) \
+	scintilla_send_message(sci, SCI_GETSELECTIONS, 0, 0)
+#define sci_get_selection_n_start(sci, n) \
+	scintilla_send_message(sci, SCI_GETSELECTIONNSTART, n, 0)
+
+/* whether the n-th selection starts past the line end, in virtual space */
+static gboolean sci_get_selection_n_virtual(ScintillaObject *sci, gint n)
+{
+	return scintilla_send_message(sci, SCI_GETSELECTIONNANCHORVIRTUALSPACE, n, 0) &&
+		scintilla_send_message(sci, SCI_GETSELECTIONNCARETVIRTUALSPACE, n, 0);
+}
 
 static void insert_numbers(gboolean *cancel)
 {
@@ -129,33 +139,37 @@ static void insert_numbers(gboolean *cancel)
 	gint xinsert = sci_point_x_from_position(sci, start_pos);
 	gint xend = sci_point_x_from_position(sci, end_pos);
 	gint *line_pos = g_new(gint, end_line - start_line + 1);
+	gint selections = sci_get_selections(sci);
 	gint line, i;
 	/* generator */
-	gint64 start = start_value;
-	gint64 value;
-	unsigned count = 0;
-	size_t prefix_len = 0;
-	int plus = 0, minus;
-	size_t length, lend;
-	char pad, aax;
-	gchar *buffer;
+	NumbersFormat format;
+	guint count = 0;
+	gsize length;
+	gchar *buffer, *number;
 
 	if (xend < xinsert)
 		xinsert = xend;
 
 	ui_progress_bar_start(_("Counting..."));
-	/* lines shorter than the current selection are skipped */
-	for (line = start_line, i = 0; line <= end_line; line++, i++)
+	for (i = 0; i <= end_line - start_line; i++)
+		line_pos[i] = -1;
+
+	/* a rectangular selection has a range per line; lines shorter than the
+	   current selection are skipped, and only a range ending at the line end
+	   needs its line measured */
+	for (i = 0; i < selections; i++)
 	{
-		if (sci_point_x_from_position(sci,
-			scintilla_send_message(sci, SCI_GETLINEENDPOSITION, line, 0)) >= xinsert)
+		gint pos = sci_get_selection_n_start(sci, i);
+
+		line = sci_get_line_from_position(sci, pos);
+		if (line >= start_line && line <= end_line && line_pos[line - start_line] < 0 &&
+			(pos < scintilla_send_message(sci, SCI_GETLINEENDPOSITION, line, 0) ||
+			(!sci_get_selection_n_virtual(sci, i) &&
+			sci_point_x_from_position(sci, pos) >= xinsert)))
 		{
-			line_pos[i] = sci_get_pos_at_line_sel_start(sci, line) -
-				sci_get_position_from_line(sci, line);
+			line_pos[line - start_line] = pos - sci_get_position_from_line(sci, line);
 			count++;
 		}
-		else
-			line_pos[i] = -1;
 
 		if (cancel && i % 2500 == 0)
 		{
@@ -169,73 +183,31 @@ static void insert_numbers(gboolean *cancel)
 		}
 	}
 
-	switch (base_value * base_prefix)
-	{
-		case 8 : prefix_len = 1; break;
-		case 16 : prefix_len = 2; break;
-		case 10 : plus++;
-	}
-
-	value = start + (count - 1) * step_value;
-	minus = start < 0 || value < 0;
-	lend = plus || (pad_zeros ? minus : value < 0);
-	while (value /= base_value) lend++;
-	value = start;
-	length = plus || (pad_zeros ? minus : value < 0);
-	while (value /= base_value) length++;
-	length = prefix_len + (length > lend ? length : lend) + 1;
-
-	buffer = g_new(gchar, length + 1);
-	buffer[length] = '\0';
-	pad = pad_zeros ? '0' : ' ';
-	aax = (lower_case ? 'a' : 'A') - 10;
-
 	gtk_progress_bar_set_text(GTK_PROGRESS_BAR(geany->main_widgets->progressbar),
 		_("Preparing..."));
 	update_display();
+	format.start = start_value;
+	format.step = step_value;
+	format.base = base_value;
+	format.lower_case = lower_case;
+	format.base_prefix = base_prefix;
+	format.pad_zeros = pad_zeros;
+	buffer = numbers_format(&format, count, &length);
 	sci_start_undo_action(sci);
 	sci_replace_sel(sci, "");
 
 	gtk_progress_bar_set_text(GTK_PROGRESS_BAR(geany->main_widgets->progressbar),
 		_("Inserting..."));
-	for (line = start_line, i = 0; line <= end_line; line++, i++)
+	for (line = start_line, i = 0, number = buffer; line <= end_line; line++, i++)
 	{
-		gchar *beg, *end;
 		gint insert_pos;
 
 		if (line_pos[i] < 0)
 			continue;
 
-		beg = buffer;
-		end = buffer + length;
-		value = ABS(start);
-
-		do
-		{
-			unsigned digit = value % base_value;
-			*--end = digit + (digit < 10 ? '0' : aax);
-		} while (value /= base_value);
-
-		if (pad_zeros)
-		{
-			if (start < 0) *beg++ = '-';
-			else if (plus) *beg++ = '+';
-			else if (minus) *beg++ = ' ';
-			memcpy(beg, "0x", prefix_len);
-			beg += prefix_len;
-		}
-		else
-		{
-			if (start < 0) *--end = '-';
-			else if (plus) *--end = '+';
-			end -= prefix_len;
-			memcpy(end, "0x", prefix_len);
-		}
-
-		memset(beg, pad, end - beg);
 		insert_pos = sci_get_position_from_line(sci, line) + line_pos[i];
-		sci_insert_text(sci, insert_pos, buffer);
-		start += step_value;
+		sci_insert_text(sci, insert_pos, number);
+		number += length + 1;
 
 		if (cancel && i % 1000 == 0)
 		{
@@ -0,0 +1,96 @@
+/*
+ *  numbers.c
+ *
+ *  Copyright 2010 Dimitar Toshkov Zhekov <dimitar.zhekov@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string.h>
+
+#include "numbers.h"
+
+gchar *numbers_format(const NumbersFormat *format, guint count, gsize *length)
+{
+	gint64 start = format->start;
+	gint64 value;
+	gint base = format->base;
+	size_t prefix_len = 0;
+	int plus = 0, minus;
+	size_t lend;
+	char pad, aax;
+	gchar *buffer, *number;
+	guint n;
+
+	switch (base * format->base_prefix)
+	{
+		case 8 : prefix_len = 1; break;
+		case 16 : prefix_len = 2; break;
+		case 10 : plus++;
+	}
+
+	value = count ? start + (gint64) (count - 1) * format->step : start;
+	minus = start < 0 || value < 0;
+	lend = plus || (format->pad_zeros ? minus : value < 0);
+	while (value /= base) lend++;
+	value = start;
+	*length = plus || (format->pad_zeros ? minus : value < 0);
+	while (value /= base) (*length)++;
+	*length = prefix_len + (*length > lend ? *length : lend) + 1;
+
+	buffer = g_new(gchar, (*length + 1) * count + 1);
+	pad = format->pad_zeros ? '0' : ' ';
+	aax = (format->lower_case ? 'a' : 'A') - 10;
+
+	for (n = 0, number = buffer; n < count; n++, number += *length + 1)
+	{
+		gchar *beg = number;
+		gchar *end = number + *length;
+
+		*end = '\0';
+		value = ABS(start);
+
+		do
+		{
+			unsigned digit = value % base;
+			*--end = digit + (digit < 10 ? '0' : aax);
+		} while (value /= base);
+
+		if (format->pad_zeros)
+		{
+			if (start < 0) *beg++ = '-';
+			else if (plus) *beg++ = '+';
+			else if (minus) *beg++ = ' ';
+			memcpy(beg, "0x", prefix_len);
+			beg += prefix_len;
+		}
+		else
+		{
+			if (start < 0) *--end = '-';
+			else if (plus) *--end = '+';
+			end -= prefix_len;
+			memcpy(end, "0x", prefix_len);
+		}
+
+		memset(beg, pad, end - beg);
+		start += format->step;
+	}
+
+	*number = '\0';
+	return buffer;
+}
@@ -0,0 +1,39 @@
+/*
+ *  numbers.h
+ *
+ *  Copyright 2010 Dimitar Toshkov Zhekov <dimitar.zhekov@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NUMBERS_H
+#define NUMBERS_H
+
+#include <glib.h>
+
+typedef struct _NumbersFormat
+{
+	gint64 start;
+	gint64 step;
+	gint base;
+	gboolean lower_case;
+	gboolean base_prefix;
+	gboolean pad_zeros;
+} NumbersFormat;
+
+/* formats count numbers, each padded to *length characters and followed by a '\0',
+   into a single buffer; number N starts at offset N * (*length + 1) */
+gchar *numbers_format(const NumbersFormat *format, guint count, gsize *length);
+
+#endif
@@ -0,0 +1,137 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <check.h>
+
+#include <glib.h>
+#include "numbers.h"
+
+
+#define BENCHMARK_NUMBERS 1000000
+
+/* checks that the numbers formatted with "format" are "expected" */
+static void check_numbers(const NumbersFormat *format, const gchar **expected)
+{
+	guint count = g_strv_length((gchar **) expected);
+	gsize length;
+	gchar *buffer = numbers_format(format, count, &length);
+	guint n;
+
+	for (n = 0; n < count; n++)
+	{
+		const gchar *number = buffer + n * (length + 1);
+
+		fail_unless(strlen(number) == length, "number %u \"%s\" is not %u characters long",
+			n, number, (guint) length);
+		fail_unless(strcmp(number, expected[n]) == 0, "expected \"%s\", got \"%s\"",
+			expected[n], number);
+	}
+
+	g_free(buffer);
+}
+
+START_TEST(test_decimal)
+{
+	NumbersFormat format = { 8, 1, 10, FALSE, FALSE, FALSE };
+	const gchar *spaces[] = { " 8", " 9", "10", "11", NULL };
+	const gchar *zeros[] = { "08", "09", "10", "11", NULL };
+
+	check_numbers(&format, spaces);
+	format.pad_zeros = TRUE;
+	check_numbers(&format, zeros);
+}
+END_TEST;
+
+START_TEST(test_negative)
+{
+	NumbersFormat format = { -2, 1, 10, FALSE, FALSE, FALSE };
+	const gchar *plain[] = { "-2", "-1", " 0", " 1", NULL };
+	const gchar *plus[] = { "-2", "-1", "+0", "+1", NULL };
+	const gchar *down[] = { " 10", "  0", "-10", "-20", NULL };
+	const gchar *down_zeros[] = { " 10", " 00", "-10", "-20", NULL };
+
+	check_numbers(&format, plain);
+	format.base_prefix = TRUE;
+	check_numbers(&format, plus);
+	format.start = 10;
+	format.step = -10;
+	format.base_prefix = FALSE;
+	check_numbers(&format, down);
+	format.pad_zeros = TRUE;
+	check_numbers(&format, down_zeros);
+}
+END_TEST;
+
+START_TEST(test_prefix)
+{
+	NumbersFormat format = { 0xfe, 1, 16, FALSE, TRUE, FALSE };
+	const gchar *upper[] = { " 0xFE", " 0xFF", "0x100", NULL };
+	const gchar *lower_zeros[] = { "0x0fe", "0x0ff", "0x100", NULL };
+	const gchar *octal[] = { " 07", "010", NULL };
+
+	check_numbers(&format, upper);
+	format.lower_case = TRUE;
+	format.pad_zeros = TRUE;
+	check_numbers(&format, lower_zeros);
+	format.start = 7;
+	format.base = 8;
+	format.pad_zeros = FALSE;
+	check_numbers(&format, octal);
+}
+END_TEST;
+
+START_TEST(test_empty)
+{
+	NumbersFormat format = { 1, 1, 10, FALSE, FALSE, FALSE };
+	gsize length;
+	gchar *buffer = numbers_format(&format, 0, &length);
+
+	fail_unless(buffer != NULL && *buffer == '\0');
+	g_free(buffer);
+}
+END_TEST;
+
+START_TEST(test_benchmark_format)
+{
+	NumbersFormat format = { 1, 1, 10, FALSE, FALSE, FALSE };
+	GTimer *timer = g_timer_new();
+	gsize length;
+	gchar *buffer = numbers_format(&format, BENCHMARK_NUMBERS, &length);
+	gdouble elapsed = g_timer_elapsed(timer, NULL);
+	gchar *expected = g_strdup_printf("%*d", (int) length, BENCHMARK_NUMBERS);
+
+	fail_unless(strcmp(buffer + (BENCHMARK_NUMBERS - 1) * (length + 1), expected) == 0);
+	printf("%d numbers formatted in %.1f ms\n", BENCHMARK_NUMBERS, elapsed * 1000);
+
+	g_free(expected);
+	g_free(buffer);
+	g_timer_destroy(timer);
+}
+END_TEST;
+
+Suite *
+my_suite(void)
+{
+	Suite *s = suite_create("InsertNum");
+	TCase *tc_core = tcase_create("Core");
+	suite_add_tcase(s, tc_core);
+	tcase_add_test(tc_core, test_decimal);
+	tcase_add_test(tc_core, test_negative);
+	tcase_add_test(tc_core, test_prefix);
+	tcase_add_test(tc_core, test_empty);
+	tcase_add_test(tc_core, test_benchmark_format);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int nf;
+	Suite *s = my_suite();
+	SRunner *sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	nf = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return (nf == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
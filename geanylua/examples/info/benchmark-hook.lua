@@ -0,0 +1,33 @@
+--[[
+  Times a tight loop with the plugin's debug hook installed, and again
+  after optimize() has removed it. The difference is what the hook
+  costs in this build.
+--]]
+
+local count=5000000
+
+local function loop(n)
+  local sum=0
+  for i=1,n
+  do
+    sum=sum+(i%7)
+  end
+  return sum
+end
+
+geany.timeout(120)
+
+local start=os.clock()
+local hooked=loop(count)
+local hooked_time=os.clock()-start
+
+geany.optimize()
+
+start=os.clock()
+local plain=loop(count)
+local plain_time=os.clock()-start
+
+geany.message("Hook benchmark:",
+  string.format("with the hook: %d iterations in %.3f s\n", count, hooked_time)..
+  string.format("without it: %d iterations in %.3f s", count, plain_time)..
+  ((hooked==plain) and "" or "\nThe results differ!"))
@@ -0,0 +1,62 @@
+--[[
+  Times reading and editing a large scratch document: stepping through
+  it with lines(), and replacing the first tab of every line with one
+  call to splice() versus one select() and selection() per line.
+--]]
+
+local count=20000
+
+local rows={}
+for i=1,count
+do
+  rows[i]="line "..i.."\tof the benchmark document"
+end
+local original=table.concat(rows, "\n").."\n"
+
+-- Lists an edit for the first tab of each line
+local function find_tabs()
+  local edits={}
+  local pos=0
+  for num, text in geany.lines()
+  do
+    local tab=string.find(text, "\t", 1, true)
+    if tab then
+      table.insert(edits, { pos+tab-1, pos+tab, "    " })
+    end
+    pos=pos+string.len(text)
+  end
+  return edits
+end
+
+geany.newfile()
+geany.text(original)
+
+local start=os.clock()
+local lines=0
+for num, text in geany.lines()
+do
+  lines=lines+1
+end
+local read_time=os.clock()-start
+
+local edits=find_tabs()
+start=os.clock()
+geany.splice(edits)
+local splice_time=os.clock()-start
+local spliced=geany.text()
+
+geany.text(original)
+edits=find_tabs()
+start=os.clock()
+for i=#edits,1,-1
+do
+  geany.select(edits[i][1], edits[i][2])
+  geany.selection(edits[i][3])
+end
+local separate_time=os.clock()-start
+
+geany.message("Text benchmark:",
+  string.format("lines(): %d lines in %.3f s\n", lines, read_time)..
+  string.format("splice(): %d edits in %.3f s\n", #edits, splice_time)..
+  string.format("selection(): %d edits in %.3f s\n", #edits, separate_time)..
+  ((spliced==geany.text()) and "Both edits agree." or "The edits differ!"))
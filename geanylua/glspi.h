@@ -135,6 +135,21 @@ static gint glspi_fail_elem_type(
 #endif
 
 
+#ifdef NEED_FAIL_FIELD_TYPE
+/*Same as above, but for a field of a table element that is itself a table*/
+static gint glspi_fail_field_type(
+		lua_State *L, const gchar *func, gint argnum, gint idx, gint field, const gchar *type)
+{
+	lua_pushfstring(L, _("Error in module \"%s\" at function %s():\n"
+											" invalid table in argument #%d:\n"
+											" expected type \"%s\" for field #%d of element #%d\n"),
+											LUA_MODULE_NAME, func+6, argnum, type, field, idx);
+	lua_error(L);
+	return 0;
+}
+#endif
+
+
 typedef void (*GsDlgRunHook) (gboolean running, gpointer user_data);
 typedef gint (*KeyfileAssignFunc) (lua_State *L, GKeyFile*kf);
 
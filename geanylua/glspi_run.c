@@ -111,12 +111,27 @@ static void glspi_script_error(const gchar *script_file, const gchar *msg, gbool
 
 
 
+/*
+	The debug hook is driven by the instruction count rather than by
+	every executed line. The count is adjusted on the fly to keep the
+	interval between hook calls near HOOK_INTERVAL seconds, whatever
+	the speed of the script.
+*/
+#define HOOK_COUNT_MIN   1000
+#define HOOK_COUNT_MAX   (1<<22)
+#define HOOK_INTERVAL    0.02
+#define REPAINT_INTERVAL 0.5
+
+
 typedef struct _StateInfo {
 	lua_State *state;
 	GString *source;
 	gint line;
 	GTimer*timer;
-	gint counter;
+	GTimer*clock;
+	gdouble last_hook;
+	gdouble last_paint;
+	gint hook_count;
 	gdouble remaining;
 	gdouble max;
 	gboolean optimized;
@@ -176,22 +191,54 @@ static gint glspi_yield(lua_State* L)
 static gint glspi_optimize(lua_State* L)
 {
 	StateInfo*si=find_state(L);
-	if (si) { si->optimized=TRUE; }
+	if (si) {
+		si->optimized=TRUE;
+		lua_sethook(L,NULL,0,0);
+	}
 	return 0;
 }
 
 
+
+/* Remember the script file and line number of the given activation record */
+static void update_location(StateInfo*si, lua_State *L, lua_Debug *ar)
+{
+	if (lua_getinfo(L,"Sl",ar)) {
+		if (ar->source && (ar->source[0]=='@') && strcmp(si->source->str, ar->source+1)) {
+			g_string_assign(si->source, ar->source+1);
+		}
+		si->line=ar->currentline;
+	}
+}
+
+
+
+/* Double or halve the hook count, to keep hook calls about HOOK_INTERVAL apart */
+static void adapt_hook_count(StateInfo*si, lua_State *L, gdouble elapsed)
+{
+	gint count=si->hook_count;
+	if ((elapsed < HOOK_INTERVAL/2) && (count < HOOK_COUNT_MAX)) {
+		count*=2;
+	} else if ((elapsed > HOOK_INTERVAL*2) && (count > HOOK_COUNT_MIN)) {
+		count/=2;
+	}
+	if (count!=si->hook_count) {
+		si->hook_count=count;
+		lua_sethook(L,lua_gethook(L),LUA_MASKCOUNT,count);
+	}
+}
+
+
+
 /* Lua debug hook callback */
 static void debug_hook(lua_State *L, lua_Debug *ar)
 {
 	StateInfo*si=find_state(L);
 	if (si && !si->optimized) {
-		if (lua_getinfo(L,"Sl",ar)) {
-			if (ar->source && (ar->source[0]=='@') && strcmp(si->source->str, ar->source+1)) {
-				g_string_assign(si->source, ar->source+1);
-			}
-			si->line=ar->currentline;
-		}
+		gdouble now=g_timer_elapsed(si->clock,NULL);
+		adapt_hook_count(si, L, now-si->last_hook);
+		si->last_hook=now;
+		update_location(si, L, ar);
 		if (si->timer) {
 			if (si->timer && si->max && (g_timer_elapsed(si->timer,NULL)>si->remaining)) {
 				if ( glspi_show_question(_("Script timeout"), _(
@@ -208,11 +255,12 @@ static void debug_hook(lua_State *L, lua_Debug *ar)
 				}
 			}
 		}
-		if (si->counter > 100000) {
+		if (now-si->last_paint > REPAINT_INTERVAL) {
 			gdk_window_invalidate_rect(gtk_widget_get_window(main_widgets->window), NULL, TRUE);
 			gdk_window_process_updates(gtk_widget_get_window(main_widgets->window), TRUE);
-			si->counter=0;
-		} else si->counter++;
+			si->last_paint=g_timer_elapsed(si->clock,NULL);
+			si->last_hook=si->last_paint;
+		}
 	}
 }
 
@@ -253,9 +301,10 @@ static lua_State *glspi_state_new(void)
 	si->remaining=DEFAULT_MAX_EXEC_TIME;
 	si->source=g_string_new("");
 	si->line=-1;
-	si->counter=0;
+	si->clock=g_timer_new();
+	si->hook_count=HOOK_COUNT_MIN;
 	state_list=g_slist_append(state_list,si);
-	lua_sethook(L,debug_hook,LUA_MASKLINE,1);
+	lua_sethook(L,debug_hook,LUA_MASKCOUNT,si->hook_count);
 	return L;
 }
 
@@ -268,6 +317,10 @@ static void glspi_state_done(lua_State *L)
 			g_timer_destroy(si->timer);
 			si->timer=NULL;
 		}
+		if (si->clock) {
+			g_timer_destroy(si->clock);
+			si->clock=NULL;
+		}
 		if (si->source) {
 			g_string_free(si->source, TRUE);
 		}
@@ -290,9 +343,25 @@ static const struct luaL_reg glspi_timer_funcs[] = {
 
 
 
-/* Catch and report script errors */
+/*
+	Catch and report script errors...
+	Since the debug hook only runs every so many instructions, the line it
+	last saw is not necessarily where the error occurred, so we look up the
+	innermost Lua function on the stack while it is still intact.
+*/
 static gint glspi_traceback(lua_State *L)
 {
+	StateInfo*si=find_state(L);
+	if (si) {
+		lua_Debug ar;
+		gint level;
+		for (level=0; lua_getstack(L, level, &ar); level++) {
+			if (lua_getinfo(L, "l", &ar) && (ar.currentline>0)) {
+				update_location(si, L, &ar);
+				break;
+			}
+		}
+	}
 	lua_getfield(L, LUA_GLOBALSINDEX, "debug");
 	if (!lua_istable(L, -1)) {
 		lua_pop(L, 1);
@@ -6,6 +6,7 @@
 
 #define NEED_FAIL_ARG_TYPE
 #define NEED_FAIL_ELEM_TYPE
+#define NEED_FAIL_FIELD_TYPE
 
 #include "glspi.h"
 #include "glspi_sci.h"
@@ -268,16 +269,31 @@ static gint glspi_word(lua_State* L)
 
 
 
+/*
+	Returns a pointer to Scintilla's own copy of the document text. The
+	pointer is only valid until the document is next modified, so it must
+	never be kept across a call that might change the buffer.
+*/
+static const gchar* get_char_pointer(ScintillaObject*sci)
+{
+	return (const gchar*) scintilla_send_message(sci, SCI_GETCHARACTERPOINTER, 0, 0);
+}
+
+
+
 /*
 	Pushes the line of text onto the Lua stack from the specified
 	line number. Return FALSE only if the index is out of bounds.
 */
-static gchar* get_line_text(GeanyDocument*doc,gint linenum)
+static gboolean push_line_text(lua_State *L, GeanyDocument*doc, gint linenum)
 {
-	gint count=sci_get_line_count(doc->editor->sci);
+	ScintillaObject*sci=doc->editor->sci;
+	gint count=sci_get_line_count(sci);
 	if ((linenum>0)&&(linenum<=count)) {
-		gchar *text=sci_get_line(doc->editor->sci, linenum-1);
-		return text?text:g_strdup("");
+		gint start=sci_get_position_from_line(sci, linenum-1);
+		gint stop=(linenum<count)?sci_get_position_from_line(sci, linenum):sci_get_length(sci);
+		lua_pushlstring(L, get_char_pointer(sci)+start, stop-start);
+		return TRUE;
 	} else {
 		return FALSE;
 	}
@@ -286,19 +302,20 @@ static gchar* get_line_text(GeanyDocument*doc,gint linenum)
 
 
 /*
-	Lua "closure" function to iterate through each line in the current document
+	Lua "closure" function to iterate through each line in the current document.
+	Each line is pushed straight from the document text. Its bounds are looked up
+	from the line number on every step, rather than kept from the last one, so
+	the iteration stays right if the script edits the document in between.
 */
 static gint lines_closure(lua_State *L)
 {
 	gint idx=lua_tonumber(L, lua_upvalueindex(1))+1;
 	GeanyDocument *doc=lua_touserdata(L,lua_upvalueindex(2));
-	gchar *text=get_line_text(doc,idx);
-	if ( text ) {
-		push_number(L, idx);
-		lua_pushvalue(L, -1);
+	if (!(doc && doc->is_valid)) { return 0; }
+	push_number(L, idx);
+	if ( push_line_text(L, doc, idx) ) {
+		lua_pushvalue(L, -2);
 		lua_replace(L, lua_upvalueindex(1));
-		lua_pushstring(L,text);
-		g_free(text);
 		return 2;
 	} else {
 		return 0;
@@ -317,24 +334,120 @@ static gint glspi_lines(lua_State* L)
 		lua_pushcclosure(L, &lines_closure, 2);
 		return 1;
 	} else {
-		int idx;
-		gchar *text;
 		if (!lua_isnumber(L,1)) { return FAIL_NUMERIC_ARG(1); }
-		idx=lua_tonumber(L,1);
-		text=get_line_text(doc,idx);
-		if (text) {
-			lua_pushstring(L,text);
-			g_free(text);
-			return 1;
-		} else {
+		return push_line_text(L, doc, lua_tonumber(L,1))?1:0;
+	}
+}
+
+
+
+typedef struct _SpliceItem {
+	gint start;
+	gint stop;
+	gint index;
+	const gchar*text;
+	size_t len;
+} SpliceItem;
+
+
+static gint compare_splice_items(gconstpointer a, gconstpointer b)
+{
+	const SpliceItem*ia=a;
+	const SpliceItem*ib=b;
+	if (ia->start!=ib->start) { return ia->start-ib->start; }
+	if (ia->stop!=ib->stop) { return ia->stop-ib->stop; }
+	return ia->index-ib->index;
+}
+
+
+/*
+	Apply a whole list of replacements to the current document as a single
+	undo action. Each element of the table is itself a table of the form
+	{start, stop, text}, where the positions refer to the document as it was
+	before any of the replacements were made. Returns the effective change
+	in the document's size.
+*/
+static gint glspi_splice(lua_State* L)
+{
+	ScintillaObject*sci;
+	SpliceItem*items;
+	gint i,n,len;
+	DOC_REQUIRED
+	if ((lua_gettop(L)==0)||(!lua_istable(L,1))) { return FAIL_TABLE_ARG(1); }
+	sci=doc->editor->sci;
+	len=sci_get_length(sci);
+	n=lua_objlen(L,1);
+	if (n==0) {
+		push_number(L,0);
+		return 1;
+	}
+	/* The strings stay referenced by the argument table while we use them */
+	items=g_new0(SpliceItem, n);
+	for (i=0; i<n; i++) {
+		lua_rawgeti(L,1,i+1);
+		if (!lua_istable(L,-1)) {
+			g_free(items);
+			return glspi_fail_elem_type(L, __FUNCTION__, 1, i+1, "table");
+		}
+		lua_rawgeti(L,-1,1);
+		if (!lua_isnumber(L,-1)) {
+			g_free(items);
+			return glspi_fail_field_type(L, __FUNCTION__, 1, i+1, 1, "number");
+		}
+		lua_rawgeti(L,-2,2);
+		if (!lua_isnumber(L,-1)) {
+			g_free(items);
+			return glspi_fail_field_type(L, __FUNCTION__, 1, i+1, 2, "number");
+		}
+		lua_rawgeti(L,-3,3);
+		if (lua_type(L,-1)!=LUA_TSTRING) {
+			g_free(items);
+			return glspi_fail_field_type(L, __FUNCTION__, 1, i+1, 3, "string");
+		}
+		items[i].text=lua_tolstring(L,-1,&items[i].len);
+		lua_pop(L,1);
+		items[i].start=lua_tonumber(L,-2);
+		items[i].stop=lua_tonumber(L,-1);
+		items[i].index=i;
+		lua_pop(L,3);
+		if ((items[i].start<0)||(items[i].stop<items[i].start)||(items[i].stop>len)) {
+			g_free(items);
+			lua_pushfstring(L, _("Error in module \"%s\" at function %s():\n"
+				" invalid table in argument #%d:\n"
+				" range out of bounds for element #%d\n"),
+				LUA_MODULE_NAME, &__FUNCTION__[6], 1, i+1);
+			lua_error(L);
 			return 0;
 		}
 	}
+	qsort(items, n, sizeof(SpliceItem), compare_splice_items);
+	for (i=1; i<n; i++) {
+		if (items[i].start<items[i-1].stop) {
+			gint idx=items[i].index+1;
+			g_free(items);
+			lua_pushfstring(L, _("Error in module \"%s\" at function %s():\n"
+				" invalid table in argument #%d:\n"
+				" overlapping range for element #%d\n"),
+				LUA_MODULE_NAME, &__FUNCTION__[6], 1, idx);
+			lua_error(L);
+			return 0;
+		}
+	}
+	/* Work backwards, so the earlier positions are still valid */
+	sci_start_undo_action(sci);
+	for (i=n-1; i>=0; i--) {
+		scintilla_send_message(sci, SCI_SETTARGETSTART, items[i].start, 0);
+		scintilla_send_message(sci, SCI_SETTARGETEND, items[i].stop, 0);
+		scintilla_send_message(sci, SCI_REPLACETARGET, items[i].len, (sptr_t)items[i].text);
+	}
+	sci_end_undo_action(sci);
+	g_free(items);
+	push_number(L, sci_get_length(sci)-len);
+	return 1;
 }
 
 
 
-
 static gint get_sci_nav_cmd(const gchar*str, gboolean fwd, gboolean sel, gboolean rect)
 {
 	if (g_ascii_strncasecmp(str, "char", 4) == 0) {
@@ -853,6 +966,7 @@ static const struct luaL_reg glspi_sci_funcs[] = {
 	{"batch",     glspi_batch},
 	{"word",      glspi_word},
 	{"lines",     glspi_lines},
+	{"splice",    glspi_splice},
 	{"navigate",  glspi_navigate},
 	{"cut",       glspi_cut},
 	{"copy",      glspi_copy},
@@ -19,30 +19,13 @@
 
 #include "utils.h"
 #include "Scintilla.h"
+#include "macros.h"
 #include <stdlib.h>
 #include <sys/stat.h>
 #include <string.h>
 #include <gdk/gdkkeysyms.h>
 #include <gtk/gtk.h>
 
-/* structure to hold details of Macro event */
-typedef struct
-{
-	gint message;
-	gulong wparam;
-	glong lparam;
-} MacroEvent;
-
-/* structure to hold details of a macro */
-typedef struct
-{
-	gchar *name;
-	/* trigger codes */
-	guint keyval;
-	guint state;
-	GSList *MacroEvents;
-} Macro;
-
 /* structure to hold details of Macro for macro editor */
 typedef struct
 {
@@ -192,7 +175,6 @@ static GtkWidget *Record_Macro_menu_item=NULL;
 static GtkWidget *Stop_Record_Macro_menu_item=NULL;
 static GtkWidget *Edit_Macro_menu_item=NULL;
 static Macro *RecordingMacro=NULL;
-static GSList *mList=NULL;
 static gboolean bMacrosHaveChanged=FALSE;
 
 /* default config file */
@@ -202,143 +184,21 @@ const gchar default_config[] =
 	"Question_Macro_Overwrite = true\n"
 	"[Macros]";
 
-/* clear macro events list and free up any memory they are using */
-static GSList * ClearMacroList(GSList *gsl)
-{
-	MacroEvent *me;
-	GSList * gslTemp=gsl;
-
-	/* free data held in GSLIST structure */
-	while(gslTemp!=NULL)
-	{
-		me=gslTemp->data;
-		/* check to see if it's a message that has string attached, and free it if so
-		 * lparam might be NULL for SCI_SEARCHNEXT or SCI_SEARCHPREV but g_free is ok
-		 * with this
-		*/
-		if(me->message==SCI_REPLACESEL ||
-		   me->message==SCI_SEARCHNEXT ||
-		   me->message==SCI_SEARCHPREV)
-			g_free((void*)(me->lparam));
-
-		g_free((void*)(gslTemp->data));
-		gslTemp=g_slist_next(gslTemp);
-	}
-
-	/* free SLIST structure */
-	g_slist_free(gsl);
-
-	return NULL;
-}
-
-
-/* create new Macro */
-static Macro * CreateMacro(void)
-{
-	Macro *m;
-
-	if((m=(Macro*)(g_malloc(sizeof *m)))!=NULL)
-	{
-		m->name=NULL;
-		m->MacroEvents=NULL;
-		return m;
-	}
-	return NULL;
-}
-
-
-/* delete macro */
-static Macro * FreeMacro(Macro *m)
-{
-	if(m==NULL)
-		return NULL;
-
-	g_free(m->name);
-	ClearMacroList(m->MacroEvents);
-	g_free(m);
-
-	return NULL;
-}
-
-
-/* add a macro to the list of defined macros */
-static void AddMacroToList(Macro *m)
-{
-	mList=g_slist_append(mList,m);
-}
-
-
-/* remove macro from list of defined macros */
-static void RemoveMacroFromList(Macro *m)
-{
-	mList=g_slist_remove(mList,m);
-}
-
-
-/* returns a macro in the defined list by name, or NULL if no macro exists with the specified name
-*/
-static Macro * FindMacroByName(gchar *name)
-{
-	GSList *gsl=mList;
-
-	if(name==NULL)
-		return NULL;
-
-	while(gsl!=NULL)
-	{
-		if(strcmp(name,((Macro*)(gsl->data))->name)==0)
-			return gsl->data;
-
-		gsl=g_slist_next(gsl);
-	}
-
-	return NULL;
-}
-
-
-/* returns a macro in the defined list by key press combination, or NULL if no macro exists
- * with the specified key combination */
-static Macro * FindMacroByKey(guint keyval,guint state)
-{
-	GSList *gsl=mList;
-
-	while(gsl!=NULL)
-	{
-		if(((Macro*)(gsl->data))->keyval==keyval && ((Macro*)(gsl->data))->state==state)
-			return gsl->data;
-
-		gsl=g_slist_next(gsl);
-	}
-
-	return NULL;
-}
-
-
-/* completely wipe all saved macros and ascosiated memory */
-static void ClearAllMacros(void)
-{
-	GSList *gsl=mList;
-
-	while(gsl!=NULL)
-	{
-		FreeMacro((Macro*)(gsl->data));
-		gsl=g_slist_next(gsl);
-	}
-
-	g_slist_free(mList);
-	mList=NULL;
-}
-
-
 /* Repeat a macro to the editor */
 static void ReplayMacro(Macro *m)
 {
 	MacroEvent *me;
-	GSList *gsl=m->MacroEvents;
+	GSList *gsl;
 	ScintillaObject* sci=document_get_current()->editor->sci;
 	gchar *clipboardcontents;
 	gboolean bFoundAnchor=FALSE;
 
+	/* optimise macro on first replay, it may be replayed many times */
+	if(m->ReplayEvents==NULL)
+		m->ReplayEvents=CompileMacroEvents(m->MacroEvents);
+
+	gsl=m->ReplayEvents;
+
 	scintilla_send_message(sci,SCI_BEGINUNDOACTION,0,0);
 
 	while(gsl!=NULL)
@@ -615,7 +475,7 @@ static void SaveSettings(void)
 	gchar *cKey;
 	gchar *pcTemp;
 	gint i,k;
-	GSList *gsl=mList;
+	GSList *gsl=GetMacroList();
 	GSList *gslTemp;
 	gchar **pszMacroStrings;
 	Macro *m;
@@ -1245,7 +1105,6 @@ static void Name_Render_Edited_CallBack(GtkCellRendererText *cell,gchar *iter_id
 	GtkTreeModel *model;
 	GtkTreeIter iter;
 	Macro *m,*mTemp;
-	GSList *gsl=mList;
 
 	/* Get the iterator */
 	model=gtk_tree_view_get_model(treeview);
@@ -1259,17 +1118,15 @@ static void Name_Render_Edited_CallBack(GtkCellRendererText *cell,gchar *iter_id
 		return;
 
 	/* now check that no other macro is using this name */
-	while(gsl!=NULL)
-	{
-		mTemp=(Macro*)(gsl->data);
-		if(mTemp!=m && strcmp(new_text,mTemp->name)==0)
-			return;
-
-		gsl=g_slist_next(gsl);
-	}
+	mTemp=FindMacroByName(new_text);
+	if(mTemp!=NULL && mTemp!=m)
+		return;
 
-	/* set new name */
+	/* set new name, macro is looked up by name so needs re-indexing */
+	UnindexMacro(m);
+	g_free(m->name);
 	m->name=g_strdup(new_text);
+	IndexMacro(m);
 
 	/* Update the model */
 	gtk_list_store_set(GTK_LIST_STORE(model),&iter,0,new_text,-1);
@@ -1287,7 +1144,6 @@ static void Accel_Render_Edited_CallBack(GtkCellRendererAccel *cell,gchar *iter_
 	GtkTreeModel *model;
 	GtkTreeIter iter;
 	Macro *m,*mTemp;
-	GSList *gsl=mList;
 
 	/* check if is useable accelerator */
 	if(UseableAccel(key,mods)==FALSE)
@@ -1305,18 +1161,15 @@ static void Accel_Render_Edited_CallBack(GtkCellRendererAccel *cell,gchar *iter_
 		return;
 
 	/* now check that no other macro is using this key combination */
-	while(gsl!=NULL)
-	{
-		mTemp=(Macro*)(gsl->data);
-		if(mTemp!=m && mTemp->keyval==key && mTemp->state==mods)
-			return;
-
-		gsl=g_slist_next(gsl);
-	}
+	mTemp=FindMacroByKey(key,mods);
+	if(mTemp!=NULL && mTemp!=m)
+		return;
 
-	/* set new trigger values */
+	/* set new trigger values, macro is looked up by trigger so needs re-indexing */
+	UnindexMacro(m);
 	m->keyval=key;
 	m->state=mods;
+	IndexMacro(m);
 
 	/* Update the model */
 	cTemp=GetPretyKeyName(key,mods);
@@ -1954,6 +1807,7 @@ static void EditMacroElements(Macro *m)
 		{
 			/* clear old macro */
 			m->MacroEvents=ClearMacroList(m->MacroEvents);
+			m->ReplayEvents=ClearMacroList(m->ReplayEvents);
 
 			/* go through list adding macro events */
 			bHaveIter=gtk_tree_model_get_iter_first(GTK_TREE_MODEL(ls),&iter);
@@ -2057,7 +1911,7 @@ static void DoEditMacro(GtkMenuItem *menuitem, gpointer gdata)
 	GtkTreeIter iter;
 	GtkListStore *ls;
 	gint i;
-	GSList *gsl=mList;
+	GSList *gsl=GetMacroList();
 	Macro *m;
 	gchar *cTemp;
 
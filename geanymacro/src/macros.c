@@ -0,0 +1,335 @@
+/*
+ * This code is supplied as is, and is used at your own risk.
+ * The GNU GPL version 2 rules apply to this code (see http://fsf.org/>
+ * You can alter it, and pass it on as you want.
+ * If you alter it, or pass it on, the only restriction is that this disclamour and licence be
+ * left intact
+ *
+ * william.fraser@virgin.net
+ * 2010-11-01
+*/
+
+
+#ifdef HAVE_CONFIG_H
+	#include "config.h"
+#endif
+
+#include "Scintilla.h"
+#include "macros.h"
+
+static GSList *mList=NULL;
+static GHashTable *mNames=NULL;
+static GHashTable *mKeys=NULL;
+
+
+/* clear macro events list and free up any memory they are using */
+GSList * ClearMacroList(GSList *gsl)
+{
+	MacroEvent *me;
+	GSList * gslTemp=gsl;
+
+	/* free data held in GSLIST structure */
+	while(gslTemp!=NULL)
+	{
+		me=gslTemp->data;
+		/* check to see if it's a message that has string attached, and free it if so
+		 * lparam might be NULL for SCI_SEARCHNEXT or SCI_SEARCHPREV but g_free is ok
+		 * with this
+		*/
+		if(me->message==SCI_REPLACESEL ||
+		   me->message==SCI_SEARCHNEXT ||
+		   me->message==SCI_SEARCHPREV)
+			g_free((void*)(me->lparam));
+
+		g_free((void*)(gslTemp->data));
+		gslTemp=g_slist_next(gslTemp);
+	}
+
+	/* free SLIST structure */
+	g_slist_free(gsl);
+
+	return NULL;
+}
+
+
+/* create new Macro */
+Macro * CreateMacro(void)
+{
+	Macro *m;
+
+	if((m=(Macro*)(g_malloc(sizeof *m)))!=NULL)
+	{
+		m->name=NULL;
+		m->MacroEvents=NULL;
+		m->ReplayEvents=NULL;
+		return m;
+	}
+	return NULL;
+}
+
+
+/* delete macro */
+Macro * FreeMacro(Macro *m)
+{
+	if(m==NULL)
+		return NULL;
+
+	g_free(m->name);
+	ClearMacroList(m->MacroEvents);
+	ClearMacroList(m->ReplayEvents);
+	g_free(m);
+
+	return NULL;
+}
+
+
+/* hash a macro by it's trigger key combination */
+static guint MacroKeyHash(gconstpointer v)
+{
+	const Macro *m=v;
+
+	return m->keyval^(m->state<<16);
+}
+
+
+/* check if two macros have the same trigger key combination */
+static gboolean MacroKeyEqual(gconstpointer a,gconstpointer b)
+{
+	const Macro *ma=a,*mb=b;
+
+	return ma->keyval==mb->keyval && ma->state==mb->state;
+}
+
+
+/* add macro to the name and trigger lookup tables. If another macro already uses the name or
+ * trigger it is kept in the tables, so the first macro in the list is found as before
+*/
+void IndexMacro(Macro *m)
+{
+	if(mNames==NULL)
+	{
+		mNames=g_hash_table_new(g_str_hash,g_str_equal);
+		mKeys=g_hash_table_new(MacroKeyHash,MacroKeyEqual);
+	}
+
+	if(m->name!=NULL && g_hash_table_lookup(mNames,m->name)==NULL)
+		g_hash_table_insert(mNames,m->name,m);
+
+	if(g_hash_table_lookup(mKeys,m)==NULL)
+		g_hash_table_insert(mKeys,m,m);
+}
+
+
+/* remove macro from the name and trigger lookup tables, making any other macro with the same name
+ * or trigger in the list findable instead
+*/
+void UnindexMacro(Macro *m)
+{
+	GSList *gsl;
+	gboolean bRemoved=FALSE;
+
+	if(mNames==NULL)
+		return;
+
+	if(m->name!=NULL && g_hash_table_lookup(mNames,m->name)==m)
+	{
+		g_hash_table_remove(mNames,m->name);
+		bRemoved=TRUE;
+	}
+
+	if(g_hash_table_lookup(mKeys,m)==m)
+	{
+		g_hash_table_remove(mKeys,m);
+		bRemoved=TRUE;
+	}
+
+	/* only happens if macros with the same name or trigger have been loaded */
+	if(bRemoved==TRUE)
+		for(gsl=mList;gsl!=NULL;gsl=g_slist_next(gsl))
+			if(gsl->data!=m)
+				IndexMacro((Macro*)(gsl->data));
+}
+
+
+/* add a macro to the list of defined macros */
+void AddMacroToList(Macro *m)
+{
+	mList=g_slist_append(mList,m);
+	IndexMacro(m);
+}
+
+
+/* remove macro from list of defined macros */
+void RemoveMacroFromList(Macro *m)
+{
+	mList=g_slist_remove(mList,m);
+	UnindexMacro(m);
+}
+
+
+/* get the list of defined macros, in the order they were added */
+GSList * GetMacroList(void)
+{
+	return mList;
+}
+
+
+/* returns a macro in the defined list by name, or NULL if no macro exists with the specified name
+*/
+Macro * FindMacroByName(gchar *name)
+{
+	if(name==NULL || mNames==NULL)
+		return NULL;
+
+	return g_hash_table_lookup(mNames,name);
+}
+
+
+/* returns a macro in the defined list by key press combination, or NULL if no macro exists
+ * with the specified key combination */
+Macro * FindMacroByKey(guint keyval,guint state)
+{
+	Macro mKey;
+
+	if(mKeys==NULL)
+		return NULL;
+
+	mKey.keyval=keyval;
+	mKey.state=state;
+
+	return g_hash_table_lookup(mKeys,&mKey);
+}
+
+
+/* completely wipe all saved macros and ascosiated memory */
+void ClearAllMacros(void)
+{
+	GSList *gsl=mList;
+
+	while(gsl!=NULL)
+	{
+		FreeMacro((Macro*)(gsl->data));
+		gsl=g_slist_next(gsl);
+	}
+
+	g_slist_free(mList);
+	mList=NULL;
+
+	if(mNames!=NULL)
+	{
+		g_hash_table_destroy(mNames);
+		g_hash_table_destroy(mKeys);
+		mNames=NULL;
+		mKeys=NULL;
+	}
+}
+
+
+/* check if message just moves the cursor, removing any selection */
+static gboolean IsCursorMove(gint message)
+{
+	switch(message)
+	{
+		case SCI_LINEDOWN:
+		case SCI_LINEUP:
+		case SCI_CHARLEFT:
+		case SCI_CHARRIGHT:
+		case SCI_WORDLEFT:
+		case SCI_WORDRIGHT:
+		case SCI_WORDPARTLEFT:
+		case SCI_WORDPARTRIGHT:
+		case SCI_HOME:
+		case SCI_LINEEND:
+		case SCI_DOCUMENTSTART:
+		case SCI_DOCUMENTEND:
+		case SCI_PAGEUP:
+		case SCI_PAGEDOWN:
+		case SCI_HOMEDISPLAY:
+		case SCI_LINEENDDISPLAY:
+		case SCI_VCHOME:
+		case SCI_PARADOWN:
+		case SCI_PARAUP:
+		case SCI_WORDLEFTEND:
+		case SCI_WORDRIGHTEND:
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+
+/* check if a cursor move makes the one before it redundant: moves to the document start or end
+ * don't depend on where the cursor was, and moves to the line start or end don't move any
+ * further when repeated
+*/
+static gboolean CursorMoveOverrides(gint message,gint previous)
+{
+	if(message==SCI_DOCUMENTSTART || message==SCI_DOCUMENTEND)
+		return TRUE;
+
+	return message==previous &&
+	       (message==SCI_HOME || message==SCI_LINEEND ||
+	        message==SCI_HOMEDISPLAY || message==SCI_LINEENDDISPLAY);
+}
+
+
+/* create a copy of macro events optimised for replaying: runs of text inserts are joined into a
+ * single insert, and cursor moves overridden by the following move are dropped
+ * resultant list needs to be freed with ClearMacroList
+*/
+GSList * CompileMacroEvents(GSList *gsl)
+{
+	GSList *gslCompiled=NULL;
+	GString *gsText=NULL;
+	MacroEvent *me,*meNew;
+
+	while(gsl!=NULL)
+	{
+		me=gsl->data;
+		gsl=g_slist_next(gsl);
+
+		/* collect inserted text until something other than an insert is found */
+		if(me->message==SCI_REPLACESEL)
+		{
+			if(gsText==NULL)
+				gsText=g_string_new(NULL);
+
+			g_string_append(gsText,(gchar*)(me->lparam));
+			continue;
+		}
+
+		if(gsText!=NULL)
+		{
+			meNew=g_new0(MacroEvent,1);
+			meNew->message=SCI_REPLACESEL;
+			meNew->lparam=(glong)(g_string_free(gsText,FALSE));
+			gslCompiled=g_slist_prepend(gslCompiled,meNew);
+			gsText=NULL;
+		}
+
+		/* skip cursor move if next event puts the cursor somewhere regardless */
+		if(gsl!=NULL && IsCursorMove(me->message) &&
+		   IsCursorMove(((MacroEvent*)(gsl->data))->message) &&
+		   CursorMoveOverrides(((MacroEvent*)(gsl->data))->message,me->message))
+			continue;
+
+		/* copy event, compiled list has it's own copy of search text */
+		meNew=g_memdup(me,sizeof(MacroEvent));
+		if(me->message==SCI_SEARCHNEXT || me->message==SCI_SEARCHPREV)
+			meNew->lparam=(glong)(g_strdup((gchar*)(me->lparam)));
+
+		gslCompiled=g_slist_prepend(gslCompiled,meNew);
+	}
+
+	/* macro may end with inserted text */
+	if(gsText!=NULL)
+	{
+		meNew=g_new0(MacroEvent,1);
+		meNew->message=SCI_REPLACESEL;
+		meNew->lparam=(glong)(g_string_free(gsText,FALSE));
+		gslCompiled=g_slist_prepend(gslCompiled,meNew);
+	}
+
+	/* more efficient to create reverse list and reverse it at the end */
+	return g_slist_reverse(gslCompiled);
+}
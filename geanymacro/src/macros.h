@@ -0,0 +1,54 @@
+/*
+ * This code is supplied as is, and is used at your own risk.
+ * The GNU GPL version 2 rules apply to this code (see http://fsf.org/>
+ * You can alter it, and pass it on as you want.
+ * If you alter it, or pass it on, the only restriction is that this disclamour and licence be
+ * left intact
+ *
+ * william.fraser@virgin.net
+ * 2010-11-01
+*/
+
+/* the list of defined macros, looked up by name and trigger, and the compiling of macros for
+ * replaying. Kept apart from the plugin code so that it can be tested without Geany
+*/
+
+#ifndef MACROS_H
+#define MACROS_H
+
+#include <glib.h>
+
+/* structure to hold details of Macro event */
+typedef struct
+{
+	gint message;
+	gulong wparam;
+	glong lparam;
+} MacroEvent;
+
+/* structure to hold details of a macro */
+typedef struct
+{
+	gchar *name;
+	/* trigger codes */
+	guint keyval;
+	guint state;
+	GSList *MacroEvents;
+	/* optimised copy of MacroEvents used for replaying, created when first replayed */
+	GSList *ReplayEvents;
+} Macro;
+
+GSList * ClearMacroList(GSList *gsl);
+Macro * CreateMacro(void);
+Macro * FreeMacro(Macro *m);
+void IndexMacro(Macro *m);
+void UnindexMacro(Macro *m);
+void AddMacroToList(Macro *m);
+void RemoveMacroFromList(Macro *m);
+GSList * GetMacroList(void);
+Macro * FindMacroByName(gchar *name);
+Macro * FindMacroByKey(guint keyval,guint state);
+void ClearAllMacros(void);
+GSList * CompileMacroEvents(GSList *gsl);
+
+#endif
@@ -0,0 +1,400 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <check.h>
+
+#include <glib.h>
+#include "Scintilla.h"
+#include "macros.h"
+
+
+/* A stand-in for the editor, with the document held as lines, that handles the messages the
+ * tests record. Text inserted never holds newlines. */
+typedef struct
+{
+	GPtrArray *lines;
+	guint line;
+	gsize column;
+	guint messages;
+} FakeEditor;
+
+
+static FakeEditor * FakeEditorNew(guint lines)
+{
+	FakeEditor *fe=g_new0(FakeEditor,1);
+	guint i;
+
+	fe->lines=g_ptr_array_new();
+	for(i=0;i<lines;i++)
+		g_ptr_array_add(fe->lines,g_string_new("int value = 0"));
+
+	return fe;
+}
+
+
+static GString * FakeLine(FakeEditor *fe,guint line)
+{
+	return g_ptr_array_index(fe->lines,line);
+}
+
+
+static void FakeEditorFree(FakeEditor *fe)
+{
+	guint i;
+
+	for(i=0;i<fe->lines->len;i++)
+		g_string_free(FakeLine(fe,i),TRUE);
+
+	g_ptr_array_free(fe->lines,TRUE);
+	g_free(fe);
+}
+
+
+static void FakeSend(FakeEditor *fe,MacroEvent *me)
+{
+	GString *line=FakeLine(fe,fe->line);
+
+	fe->messages++;
+	switch(me->message)
+	{
+		case SCI_REPLACESEL:
+			g_string_insert(line,fe->column,(gchar*)(me->lparam));
+			fe->column+=strlen((gchar*)(me->lparam));
+			break;
+		case SCI_CHARLEFT:
+			if(fe->column>0)
+				fe->column--;
+			else if(fe->line>0)
+				fe->column=FakeLine(fe,--fe->line)->len;
+			break;
+		case SCI_CHARRIGHT:
+			if(fe->column<line->len)
+				fe->column++;
+			else if(fe->line+1<fe->lines->len)
+			{
+				fe->line++;
+				fe->column=0;
+			}
+			break;
+		case SCI_LINEUP:
+		case SCI_LINEDOWN:
+			if(me->message==SCI_LINEUP ? fe->line>0 : fe->line+1<fe->lines->len)
+				fe->line+=me->message==SCI_LINEUP ? -1 : 1;
+			fe->column=MIN(fe->column,FakeLine(fe,fe->line)->len);
+			break;
+		case SCI_HOME:
+			fe->column=0;
+			break;
+		case SCI_LINEEND:
+			fe->column=line->len;
+			break;
+		case SCI_DOCUMENTSTART:
+			fe->line=0;
+			fe->column=0;
+			break;
+		case SCI_DOCUMENTEND:
+			fe->line=fe->lines->len-1;
+			fe->column=FakeLine(fe,fe->line)->len;
+			break;
+		case SCI_DELETEBACK:
+			if(fe->column>0)
+				g_string_erase(line,--fe->column,1);
+			break;
+		default:
+			fail("message %d not handled",me->message);
+	}
+}
+
+
+static void FakeReplay(FakeEditor *fe,GSList *gsl)
+{
+	for(;gsl!=NULL;gsl=g_slist_next(gsl))
+		FakeSend(fe,gsl->data);
+}
+
+
+/* check both editors hold the same text, with the cursor in the same place */
+static void CheckSameEditors(FakeEditor *fe1,FakeEditor *fe2)
+{
+	guint i;
+
+	fail_unless(fe1->line==fe2->line && fe1->column==fe2->column,
+	            "cursor at %u:%u and %u:%u",fe1->line,(guint)(fe1->column),fe2->line,
+	            (guint)(fe2->column));
+	for(i=0;i<fe1->lines->len;i++)
+		fail_unless(strcmp(FakeLine(fe1,i)->str,FakeLine(fe2,i)->str)==0,
+		            "line %u: \"%s\" and \"%s\"",i,FakeLine(fe1,i)->str,FakeLine(fe2,i)->str);
+}
+
+
+/* add an event to a macro being built in reverse order */
+static GSList * AddEvent(GSList *gsl,gint message,const gchar *text)
+{
+	MacroEvent *me=g_new0(MacroEvent,1);
+
+	me->message=message;
+	if(text!=NULL)
+		me->lparam=(glong)(g_strdup(text));
+
+	return g_slist_prepend(gsl,me);
+}
+
+
+/* check events are the messages in expected, which ends with 0 */
+static void CheckEvents(GSList *gsl,const gint *expected)
+{
+	guint i;
+
+	for(i=0;gsl!=NULL && expected[i]!=0;i++,gsl=g_slist_next(gsl))
+		fail_unless(((MacroEvent*)(gsl->data))->message==expected[i],
+		            "event %u is %d, expected %d",i,((MacroEvent*)(gsl->data))->message,
+		            expected[i]);
+
+	fail_unless(gsl==NULL && expected[i]==0,"event count differs at %u",i);
+}
+
+
+static Macro * NewMacro(const gchar *name,guint keyval,guint state)
+{
+	Macro *m=CreateMacro();
+
+	m->name=g_strdup(name);
+	m->keyval=keyval;
+	m->state=state;
+	return m;
+}
+
+
+START_TEST(test_find)
+{
+	Macro *m1=NewMacro("one",'a',4);
+	Macro *m2=NewMacro("two",'b',4);
+	Macro *m3=NewMacro("one",'a',5);
+
+	AddMacroToList(m1);
+	AddMacroToList(m2);
+	fail_unless(FindMacroByName("two")==m2);
+	fail_unless(FindMacroByName("three")==NULL);
+	fail_unless(FindMacroByKey('a',4)==m1);
+	fail_unless(FindMacroByKey('a',5)==NULL);
+
+	/* a duplicate name from a hand edited file: the first macro is found until removed */
+	AddMacroToList(m3);
+	fail_unless(FindMacroByName("one")==m1);
+	fail_unless(FindMacroByKey('a',5)==m3);
+	RemoveMacroFromList(m1);
+	FreeMacro(m1);
+	fail_unless(FindMacroByName("one")==m3);
+	fail_unless(FindMacroByKey('a',4)==NULL);
+
+	/* renaming and changing the trigger re-index the macro */
+	UnindexMacro(m2);
+	g_free(m2->name);
+	m2->name=g_strdup("renamed");
+	m2->keyval='c';
+	IndexMacro(m2);
+	fail_unless(FindMacroByName("two")==NULL);
+	fail_unless(FindMacroByName("renamed")==m2);
+	fail_unless(FindMacroByKey('b',4)==NULL);
+	fail_unless(FindMacroByKey('c',4)==m2);
+
+	fail_unless(g_slist_length(GetMacroList())==2);
+	ClearAllMacros();
+	fail_unless(GetMacroList()==NULL);
+	fail_unless(FindMacroByName("renamed")==NULL);
+	fail_unless(FindMacroByKey('c',4)==NULL);
+}
+END_TEST;
+
+
+START_TEST(test_compile_inserts)
+{
+	GSList *gsl=NULL,*gslCompiled;
+	const gint expected[]={SCI_REPLACESEL,SCI_LINEDOWN,SCI_REPLACESEL,0};
+
+	gsl=AddEvent(gsl,SCI_REPLACESEL,"a");
+	gsl=AddEvent(gsl,SCI_REPLACESEL,"b");
+	gsl=AddEvent(gsl,SCI_REPLACESEL,"c");
+	gsl=AddEvent(gsl,SCI_LINEDOWN,NULL);
+	gsl=AddEvent(gsl,SCI_REPLACESEL,"d");
+	gsl=g_slist_reverse(gsl);
+
+	gslCompiled=CompileMacroEvents(gsl);
+	CheckEvents(gslCompiled,expected);
+	fail_unless(strcmp((gchar*)(((MacroEvent*)(gslCompiled->data))->lparam),"abc")==0);
+	fail_unless(strcmp((gchar*)(((MacroEvent*)(g_slist_last(gslCompiled)->data))->lparam),
+	            "d")==0);
+
+	/* the compiled list has its own copies of the text */
+	ClearMacroList(gsl);
+	ClearMacroList(gslCompiled);
+	fail_unless(CompileMacroEvents(NULL)==NULL);
+}
+END_TEST;
+
+
+START_TEST(test_compile_moves)
+{
+	GSList *gsl=NULL,*gslCompiled;
+	const gint expected[]={SCI_CHARRIGHT,SCI_DOCUMENTEND,SCI_HOME,SCI_LINEEND,SCI_CHARLEFT,
+	                       SCI_SEARCHNEXT,SCI_HOME,SCI_CHARRIGHT,SCI_HOME,0};
+
+	gsl=AddEvent(gsl,SCI_CHARRIGHT,NULL);
+	gsl=AddEvent(gsl,SCI_LINEDOWN,NULL);
+	gsl=AddEvent(gsl,SCI_DOCUMENTEND,NULL);
+	gsl=AddEvent(gsl,SCI_HOME,NULL);
+	gsl=AddEvent(gsl,SCI_HOME,NULL);
+	gsl=AddEvent(gsl,SCI_LINEEND,NULL);
+	gsl=AddEvent(gsl,SCI_LINEEND,NULL);
+	gsl=AddEvent(gsl,SCI_CHARLEFT,NULL);
+	/* a search is not a cursor move, so the one before it stays */
+	gsl=AddEvent(gsl,SCI_SEARCHNEXT,"x");
+	gsl=AddEvent(gsl,SCI_HOME,NULL);
+	gsl=AddEvent(gsl,SCI_CHARRIGHT,NULL);
+	gsl=AddEvent(gsl,SCI_HOME,NULL);
+	gsl=g_slist_reverse(gsl);
+
+	gslCompiled=CompileMacroEvents(gsl);
+	CheckEvents(gslCompiled,expected);
+	ClearMacroList(gsl);
+	ClearMacroList(gslCompiled);
+}
+END_TEST;
+
+
+/* random macros leave the editor as the recorded events do when compiled */
+START_TEST(test_compile_random)
+{
+	const gint messages[]={SCI_REPLACESEL,SCI_REPLACESEL,SCI_CHARLEFT,SCI_CHARRIGHT,SCI_LINEUP,
+	                       SCI_LINEDOWN,SCI_HOME,SCI_LINEEND,SCI_DOCUMENTSTART,SCI_DOCUMENTEND,
+	                       SCI_DELETEBACK};
+	const gchar *texts[]={"a","bc","",";"};
+	gint i,k;
+
+	srand(1);
+	for(i=0;i<2000;i++)
+	{
+		GSList *gsl=NULL,*gslCompiled;
+		FakeEditor *fe1=FakeEditorNew(5),*fe2=FakeEditorNew(5);
+		gint count=rand()%20;
+
+		for(k=0;k<count;k++)
+		{
+			gint message=messages[rand()%G_N_ELEMENTS(messages)];
+
+			gsl=AddEvent(gsl,message,message==SCI_REPLACESEL ?
+			             texts[rand()%G_N_ELEMENTS(texts)] : NULL);
+		}
+		gsl=g_slist_reverse(gsl);
+		gslCompiled=CompileMacroEvents(gsl);
+
+		for(k=0;k<3;k++)
+		{
+			FakeReplay(fe1,gsl);
+			FakeReplay(fe2,gslCompiled);
+		}
+		CheckSameEditors(fe1,fe2);
+		fail_unless(fe2->messages<=fe1->messages);
+
+		ClearMacroList(gsl);
+		ClearMacroList(gslCompiled);
+		FakeEditorFree(fe1);
+		FakeEditorFree(fe2);
+	}
+}
+END_TEST;
+
+
+#define BENCHMARK_LINES 100000
+#define BENCHMARK_REPLAYS 10000
+
+/* a macro typed to edit a line and move to the next one */
+static GSList * TypingMacro(void)
+{
+	GSList *gsl=NULL;
+	const gchar *typed="static ";
+	gint i;
+
+	gsl=AddEvent(gsl,SCI_LINEEND,NULL);
+	gsl=AddEvent(gsl,SCI_HOME,NULL);
+	gsl=AddEvent(gsl,SCI_HOME,NULL);
+	for(i=0;typed[i];i++)
+	{
+		gchar c[2]={typed[i],'\0'};
+		gsl=AddEvent(gsl,SCI_REPLACESEL,c);
+	}
+	for(i=0;i<6;i++)
+		gsl=AddEvent(gsl,SCI_CHARRIGHT,NULL);
+	gsl=AddEvent(gsl,SCI_LINEEND,NULL);
+	gsl=AddEvent(gsl,SCI_DELETEBACK,NULL);
+	gsl=AddEvent(gsl,SCI_REPLACESEL,"1");
+	gsl=AddEvent(gsl,SCI_REPLACESEL,";");
+	gsl=AddEvent(gsl,SCI_LINEDOWN,NULL);
+	return g_slist_reverse(gsl);
+}
+
+
+static gdouble BenchmarkReplay(FakeEditor *fe,GSList *gsl)
+{
+	GTimer *timer=g_timer_new();
+	gdouble elapsed;
+	gint i;
+
+	for(i=0;i<BENCHMARK_REPLAYS;i++)
+		FakeReplay(fe,gsl);
+
+	elapsed=g_timer_elapsed(timer,NULL);
+	g_timer_destroy(timer);
+	return elapsed;
+}
+
+
+START_TEST(test_benchmark_replay)
+{
+	GSList *gsl=TypingMacro();
+	GSList *gslCompiled=CompileMacroEvents(gsl);
+	FakeEditor *fe1=FakeEditorNew(BENCHMARK_LINES),*fe2=FakeEditorNew(BENCHMARK_LINES);
+	gdouble recorded=BenchmarkReplay(fe1,gsl);
+	gdouble compiled=BenchmarkReplay(fe2,gslCompiled);
+
+	CheckSameEditors(fe1,fe2);
+	fail_unless(strcmp(FakeLine(fe2,BENCHMARK_REPLAYS-1)->str,"static int value = 1;")==0);
+	fail_unless(strcmp(FakeLine(fe2,BENCHMARK_REPLAYS)->str,"int value = 0")==0);
+	printf("%d replays over %d lines: %u messages in %.1f ms, compiled %u in %.1f ms\n",
+	       BENCHMARK_REPLAYS,BENCHMARK_LINES,fe1->messages,recorded*1000,fe2->messages,
+	       compiled*1000);
+
+	ClearMacroList(gsl);
+	ClearMacroList(gslCompiled);
+	FakeEditorFree(fe1);
+	FakeEditorFree(fe2);
+}
+END_TEST;
+
+
+Suite *
+my_suite(void)
+{
+	Suite *s = suite_create("GeanyMacro");
+	TCase *tc_core = tcase_create("Core");
+	suite_add_tcase(s, tc_core);
+	tcase_add_test(tc_core, test_find);
+	tcase_add_test(tc_core, test_compile_inserts);
+	tcase_add_test(tc_core, test_compile_moves);
+	tcase_add_test(tc_core, test_compile_random);
+	tcase_add_test(tc_core, test_benchmark_replay);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int nf;
+	Suite *s = my_suite();
+	SRunner *sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	nf = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return (nf == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
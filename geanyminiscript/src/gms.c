@@ -34,6 +34,11 @@
 
 /* headers */
 #include    <stdlib.h>
+#include    <string.h>
+#include    <signal.h>
+#include    <unistd.h>
+#include    <sys/types.h>
+#include    <sys/wait.h>
 #include    <glib.h>
 #include    <glib/gstdio.h>
 
@@ -59,177 +64,524 @@ PLUGIN_SET_TRANSLATABLE_INFO(
     _("A tool to apply a script filter on a text selection or current document(s)"),
     "0.1" , _("Pascal BURLOT, a Geany user"))
 
+/*! \brief size of the chunks written to the filter input */
+#define GMS_WRITE_CHUNK     65536
+/*! \brief size of the buffer used to read the filter outputs */
+#define GMS_READ_CHUNK      65536
+/*! \brief period of the progress bar pulses, in milliseconds */
+#define GMS_PULSE_PERIOD    100
+
+/*! \brief definition of a running filter */
+typedef struct {
+    GeanyDocument *doc        ; /*!< filtered document */
+    gint        sel_start     ; /*!< start of the filtered text */
+    gint        sel_end       ; /*!< end of the filtered text */
+    gchar      *input         ; /*!< text given to the filter input */
+    gsize       in_len        ; /*!< length of the input */
+    gsize       in_pos        ; /*!< number of input bytes already written */
+    GString    *output        ; /*!< text read from the filter output */
+    GString    *error         ; /*!< text read from the filter error output */
+    GPid        pid           ; /*!< process id of the filter */
+    gint        status        ; /*!< exit status of the filter */
+    gboolean    exited        ; /*!< the filter process has exited */
+    gboolean    timed_out     ; /*!< the filter has been stopped by the timeout */
+    gboolean    cancelled     ; /*!< the filter has been stopped by the user */
+    guint       in_id         ; /*!< event source writing the input */
+    guint       out_id        ; /*!< event source reading the output */
+    guint       err_id        ; /*!< event source reading the error output */
+    guint       child_id      ; /*!< event source watching the process */
+    guint       timeout_id    ; /*!< event source of the timeout */
+} gms_job_t ;
+
 static GtkWidget     *gms_item   = NULL ;
 static gms_handle_t gms_hnd     = NULL ;
 static gchar        *gms_command = NULL ;
 
+static gms_job_t    *gms_job      = NULL ; /*!< running filter */
+static GSList       *gms_pending  = NULL ; /*!< documents waiting for the filter */
+static gms_input_t   gms_in_mode  = IN_SELECTION ;    /*!< input mode of the running filter */
+static gms_output_t  gms_out_mode = OUT_CURRENT_DOC ; /*!< output mode of the running filter */
+static GtkWidget    *gms_progress = NULL ; /*!< progress dialog of the running filter */
+static guint         gms_pulse_id = 0 ;    /*!< event source animating the progress bar */
+
+static void job_check_done( gms_job_t *job ) ;
+static void start_next_job( void ) ;
+
+
+/**
+ * \brief the function select entirely the document
+ */
+static void select_entirely_doc( ScintillaObject *sci  )
+{
+    gint            size_buf = sci_get_length(sci);
+
+    sci_set_selection_start( sci , 0 ) ;
+    sci_set_selection_end( sci , size_buf ) ;
+}
+
+/**
+ * \brief the function converts a filter output to UTF-8, the text is consumed
+ */
+static gchar *filter_text_to_utf8( GString *text )
+{
+    /* the usual UTF-8 locale needs no conversion */
+    if ( g_get_charset(NULL) && g_utf8_validate( text->str, text->len, NULL ) )
+        return g_string_free( text, FALSE ) ;
+    else
+    {
+        gchar *utf8 = g_locale_to_utf8( text->str, text->len, NULL, NULL, NULL );
+        g_string_free( text, TRUE ) ;
+        return utf8 ;
+    }
+}
 
 /**
- * \brief the function creates from the current selection to the input file
+ * \brief the function updates the current document as a single undo action
  */
-static void create_selection_2_input_file( ScintillaObject *sci )
+static void update_doc( ScintillaObject *sci, gint start, gint end, gchar * contents )
 {
-    gchar  *contents = NULL;
-    gint    size_buf = sci_get_selected_text_length(sci);
+    if (contents==NULL) return ;
+    sci_set_selection_start( sci , start ) ;
+    sci_set_selection_end( sci , end ) ;
+    sci_start_undo_action( sci ) ;
+    sci_replace_sel( sci, contents );
+    sci_end_undo_action( sci ) ;
+}
 
-    contents = GMS_G_MALLOC( gchar, size_buf + 1  ) ;
-    GMS_PNULL(contents) ;
+/**
+ * \brief the function displays an error message of the filter
+ */
+static void show_filter_error( const gchar *msg )
+{
+    GtkWidget *dlg ;
 
-    sci_get_selected_text( sci ,contents  );
+    dlg = gtk_message_dialog_new( GTK_WINDOW(geany->main_widgets->window),
+                    GTK_DIALOG_DESTROY_WITH_PARENT,
+                    GTK_MESSAGE_ERROR,
+                    GTK_BUTTONS_CLOSE,
+                    "%s", msg);
 
-    g_file_set_contents(gms_get_in_filename(gms_hnd), contents, -1 , NULL );
-    GMS_G_FREE(contents);
+    gtk_dialog_run(GTK_DIALOG(dlg));
+    gtk_widget_destroy(GTK_WIDGET(dlg)) ;
 }
 
 /**
- * \brief the function reads the result file
+ * \brief the function removes an event source of the filter
  */
-static gchar *read_result_file( gchar *filename )
+static void remove_source( guint *id )
 {
-    gchar *utf8     = NULL;
-    gchar *contents = NULL;
-    GError *error   = NULL ;
-    if (g_file_get_contents(filename, &contents, NULL, &error ))
+    if ( *id != 0 )
     {
-        if ( contents )
-        {
-            utf8 = g_locale_to_utf8 (contents, -1, NULL, NULL, NULL);
-            GMS_G_FREE(contents);
-        }
+        g_source_remove( *id ) ;
+        *id = 0 ;
     }
-    return utf8 ;
 }
+
 /**
- * \brief the function select entirely the document
+ * \brief the function opens a channel on a filter pipe and watches it
  */
-static void select_entirely_doc( ScintillaObject *sci  )
+static guint watch_channel( gint fd, GIOCondition cond, GIOFunc func, gms_job_t *job )
 {
-    gint            size_buf = sci_get_length(sci);
+    GIOChannel *ch = g_io_channel_unix_new( fd ) ;
+    guint       id ;
+
+    g_io_channel_set_encoding( ch, NULL, NULL ) ;
+    g_io_channel_set_buffered( ch, FALSE ) ;
+    g_io_channel_set_flags( ch, G_IO_FLAG_NONBLOCK, NULL ) ;
+    g_io_channel_set_close_on_unref( ch, TRUE ) ;
+
+    /* the watch keeps the channel, the pipe is closed with the watch */
+    id = g_io_add_watch( ch, cond, func, job ) ;
+    g_io_channel_unref( ch ) ;
+    return id ;
+}
 
-    sci_set_selection_start( sci , 0 ) ;
-    sci_set_selection_end( sci , size_buf ) ;
+/**
+ * \brief the function reads the available data of a filter pipe
+ * \return FALSE at the end of file or on error
+ */
+static gboolean read_filter_pipe( GIOChannel *ch, GIOCondition cond, GString *text )
+{
+    gsize       len   = text->len ;
+    gsize       count = 0 ;
+    GIOStatus   st ;
+
+    if ( !( cond & (G_IO_IN|G_IO_HUP) ) )
+        return FALSE ;
+
+    /* read straight into the string */
+    g_string_set_size( text, len + GMS_READ_CHUNK ) ;
+    st = g_io_channel_read_chars( ch, text->str + len, GMS_READ_CHUNK, &count, NULL ) ;
+    g_string_set_size( text, len + count ) ;
+
+    return st == G_IO_STATUS_NORMAL || st == G_IO_STATUS_AGAIN ;
 }
 
 /**
- * \brief the function updates the current document
+ * \brief Callback writing the next input chunk to the filter
  */
-static void update_doc( ScintillaObject *sci, gchar * contents )
+static gboolean on_filter_input( GIOChannel *ch, GIOCondition cond, gpointer data )
 {
-    if (contents==NULL) return ;
-    sci_replace_sel( sci, contents );
+    gms_job_t  *job = (gms_job_t *) data ;
+
+    if ( cond & G_IO_OUT )
+    {
+        gsize       written = 0 ;
+        gsize       count   = MIN( job->in_len - job->in_pos, GMS_WRITE_CHUNK ) ;
+        GIOStatus   st ;
+        void      (*old_handler)(int) ;
+
+        /* a filter which does not read its input must not kill geany */
+        old_handler = signal( SIGPIPE, SIG_IGN ) ;
+        st = g_io_channel_write_chars( ch, job->input + job->in_pos, count, &written, NULL ) ;
+        signal( SIGPIPE, old_handler ) ;
+
+        job->in_pos += written ;
+        if ( ( st == G_IO_STATUS_NORMAL || st == G_IO_STATUS_AGAIN ) && job->in_pos < job->in_len )
+            return TRUE ;
+    }
+
+    /* all written or the filter closed its input: the pipe is closed */
+    job->in_id = 0 ;
+    return FALSE ;
+}
+
+/**
+ * \brief Callback reading the filter output
+ */
+static gboolean on_filter_output( GIOChannel *ch, GIOCondition cond, gpointer data )
+{
+    gms_job_t  *job = (gms_job_t *) data ;
+
+    if ( read_filter_pipe( ch, cond, job->output ) )
+        return TRUE ;
+
+    job->out_id = 0 ;
+    job_check_done( job ) ;
+    return FALSE ;
+}
+
+/**
+ * \brief Callback reading the filter error output
+ */
+static gboolean on_filter_error( GIOChannel *ch, GIOCondition cond, gpointer data )
+{
+    gms_job_t  *job = (gms_job_t *) data ;
+
+    if ( read_filter_pipe( ch, cond, job->error ) )
+        return TRUE ;
+
+    job->err_id = 0 ;
+    job_check_done( job ) ;
+    return FALSE ;
+}
+
+/**
+ * \brief Callback called when the filter process exits
+ */
+static void on_filter_exit( GPid pid, gint status, gpointer data )
+{
+    gms_job_t  *job = (gms_job_t *) data ;
+
+    g_spawn_close_pid( pid ) ;
+    job->status   = status ;
+    job->exited   = TRUE ;
+    job->child_id = 0 ;
+    job_check_done( job ) ;
+}
+
+/**
+ * \brief Called in the filter process before the script is executed
+ */
+static void on_filter_setup( gpointer data )
+{
+    /* own process group, so the whole pipeline can be stopped */
+    setpgid( 0, 0 ) ;
+}
+
+/**
+ * \brief the function stops a running filter, its outputs are discarded
+ */
+static void stop_job( gms_job_t *job )
+{
+    if ( !job->exited || job->out_id != 0 || job->err_id != 0 )
+        kill( -job->pid, SIGKILL ) ;
+
+    remove_source( &job->in_id ) ;
+    remove_source( &job->out_id ) ;
+    remove_source( &job->err_id ) ;
+    job_check_done( job ) ;
 }
+
 /**
- * \brief the function deletes the tempory files
+ * \brief Callback called when the filter runs too long
  */
-static void delete_tmp_files(void)
+static gboolean on_filter_timeout( gpointer data )
 {
-    if( g_file_test( gms_get_in_filename(gms_hnd),G_FILE_TEST_EXISTS) == TRUE )
-        g_unlink( gms_get_in_filename(gms_hnd) ) ;
-    if( g_file_test( gms_get_out_filename(gms_hnd),G_FILE_TEST_EXISTS) == TRUE )
-        g_unlink( gms_get_out_filename(gms_hnd) ) ;
+    gms_job_t  *job = (gms_job_t *) data ;
+
+    job->timeout_id = 0 ;
+    job->timed_out  = TRUE ;
+    stop_job( job ) ;
+    return FALSE ;
+}
+
+/**
+ * \brief the function frees a filter job
+ */
+static void free_job( gms_job_t *job )
+{
+    remove_source( &job->in_id ) ;
+    remove_source( &job->out_id ) ;
+    remove_source( &job->err_id ) ;
+    remove_source( &job->child_id ) ;
+    remove_source( &job->timeout_id ) ;
+
+    GMS_G_FREE( job->input ) ;
+    if ( job->output != NULL )
+        g_string_free( job->output, TRUE ) ;
+    if ( job->error != NULL )
+        g_string_free( job->error, TRUE ) ;
+    GMS_G_FREE( job ) ;
+}
+
+/**
+ * \brief the function ends the filtering of all documents
+ */
+static void finish_filter( void )
+{
+    g_slist_free( gms_pending ) ;
+    gms_pending = NULL ;
+
+    if ( gms_pulse_id != 0 )
+    {
+        g_source_remove( gms_pulse_id ) ;
+        gms_pulse_id = 0 ;
+    }
+    GMS_FREE_WIDGET( gms_progress ) ;
+
     if( g_file_test( gms_get_filter_filename(gms_hnd),G_FILE_TEST_EXISTS) == TRUE )
         g_unlink( gms_get_filter_filename(gms_hnd) ) ;
 }
 
 /**
- * \brief the function updates the current document
+ * \brief the function applies the result of a filter once it is complete
  */
-static gint run_filter( ScintillaObject *sci )
+static void job_check_done( gms_job_t *job )
 {
-    int r , ret = 0 ;
-    gchar *result = NULL ;
+    gchar    *msg  = NULL ;
+    gboolean  stop = job->cancelled ;
+
+    /* wait for the process and the end of its outputs */
+    if ( !job->exited || job->out_id != 0 || job->err_id != 0 )
+        return ;
+
+    gms_job = NULL ;
 
-    gms_command = gms_get_str_command(gms_hnd);
-    r = system( gms_command ) ;
-    if ( r != 0 )
+    if ( job->cancelled )
+        ;
+    else if ( job->timed_out )
     {
-        GtkWidget *dlg ;
-        result = read_result_file( gms_get_error_filename(gms_hnd) ) ;
-
-        dlg = gtk_message_dialog_new( GTK_WINDOW(geany->main_widgets->window),
-                        GTK_DIALOG_DESTROY_WITH_PARENT,
-                        GTK_MESSAGE_ERROR,
-                        GTK_BUTTONS_CLOSE,
-                        "%s", result);
-
-        gtk_dialog_run(GTK_DIALOG(dlg));
-        gtk_widget_destroy(GTK_WIDGET(dlg)) ;
-		ret = -1 ;
+        msg = g_strdup_printf( _("The filter has been stopped after %d seconds."),
+                                gms_get_timeout(gms_hnd) ) ;
     }
-    else
+    else if ( !WIFEXITED(job->status) || WEXITSTATUS(job->status) != 0 )
     {
-        result = read_result_file( gms_get_out_filename(gms_hnd) ) ;
-
-        if ( gms_get_output_mode( gms_hnd) == OUT_CURRENT_DOC )
+        msg = filter_text_to_utf8( job->error ) ;
+        job->error = NULL ;
+        if ( msg == NULL || *msg == '\0' )
         {
-            if ( gms_get_input_mode( gms_hnd) != IN_SELECTION )
-                select_entirely_doc(  sci  ) ;
-
-            update_doc( sci, result ) ;
+            GMS_G_FREE( msg ) ;
+            msg = g_strdup( _("The filter has failed.") ) ;
         }
+    }
+    else if ( DOC_VALID(job->doc) )
+    {
+        gchar *result = filter_text_to_utf8( job->output ) ;
+        job->output = NULL ;
+
+        if ( gms_out_mode == OUT_CURRENT_DOC )
+            update_doc( job->doc->editor->sci, job->sel_start, job->sel_end, result ) ;
         else
-        {
             document_new_file( NULL, NULL, result ) ;
-        }
+        GMS_G_FREE( result ) ;
     }
-    GMS_G_FREE( result ) ;
+    free_job( job ) ;
 
-	return ret ;
+    if ( msg != NULL )
+    {
+        /* an error stops the filtering of the next documents */
+        finish_filter() ;
+        show_filter_error( msg ) ;
+        GMS_G_FREE( msg ) ;
+    }
+    else if ( stop )
+        finish_filter() ;
+    else
+        start_next_job() ;
 }
 
+/**
+ * \brief the function runs the filter on the next pending document
+ */
+static void start_next_job( void )
+{
+    GeanyDocument   *doc = NULL ;
+    ScintillaObject *sci ;
+    gms_job_t       *job ;
+    gchar           *argv[4] ;
+    gint             in_fd, out_fd, err_fd ;
+    gint             timeout = gms_get_timeout(gms_hnd) ;
+    GError          *error = NULL ;
+
+    /* skip the documents closed meanwhile */
+    while ( gms_pending != NULL && !DOC_VALID(doc) )
+    {
+        doc = (GeanyDocument *) gms_pending->data ;
+        gms_pending = g_slist_delete_link( gms_pending, gms_pending ) ;
+    }
+    if ( !DOC_VALID(doc) )
+    {
+        finish_filter() ;
+        return ;
+    }
+
+    sci = doc->editor->sci ;
+    if ( gms_in_mode != IN_SELECTION )
+        select_entirely_doc( sci ) ;
+
+    job = GMS_G_MALLOC0( gms_job_t, 1 ) ;
+    job->doc       = doc ;
+    job->sel_start = sci_get_selection_start( sci ) ;
+    job->sel_end   = sci_get_selection_end( sci ) ;
+    job->input     = sci_get_selection_contents( sci ) ;
+    job->in_len    = strlen( job->input ) ;
+    job->output    = g_string_sized_new( job->in_len + 1 ) ;
+    job->error     = g_string_new( NULL ) ;
+
+    argv[0] = "/bin/sh" ;
+    argv[1] = "-c" ;
+    argv[2] = gms_command ;
+    argv[3] = NULL ;
+    if ( !g_spawn_async_with_pipes( NULL, argv, NULL, G_SPAWN_DO_NOT_REAP_CHILD,
+                                    on_filter_setup, NULL, &job->pid,
+                                    &in_fd, &out_fd, &err_fd, &error ) )
+    {
+        free_job( job ) ;
+        finish_filter() ;
+        show_filter_error( error->message ) ;
+        g_error_free( error ) ;
+        return ;
+    }
+
+    gms_job = job ;
+    job->in_id    = watch_channel( in_fd, G_IO_OUT|G_IO_ERR|G_IO_HUP, on_filter_input, job ) ;
+    job->out_id   = watch_channel( out_fd, G_IO_IN|G_IO_ERR|G_IO_HUP, on_filter_output, job ) ;
+    job->err_id   = watch_channel( err_fd, G_IO_IN|G_IO_ERR|G_IO_HUP, on_filter_error, job ) ;
+    job->child_id = g_child_watch_add( job->pid, on_filter_exit, job ) ;
+    if ( timeout > 0 )
+        job->timeout_id = g_timeout_add_seconds( timeout, on_filter_timeout, job ) ;
+}
+
+/**
+ * \brief Callback animating the progress bar while the filter runs
+ */
+static gboolean on_progress_pulse( gpointer data )
+{
+    gtk_progress_bar_pulse( GTK_PROGRESS_BAR(data) ) ;
+    return TRUE ;
+}
+
+/**
+ * \brief Callback of the progress dialog: the filter is cancelled
+ */
+static void on_progress_response( GtkDialog *dialog, gint response, gpointer data )
+{
+    g_slist_free( gms_pending ) ;
+    gms_pending = NULL ;
+
+    if ( gms_job != NULL )
+    {
+        gms_job->cancelled = TRUE ;
+        stop_job( gms_job ) ;
+    }
+}
+
+/**
+ * \brief the function creates the progress dialog, it is modal so that the
+ * filtered documents are not edited while the filter runs
+ */
+static void create_progress_dialog( void )
+{
+    GtkWidget *vbox ;
+    GtkWidget *label ;
+    GtkWidget *bar ;
+
+    gms_progress = gtk_dialog_new_with_buttons(
+                    _("Mini-Script Filter"),
+                    GTK_WINDOW(geany->main_widgets->window),
+                    GTK_DIALOG_DESTROY_WITH_PARENT|GTK_DIALOG_MODAL,
+                    GTK_STOCK_CANCEL,GTK_RESPONSE_CANCEL,
+                    NULL ) ;
+    vbox = gtk_dialog_get_content_area( GTK_DIALOG(gms_progress) ) ;
+    gtk_container_set_border_width( GTK_CONTAINER(vbox), 6 ) ;
+
+    label = gtk_label_new( _("The filter is running...") ) ;
+    gtk_box_pack_start( GTK_BOX(vbox), label, FALSE, FALSE, 6 ) ;
+
+    bar = gtk_progress_bar_new() ;
+    gtk_box_pack_start( GTK_BOX(vbox), bar, FALSE, FALSE, 6 ) ;
+
+    /* closing the dialog cancels too */
+    g_signal_connect( gms_progress, "response", G_CALLBACK(on_progress_response), NULL ) ;
+    g_signal_connect( gms_progress, "delete-event", G_CALLBACK(gtk_true), NULL ) ;
+    gms_pulse_id = g_timeout_add( GMS_PULSE_PERIOD, on_progress_pulse, bar ) ;
+
+    gtk_widget_show_all( gms_progress ) ;
+}
 /**
  * \brief Callback when the menu item is clicked.
  */
 static void item_activate(GtkMenuItem *menuitem, gpointer gdata)
 {
     GeanyDocument   *doc = document_get_current();
-    ScintillaObject *sci = doc->editor->sci ;
-    if ( gms_hnd  == NULL )
+    if ( gms_hnd  == NULL || gms_job != NULL )
         return ;
 
     if ( gms_dlg( gms_hnd ) == 0 )
         return ;
 
     gms_create_filter_file( gms_hnd ) ;
+    gms_command  = gms_get_str_command( gms_hnd ) ;
+    gms_in_mode  = gms_get_input_mode( gms_hnd ) ;
+    gms_out_mode = gms_get_output_mode( gms_hnd ) ;
 
-    switch ( gms_get_input_mode(gms_hnd) )
+    switch ( gms_in_mode )
     {
         case IN_CURRENT_DOC :
-            select_entirely_doc(  sci  ) ;
-            create_selection_2_input_file(sci) ;
-            run_filter( sci ) ;
-            delete_tmp_files() ;
-            break;
         case IN_SELECTION :
-            create_selection_2_input_file(sci) ;
-            run_filter( sci ) ;
-            delete_tmp_files() ;
+            gms_pending = g_slist_prepend( NULL, doc ) ;
             break;
         case IN_DOCS_SESSION :
             {
-                guint nb_doc = 0  , i=0;
-
-				/* find the opened document in the geany session */
-                while ( (doc = document_get_from_page(nb_doc))!=NULL ) nb_doc++;
+                guint nb_doc = 0 ;
 
-                /* For each document */
-                for( i=0; i<nb_doc;i++)
+				/* queue the opened documents of the geany session */
+                while ( (doc = document_get_from_page(nb_doc))!=NULL )
                 {
-                    doc = document_get_from_page(i) ;
-                    sci = doc->editor->sci ;
-                    select_entirely_doc(  sci  ) ;
-                    create_selection_2_input_file(sci) ;
-                    if ( run_filter( sci ) )
-						break ; /* if error then stop the loop */
+                    gms_pending = g_slist_prepend( gms_pending, doc ) ;
+                    nb_doc++;
                 }
+                gms_pending = g_slist_reverse( gms_pending ) ;
             }
-            delete_tmp_files() ;
             break;
         default:
-            delete_tmp_files() ;
-            return ;
+            break;
     }
 
+    /* the filters run one after the other in the background */
+    create_progress_dialog() ;
+    start_next_job() ;
 }
 
 
@@ -275,6 +627,20 @@ GtkWidget *plugin_configure(GtkDialog *dialog)
  */
 void plugin_cleanup(void)
 {
+    if ( gms_job != NULL )
+    {
+        if ( !gms_job->exited )
+        {
+            kill( -gms_job->pid, SIGKILL ) ;
+            waitpid( gms_job->pid, NULL, 0 ) ;
+            g_spawn_close_pid( gms_job->pid ) ;
+        }
+        free_job( gms_job ) ;
+        gms_job = NULL ;
+    }
+    if ( gms_hnd != NULL && gms_progress != NULL )
+        finish_filter() ;
+
     if ( gms_hnd != NULL )
        gms_delete( &gms_hnd ) ;
 
@@ -66,6 +66,10 @@
 #define GMS_NB_TYPE_SCRIPT  6
 /*! \brief Number of char of the line buffer */
 #define GMS_MAX_LINE        127
+/*! \brief Default timeout of a filter, in seconds (0: no timeout) */
+#define GMS_DEFAULT_TIMEOUT 60
+/*! \brief Maximum timeout of a filter, in seconds */
+#define GMS_MAX_TIMEOUT     3600
 
 /*! \brief macro uset to cast a gms_handle_t  to a gms_private_t pointer */
 #define GMS_PRIVATE(p) ((gms_private_t *) p)
@@ -82,6 +86,7 @@ typedef struct {
     GtkWidget   *rb_ndoc      ; /*!< radio button : the filter output is in the current document */
 
     GtkWidget   *e_script[GMS_NB_TYPE_SCRIPT] ; /*!< entry for script configuration */
+    GtkWidget   *sb_timeout   ; /*!< spin button for the filter timeout configuration */
     PangoFontDescription *fontdesc;
 } gms_gui_t  ;
 
@@ -92,11 +97,9 @@ typedef struct {
     GString    *cmd         ;                    /*!< Command string of filtering */
     GtkWidget  *mw          ;                    /*!< MainWindow of Geany */
     gms_gui_t   w           ;                    /*!< Widgets of minis-script gui */
-    GString    *input_name  ;                    /*!< filename of the filter input */
     GString    *filter_name ;                    /*!< filter filename */
-    GString    *output_name ;                    /*!< filename of the filter output */
-    GString    *error_name  ;                    /*!< errors filename */
     GString    *script_cmd[GMS_NB_TYPE_SCRIPT];  /*!< array of script command names */
+    gint        timeout     ;                    /*!< timeout of the filter in seconds */
 } gms_private_t  ;
 /*
  * *****************************************************************************
@@ -112,10 +115,7 @@ static gchar bufline[GMS_MAX_LINE+1]; /*!< buffer used to read the configuration
 
 static const gchar pref_filename[]   = "gms.rc"    ; /*!< preferences filename */
 static const gchar prefix_filename[] = "/tmp/gms"  ; /*!< prefix filename */
-static const gchar in_ext[]          = ".in"       ; /*!< filename extension for the input file */
-static const gchar out_ext[]         = ".out"      ; /*!< filename extension for the output file */
 static const gchar filter_ext[]      = ".filter"   ; /*!< filename extension for the filter file */
-static const gchar error_ext[]       = ".error"    ; /*!< filename extension for the error file */
 
 /**< \brief It's the default script command */
 static const gchar *default_script_cmd[GMS_NB_TYPE_SCRIPT] = {
@@ -180,6 +180,11 @@ static void load_prefs_file(
                 bufline[strlen(bufline)-1] = 0 ;
                 g_string_assign(this->script_cmd[ii] , bufline ) ;
             }
+            /* the timeout follows the script commands */
+            if ( ii == GMS_NB_TYPE_SCRIPT
+                && fgets(bufline,GMS_MAX_LINE,fd) != NULL
+                && fgets(bufline,GMS_MAX_LINE,fd) != NULL )
+                this->timeout = CLAMP( atoi(bufline), 0, GMS_MAX_TIMEOUT ) ;
             fclose(fd) ;
         }
      }
@@ -215,6 +220,7 @@ static void save_prefs_file(
             int  ii ;
             for ( ii = 0 ; ii <GMS_NB_TYPE_SCRIPT ;ii++ )
                 fprintf(fd,"# %s\n%s\n",label_script_cmd[ii],this->script_cmd[ii]->str);
+            fprintf(fd,"# Timeout\n%d\n",this->timeout);
 
             fclose(fd) ;
         }
@@ -532,29 +538,19 @@ gms_handle_t gms_new(
         gtk_widget_show_all(GTK_WIDGET(vb_dlg));
         this->id  = ++inst_cnt ;
 
-        this->input_name = g_string_new(prefix_filename) ;
         this->filter_name= g_string_new(prefix_filename) ;
-        this->output_name= g_string_new(prefix_filename) ;
-        this->error_name = g_string_new(prefix_filename) ;
 
         size_pid = (gint)(2*sizeof(pid_t)) ;
-        g_string_append_printf( this->input_name,"%02x_%0*x%s",
-                    this->id,size_pid, getpid(), in_ext ) ;
-
         g_string_append_printf(this->filter_name,"%02x_%0*x%s",
                     this->id,size_pid, getpid(), filter_ext ) ;
 
-        g_string_append_printf(this->output_name,"%02x_%0*x%s",
-                    this->id,size_pid, getpid(), out_ext ) ;
-
-        g_string_append_printf(this->error_name,"%02x_%0*x%s",
-                    this->id,size_pid, getpid(), error_ext ) ;
-
         for ( i=0;i<GMS_NB_TYPE_SCRIPT ; i++ )
         {
             this->script_cmd[i]=g_string_new(default_script_cmd[i] ) ;
             this->w.e_script[i]=NULL;
         }
+        this->w.sb_timeout = NULL ;
+        this->timeout = GMS_DEFAULT_TIMEOUT ;
         load_prefs_file(this) ;
 
     }
@@ -578,8 +574,6 @@ void gms_delete(
         GMS_FREE_FONTDESC(this->w.fontdesc );
         GMS_FREE_WIDGET(this->w.dlg);
 
-        g_string_free( this->input_name  ,flag) ;
-        g_string_free( this->output_name ,flag) ;
         g_string_free( this->filter_name ,flag) ;
         g_string_free( this->cmd         ,flag) ;
 
@@ -647,28 +641,6 @@ gms_output_t  gms_get_output_mode(
     return mode ;
 }
 
-/**
- * \brief the function get the input filename for filter input.
- */
-gchar *gms_get_in_filename(
-    gms_handle_t hnd /**< handle of mini-script data structure */
-    )
-{
-    gms_private_t *this = GMS_PRIVATE( hnd ) ;
-    return this->input_name->str ;
-}
-
-/**
- * \brief the function get the output filename for filter result.
- */
-gchar *gms_get_out_filename(
-    gms_handle_t hnd /**< handle of mini-script data structure */
-    )
-{
-    gms_private_t *this = GMS_PRIVATE( hnd ) ;
-    return this->output_name->str ;
-}
-
 /**
  * \brief the function get the output filename for filter script.
  */
@@ -678,17 +650,6 @@ gchar *gms_get_filter_filename( gms_handle_t hnd )
     return this->filter_name->str ;
 }
 
-/**
- * \brief the function get the error filename for filter script.
- */
-gchar *gms_get_error_filename(
-    gms_handle_t hnd /**< handle of mini-script data structure */
-    )
-{
-    gms_private_t *this = GMS_PRIVATE( hnd ) ;
-    return this->error_name->str ;
-}
-
 /**
  * \brief the function creates the filter file.
  */
@@ -719,15 +680,23 @@ gchar *gms_get_str_command(
     gms_private_t *this = GMS_PRIVATE( hnd ) ;
     gint ii_script = gtk_combo_box_get_active(GTK_COMBO_BOX(this->w.cb_st) ) ;
 
-    g_string_printf( this->cmd,"cat %s | %s %s > %s 2> %s",
-                                this->input_name->str,
-                                    this->script_cmd[ii_script]->str,
-                                        this->filter_name->str,
-                                            this->output_name->str,
-                                                this->error_name->str );
+    g_string_printf( this->cmd,"%s %s",
+                                this->script_cmd[ii_script]->str,
+                                    this->filter_name->str );
     return this->cmd->str  ;
 }
 
+/**
+ * \brief the function get the timeout of the filter in seconds (0: no timeout).
+ */
+gint gms_get_timeout(
+    gms_handle_t hnd /**< handle of mini-script data structure */
+    )
+{
+    gms_private_t *this = GMS_PRIVATE( hnd ) ;
+    return this->timeout ;
+}
+
 /**
  * \brief the function creates the configuration gui.
  */
@@ -748,7 +717,7 @@ GtkWidget   *gms_configure_gui(
     f_script = gtk_frame_new (_("script configuration") );
     gtk_box_pack_start( GTK_BOX (vb_pref), f_script, FALSE, FALSE, 0);
 
-    t_script = gtk_table_new( GMS_NB_TYPE_SCRIPT ,3,FALSE) ;
+    t_script = gtk_table_new( GMS_NB_TYPE_SCRIPT+1 ,3,FALSE) ;
     gtk_container_add (GTK_CONTAINER (f_script), t_script );
 
     for ( ii = 0 ; ii <GMS_NB_TYPE_SCRIPT ;ii++ )
@@ -761,6 +730,14 @@ GtkWidget   *gms_configure_gui(
         gtk_table_attach_defaults(GTK_TABLE(t_script),this->w.e_script[ii], 1,2,ii,ii+1 );
     }
 
+    w = gtk_label_new(_("Timeout (s)"));
+    gtk_table_attach_defaults(GTK_TABLE(t_script),w, 0,1,ii,ii+1 );
+
+    this->w.sb_timeout = gtk_spin_button_new_with_range( 0, GMS_MAX_TIMEOUT, 1 );
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(this->w.sb_timeout), this->timeout);
+    gtk_widget_set_tooltip_text(this->w.sb_timeout, _("stop the filter if it runs longer (0: never)"));
+    gtk_table_attach_defaults(GTK_TABLE(t_script),this->w.sb_timeout, 1,2,ii,ii+1 );
+
     gtk_widget_show_all(vb_pref);
     return vb_pref ;
 }
@@ -778,6 +755,8 @@ void on_gms_configure_response(GtkDialog *dialog, gint response, gpointer user_d
         for ( ii = 0 ; ii <GMS_NB_TYPE_SCRIPT ;ii++ )
             if (this->w.e_script[ii]!=NULL )
                 g_string_assign( this->script_cmd[ii] , gtk_entry_get_text(GTK_ENTRY(this->w.e_script[ii])));
+        if (this->w.sb_timeout!=NULL )
+            this->timeout = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(this->w.sb_timeout));
         save_prefs_file(this);
     }
 }
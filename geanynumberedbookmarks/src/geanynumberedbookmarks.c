@@ -14,6 +14,7 @@
 #include "geanyplugin.h"
 #include "utils.h"
 #include "Scintilla.h"
+#include "journal.h"
 #include <stdlib.h>
 #include <sys/stat.h>
 #include <string.h>
@@ -33,9 +34,6 @@ static const gint base64_char_to_int[]=
    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51,255,255,255,255,255
 };
 
-static const gchar base64_int_to_char[]=
-  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-
 /* define structures used in this plugin */
 typedef struct FileData
 {
@@ -73,8 +71,13 @@ static gboolean bRememberBookmarks=TRUE;
 /* internal variables */
 static gint iShiftNumbers[]={41,33,34,163,36,37,94,38,42,40};
 static FileData *fdKnownFilesSettings=NULL;
+static FileData *fdLastFileData=NULL;  /* last entry in fdKnownFilesSettings chain */
+static GHashTable *htKnownFiles=NULL;  /* fdKnownFilesSettings entries indexed by filename */
 static gulong key_release_signal_id;
 
+/* size the journal can grow to before it's merged back into the settings file */
+#define JOURNAL_COMPACT_SIZE 65536
+
 /* default config file */
 const gchar default_config[] =
 	"[Settings]\n"
@@ -304,6 +307,19 @@ static const gchar ** aszMarkerImages[]=
 };
 
 
+/* hash & compare filenames for htKnownFiles. Documents not yet saved have a NULL filename */
+static guint FileNameHash(gconstpointer key)
+{
+	return key==NULL ? 0 : g_str_hash(key);
+}
+
+
+static gboolean FileNameEqual(gconstpointer a,gconstpointer b)
+{
+	return utils_str_equal((const gchar*)a,(const gchar*)b);
+}
+
+
 /* return a FileData structure for a file
  * if not come across this file before then create one, otherwise return existing structure with
  * data in it
@@ -311,55 +327,41 @@ static const gchar ** aszMarkerImages[]=
 */
 static FileData * GetFileData(gchar *pcFileName)
 {
-	FileData *fdTemp=fdKnownFilesSettings;
+	FileData *fdTemp;
 	gint i;
 
-	/* First handle if main pointer doesn't point to anything */
-	if(fdTemp==NULL)
-	{
-		if((fdKnownFilesSettings=(FileData*)(g_malloc(sizeof *fdTemp)))!=NULL)
-		{
-			fdKnownFilesSettings->pcFileName=g_strdup(pcFileName);
-			for(i=0;i<10;i++)
-				fdKnownFilesSettings->iBookmark[i]=-1;
-
-			/* don't need to initiate iBookmarkLinePos */
-			fdKnownFilesSettings->pcFolding=NULL;
-			fdKnownFilesSettings->LastChangedTime=-1;
-			fdKnownFilesSettings->pcBookmarks=NULL;
-			fdKnownFilesSettings->NextNode=NULL;
-		}
-		return fdKnownFilesSettings;
-	}
-
-	/* move through chain to the correct entry or the end of a chain */
-	while(TRUE)
-	{
-		/* if have found relavent FileData, then exit */
-		if(utils_str_equal(pcFileName,fdTemp->pcFileName)==TRUE)
-			return fdTemp;
-
-		/* if end of chain, then add new entry, and return it. */
-		if(fdTemp->NextNode==NULL)
-		{
-			if((fdTemp->NextNode=(FileData*)(g_malloc(sizeof *fdTemp)))!=NULL)
-			{
-				fdTemp->NextNode->pcFileName=g_strdup(pcFileName);
-				for(i=0;i<10;i++)
-					fdTemp->NextNode->iBookmark[i]=-1;
-
-				/* don't need to initiate iBookmarkLinePos */
-				fdTemp->NextNode->pcFolding=NULL;
-				fdTemp->NextNode->LastChangedTime=-1;
-				fdTemp->NextNode->pcBookmarks=NULL;
-				fdTemp->NextNode->NextNode=NULL;
-			}
-			return fdTemp->NextNode;
+	/* create index on first use */
+	if(htKnownFiles==NULL)
+		htKnownFiles=g_hash_table_new(FileNameHash,FileNameEqual);
 
-		}
-		fdTemp=fdTemp->NextNode;
+	/* if have come across this file before, then return existing entry */
+	fdTemp=(FileData*)(g_hash_table_lookup(htKnownFiles,pcFileName));
+	if(fdTemp!=NULL)
+		return fdTemp;
 
+	/* otherwise add new entry to end of chain, and return it. */
+	if((fdTemp=(FileData*)(g_malloc(sizeof *fdTemp)))!=NULL)
+	{
+		fdTemp->pcFileName=g_strdup(pcFileName);
+		for(i=0;i<10;i++)
+			fdTemp->iBookmark[i]=-1;
+
+		/* don't need to initiate iBookmarkLinePos */
+		fdTemp->pcFolding=NULL;
+		fdTemp->LastChangedTime=-1;
+		fdTemp->pcBookmarks=NULL;
+		fdTemp->NextNode=NULL;
+
+		if(fdLastFileData==NULL)
+			fdKnownFilesSettings=fdTemp;
+		else
+			fdLastFileData->NextNode=fdTemp;
+
+		fdLastFileData=fdTemp;
+		g_hash_table_insert(htKnownFiles,fdTemp->pcFileName,fdTemp);
 	}
+
+	return fdTemp;
 }
 
 
@@ -463,8 +465,10 @@ static gboolean SaveIndividualSetting(GKeyFile *gkf,FileData *fd,gint iNumber,gc
 }
 
 
-/* save settings (preferences, file data such as fold states, marker positions) */
-static void SaveSettings(gchar *filename)
+/* write settings file (preferences, file data such as fold states, marker positions) from
+ * scratch. This makes any journal redundant so it's removed
+*/
+static void WriteSettingsFile(void)
 {
 	GKeyFile *config=NULL;
 	gchar *config_file=NULL,*config_dir=NULL;
@@ -488,7 +492,8 @@ static void SaveSettings(gchar *filename)
 	while(fdTemp!=NULL)
 	{
 		/* if this entry has data needing saveing then save it and increment the counter */
-		if(SaveIndividualSetting(config,fdTemp,i,fdTemp->pcFileName))
+		/* can't save details of documents that have no filename yet */
+		if(fdTemp->pcFileName!=NULL && SaveIndividualSetting(config,fdTemp,i,fdTemp->pcFileName))
 			i++;
 
 		fdTemp=fdTemp->NextNode;
@@ -508,11 +513,77 @@ static void SaveSettings(gchar *filename)
 	/* write data */
 	utils_write_file(config_file,data);
 
+	/* journal entries are now all in settings file */
+	g_free(config_file);
+	config_file=g_build_filename(config_dir,"settings.journal",NULL);
+	g_remove(config_file);
+
 	/* free memory */
 	g_free(config_dir);
 	g_free(config_file);
 	g_key_file_free(config);
 	g_free(data);
+}
+
+
+/* append details of one file to the end of the journal, rather than rewriting the whole
+ * settings file each time a document is saved. Each entry is in the same format as a local file
+ * details file, followed by a Z key so that an entry only partly written can be ignored.
+ * returns FALSE if the journal is big enough to be merged back into the settings file or can't
+ * be written to, in which case the settings file needs to be rewritten instead
+*/
+static gboolean AppendToJournal(FileData *fd)
+{
+	GKeyFile *config=NULL;
+	gchar *journal_file=NULL;
+	gchar *data;
+	struct stat sBuf;
+	gboolean bAppended=FALSE;
+
+	/* can't save details of documents that have no filename yet */
+	if(fd->pcFileName==NULL)
+		return TRUE;
+
+	journal_file=g_build_filename(geany->app->configdir,"plugins","Geany_Numbered_Bookmarks",
+	                              "settings.journal",NULL);
+
+	if(g_stat(journal_file,&sBuf)!=0 || sBuf.st_size<JOURNAL_COMPACT_SIZE)
+	{
+		config=g_key_file_new();
+
+		/* if nothing to save still need filename so that any old details are cleared */
+		if(SaveIndividualSetting(config,fd,-1,fd->pcFileName)==FALSE)
+			g_key_file_set_string(config,"FileData","A",fd->pcFileName);
+
+		/* mark end of entry */
+		g_key_file_set_integer(config,"FileData","Z",1);
+
+		data=g_key_file_to_data(config,NULL,NULL);
+		bAppended=JournalAppend(journal_file,data);
+
+		g_free(data);
+		g_key_file_free(config);
+	}
+
+	g_free(journal_file);
+
+	return bAppended;
+}
+
+
+/* save settings (preferences, file data such as fold states, marker positions)
+ * if filename is not NULL then only the details of that file have changed
+*/
+static void SaveSettings(gchar *filename)
+{
+	GKeyFile *config=NULL;
+	gchar *config_file=NULL;
+	gchar *data;
+	FileData* fdTemp;
+
+	/* if only one file's details have changed, then just add them to the journal */
+	if(filename==NULL || AppendToJournal(GetFileData(filename))==FALSE)
+		WriteSettingsFile();
 
 	/* now consider if not purely saving file settings to main settings file */
 	/* return if not saving data with file */
@@ -557,20 +628,21 @@ static gboolean LoadIndividualSetting(GKeyFile *gkf,gint iNumber,gchar *Filename
 	gint l;
 	FileData *fd=NULL;
 
-	/* if loading from local file then no fiilename in file and no number in key*/
+	/* if loading from local file or journal then no number in key */
 	if(iNumber==-1)
+		pcKey=g_strdup("A");
+	else
+		pcKey=g_strdup_printf("A%d",iNumber);
+
+	/* if loading from local file then no fiilename in file */
+	if(Filename!=NULL)
 	{
 		/* get structure to hold filedetails */
 		fd=GetFileData(Filename);
-
-		/* create key */
-		pcKey=g_strdup("A");
 	}
-	/* if loading from central file then need to extract filename from A key */
+	/* if loading from central file or journal then need to extract filename from A key */
 	else
 	{
-		pcKey=g_strdup_printf("A%d",iNumber);
-
 		/* get filename */
 		pcTemp=(gchar*)(utils_get_setting_string(gkf,"FileData",pcKey,NULL));
 		/* if null then have reached end of files */
@@ -586,6 +658,7 @@ static gboolean LoadIndividualSetting(GKeyFile *gkf,gint iNumber,gchar *Filename
 
 	/* get folding data */
 	pcKey[0]='B';
+	g_free(fd->pcFolding);
 	if(bRememberFolds==TRUE)
 		fd->pcFolding=(gchar*)(utils_get_setting_string(gkf,"FileData",pcKey,NULL));
 	else
@@ -599,9 +672,13 @@ static gboolean LoadIndividualSetting(GKeyFile *gkf,gint iNumber,gchar *Filename
 	pcTemp=(gchar*)(utils_get_setting_string(gkf,"FileData",pcKey,NULL));
 	/* pcTemp contains comma seperated numbers (or blank for -1) */
 	pcTemp2=pcTemp;
+	/* entry may already hold details of file, so clear old bookmarks */
+	for(l=0;l<10;l++)
+		fd->iBookmark[l]=-1;
+
 	if(pcTemp!=NULL) for(l=0;l<10;l++)
 	{
-		/* Bookmark entries are initialized to -1, so only need to parse non-empty slots */
+		/* Bookmark entries are now all -1, so only need to parse non-empty slots */
 		if(pcTemp2[0]!=',' && pcTemp2[0]!=0)
 		{
 			fd->iBookmark[l]=strtoll(pcTemp2,NULL,10);
@@ -633,6 +710,7 @@ static gboolean LoadIndividualSetting(GKeyFile *gkf,gint iNumber,gchar *Filename
 
 	/* get non-numbered bookmarks */
 	pcKey[0]='F';
+	g_free(fd->pcBookmarks);
 	if(bRememberBookmarks==TRUE)
 		fd->pcBookmarks=(gchar*)(utils_get_setting_string(gkf,"FileData",pcKey,NULL));
 	else
@@ -646,6 +724,13 @@ static gboolean LoadIndividualSetting(GKeyFile *gkf,gint iNumber,gchar *Filename
 }
 
 
+/* load the file details of one journal entry */
+static void LoadJournalEntry(GKeyFile *gkf)
+{
+	LoadIndividualSetting(gkf,-1,NULL);
+}
+
+
 /* load settings (preferences, file data, and macro data) */
 static void LoadSettings(void)
 {
@@ -684,6 +769,11 @@ static void LoadSettings(void)
 	while(LoadIndividualSetting(config,i,NULL))
 		i++;
 
+	/* bring file data up to date with details saved since settings file was written */
+	g_free(config_file);
+	config_file=g_build_filename(config_dir,"settings.journal",NULL);
+	JournalLoad(config_file,LoadJournalEntry);
+
 	/* free memory */
 	g_free(config_dir);
 	g_free(config_file);
@@ -938,6 +1028,116 @@ _("Unable to apply all markers to '%s' as all being used."),
 }
 
 
+/* close the fold with its header at line i. Closed folds inside a closed fold have their lines
+ * hidden already, so these are only marked as closed. Returns the last line now hidden
+*/
+static gint CloseFold(ScintillaObject* sci,gint i,gint iHiddenTo)
+{
+	/* as with toggling a fold, only folds with lines in them are closed */
+	gint iLastChild=scintilla_send_message(sci,SCI_GETLASTCHILD,i,-1);
+	if(iLastChild<=i)
+		return iHiddenTo;
+
+	scintilla_send_message(sci,SCI_SETFOLDEXPANDED,i,0);
+
+	/* hide lines in fold unless already hidden by an enclosing fold */
+	if(i>iHiddenTo)
+	{
+		scintilla_send_message(sci,SCI_HIDELINES,i+1,iLastChild);
+		iHiddenTo=iLastChild;
+	}
+
+	return iHiddenTo;
+}
+
+
+/* set fold states from fold data saved by on_document_save
+ * The data is a ':' followed by the comma separated line numbers, in hex, of the closed fold
+ * headers in ascending order, so only these lines are visited. Folds are all open when a
+ * document is opened, so nothing needs doing for the others.
+ * Data saved by older versions is instead one bit per fold header, open or not, in base64.
+ * This needs a pass over the lines up to the last closed fold to find the headers.
+*/
+static void ApplyFolds(ScintillaObject* sci,gchar *cFoldData)
+{
+	gint i,iLineCount,iFlags,iBits=0,iBitCounter,iHiddenTo=-1;
+	gint iFoldsLeft=0;
+	gchar *pcEnd;
+
+	if(cFoldData[0]==':')
+	{
+		/* first ensure fold positions exist */
+		scintilla_send_message(sci,SCI_COLOURISE,0,-1);
+
+		iLineCount=scintilla_send_message(sci,SCI_GETLINECOUNT,0,0);
+
+		cFoldData++;
+		while(cFoldData[0]!=0)
+		{
+			/* get next linenumber */
+			i=strtoll(cFoldData,&pcEnd,16);
+			if(pcEnd==cFoldData)
+				break;
+
+			/* skip lines that are no longer fold headers */
+			if(i>=0 && i<iLineCount &&
+			   (scintilla_send_message(sci,SCI_GETFOLDLEVEL,i,0) & SC_FOLDLEVELHEADERFLAG)!=0)
+				iHiddenTo=CloseFold(sci,i,iHiddenTo);
+
+			/* move to next linenumber */
+			cFoldData=pcEnd;
+			if(cFoldData[0]==',')
+				cFoldData++;
+		}
+
+		return;
+	}
+
+	/* work out how many fold headers there are up to and including the last closed fold */
+	for(i=0;cFoldData[i]!=0;i++)
+	{
+		iBits=base64_char_to_int[cFoldData[i]&127];
+		for(iBitCounter=0;iBitCounter<6;iBitCounter++)
+			if(((iBits>>iBitCounter)&1)==0)
+				iFoldsLeft=i*6+iBitCounter+1;
+	}
+
+	/* nothing to do if all folds open */
+	if(iFoldsLeft==0)
+		return;
+
+	/* first ensure fold positions exist */
+	scintilla_send_message(sci,SCI_COLOURISE,0,-1);
+
+	iLineCount=scintilla_send_message(sci,SCI_GETLINECOUNT,0,0);
+
+	/* go through lines setting fold status */
+	for(i=0,iBitCounter=6;i<iLineCount && iFoldsLeft>0;i++)
+	{
+		iFlags=scintilla_send_message(sci,SCI_GETFOLDLEVEL,i,0);
+		/* ignore non-folding lines */
+		if((iFlags & SC_FOLDLEVELHEADERFLAG)==0)
+			continue;
+
+		/* get next 6 fold states if needed */
+		if(iBitCounter==6)
+		{
+			iBitCounter=0;
+			iBits=base64_char_to_int[(*cFoldData)&127];
+			cFoldData++;
+		}
+
+		/* close fold if needed */
+		if(((iBits>>iBitCounter)&1)==0)
+			iHiddenTo=CloseFold(sci,i,iHiddenTo);
+
+		/* increment counter */
+		iBitCounter++;
+		iFoldsLeft--;
+	}
+}
+
+
 /* handler for when a document has been opened
  * this checks to see if a document has been altered since it was last saved in geany (as plugin
  * data may then be out of date for file)
@@ -946,14 +1146,11 @@ _("Unable to apply all markers to '%s' as all being used."),
 static void on_document_open(GObject *obj, GeanyDocument *doc, gpointer user_data)
 {
 	FileData *fd;
-	gint i,l=GTK_RESPONSE_ACCEPT,iLineCount;
+	gint i,l=GTK_RESPONSE_ACCEPT;
 	ScintillaObject* sci=doc->editor->sci;
 	struct stat sBuf;
 	GtkWidget *dialog;
-	gchar *cFoldData=NULL;
 	gchar *pcTemp;
-	/* keep compiler happy & initialise iBits: will logically be initiated anyway */
-	gint iBits=0,iFlags,iBitCounter;
 
 	/* if saving details in file alongside file we're editing then load it up */
 	if(WhereToSaveFileDetails==1)
@@ -985,38 +1182,7 @@ ill not be loaded.\nPress Ignore to try an load markers anyway."),doc->file_name
 
 			/* get fold settings if present and want to use them */
 			if(fd->pcFolding!=NULL && bRememberFolds==TRUE)
-			{
-				cFoldData=fd->pcFolding;
-
-				/* first ensure fold positions exist */
-				scintilla_send_message(sci,SCI_COLOURISE,0,-1);
-
-				iLineCount=scintilla_send_message(sci,SCI_GETLINECOUNT,0,0);
-
-				/* go through lines setting fold status */
-				for(i=0,iBitCounter=6;i<iLineCount;i++)
-				{
-					iFlags=scintilla_send_message(sci,SCI_GETFOLDLEVEL,i,0);
-					/* ignore non-folding lines */
-					if((iFlags & SC_FOLDLEVELHEADERFLAG)==0)
-						continue;
-
-					/* get next 6 fold states if needed */
-					if(iBitCounter==6)
-					{
-						iBitCounter=0;
-						iBits=base64_char_to_int[(gint)(*cFoldData)];
-						cFoldData++;
-					}
-
-					/* set fold if needed */
-					if(((iBits>>iBitCounter)&1)==0)
-						scintilla_send_message(sci,SCI_TOGGLEFOLD,i,0);
-
-					/* increment counter */
-					iBitCounter++;
-				}
-			}
+				ApplyFolds(sci,fd->pcFolding);
 
 			/* get non-numbered bookmark settings if present and want to use them */
 			if(fd->pcBookmarks!=NULL && bRememberBookmarks==TRUE)
@@ -1056,11 +1222,10 @@ ill not be loaded.\nPress Ignore to try an load markers anyway."),doc->file_name
 static void on_document_save(GObject *obj, GeanyDocument *doc, gpointer user_data)
 {
 	FileData *fd;
-	gint i,iLineCount,iFlags,iBitCounter=0;
+	gint i,iLineCount,iFlags;
 	ScintillaObject* sci=doc->editor->sci;
 	struct stat sBuf;
 	GByteArray *gbaFoldData=NULL;
-	guint8 guiFold=0;
 	gboolean bHasClosedFold=FALSE,bHasBookmark=FALSE;
 	gchar szLine[20];
 
@@ -1070,10 +1235,11 @@ static void on_document_save(GObject *obj, GeanyDocument *doc, gpointer user_dat
 		fd->iBookmark[i]=scintilla_send_message(sci,SCI_MARKERNEXT,0,
 		                                        1<<(fd->iBookmarkMarkerUsed[i]));
 
-	/* save fold state */
+	/* save fold state as the lines of the closed fold headers */
 	if(bRememberFolds==TRUE)
 	{
 		gbaFoldData=g_byte_array_sized_new(1000);
+		g_byte_array_append(gbaFoldData,(guint8*)":",1);
 
 		iLineCount=scintilla_send_message(sci,SCI_GETLINECOUNT,0,0);
 		/* go through each line */
@@ -1084,27 +1250,15 @@ static void on_document_save(GObject *obj, GeanyDocument *doc, gpointer user_dat
 			if((iFlags & SC_FOLDLEVELHEADERFLAG)==0)
 				continue;
 
-			iFlags=scintilla_send_message(sci,SCI_GETFOLDEXPANDED,i,0);
-			/* make note of if any folds closed or not */
-			bHasClosedFold|=((iFlags&1)==0);
-			/* remember if folded or not */
-			guiFold|=(iFlags&1)<<iBitCounter;
-			iBitCounter++;
-			if(iBitCounter<6)
+			/* ignore open folds */
+			if((scintilla_send_message(sci,SCI_GETFOLDEXPANDED,i,0)&1)!=0)
 				continue;
 
-			/* if have 6 bits then store these */
-			iBitCounter=0;
-			guiFold=(guint8)base64_int_to_char[guiFold];
-			g_byte_array_append(gbaFoldData,&guiFold,1);
-			guiFold=0;
-		}
+			g_sprintf(szLine,"%s%X",bHasClosedFold?",":"",i);
+			g_byte_array_append(gbaFoldData,(guint8*)szLine,strlen(szLine));
 
-		/* flush buffer */
-		if(iBitCounter!=0)
-		{
-			guiFold=(guint8)base64_int_to_char[guiFold];
-			g_byte_array_append(gbaFoldData,&guiFold,1);
+			/* make note of having a closed fold */
+			bHasClosedFold=TRUE;
 		}
 
 		/* transfer data to text string if have closed fold. Default will leave them open*/
@@ -1559,6 +1713,12 @@ void plugin_cleanup(void)
 		}
 
 	/* Clear memory used to hold file details */
+	if(htKnownFiles!=NULL)
+		g_hash_table_destroy(htKnownFiles);
+
+	htKnownFiles=NULL;
+	fdLastFileData=NULL;
+	fdKnownFilesSettings=NULL;
 	while(fdTemp!=NULL)
 	{
 		/* free filename */
@@ -0,0 +1,84 @@
+/*
+ * This code is supplied as is, and is used at your own risk.
+ * The GNU GPL version 2 rules apply to this code (see http://fsf.org/>
+ * You can alter it, and pass it on as you want.
+ * If you alter it, or pass it on, the only restriction is that this disclamour and licence be
+ * left intact
+ *
+ * william.fraser@virgin.net
+ * 2010-11-01
+*/
+
+
+#ifdef HAVE_CONFIG_H
+	#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include "journal.h"
+
+
+/* append an entry to the end of the journal. The entry must be a [FileData] group ending with
+ * a Z key, so that an entry only partly written can be ignored when loading.
+ * returns FALSE if the journal can't be written to
+*/
+gboolean JournalAppend(const gchar *journal_file,const gchar *data)
+{
+	FILE *fp;
+	gboolean bAppended=TRUE;
+	gboolean bTorn;
+
+	fp=g_fopen(journal_file,"a+");
+	if(fp==NULL)
+		return FALSE;
+
+	/* an entry cut short by a crash may have stopped part way through a line. Start a new line
+	 * so that the [FileData] line of this entry is still found when loading */
+	bTorn=(fseek(fp,-1,SEEK_END)==0 && fgetc(fp)!='\n');
+	/* need to reposition between reading and writing */
+	fseek(fp,0,SEEK_END);
+	if(bTorn)
+		bAppended=(fputc('\n',fp)!=EOF);
+
+	bAppended&=(fputs(data,fp)>=0);
+	bAppended&=(fclose(fp)==0);
+
+	return bAppended;
+}
+
+
+/* load the entries of the journal, in the order they were saved, passing each complete one to
+ * func
+*/
+void JournalLoad(const gchar *journal_file,JournalEntryFunc func)
+{
+	gchar *pcData=NULL;
+	gchar *pcEntry,*pcNext;
+	gsize iLength;
+	GKeyFile *config;
+
+	if(!g_file_get_contents(journal_file,&pcData,NULL,NULL))
+		return;
+
+	/* each entry starts with a [FileData] line. Split at the start of any group line though, so
+	 * that an entry cut short inside its [FileData] line doesn't run into the entry before it */
+	pcEntry=pcData;
+	while(pcEntry[0]!=0)
+	{
+		pcNext=strstr(pcEntry,"\n[");
+		iLength=(pcNext==NULL) ? strlen(pcEntry) : (gsize)(pcNext+1-pcEntry);
+
+		/* ignore entries that weren't completely written */
+		config=g_key_file_new();
+		if(g_key_file_load_from_data(config,pcEntry,iLength,G_KEY_FILE_NONE,NULL) &&
+		   g_key_file_get_integer(config,"FileData","Z",NULL)==1)
+			func(config);
+
+		g_key_file_free(config);
+		pcEntry+=iLength;
+	}
+
+	g_free(pcData);
+}
@@ -0,0 +1,27 @@
+/*
+ * This code is supplied as is, and is used at your own risk.
+ * The GNU GPL version 2 rules apply to this code (see http://fsf.org/>
+ * You can alter it, and pass it on as you want.
+ * If you alter it, or pass it on, the only restriction is that this disclamour and licence be
+ * left intact
+ *
+ * william.fraser@virgin.net
+ * 2010-11-01
+*/
+
+/* the journal of file details saved since the settings file was last written. Kept apart from
+ * the plugin code so that it can be tested without Geany
+*/
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <glib.h>
+
+/* called for each complete entry of a journal, in the order they were written */
+typedef void (*JournalEntryFunc)(GKeyFile *gkf);
+
+gboolean JournalAppend(const gchar *journal_file,const gchar *data);
+void JournalLoad(const gchar *journal_file,JournalEntryFunc func);
+
+#endif
@@ -0,0 +1,243 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <check.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include "journal.h"
+
+
+static gchar *journal_file=NULL;
+/* the entries loaded, each as "A value|B value", with "-" for a missing key */
+static GPtrArray *loaded=NULL;
+
+
+/* an entry as the plugin writes it, with bookmarks in the B key if not NULL */
+static gchar * MakeEntry(const gchar *name,const gchar *bookmarks)
+{
+	GKeyFile *config=g_key_file_new();
+	gchar *data;
+
+	g_key_file_set_string(config,"FileData","A",name);
+	if(bookmarks!=NULL)
+		g_key_file_set_string(config,"FileData","B",bookmarks);
+	g_key_file_set_integer(config,"FileData","Z",1);
+	data=g_key_file_to_data(config,NULL,NULL);
+	g_key_file_free(config);
+
+	return data;
+}
+
+
+static void AppendEntry(const gchar *name,const gchar *bookmarks)
+{
+	gchar *data=MakeEntry(name,bookmarks);
+
+	fail_unless(JournalAppend(journal_file,data),"can't append to %s",journal_file);
+	g_free(data);
+}
+
+
+/* writes the first length bytes of an entry, as if saving it had been cut short */
+static void AppendTorn(const gchar *name,const gchar *bookmarks,gsize length)
+{
+	gchar *data=MakeEntry(name,bookmarks);
+	FILE *fp=g_fopen(journal_file,"a");
+
+	fail_unless(fp!=NULL);
+	fail_unless(length<strlen(data));
+	fwrite(data,1,length,fp);
+	fclose(fp);
+	g_free(data);
+}
+
+
+static void CollectEntry(GKeyFile *gkf)
+{
+	gchar *name=g_key_file_get_string(gkf,"FileData","A",NULL);
+	gchar *bookmarks=g_key_file_get_string(gkf,"FileData","B",NULL);
+
+	g_ptr_array_add(loaded,g_strdup_printf("%s|%s",name ? name : "-",bookmarks ? bookmarks : "-"));
+	g_free(bookmarks);
+	g_free(name);
+}
+
+
+/* loads the journal and checks the entries are "expected", in order */
+static void CheckLoaded(const gchar **expected)
+{
+	guint i;
+
+	g_ptr_array_set_size(loaded,0);
+	JournalLoad(journal_file,CollectEntry);
+
+	for(i=0;i<loaded->len && expected[i]!=NULL;i++)
+		fail_unless(strcmp(g_ptr_array_index(loaded,i),expected[i])==0,
+		            "entry %u is \"%s\", expected \"%s\"",i,
+		            (gchar*)g_ptr_array_index(loaded,i),expected[i]);
+	fail_unless(i==loaded->len && expected[i]==NULL,"loaded %u entries, expected %u",
+	            loaded->len,g_strv_length((gchar**)expected));
+}
+
+
+static void Setup(void)
+{
+	gchar *dir=g_dir_make_tmp("gnb-XXXXXX",NULL);
+
+	fail_unless(dir!=NULL);
+	journal_file=g_build_filename(dir,"settings.journal",NULL);
+	loaded=g_ptr_array_new_with_free_func(g_free);
+	g_free(dir);
+}
+
+
+static void Teardown(void)
+{
+	gchar *dir=g_path_get_dirname(journal_file);
+
+	g_remove(journal_file);
+	g_rmdir(dir);
+	g_free(dir);
+	g_free(journal_file);
+	g_ptr_array_free(loaded,TRUE);
+}
+
+
+START_TEST(test_missing)
+{
+	const gchar *none[]={ NULL };
+	const gchar *one[]={ "/a.c|1,2", NULL };
+
+	CheckLoaded(none);
+	AppendEntry("/a.c","1,2");
+	CheckLoaded(one);
+}
+END_TEST;
+
+
+START_TEST(test_in_order)
+{
+	const gchar *expected[]={ "/a.c|1", "/b.c|-", "/a.c|2,3", NULL };
+
+	AppendEntry("/a.c","1");
+	AppendEntry("/b.c",NULL);
+	AppendEntry("/a.c","2,3");
+	CheckLoaded(expected);
+}
+END_TEST;
+
+
+/* an entry cut short part way through a line mustn't swallow the one saved after it */
+START_TEST(test_torn_line)
+{
+	const gchar *expected[]={ "/a.c|1", "/c.c|-", NULL };
+	gchar *data=MakeEntry("/b.c","4,5");
+
+	AppendEntry("/a.c","1");
+	/* stop inside the B line, before its newline */
+	AppendTorn("/b.c","4,5",strstr(data,"4,5")+2-data);
+	AppendEntry("/c.c",NULL);
+	CheckLoaded(expected);
+	g_free(data);
+}
+END_TEST;
+
+
+/* an entry cut short inside its [FileData] line mustn't spoil the ones either side of it */
+START_TEST(test_torn_header)
+{
+	const gchar *first[]={ "/b.c|-", NULL };
+	const gchar *expected[]={ "/b.c|-", "/d.c|3", NULL };
+
+	/* as the very first entry */
+	AppendTorn("/a.c","1",5);
+	AppendEntry("/b.c",NULL);
+	CheckLoaded(first);
+	/* straight after a complete entry */
+	AppendTorn("/c.c","2",5);
+	AppendEntry("/d.c","3");
+	CheckLoaded(expected);
+}
+END_TEST;
+
+
+/* an entry cut short after a whole line, only missing its Z key */
+START_TEST(test_torn_at_newline)
+{
+	const gchar *expected[]={ "/b.c|2", NULL };
+	gchar *data=MakeEntry("/a.c","1");
+
+	AppendTorn("/a.c","1",strstr(data,"Z=")-data);
+	AppendEntry("/b.c","2");
+	CheckLoaded(expected);
+	g_free(data);
+}
+END_TEST;
+
+
+/* complete entries cut short at random points in between must all load, in order, unchanged */
+START_TEST(test_torn_random)
+{
+	GPtrArray *expected=g_ptr_array_new_with_free_func(g_free);
+	GRand *rand=g_rand_new_with_seed(49);
+	gint i;
+
+	for(i=0;i<500;i++)
+	{
+		gchar *name=g_strdup_printf("/file%d.c",g_rand_int_range(rand,0,20));
+		gchar *bookmarks=g_rand_boolean(rand) ? g_strdup_printf("%d,%d",i,i+1) : NULL;
+
+		if(g_rand_int_range(rand,0,3)==0)
+		{
+			gchar *data=MakeEntry(name,bookmarks);
+			/* anywhere before the value of the Z key, whose newline alone isn't needed */
+			AppendTorn(name,bookmarks,g_rand_int_range(rand,0,strlen(data)-2));
+			g_free(data);
+		}
+		else
+		{
+			AppendEntry(name,bookmarks);
+			g_ptr_array_add(expected,g_strdup_printf("%s|%s",name,bookmarks ? bookmarks : "-"));
+		}
+		g_free(bookmarks);
+		g_free(name);
+	}
+	g_ptr_array_add(expected,NULL);
+
+	CheckLoaded((const gchar**)expected->pdata);
+
+	g_rand_free(rand);
+	g_ptr_array_free(expected,TRUE);
+}
+END_TEST;
+
+
+Suite *
+my_suite(void)
+{
+	Suite *s = suite_create("GeanyNumberedBookmarks");
+	TCase *tc_core = tcase_create("Core");
+	suite_add_tcase(s, tc_core);
+	tcase_add_checked_fixture(tc_core, Setup, Teardown);
+	tcase_add_test(tc_core, test_missing);
+	tcase_add_test(tc_core, test_in_order);
+	tcase_add_test(tc_core, test_torn_line);
+	tcase_add_test(tc_core, test_torn_header);
+	tcase_add_test(tc_core, test_torn_at_newline);
+	tcase_add_test(tc_core, test_torn_random);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int nf;
+	Suite *s = my_suite();
+	SRunner *sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	nf = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return (nf == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -21,44 +21,36 @@
 
 #include "geanypg.h"
 
-static void geanypg_decrypt_verify(encrypt_data * ed)
+static gpgme_error_t geanypg_decrypt_verify_op(encrypt_data * ed, gpgme_data_t cipher,
+                                               gpgme_data_t plain, gpointer user_data)
 {
-    gpgme_data_t plain, cipher;
-    gpgme_error_t err;
-    FILE * tempfile;
-
-    tempfile = tmpfile();
-    if (!(tempfile))
-    {
-        fprintf(stderr, "GeanyPG: %s: %s.\n", _("couldn't create tempfile"), strerror(errno));
-        return ;
-    }
-    gpgme_data_new_from_stream(&plain, tempfile);
-
-    geanypg_load_buffer(&cipher);
-
-    err = gpgme_op_decrypt_verify(ed->ctx, cipher, plain);
+    gpgme_error_t err = gpgme_op_decrypt_verify(ed->ctx, cipher, plain);
     if (gpgme_err_code(err) == GPG_ERR_NO_DATA) /* no encription, but maybe signatures */
     {
-        /* maybe reaload cipher */
-        gpgme_data_release(cipher);
-        geanypg_load_buffer(&cipher);
-        rewind(tempfile);
+        /* start over with the same input */
+        gpgme_data_seek(cipher, 0, SEEK_SET);
+        gpgme_data_seek(plain, 0, SEEK_SET);
         err = gpgme_op_verify(ed->ctx, cipher, NULL, plain);
     }
-    if (err != GPG_ERR_NO_ERROR)
+    return err;
+}
+
+static void geanypg_decrypt_verify(encrypt_data * ed)
+{
+    geanypg_stream stream;
+    gpgme_error_t err;
+
+    if (!geanypg_stream_init(&stream))
+        return;
+    err = geanypg_run_operation(ed, &stream, geanypg_decrypt_verify_op, NULL);
+    if (err != GPG_ERR_NO_ERROR && gpgme_err_code(err) != GPG_ERR_CANCELED)
         geanypg_show_err_msg(err);
-    else
+    else if (gpgme_err_code(err) != GPG_ERR_CANCELED)
     {
-        rewind(tempfile);
-        geanypg_write_file(tempfile);
+        geanypg_write_output(&stream);
         geanypg_handle_signatures(ed, 0);
     }
-
-    fclose(tempfile);
-    /* release buffers */
-    gpgme_data_release(cipher);
-    gpgme_data_release(plain);
+    geanypg_stream_release(&stream);
 }
 
 void geanypg_decrypt_cb(GtkMenuItem * menuitem, gpointer user_data)
@@ -21,39 +21,42 @@
 
 #include "geanypg.h"
 
+typedef struct
+{
+    gpgme_key_t * recp;
+    int sign;
+    int flags;
+} encrypt_args;
+
+static gpgme_error_t geanypg_encrypt_op(encrypt_data * ed, gpgme_data_t plain,
+                                        gpgme_data_t cipher, gpointer user_data)
+{
+    encrypt_args * args = user_data;
+    gpgme_data_set_encoding(cipher, GPGME_DATA_ENCODING_ARMOR);
+    if (args->sign)
+        return gpgme_op_encrypt_sign(ed->ctx, args->recp, args->flags, plain, cipher);
+    return gpgme_op_encrypt(ed->ctx, args->recp, args->flags, plain, cipher);
+}
+
 static void geanypg_encrypt(encrypt_data * ed, gpgme_key_t * recp, int sign, int flags)
-{   /* FACTORIZE */
-    gpgme_data_t plain, cipher;
+{
+    geanypg_stream stream;
     gpgme_error_t err;
-    FILE * tempfile;
-    tempfile = tmpfile();
-    if (!(tempfile))
-    {
-        fprintf(stderr, "GeanyPG: %s: %s.\n", _("couldn't create tempfile"), strerror(errno));
-        return ;
-    }
-    gpgme_data_new_from_stream(&cipher, tempfile);
-    gpgme_data_set_encoding(cipher, GPGME_DATA_ENCODING_ARMOR);
+    encrypt_args args;
 
-    geanypg_load_buffer(&plain);
+    args.recp = recp;
+    args.sign = sign;
+    args.flags = flags;
 
+    if (!geanypg_stream_init(&stream))
+        return;
     /* do the actual encryption */
-    if (sign)
-        err = gpgme_op_encrypt_sign(ed->ctx, recp, flags, plain, cipher);
-    else
-        err = gpgme_op_encrypt(ed->ctx, recp, flags, plain, cipher);
+    err = geanypg_run_operation(ed, &stream, geanypg_encrypt_op, &args);
     if (err != GPG_ERR_NO_ERROR && gpgme_err_code(err) != GPG_ERR_CANCELED)
         geanypg_show_err_msg(err);
     else if(gpgme_err_code(err) != GPG_ERR_CANCELED)
-    {
-        rewind(tempfile);
-        geanypg_write_file(tempfile);
-    }
-
-    fclose(tempfile);
-    /* release buffers */
-    gpgme_data_release(plain);
-    gpgme_data_release(cipher);
+        geanypg_write_output(&stream);
+    geanypg_stream_release(&stream);
 }
 
 void geanypg_encrypt_cb(GtkMenuItem * menuitem, gpointer user_data)
@@ -76,6 +76,8 @@ void plugin_init(GeanyData *data)
         geanypg_show_err_msg(err);
         return;
     }
+    geanypg_key_cache_init();
+
     /* Create a new menu item and show it */
     main_menu_item = gtk_menu_item_new_with_mnemonic("GeanyPG");
     gtk_widget_show(main_menu_item);
@@ -117,4 +119,5 @@ void plugin_cleanup(void)
 {
     if (main_menu_item)
         gtk_widget_destroy(main_menu_item);
+    geanypg_key_cache_cleanup();
 }
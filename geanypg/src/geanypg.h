@@ -52,17 +52,46 @@ typedef struct
     unsigned long nskeys;
 } encrypt_data;
 
+typedef struct
+{
+    ScintillaObject * sci;  /* NULL when the document was closed */
+    int selection;          /* whether the text is the selection */
+    int start;              /* range of the text in the document */
+    int end;
+    gchar * text;           /* snapshot of the text */
+    gsize length;
+    gint read;              /* read position of gpgme in text */
+    GString * output;       /* what gpgme wrote */
+    gint cancel;
+} geanypg_stream;
+
+typedef gpgme_error_t (*geanypg_operation)(encrypt_data * ed, gpgme_data_t input,
+                                           gpgme_data_t output, gpointer user_data);
+
 extern GeanyPlugin     *geany_plugin;
 extern GeanyData       *geany_data;
 extern GeanyFunctions  *geany_functions;
 
 /* auxiliary functions (helper_functions.c) */
 void geanypg_init_ed(encrypt_data * ed);
+gpgme_error_t geanypg_list_keys(gpgme_ctx_t ctx, int secret, gpgme_key_t ** keys,
+                                unsigned long * nkeys, gint * cancel);
 int geanypg_get_keys(encrypt_data * ed);
 int geanypg_get_secret_keys(encrypt_data * ed);
 void geanypg_release_keys(encrypt_data * ed);
-void geanypg_load_buffer(gpgme_data_t * buffer);
-void geanypg_write_file(FILE * file);
+
+/* keyring cache, listed in a background thread (key_cache.c) */
+void geanypg_key_cache_init(void);
+void geanypg_key_cache_cleanup(void);
+void geanypg_key_cache_refresh(void);
+int geanypg_key_cache_get(encrypt_data * ed, int secret);
+
+/* operations running in a worker thread (operation.c) */
+int geanypg_stream_init(geanypg_stream * stream);
+void geanypg_stream_release(geanypg_stream * stream);
+void geanypg_write_output(geanypg_stream * stream);
+gpgme_error_t geanypg_run_operation(encrypt_data * ed, geanypg_stream * stream,
+                                    geanypg_operation operation, gpointer user_data);
 
 /* some more auxiliary functions (verify_aux.c) */
 void geanypg_handle_signatures(encrypt_data * ed, int need_error);
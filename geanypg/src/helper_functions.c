@@ -29,7 +29,11 @@ void geanypg_init_ed(encrypt_data * ed)
     ed->nskeys = 0;
 }
 
-int geanypg_get_keys(encrypt_data * ed)
+/* Lists the usable public (secret == 0) or secret keys with ctx into a newly
+ * allocated array. When cancel is set from another thread, the listing stops
+ * with GPG_ERR_CANCELED. On errors the keys listed so far are still returned. */
+gpgme_error_t geanypg_list_keys(gpgme_ctx_t ctx, int secret, gpgme_key_t ** keys,
+                                unsigned long * nkeys, gint * cancel)
 {
     gpgme_error_t err;
     unsigned long size = SIZE;
@@ -37,12 +41,18 @@ int geanypg_get_keys(encrypt_data * ed)
     unsigned long idx = 0;
     /* allocate array of size 1N */
     gpgme_key_t * key;
-    ed->key_array = (gpgme_key_t*) malloc(SIZE * sizeof(gpgme_key_t));
-    err = gpgme_op_keylist_start(ed->ctx, NULL, 0);
+    *keys = (gpgme_key_t*) malloc(SIZE * sizeof(gpgme_key_t));
+    err = gpgme_op_keylist_start(ctx, NULL, secret);
     while (!err)
     {
-        key = ed->key_array + idx;
-        err = gpgme_op_keylist_next(ed->ctx, key);
+        if (cancel && g_atomic_int_get(cancel))
+        {
+            gpgme_op_keylist_end(ctx);
+            err = gpgme_error(GPG_ERR_CANCELED);
+            break;
+        }
+        key = *keys + idx;
+        err = gpgme_op_keylist_next(ctx, key);
         if (err)
             break;
         if ((*key)->revoked  || /* key cannot be used */
@@ -55,11 +65,22 @@ int geanypg_get_keys(encrypt_data * ed)
         if (idx >= size)
         {
             size += SIZE;
-            ed->key_array = (gpgme_key_t*) realloc(ed->key_array, size * sizeof(gpgme_key_t));
+            *keys = (gpgme_key_t*) realloc(*keys, size * sizeof(gpgme_key_t));
         }
     }
-    ed->nkeys = idx;
-    if (gpg_err_code(err) != GPG_ERR_EOF)
+    *nkeys = idx;
+    if (gpg_err_code(err) == GPG_ERR_EOF)
+        return GPG_ERR_NO_ERROR;
+    return err;
+}
+
+int geanypg_get_keys(encrypt_data * ed)
+{
+    gpgme_error_t err;
+    if (geanypg_key_cache_get(ed, 0))
+        return 1;
+    err = geanypg_list_keys(ed->ctx, 0, &ed->key_array, &ed->nkeys, NULL);
+    if (err)
     {
         geanypg_show_err_msg(err);
         return 0;
@@ -70,34 +91,10 @@ int geanypg_get_keys(encrypt_data * ed)
 int geanypg_get_secret_keys(encrypt_data * ed)
 {
     gpgme_error_t err;
-    unsigned long size = SIZE;
-    /* initialize idx to 0 */
-    unsigned long idx = 0;
-    /* allocate array of size 1N */
-    gpgme_key_t * key;
-    ed->skey_array = (gpgme_key_t*) malloc(SIZE * sizeof(gpgme_key_t));
-    err = gpgme_op_keylist_start(ed->ctx, NULL, 1);
-    while (!err)
-    {
-        key = ed->skey_array + idx;
-        err = gpgme_op_keylist_next(ed->ctx, key);
-        if (err)
-            break;
-        if ((*key)->revoked  || /* key cannot be used */
-            (*key)->expired  ||
-            (*key)->disabled ||
-            (*key)->invalid)
-           gpgme_key_unref(*key);
-        else /* key is valid */
-            ++idx;
-        if (idx >= size)
-        {
-            size += SIZE;
-            ed->skey_array = (gpgme_key_t*) realloc(ed->skey_array, size * sizeof(gpgme_key_t));
-        }
-    }
-    ed->nskeys = idx;
-    if (gpg_err_code(err) != GPG_ERR_EOF)
+    if (geanypg_key_cache_get(ed, 1))
+        return 1;
+    err = geanypg_list_keys(ed->ctx, 1, &ed->skey_array, &ed->nskeys, NULL);
+    if (err)
     {
         geanypg_show_err_msg(err);
         return 0;
@@ -128,53 +125,3 @@ void geanypg_release_keys(encrypt_data * ed)
     }
 }
 
-
-void geanypg_load_buffer(gpgme_data_t * buffer)
-{
-    /* gpgme_data_new_from_mem(buffer, text, size, 0); */
-    GeanyDocument * doc = document_get_current();
-    char * data = NULL;
-    unsigned long size = 0;
-    if (sci_has_selection(doc->editor->sci))
-    {
-        size = scintilla_send_message(doc->editor->sci, SCI_GETSELTEXT, 0, 0) - 1;
-        data = (char *) malloc(size + 1);
-        scintilla_send_message(doc->editor->sci, SCI_GETSELTEXT, 0, (sptr_t)data);
-        gpgme_data_new_from_mem(buffer, data, size, 1);
-    }
-    else
-    {
-        size = scintilla_send_message(doc->editor->sci, SCI_GETLENGTH, 0, 0);
-        data = (char *) malloc(size + 1);
-        scintilla_send_message(doc->editor->sci, SCI_GETTEXT, (uptr_t)(size + 1), (sptr_t)data);
-        gpgme_data_new_from_mem(buffer, data, size, 1);
-    }
-    if (data) /* if there is no text data may still be NULL */
-        free(data);
-    gpgme_data_set_encoding(*buffer, GPGME_DATA_ENCODING_BINARY);
-}
-
-void geanypg_write_file(FILE * file)
-{
-#define BUFSIZE 2048
-    unsigned long size;
-    char buffer[BUFSIZE] = {0};
-    GeanyDocument * doc = document_get_current();
-    sci_start_undo_action(doc->editor->sci);
-    if (sci_has_selection(doc->editor->sci))
-    {   /* replace selected text
-         * clear selection, cursor should be at the end or beginneng of the selection */
-        scintilla_send_message(doc->editor->sci, SCI_REPLACESEL, 0, (sptr_t)"");
-        while ((size = fread(buffer, 1, BUFSIZE, file)))
-            /* add at the cursor */
-            scintilla_send_message(doc->editor->sci, SCI_ADDTEXT, (uptr_t) size, (sptr_t) buffer);
-    }
-    else
-    {   /* replace complete document */
-        scintilla_send_message(doc->editor->sci, SCI_CLEARALL, 0, 0);
-        while ((size = fread(buffer, 1, BUFSIZE, file)))
-            scintilla_send_message(doc->editor->sci, SCI_APPENDTEXT, (uptr_t) size, (sptr_t) buffer);
-    }
-    sci_end_undo_action(doc->editor->sci);
-#undef BUFSIZE
-}
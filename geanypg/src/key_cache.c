@@ -0,0 +1,321 @@
+/*      key_cache.c
+ *
+ *      Copyright 2011 Hans Alves <alves.h88@gmail.com>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ */
+
+/* Listing a big keyring takes seconds, so the keys are listed once in a
+ * background thread and handed out from memory. The keyring files are
+ * watched and the lists are made again whenever one of them changes. */
+
+#include "geanypg.h"
+
+/* wait a bit after a change, gpg usually touches several files at once */
+#define REFRESH_DELAY 500
+
+static GMutex * cache_mutex = NULL;
+static GCond * cache_cond = NULL;
+static GThread * cache_thread = NULL;
+
+/* protected by cache_mutex */
+static gpgme_key_t * cached_keys = NULL;
+static unsigned long ncached_keys = 0;
+static gpgme_key_t * cached_skeys = NULL;
+static unsigned long ncached_skeys = 0;
+static gboolean cache_valid = FALSE;
+static gboolean refresh_requested = FALSE;
+static guint keyring_changes = 0;
+static gint quit_requested = 0;
+
+/* main thread only */
+static GFileMonitor * keyring_monitor = NULL;
+static GFileMonitor * private_keys_monitor = NULL;
+static guint refresh_source = 0;
+
+static void geanypg_free_key_array(gpgme_key_t * keys, unsigned long nkeys)
+{
+    unsigned long idx;
+    for (idx = 0; idx < nkeys; ++idx)
+        gpgme_key_unref(keys[idx]);
+    free(keys);
+}
+
+static gpgme_key_t * geanypg_copy_key_array(gpgme_key_t * keys, unsigned long nkeys)
+{
+    unsigned long idx;
+    /* always allocate something, callers check the array for NULL */
+    gpgme_key_t * copy = (gpgme_key_t*) malloc((nkeys + 1) * sizeof(gpgme_key_t));
+    for (idx = 0; idx < nkeys; ++idx)
+    {
+        copy[idx] = keys[idx];
+        gpgme_key_ref(copy[idx]);
+    }
+    return copy;
+}
+
+static gpointer geanypg_key_cache_thread(gpointer data)
+{
+    gpgme_ctx_t ctx;
+    if (gpgme_new(&ctx))
+        return NULL;
+
+    g_mutex_lock(cache_mutex);
+    while (!g_atomic_int_get(&quit_requested))
+    {
+        gpgme_key_t * keys = NULL, * skeys = NULL;
+        unsigned long nkeys = 0, nskeys = 0;
+        gpgme_error_t err;
+        guint changes;
+
+        if (!refresh_requested)
+        {
+            g_cond_wait(cache_cond, cache_mutex);
+            continue;
+        }
+        refresh_requested = FALSE;
+        changes = keyring_changes;
+        g_mutex_unlock(cache_mutex);
+
+        err = geanypg_list_keys(ctx, 0, &keys, &nkeys, &quit_requested);
+        if (!err)
+            err = geanypg_list_keys(ctx, 1, &skeys, &nskeys, &quit_requested);
+
+        g_mutex_lock(cache_mutex);
+        if (err)
+        {   /* callers fall back to listing the keys themselves,
+             * which also gets the error shown to the user */
+            if (gpg_err_code(err) != GPG_ERR_CANCELED)
+                fprintf(stderr, "GeanyPG: %s: %s\n", _("couldn't list keys"), gpgme_strerror(err));
+            if (keys)
+                geanypg_free_key_array(keys, nkeys);
+            if (skeys)
+                geanypg_free_key_array(skeys, nskeys);
+            cache_valid = FALSE;
+            continue;
+        }
+        /* if a refresh was requested meanwhile the loop lists the keys
+         * again, but until then these are still better than none */
+        if (cached_keys)
+            geanypg_free_key_array(cached_keys, ncached_keys);
+        if (cached_skeys)
+            geanypg_free_key_array(cached_skeys, ncached_skeys);
+        cached_keys = keys;
+        ncached_keys = nkeys;
+        cached_skeys = skeys;
+        ncached_skeys = nskeys;
+        /* keys listed while the keyring changed may be stale already */
+        cache_valid = (changes == keyring_changes);
+    }
+    g_mutex_unlock(cache_mutex);
+
+    gpgme_release(ctx);
+    return NULL;
+}
+
+void geanypg_key_cache_refresh(void)
+{
+    if (!cache_mutex)
+        return;
+    g_mutex_lock(cache_mutex);
+    refresh_requested = TRUE;
+    g_cond_signal(cache_cond);
+    g_mutex_unlock(cache_mutex);
+}
+
+static gboolean geanypg_key_cache_refresh_timeout(gpointer data)
+{
+    refresh_source = 0;
+    geanypg_key_cache_refresh();
+    return FALSE;
+}
+
+/* Whether file is one of the files gpg keeps the keys in. Everything else
+ * in the home directory (trustdb.gpg, random_seed, lock and temporary files)
+ * is written by gpg itself on nearly every run, including our own listings. */
+static gboolean geanypg_is_keyring_file(GFile * file)
+{
+    static const gchar * keyrings[] = { "pubring.kbx", "pubring.gpg", "secring.gpg", NULL };
+    gchar * name;
+    gboolean found = FALSE;
+    int idx;
+
+    if (!file)
+        return FALSE;
+    name = g_file_get_basename(file);
+    for (idx = 0; keyrings[idx] && !found; ++idx)
+        found = !strcmp(name, keyrings[idx]);
+    g_free(name);
+    return found;
+}
+
+/* Whether file is a secret key of gpg >= 2.1, stored in private-keys-v1.d */
+static gboolean geanypg_is_private_key_file(GFile * file)
+{
+    gchar * name;
+    gboolean found;
+
+    if (!file)
+        return FALSE;
+    name = g_file_get_basename(file);
+    found = g_str_has_suffix(name, ".key");
+    g_free(name);
+    return found;
+}
+
+static void geanypg_keyring_changed(GFileMonitor * monitor, GFile * file, GFile * other,
+                                    GFileMonitorEvent event, gpointer user_data)
+{
+    gboolean (*is_key_file)(GFile *) = user_data;
+
+    if (event == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED)
+        return;
+    /* a keyring written to a temporary file and renamed shows up as other */
+    if (!is_key_file(file) && !is_key_file(other))
+        return;
+    /* the cached keys are stale from now on, until the thread is done */
+    g_mutex_lock(cache_mutex);
+    cache_valid = FALSE;
+    ++keyring_changes;
+    g_mutex_unlock(cache_mutex);
+    if (refresh_source)
+        g_source_remove(refresh_source);
+    refresh_source = g_timeout_add(REFRESH_DELAY, geanypg_key_cache_refresh_timeout, NULL);
+}
+
+static GFileMonitor * geanypg_watch_directory(const gchar * path, gboolean (*is_key_file)(GFile *))
+{
+    GFile * dir = g_file_new_for_path(path);
+    GFileMonitor * monitor = g_file_monitor_directory(dir, G_FILE_MONITOR_NONE, NULL, NULL);
+
+    if (monitor)
+        g_signal_connect(monitor, "changed", G_CALLBACK(geanypg_keyring_changed), is_key_file);
+    g_object_unref(dir);
+    return monitor;
+}
+
+static void geanypg_unwatch_directory(GFileMonitor ** monitor)
+{
+    if (*monitor)
+    {
+        g_file_monitor_cancel(*monitor);
+        g_object_unref(*monitor);
+        *monitor = NULL;
+    }
+}
+
+/* Returns the directory gpg keeps its keyrings in */
+static gchar * geanypg_get_home_dir(void)
+{
+    gpgme_engine_info_t info;
+    const gchar * env;
+
+    if (gpgme_get_engine_info(&info) == GPG_ERR_NO_ERROR)
+    {
+        for (; info; info = info->next)
+            if (info->protocol == GPGME_PROTOCOL_OpenPGP && info->home_dir)
+                return g_strdup(info->home_dir);
+    }
+    env = g_getenv("GNUPGHOME");
+    if (env && *env)
+        return g_strdup(env);
+    return g_build_filename(g_get_home_dir(), ".gnupg", NULL);
+}
+
+void geanypg_key_cache_init(void)
+{
+    gchar * home_dir;
+    gchar * private_keys_dir;
+
+    if (!g_thread_supported())
+        g_thread_init(NULL);
+
+    cache_mutex = g_mutex_new();
+    cache_cond = g_cond_new();
+    quit_requested = 0;
+    refresh_requested = TRUE;
+    cache_thread = g_thread_create(geanypg_key_cache_thread, NULL, TRUE, NULL);
+
+    home_dir = geanypg_get_home_dir();
+    private_keys_dir = g_build_filename(home_dir, "private-keys-v1.d", NULL);
+    keyring_monitor = geanypg_watch_directory(home_dir, geanypg_is_keyring_file);
+    private_keys_monitor = geanypg_watch_directory(private_keys_dir, geanypg_is_private_key_file);
+    g_free(private_keys_dir);
+    g_free(home_dir);
+}
+
+void geanypg_key_cache_cleanup(void)
+{
+    if (!cache_mutex)
+        return;
+
+    geanypg_unwatch_directory(&keyring_monitor);
+    geanypg_unwatch_directory(&private_keys_monitor);
+    if (refresh_source)
+    {
+        g_source_remove(refresh_source);
+        refresh_source = 0;
+    }
+
+    if (cache_thread)
+    {
+        g_mutex_lock(cache_mutex);
+        g_atomic_int_set(&quit_requested, 1);
+        g_cond_signal(cache_cond);
+        g_mutex_unlock(cache_mutex);
+        g_thread_join(cache_thread);
+        cache_thread = NULL;
+    }
+
+    if (cached_keys)
+        geanypg_free_key_array(cached_keys, ncached_keys);
+    if (cached_skeys)
+        geanypg_free_key_array(cached_skeys, ncached_skeys);
+    cached_keys = cached_skeys = NULL;
+    ncached_keys = ncached_skeys = 0;
+    cache_valid = FALSE;
+
+    g_cond_free(cache_cond);
+    g_mutex_free(cache_mutex);
+    cache_cond = NULL;
+    cache_mutex = NULL;
+}
+
+/* Fills the public (secret == 0) or secret key array of ed from the cache.
+ * Returns 0 when the cache isn't filled yet, or is being refreshed. */
+int geanypg_key_cache_get(encrypt_data * ed, int secret)
+{
+    int found = 0;
+    if (!cache_mutex)
+        return 0;
+    g_mutex_lock(cache_mutex);
+    if (cache_valid)
+    {
+        if (secret)
+        {
+            ed->skey_array = geanypg_copy_key_array(cached_skeys, ncached_skeys);
+            ed->nskeys = ncached_skeys;
+        }
+        else
+        {
+            ed->key_array = geanypg_copy_key_array(cached_keys, ncached_keys);
+            ed->nkeys = ncached_keys;
+        }
+        found = 1;
+    }
+    g_mutex_unlock(cache_mutex);
+    return found;
+}
@@ -0,0 +1,334 @@
+/*      operation.c
+ *
+ *      Copyright 2011 Hans Alves <alves.h88@gmail.com>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ */
+
+/* Runs gpgme operations in a worker thread. gpgme reads the input straight
+ * from a snapshot of the document and writes the output into memory, which
+ * replaces the snapshotted text in one go when the operation is done. The
+ * document is read-only meanwhile, and a progress dialog with a cancel button
+ * shows up for operations that take a while. */
+
+#include "geanypg.h"
+
+#ifndef ECANCELED
+#define ECANCELED EINTR
+#endif
+
+/* don't flash a dialog for small documents */
+#define PROGRESS_DELAY 300
+#define PROGRESS_INTERVAL 100
+
+/* the main loop keeps running during an operation, so the menu items can
+ * be activated again; a second operation on the same document would
+ * replace text that the first one is about to replace as well */
+static gboolean geanypg_running = FALSE;
+
+typedef struct
+{
+    encrypt_data * ed;
+    geanypg_stream * stream;
+    geanypg_operation operation;
+    gpointer user_data;
+    gpgme_data_t input;
+    gpgme_data_t output;
+    gpgme_error_t err;
+    GMainLoop * loop;
+    GtkWidget * dialog;
+    GtkWidget * progress;
+    guint timeout;
+} geanypg_job;
+
+static ssize_t geanypg_stream_read(void * handle, void * buffer, size_t size)
+{
+    geanypg_stream * stream = handle;
+    gint pos = g_atomic_int_get(&stream->read);
+    if (g_atomic_int_get(&stream->cancel))
+    {
+        errno = ECANCELED;
+        return -1;
+    }
+    size = MIN(size, stream->length - pos);
+    memcpy(buffer, stream->text + pos, size);
+    g_atomic_int_set(&stream->read, pos + size);
+    return size;
+}
+
+static off_t geanypg_stream_seek_input(void * handle, off_t offset, int whence)
+{
+    geanypg_stream * stream = handle;
+    off_t pos;
+    switch (whence)
+    {
+        case SEEK_SET: pos = offset; break;
+        case SEEK_CUR: pos = g_atomic_int_get(&stream->read) + offset; break;
+        case SEEK_END: pos = stream->length + offset; break;
+        default: errno = EINVAL; return -1;
+    }
+    if (pos < 0 || pos > (off_t) stream->length)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    g_atomic_int_set(&stream->read, pos);
+    return pos;
+}
+
+static ssize_t geanypg_stream_write(void * handle, const void * buffer, size_t size)
+{
+    geanypg_stream * stream = handle;
+    if (g_atomic_int_get(&stream->cancel))
+    {
+        errno = ECANCELED;
+        return -1;
+    }
+    g_string_append_len(stream->output, buffer, size);
+    return size;
+}
+
+/* gpgme only seeks in the output to start over, so everything written
+ * after the new position is dropped */
+static off_t geanypg_stream_seek_output(void * handle, off_t offset, int whence)
+{
+    geanypg_stream * stream = handle;
+    off_t pos;
+    switch (whence)
+    {
+        case SEEK_SET: pos = offset; break;
+        case SEEK_CUR:
+        case SEEK_END: pos = stream->output->len + offset; break;
+        default: errno = EINVAL; return -1;
+    }
+    if (pos < 0 || pos > (off_t) stream->output->len)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    g_string_truncate(stream->output, pos);
+    return pos;
+}
+
+static struct gpgme_data_cbs input_cbs =
+{
+    geanypg_stream_read,
+    NULL,
+    geanypg_stream_seek_input,
+    NULL
+};
+
+static struct gpgme_data_cbs output_cbs =
+{
+    NULL,
+    geanypg_stream_write,
+    geanypg_stream_seek_output,
+    NULL
+};
+
+/* Takes the snapshot, returns 0 if there is none to take: when another
+ * operation is still running, or the selection is rectangular or multiple,
+ * which the output could not replace */
+int geanypg_stream_init(geanypg_stream * stream)
+{
+    GeanyDocument * doc = document_get_current();
+    ScintillaObject * sci = doc->editor->sci;
+    struct Sci_TextRange range;
+
+    if (geanypg_running)
+    {
+        dialogs_show_msgbox(GTK_MESSAGE_INFO, _("Another GeanyPG operation is still running."));
+        return 0;
+    }
+    if (sci_has_selection(sci) &&
+        (scintilla_send_message(sci, SCI_SELECTIONISRECTANGLE, 0, 0) ||
+         scintilla_send_message(sci, SCI_GETSELECTIONS, 0, 0) > 1))
+    {
+        dialogs_show_msgbox(GTK_MESSAGE_ERROR, _("Error, rectangular and multiple selections are not supported."));
+        return 0;
+    }
+
+    stream->sci = sci;
+    g_object_add_weak_pointer(G_OBJECT(sci), (gpointer *) &stream->sci);
+    stream->selection = sci_has_selection(sci);
+    if (stream->selection)
+    {
+        stream->start = sci_get_selection_start(sci);
+        stream->end = sci_get_selection_end(sci);
+    }
+    else
+    {
+        stream->start = 0;
+        stream->end = sci_get_length(sci);
+    }
+    /* the only copy of the text, gpgme reads it through the callbacks */
+    stream->length = stream->end - stream->start;
+    stream->text = g_malloc(stream->length + 1);
+    range.chrg.cpMin = stream->start;
+    range.chrg.cpMax = stream->end;
+    range.lpstrText = stream->text;
+    scintilla_send_message(sci, SCI_GETTEXTRANGE, 0, (sptr_t) &range);
+    stream->read = 0;
+    stream->output = g_string_sized_new(stream->length);
+    stream->cancel = 0;
+    return 1;
+}
+
+void geanypg_stream_release(geanypg_stream * stream)
+{
+    if (stream->sci)
+        g_object_remove_weak_pointer(G_OBJECT(stream->sci), (gpointer *) &stream->sci);
+    g_free(stream->text);
+    g_string_free(stream->output, TRUE);
+}
+
+/* Replaces the text the snapshot was taken from by the output */
+void geanypg_write_output(geanypg_stream * stream)
+{
+    ScintillaObject * sci = stream->sci;
+    if (!sci) /* the document was closed meanwhile */
+        return;
+    sci_start_undo_action(sci);
+    scintilla_send_message(sci, SCI_SETTARGETSTART, (uptr_t) stream->start, 0);
+    scintilla_send_message(sci, SCI_SETTARGETEND, (uptr_t) stream->end, 0);
+    scintilla_send_message(sci, SCI_REPLACETARGET, (uptr_t) stream->output->len,
+                           (sptr_t) stream->output->str);
+    if (stream->selection) /* cursor at the end of the replaced selection */
+        sci_set_current_position(sci, stream->start + stream->output->len, TRUE);
+    else
+        sci_set_current_position(sci, 0, TRUE);
+    sci_end_undo_action(sci);
+}
+
+static gboolean geanypg_job_quit(gpointer data)
+{
+    g_main_loop_quit((GMainLoop *) data);
+    return FALSE;
+}
+
+static gpointer geanypg_job_thread(gpointer data)
+{
+    geanypg_job * job = data;
+    job->err = job->operation(job->ed, job->input, job->output, job->user_data);
+    g_idle_add(geanypg_job_quit, job->loop);
+    return NULL;
+}
+
+static void geanypg_job_cancel(GtkDialog * dialog, gint response, gpointer data)
+{
+    geanypg_job * job = data;
+    g_atomic_int_set(&job->stream->cancel, 1);
+    gtk_dialog_set_response_sensitive(dialog, GTK_RESPONSE_CANCEL, FALSE);
+    gtk_progress_bar_set_text(GTK_PROGRESS_BAR(job->progress), _("Cancelling..."));
+}
+
+static gboolean geanypg_job_update(gpointer data)
+{
+    geanypg_job * job = data;
+    if (job->stream->length && !g_atomic_int_get(&job->stream->cancel))
+        gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(job->progress),
+            (gdouble) g_atomic_int_get(&job->stream->read) / job->stream->length);
+    return TRUE;
+}
+
+static gboolean geanypg_job_show_progress(gpointer data)
+{
+    geanypg_job * job = data;
+    GtkWidget * contentarea;
+
+    job->dialog = gtk_dialog_new_with_buttons(_("GeanyPG"),
+                                              GTK_WINDOW(geany->main_widgets->window),
+                                              GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
+                                              GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL,
+                                              NULL);
+    job->progress = gtk_progress_bar_new();
+    gtk_widget_set_size_request(job->progress, 300, -1);
+    contentarea = gtk_dialog_get_content_area(GTK_DIALOG(job->dialog));
+    gtk_box_pack_start(GTK_BOX(contentarea), gtk_label_new(_("Please wait...")), FALSE, FALSE, 5);
+    gtk_box_pack_start(GTK_BOX(contentarea), job->progress, FALSE, FALSE, 5);
+    /* closing the dialog cancels as well */
+    g_signal_connect(job->dialog, "response", G_CALLBACK(geanypg_job_cancel), job);
+    g_signal_connect(job->dialog, "delete-event", G_CALLBACK(gtk_true), NULL);
+    gtk_widget_show_all(job->dialog);
+
+    job->timeout = g_timeout_add(PROGRESS_INTERVAL, geanypg_job_update, job);
+    geanypg_job_update(job);
+    return FALSE;
+}
+
+/* Runs operation(ed, input, output, user_data) in a worker thread, with the
+ * snapshot in stream as input and its output buffer as output. The main loop
+ * keeps running in the meantime. Returns the error of the operation, or of
+ * setting up its data, or GPG_ERR_CANCELED if the user cancelled it. */
+gpgme_error_t geanypg_run_operation(encrypt_data * ed, geanypg_stream * stream,
+                                    geanypg_operation operation, gpointer user_data)
+{
+    geanypg_job job;
+    GThread * thread;
+    gboolean readonly;
+
+    memset(&job, 0, sizeof(job));
+    job.ed = ed;
+    job.stream = stream;
+    job.operation = operation;
+    job.user_data = user_data;
+
+    job.err = gpgme_data_new_from_cbs(&job.input, &input_cbs, stream);
+    if (job.err != GPG_ERR_NO_ERROR)
+        return job.err;
+    job.err = gpgme_data_new_from_cbs(&job.output, &output_cbs, stream);
+    if (job.err != GPG_ERR_NO_ERROR)
+    {
+        gpgme_data_release(job.input);
+        return job.err;
+    }
+    gpgme_data_set_encoding(job.input, GPGME_DATA_ENCODING_BINARY);
+
+    if (!g_thread_supported())
+        g_thread_init(NULL);
+
+    /* the snapshot must still match the document when the output is written */
+    readonly = scintilla_send_message(stream->sci, SCI_GETREADONLY, 0, 0);
+    scintilla_send_message(stream->sci, SCI_SETREADONLY, 1, 0);
+
+    job.loop = g_main_loop_new(NULL, FALSE);
+    thread = g_thread_create(geanypg_job_thread, &job, TRUE, NULL);
+    if (thread)
+    {
+        job.timeout = g_timeout_add(PROGRESS_DELAY, geanypg_job_show_progress, &job);
+        geanypg_running = TRUE;
+        g_main_loop_run(job.loop);
+        geanypg_running = FALSE;
+        g_thread_join(thread);
+        if (job.timeout)
+            g_source_remove(job.timeout);
+        if (job.dialog)
+            gtk_widget_destroy(job.dialog);
+    }
+    else /* do it the old way */
+        job.err = operation(ed, job.input, job.output, user_data);
+    g_main_loop_unref(job.loop);
+
+    if (stream->sci)
+        scintilla_send_message(stream->sci, SCI_SETREADONLY, readonly, 0);
+
+    gpgme_data_release(job.input);
+    gpgme_data_release(job.output);
+
+    if (g_atomic_int_get(&stream->cancel))
+        return gpgme_error(GPG_ERR_CANCELED);
+    return job.err;
+}
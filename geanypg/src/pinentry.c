@@ -190,13 +190,20 @@ gpgme_error_t geanypg_passphrase_cb(void * hook,
 
 #else
 
+/* the callback runs in the worker thread, the message is shown by the main loop */
+static gboolean geanypg_show_no_pinentry(gpointer data)
+{
+    dialogs_show_msgbox(GTK_MESSAGE_ERROR, _("Error, Passphrase input without using gpg-agent is not supported on Windows yet."));
+    return FALSE;
+}
+
 gpgme_error_t geanypg_passphrase_cb(void *hook,
                                     const char *uid_hint,
                                     const char *passphrase_info,
                                     int prev_was_bad ,
                                     int fd)
 {
-    dialogs_show_msgbox(GTK_MESSAGE_ERROR, _("Error, Passphrase input without using gpg-agent is not supported on Windows yet."));
+    g_idle_add(geanypg_show_no_pinentry, NULL);
     return gpgme_err_make(GPG_ERR_SOURCE_PINENTRY, GPG_ERR_CANCELED);
 }
 #endif
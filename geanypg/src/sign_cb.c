@@ -21,36 +21,26 @@
 
 #include "geanypg.h"
 
-static void geanypg_sign(encrypt_data * ed)
+static gpgme_error_t geanypg_sign_op(encrypt_data * ed, gpgme_data_t plain,
+                                     gpgme_data_t cipher, gpointer user_data)
 {
-    gpgme_data_t plain, cipher;
-    gpgme_error_t err;
-    FILE * tempfile;
-
-    tempfile = tmpfile();
-    if (!(tempfile))
-    {
-        fprintf(stderr, "GeanyPG: %s: %s\n", _("couldn't create tempfile"), strerror(errno));
-        return ;
-    }
-    gpgme_data_new_from_stream(&cipher, tempfile);
     gpgme_data_set_encoding(cipher, GPGME_DATA_ENCODING_ARMOR);
+    return gpgme_op_sign(ed->ctx, plain, cipher, GPGME_SIG_MODE_CLEAR);
+}
 
-    geanypg_load_buffer(&plain);
+static void geanypg_sign(encrypt_data * ed)
+{
+    geanypg_stream stream;
+    gpgme_error_t err;
 
-    err = gpgme_op_sign(ed->ctx, plain , cipher, GPGME_SIG_MODE_CLEAR);
+    if (!geanypg_stream_init(&stream))
+        return;
+    err = geanypg_run_operation(ed, &stream, geanypg_sign_op, NULL);
     if (err != GPG_ERR_NO_ERROR && gpgme_err_code(err) != GPG_ERR_CANCELED)
         geanypg_show_err_msg(err);
-    else
-    {
-        rewind(tempfile);
-        geanypg_write_file(tempfile);
-    }
-
-    fclose(tempfile);
-    /* release buffers */
-    gpgme_data_release(plain);
-    gpgme_data_release(cipher);
+    else if (gpgme_err_code(err) != GPG_ERR_CANCELED)
+        geanypg_write_output(&stream);
+    geanypg_stream_release(&stream);
 }
 
 void geanypg_sign_cb(GtkMenuItem * menuitem, gpointer user_data)
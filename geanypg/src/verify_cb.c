@@ -38,23 +38,39 @@ static char * geanypg_choose_sig(void)
     return file;
 }
 
+static gpgme_error_t geanypg_verify_op(encrypt_data * ed, gpgme_data_t text,
+                                       gpgme_data_t output, gpointer user_data)
+{
+    return gpgme_op_verify(ed->ctx, (gpgme_data_t) user_data, text, NULL);
+}
+
 static void geanypg_verify(encrypt_data * ed, char * signame)
 {
-    gpgme_data_t sig, text;
+    geanypg_stream stream;
+    gpgme_data_t sig;
     gpgme_error_t err;
     FILE * sigfile = fopen(signame, "r");
+    if (!sigfile)
+    {
+        fprintf(stderr, "GeanyPG: %s: %s.\n", signame, strerror(errno));
+        return;
+    }
+    if (!geanypg_stream_init(&stream))
+    {
+        fclose(sigfile);
+        return;
+    }
     gpgme_data_new_from_stream(&sig, sigfile);
-    geanypg_load_buffer(&text);
 
-    err = gpgme_op_verify(ed->ctx, sig, text, NULL);
+    err = geanypg_run_operation(ed, &stream, geanypg_verify_op, sig);
 
-    if (err != GPG_ERR_NO_ERROR)
+    if (err != GPG_ERR_NO_ERROR && gpgme_err_code(err) != GPG_ERR_CANCELED)
         geanypg_show_err_msg(err);
-    else
+    else if (gpgme_err_code(err) != GPG_ERR_CANCELED)
         geanypg_handle_signatures(ed, 1);
 
+    geanypg_stream_release(&stream);
     gpgme_data_release(sig);
-    gpgme_data_release(text);
     fclose(sigfile);
 }
 
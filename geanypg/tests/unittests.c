@@ -0,0 +1,532 @@
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+
+#include "geanypg.h"
+#include <glib/gstdio.h>
+
+
+/* how long to wait for the monitor and the refresh, in microseconds */
+#define WAIT_TIMEOUT 5000000
+/* longer than the delay key_cache.c waits before refreshing */
+#define QUIET_PERIOD 1500000
+
+GeanyPlugin     *geany_plugin;
+GeanyData       *geany_data;
+GeanyFunctions  *geany_functions;
+
+static gchar *home_dir;
+static gint listings;
+static GThread *main_thread;
+
+
+/* A stand-in for listing the keyring: it only counts the listings of the
+ * public keys, which the cache thread does once per refresh. */
+gpgme_error_t geanypg_list_keys(gpgme_ctx_t ctx, int secret, gpgme_key_t ** keys,
+                                unsigned long * nkeys, gint * cancel)
+{
+    *keys = (gpgme_key_t*) malloc(sizeof(gpgme_key_t));
+    *nkeys = 0;
+    if (!secret)
+        g_atomic_int_inc(&listings);
+    return GPG_ERR_NO_ERROR;
+}
+
+
+static gboolean is_cached(void)
+{
+    encrypt_data ed;
+
+    memset(&ed, 0, sizeof ed);
+    if (!geanypg_key_cache_get(&ed, 0))
+        return FALSE;
+    free(ed.key_array);
+    return TRUE;
+}
+
+
+/* runs the main loop until the keys were listed "count" times and the
+ * cache is valid, or the timeout elapses */
+static gboolean wait_listed(gint count)
+{
+    gint64 end = g_get_monotonic_time() + WAIT_TIMEOUT;
+
+    while (g_get_monotonic_time() < end)
+    {
+        while (g_main_context_iteration(NULL, FALSE));
+        if (g_atomic_int_get(&listings) >= count && is_cached())
+            return TRUE;
+        g_usleep(10000);
+    }
+    return FALSE;
+}
+
+
+/* runs the main loop long enough for a change to be noticed and refreshed */
+static void wait_quiet(void)
+{
+    gint64 end = g_get_monotonic_time() + QUIET_PERIOD;
+
+    while (g_get_monotonic_time() < end)
+    {
+        while (g_main_context_iteration(NULL, FALSE));
+        g_usleep(10000);
+    }
+}
+
+
+static void write_file(const gchar * name, const gchar * contents)
+{
+    gchar * path = g_build_filename(home_dir, name, NULL);
+    fail_unless(g_file_set_contents(path, contents, -1, NULL), "can't write %s", path);
+    g_free(path);
+}
+
+
+static void rename_file(const gchar * name, const gchar * new_name)
+{
+    gchar * path = g_build_filename(home_dir, name, NULL);
+    gchar * new_path = g_build_filename(home_dir, new_name, NULL);
+    fail_unless(g_rename(path, new_path) == 0, "can't rename %s", path);
+    g_free(new_path);
+    g_free(path);
+}
+
+
+static void remove_tree(const gchar * path)
+{
+    GDir * dir = g_dir_open(path, 0, NULL);
+    const gchar * name;
+
+    if (dir)
+    {
+        while ((name = g_dir_read_name(dir)) != NULL)
+        {
+            gchar * child = g_build_filename(path, name, NULL);
+            remove_tree(child);
+            g_free(child);
+        }
+        g_dir_close(dir);
+    }
+    g_remove(path);
+}
+
+
+/* a temporary GnuPG home with a keyring, and the cache watching it */
+static void setup(void)
+{
+    gchar * private_keys;
+
+    home_dir = g_dir_make_tmp("geanypg-XXXXXX", NULL);
+    fail_unless(home_dir != NULL);
+    private_keys = g_build_filename(home_dir, "private-keys-v1.d", NULL);
+    g_mkdir_with_parents(private_keys, 0700);
+    g_free(private_keys);
+    write_file("pubring.kbx", "keys");
+
+    g_setenv("GNUPGHOME", home_dir, TRUE);
+    gpgme_set_engine_info(GPGME_PROTOCOL_OpenPGP, NULL, home_dir);
+    listings = 0;
+    geanypg_key_cache_init();
+    fail_unless(wait_listed(1), "the keys were never listed");
+}
+
+
+static void teardown(void)
+{
+    geanypg_key_cache_cleanup();
+    remove_tree(home_dir);
+    g_free(home_dir);
+}
+
+
+/* what gpg writes on every run, whatever the operation */
+START_TEST(test_gpg_own_writes)
+{
+    write_file("trustdb.gpg", "trust");
+    write_file("random_seed", "seed");
+    write_file("pubring.kbx.lock", "1234");
+    write_file(".#lk0x00005555.host.1234", "1234");
+    write_file("pubring.kbx~", "keys");
+    write_file("private-keys-v1.d/.#lk0x00005555.host.1234", "1234");
+    write_file("private-keys-v1.d/ABCDEF.key.tmp", "key");
+    write_file("S.gpg-agent", "");
+    wait_quiet();
+
+    fail_unless(g_atomic_int_get(&listings) == 1, "listed %d times", g_atomic_int_get(&listings));
+    fail_unless(is_cached(), "the cache was invalidated");
+}
+END_TEST;
+
+
+START_TEST(test_keyring_change)
+{
+    write_file("pubring.kbx", "more keys");
+    fail_unless(wait_listed(2), "the change wasn't noticed");
+
+    write_file("pubring.gpg", "old keys");
+    fail_unless(wait_listed(3), "the old keyring wasn't watched");
+
+    write_file("secring.gpg", "old secret keys");
+    fail_unless(wait_listed(4), "the old secret keyring wasn't watched");
+}
+END_TEST;
+
+
+/* gpg writes the new keyring next to the old one and renames it */
+START_TEST(test_keyring_rename)
+{
+    write_file("pubring.kbx.tmp", "more keys");
+    wait_quiet();
+    fail_unless(g_atomic_int_get(&listings) == 1, "listed for the temporary file");
+
+    rename_file("pubring.kbx.tmp", "pubring.kbx");
+    fail_unless(wait_listed(2), "the rename wasn't noticed");
+}
+END_TEST;
+
+
+START_TEST(test_private_key)
+{
+    write_file("private-keys-v1.d/ABCDEF.key", "key");
+    fail_unless(wait_listed(2), "the new secret key wasn't noticed");
+}
+END_TEST;
+
+
+/* A stand-in for the Scintilla widget of the current document: a GObject,
+ * so the operation can watch for it being destroyed */
+
+typedef struct
+{
+    GObject parent;
+    GString * text;
+    gint selection_start;
+    gint selection_end;
+    gint readonly;
+    gint target_start;
+    gint target_end;
+} FakeSci;
+
+typedef GObjectClass FakeSciClass;
+
+static GType fake_sci_type = 0;
+static GeanyEditor current_editor;
+static GeanyDocument current_document;
+static gint messages;
+
+
+static void fake_sci_finalize(GObject * object)
+{
+    g_string_free(((FakeSci *) object)->text, TRUE);
+    G_OBJECT_CLASS(g_type_class_peek_parent(G_OBJECT_GET_CLASS(object)))->finalize(object);
+}
+
+
+static void fake_sci_class_init(GObjectClass * klass)
+{
+    klass->finalize = fake_sci_finalize;
+}
+
+
+/* makes a document with text the current one */
+static FakeSci * fake_sci_new(const gchar * text)
+{
+    FakeSci * sci;
+
+    if (!fake_sci_type)
+        fake_sci_type = g_type_register_static_simple(G_TYPE_OBJECT, "FakeSci",
+            sizeof(FakeSciClass), (GClassInitFunc) fake_sci_class_init, sizeof(FakeSci), NULL, 0);
+    sci = g_object_new(fake_sci_type, NULL);
+    sci->text = g_string_new(text);
+    current_editor.sci = (ScintillaObject *) sci;
+    current_document.editor = &current_editor;
+    messages = 0;
+    return sci;
+}
+
+
+sptr_t scintilla_send_message(ScintillaObject * sci, unsigned int iMessage, uptr_t wParam, sptr_t lParam)
+{
+    FakeSci * fake = (FakeSci *) sci;
+    struct Sci_TextRange * range;
+
+    switch (iMessage)
+    {
+        case SCI_GETREADONLY: return g_atomic_int_get(&fake->readonly);
+        case SCI_SETREADONLY: g_atomic_int_set(&fake->readonly, wParam); return 0;
+        case SCI_SELECTIONISRECTANGLE: return 0;
+        case SCI_GETSELECTIONS: return 1;
+        case SCI_GETTEXTRANGE:
+            range = (struct Sci_TextRange *) lParam;
+            memcpy(range->lpstrText, fake->text->str + range->chrg.cpMin,
+                   range->chrg.cpMax - range->chrg.cpMin);
+            range->lpstrText[range->chrg.cpMax - range->chrg.cpMin] = '\0';
+            return range->chrg.cpMax - range->chrg.cpMin;
+        case SCI_SETTARGETSTART: fake->target_start = wParam; return 0;
+        case SCI_SETTARGETEND: fake->target_end = wParam; return 0;
+        case SCI_REPLACETARGET:
+            fail_unless(!fake->readonly, "replaced the text of a read-only document");
+            g_string_erase(fake->text, fake->target_start, fake->target_end - fake->target_start);
+            g_string_insert_len(fake->text, fake->target_start, (const gchar *) lParam, wParam);
+            return wParam;
+    }
+    return 0;
+}
+
+
+GeanyDocument * document_get_current(void)
+{
+    return &current_document;
+}
+
+
+void dialogs_show_msgbox(GtkMessageType type, const gchar * text, ...)
+{
+    fail_unless(g_thread_self() == main_thread, "message shown from another thread");
+    messages++;
+}
+
+
+gboolean sci_has_selection(ScintillaObject * sci)
+{
+    return ((FakeSci *) sci)->selection_start != ((FakeSci *) sci)->selection_end;
+}
+
+
+gint sci_get_selection_start(ScintillaObject * sci)
+{
+    return ((FakeSci *) sci)->selection_start;
+}
+
+
+gint sci_get_selection_end(ScintillaObject * sci)
+{
+    return ((FakeSci *) sci)->selection_end;
+}
+
+
+gint sci_get_length(ScintillaObject * sci)
+{
+    return ((FakeSci *) sci)->text->len;
+}
+
+
+void sci_start_undo_action(ScintillaObject * sci)
+{
+}
+
+
+void sci_end_undo_action(ScintillaObject * sci)
+{
+}
+
+
+void sci_set_current_position(ScintillaObject * sci, gint position, gboolean scroll_to_caret)
+{
+}
+
+
+/* what an operation saw of the document while it ran */
+typedef struct
+{
+    FakeSci * sci;
+    GThread * thread;
+    gint readonly;
+} operation_log;
+
+
+/* upper-cases the input, reading it twice and starting the output over
+ * once, the way gpgme does when it checks the input first */
+static gpgme_error_t upcase_op(encrypt_data * ed, gpgme_data_t input,
+                               gpgme_data_t output, gpointer user_data)
+{
+    operation_log * log = user_data;
+    char buffer[3];
+    ssize_t n;
+    ssize_t i;
+
+    log->thread = g_thread_self();
+    log->readonly = g_atomic_int_get(&log->sci->readonly);
+
+    while ((n = gpgme_data_read(input, buffer, sizeof buffer)) > 0)
+        gpgme_data_write(output, "?", 1);
+    gpgme_data_seek(input, 0, SEEK_SET);
+    gpgme_data_seek(output, 0, SEEK_SET);
+    while ((n = gpgme_data_read(input, buffer, sizeof buffer)) > 0)
+    {
+        for (i = 0; i < n; i++)
+            buffer[i] = g_ascii_toupper(buffer[i]);
+        gpgme_data_write(output, buffer, n);
+    }
+    return n < 0 ? gpgme_error_from_errno(errno) : GPG_ERR_NO_ERROR;
+}
+
+
+/* reads the input slowly, until it is cancelled */
+static gpgme_error_t slow_op(encrypt_data * ed, gpgme_data_t input,
+                             gpgme_data_t output, gpointer user_data)
+{
+    char c;
+    ssize_t n;
+
+    while ((n = gpgme_data_read(input, &c, 1)) > 0)
+    {
+        gpgme_data_write(output, &c, 1);
+        g_usleep(1000);
+    }
+    return n < 0 ? gpgme_error_from_errno(errno) : GPG_ERR_NO_ERROR;
+}
+
+
+static gpgme_error_t run(FakeSci * sci, geanypg_operation operation, gpointer user_data)
+{
+    encrypt_data ed;
+    geanypg_stream stream;
+    gpgme_error_t err;
+
+    memset(&ed, 0, sizeof ed);
+    fail_unless(geanypg_stream_init(&stream), "no snapshot taken");
+    err = geanypg_run_operation(&ed, &stream, operation, user_data);
+    if (err == GPG_ERR_NO_ERROR)
+        geanypg_write_output(&stream);
+    geanypg_stream_release(&stream);
+    return err;
+}
+
+
+START_TEST(test_operation)
+{
+    FakeSci * sci = fake_sci_new("hello, world");
+    operation_log log = { sci, NULL, 0 };
+
+    fail_unless(run(sci, upcase_op, &log) == GPG_ERR_NO_ERROR);
+    fail_unless(log.thread != NULL && log.thread != main_thread, "not run in a worker thread");
+    fail_unless(log.readonly, "the document wasn't read-only during the operation");
+    fail_unless(!sci->readonly, "the document was left read-only");
+    fail_unless(strcmp(sci->text->str, "HELLO, WORLD") == 0, "got \"%s\"", sci->text->str);
+    g_object_unref(sci);
+}
+END_TEST;
+
+
+START_TEST(test_operation_selection)
+{
+    FakeSci * sci = fake_sci_new("hello, world");
+    operation_log log = { sci, NULL, 0 };
+
+    sci->selection_start = 7;
+    sci->selection_end = 12;
+    fail_unless(run(sci, upcase_op, &log) == GPG_ERR_NO_ERROR);
+    fail_unless(strcmp(sci->text->str, "hello, WORLD") == 0, "got \"%s\"", sci->text->str);
+    g_object_unref(sci);
+}
+END_TEST;
+
+
+/* from the main loop while slow_op runs: another operation is refused, then
+ * the running one is cancelled */
+static gboolean cancel_running(gpointer data)
+{
+    geanypg_stream other;
+
+    fail_unless(!geanypg_stream_init(&other), "a second operation was started");
+    fail_unless(messages == 1, "the second operation wasn't refused");
+    g_atomic_int_set(&((geanypg_stream *) data)->cancel, 1);
+    return FALSE;
+}
+
+
+START_TEST(test_operation_cancel)
+{
+    GString * text = g_string_new(NULL);
+    FakeSci * sci;
+    encrypt_data ed;
+    geanypg_stream stream;
+    gpgme_error_t err;
+    gint i;
+
+    for (i = 0; i < 10000; i++)
+        g_string_append_c(text, 'a' + i % 26);
+    sci = fake_sci_new(text->str);
+    memset(&ed, 0, sizeof ed);
+    fail_unless(geanypg_stream_init(&stream));
+    g_timeout_add(20, cancel_running, &stream);
+    err = geanypg_run_operation(&ed, &stream, slow_op, NULL);
+    geanypg_stream_release(&stream);
+
+    fail_unless(gpg_err_code(err) == GPG_ERR_CANCELED, "error %u", err);
+    fail_unless(strcmp(sci->text->str, text->str) == 0, "the document was changed");
+    fail_unless(!sci->readonly, "the document was left read-only");
+    /* and the next one may run */
+    fail_unless(geanypg_stream_init(&stream));
+    geanypg_stream_release(&stream);
+
+    g_object_unref(sci);
+    g_string_free(text, TRUE);
+}
+END_TEST;
+
+
+static gboolean close_document(gpointer data)
+{
+    g_object_unref(data);
+    return FALSE;
+}
+
+
+/* the output is dropped when the document is closed during the operation */
+START_TEST(test_operation_closed)
+{
+    FakeSci * sci = fake_sci_new("a hundred bytes, read one a millisecond, which is long enough "
+                                 "to close the document in the meantime");
+    gpointer weak = sci;
+
+    g_object_add_weak_pointer(G_OBJECT(sci), &weak);
+    g_timeout_add(5, close_document, sci);
+    fail_unless(run(sci, slow_op, NULL) == GPG_ERR_NO_ERROR);
+    fail_unless(weak == NULL, "the document wasn't closed");
+}
+END_TEST;
+
+
+Suite *
+my_suite(void)
+{
+    Suite *s = suite_create("GeanyPG");
+    TCase *tc_core = tcase_create("Core");
+    suite_add_tcase(s, tc_core);
+    tcase_add_checked_fixture(tc_core, setup, teardown);
+    tcase_set_timeout(tc_core, 30);
+    tcase_add_test(tc_core, test_gpg_own_writes);
+    tcase_add_test(tc_core, test_keyring_change);
+    tcase_add_test(tc_core, test_keyring_rename);
+    tcase_add_test(tc_core, test_private_key);
+
+    TCase *tc_operation = tcase_create("Operation");
+    suite_add_tcase(s, tc_operation);
+    tcase_set_timeout(tc_operation, 30);
+    tcase_add_test(tc_operation, test_operation);
+    tcase_add_test(tc_operation, test_operation_selection);
+    tcase_add_test(tc_operation, test_operation_cancel);
+    tcase_add_test(tc_operation, test_operation_closed);
+
+    return s;
+}
+
+int
+main(void)
+{
+    int nf;
+    Suite *s;
+    SRunner *sr;
+
+    gpgme_check_version(NULL);
+    main_thread = g_thread_self();
+    s = my_suite();
+    sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    nf = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (nf == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
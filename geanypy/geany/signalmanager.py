@@ -10,6 +10,14 @@ import gobject
 class SignalManager(gobject.GObject):
 	"""
 	Manages callback functions for events emitted by Geany's internal GObject.
+
+	The 'editor-notify' signal is emitted for every Scintilla notification,
+	which includes frequent ones like SCN_PAINTED and SCN_UPDATEUI.  Handlers
+	that only care about some notifications should connect with a detail
+	naming the notification, for example 'editor-notify::modified' or
+	'editor-notify::char-added'.  Notifications that no handler has asked
+	for are then skipped without creating any Python objects.  Handlers
+	connected to plain 'editor-notify' still receive everything.
 	"""
 	__gsignals__ = {
 		'build-start':				(gobject.SIGNAL_RUN_LAST, gobject.TYPE_NONE,
@@ -30,7 +38,8 @@ class SignalManager(gobject.GObject):
 										(gobject.TYPE_PYOBJECT,)),
 		'document-save':			(gobject.SIGNAL_RUN_LAST, gobject.TYPE_NONE,
 										(gobject.TYPE_PYOBJECT,)),
-		'editor-notify':			(gobject.SIGNAL_RUN_LAST, gobject.TYPE_BOOLEAN,
+		'editor-notify':			(gobject.SIGNAL_RUN_LAST | gobject.SIGNAL_DETAILED,
+										gobject.TYPE_BOOLEAN,
 										(gobject.TYPE_PYOBJECT, gobject.TYPE_PYOBJECT)),
 		'geany-startup-complete':	(gobject.SIGNAL_RUN_LAST, gobject.TYPE_NONE,
 										()),
@@ -0,0 +1,264 @@
+#include "geanypy.h"
+
+
+/* Key for the modification counter attached to each ScintillaObject. */
+#define GENERATION_KEY "geanypy-contents-generation"
+
+
+static void
+on_sci_notify(ScintillaObject *sci, gint scn, SCNotification *nt, guint *generation)
+{
+	if (nt->nmhdr.code == SCN_MODIFIED &&
+		(nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)))
+	{
+		(*generation)++;
+	}
+}
+
+
+/* Gets the counter which is bumped on every change to the text of sci,
+ * starting to watch the widget the first time it is asked for. */
+static guint *
+get_generation(ScintillaObject *sci)
+{
+	guint *generation = g_object_get_data(G_OBJECT(sci), GENERATION_KEY);
+
+	if (generation == NULL)
+	{
+		generation = g_new0(guint, 1);
+		g_object_set_data_full(G_OBJECT(sci), GENERATION_KEY, generation, g_free);
+		g_signal_connect(sci, "sci-notify", G_CALLBACK(on_sci_notify), generation);
+	}
+	return generation;
+}
+
+
+/* Checks that the Scintilla buffer the view points into hasn't changed
+ * since the view was made, setting a Python exception if it has. */
+static gboolean
+ContentsView_check_valid(ContentsView *self)
+{
+	if (self->sci == NULL || self->text == NULL)
+	{
+		PyErr_SetString(PyExc_RuntimeError,
+			"ContentsView instance not initialized properly or its widget was destroyed");
+		return FALSE;
+	}
+	if (*get_generation(self->sci) != self->generation)
+	{
+		PyErr_SetString(PyExc_RuntimeError,
+			"ContentsView is stale, the document was modified after it was made");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+
+static void
+ContentsView_dealloc(ContentsView *self)
+{
+	if (self->sci != NULL)
+		g_object_remove_weak_pointer(G_OBJECT(self->sci), (gpointer *) &self->sci);
+	self->ob_type->tp_free((PyObject *) self);
+}
+
+
+static int
+ContentsView_init(ContentsView *self)
+{
+	self->sci = NULL;
+	self->text = NULL;
+	self->start = 0;
+	self->length = 0;
+	self->generation = 0;
+	return 0;
+}
+
+
+static PyObject *
+ContentsView_get_property(ContentsView *self, const gchar *prop_name)
+{
+	g_return_val_if_fail(self != NULL, NULL);
+	g_return_val_if_fail(prop_name != NULL, NULL);
+
+	if (g_str_equal(prop_name, "valid"))
+	{
+		if (self->sci != NULL && self->text != NULL &&
+			*get_generation(self->sci) == self->generation)
+		{
+			Py_RETURN_TRUE;
+		}
+		Py_RETURN_FALSE;
+	}
+	else if (g_str_equal(prop_name, "start"))
+		return PyInt_FromLong((glong) self->start);
+	else if (g_str_equal(prop_name, "end"))
+		return PyInt_FromLong((glong) (self->start + self->length));
+
+	Py_RETURN_NONE;
+}
+GEANYPY_PROPS_READONLY(ContentsView);
+
+
+static PyObject *
+ContentsView_get_range(ContentsView *self, PyObject *args, PyObject *kwargs)
+{
+	gint start = 0, end = -1;
+	static gchar *kwlist[] = { "start", "end", NULL };
+
+	if (PyArg_ParseTupleAndKeywords(args, kwargs, "|ii", kwlist, &start, &end))
+	{
+		if (!ContentsView_check_valid(self))
+			return NULL;
+		if (end == -1 || end > self->length)
+			end = self->length;
+		start = CLAMP(start, 0, end);
+		return PyString_FromStringAndSize(self->text + start, end - start);
+	}
+
+	Py_RETURN_NONE;
+}
+
+
+static Py_ssize_t
+ContentsView_length(ContentsView *self)
+{
+	if (!ContentsView_check_valid(self))
+		return -1;
+	return self->length;
+}
+
+
+static Py_ssize_t
+ContentsView_get_read_buffer(ContentsView *self, Py_ssize_t segment, void **ptr)
+{
+	if (segment != 0)
+	{
+		PyErr_SetString(PyExc_SystemError, "accessing non-existent buffer segment");
+		return -1;
+	}
+	if (!ContentsView_check_valid(self))
+		return -1;
+	*ptr = (void *) self->text;
+	return self->length;
+}
+
+
+static Py_ssize_t
+ContentsView_get_segment_count(ContentsView *self, Py_ssize_t *lenp)
+{
+	if (lenp != NULL)
+		*lenp = self->length;
+	return 1;
+}
+
+
+/* A memoryview keeps the pointer it gets for as long as it lives, and never
+ * calls back before reading through it, so the generation can't be checked on
+ * access, while an edit that grows the document reallocates the Scintilla
+ * buffer. So the new style buffer is a copy of the text the memoryview owns,
+ * made once when it is created. Only the old style buffer is zero-copy:
+ * buffer() asks for the pointer again, and so re-validates the view, on every
+ * access. */
+static int
+ContentsView_get_buffer(ContentsView *self, Py_buffer *view, int flags)
+{
+	PyObject *snapshot;
+	int result;
+
+	if (!ContentsView_check_valid(self))
+		return -1;
+	snapshot = PyString_FromStringAndSize(self->text, self->length);
+	if (snapshot == NULL)
+		return -1;
+	result = PyBuffer_FillInfo(view, snapshot, PyString_AS_STRING(snapshot),
+		self->length, 1, flags);
+	Py_DECREF(snapshot);
+	return result;
+}
+
+
+static PyMethodDef ContentsView_methods[] = {
+	{ "get_range", (PyCFunction) ContentsView_get_range, METH_KEYWORDS,
+		"Gets a copy of the text between start and end, relative to the "
+		"start of the view." },
+	{ NULL }
+};
+
+
+static PyGetSetDef ContentsView_getseters[] = {
+	GEANYPY_GETSETDEF(ContentsView, "valid",
+		"Whether the document is unchanged since the view was made."),
+	GEANYPY_GETSETDEF(ContentsView, "start",
+		"Document position of the start of the view."),
+	GEANYPY_GETSETDEF(ContentsView, "end",
+		"Document position of the end of the view."),
+	{ NULL }
+};
+
+
+static PySequenceMethods ContentsView_as_sequence = {
+	(lenfunc) ContentsView_length,					/* sq_length */
+};
+
+
+static PyBufferProcs ContentsView_as_buffer = {
+	(readbufferproc) ContentsView_get_read_buffer,	/* bf_getreadbuffer */
+	NULL,											/* bf_getwritebuffer */
+	(segcountproc) ContentsView_get_segment_count,	/* bf_getsegcount */
+	(charbufferproc) ContentsView_get_read_buffer,	/* bf_getcharbuffer */
+	(getbufferproc) ContentsView_get_buffer,		/* bf_getbuffer */
+	NULL,											/* bf_releasebuffer */
+};
+
+
+PyTypeObject ContentsViewType = {
+	PyObject_HEAD_INIT(NULL)
+	0,												/* ob_size */
+	"geany.scintilla.ContentsView",					/* tp_name */
+	sizeof(ContentsView),							/* tp_basicsize */
+	0,												/* tp_itemsize */
+	(destructor) ContentsView_dealloc,				/* tp_dealloc */
+	0, 0, 0, 0, 0, 0,								/* tp_print - tp_as_number */
+	&ContentsView_as_sequence,						/* tp_as_sequence */
+	0, 0, 0, 0, 0, 0,								/* tp_as_mapping - tp_setattro */
+	&ContentsView_as_buffer,						/* tp_as_buffer */
+	Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER,	/* tp_flags */
+	"Read-only view of the text inside a ScintillaObject. Through buffer() "
+	"the text is read without copying it, but only until the document is "
+	"next modified. A memoryview of it copies the text once, when it is "
+	"made, and that copy stays valid.",				/* tp_doc */
+	0, 0, 0, 0, 0, 0,								/* tp_traverse - tp_iternext */
+	ContentsView_methods,							/* tp_methods */
+	0,												/* tp_members */
+	ContentsView_getseters,							/* tp_getset */
+	0, 0, 0, 0, 0,									/* tp_base - tp_dictoffset */
+	(initproc) ContentsView_init,					/* tp_init */
+	0, 0,											/* tp_alloc - tp_new */
+};
+
+
+ContentsView *ContentsView_create_new_from_scintilla(ScintillaObject *sci, gint start, gint end)
+{
+	ContentsView *self;
+	gint len;
+
+	len = sci_get_length(sci);
+	if (end < 0 || end > len)
+		end = len;
+	start = CLAMP(start, 0, end);
+
+	self = (ContentsView *) PyObject_CallObject((PyObject *) &ContentsViewType, NULL);
+	if (self == NULL)
+		return NULL;
+
+	self->sci = sci;
+	g_object_add_weak_pointer(G_OBJECT(sci), (gpointer *) &self->sci);
+	/* SCI_GETCHARACTERPOINTER makes the text contiguous, and the pointer
+	 * stays valid until the next change, which the generation tracks */
+	self->text = (const gchar *) scintilla_send_message(sci, SCI_GETCHARACTERPOINTER, 0, 0) + start;
+	self->start = start;
+	self->length = end - start;
+	self->generation = *get_generation(sci);
+	return self;
+}
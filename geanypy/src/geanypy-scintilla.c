@@ -167,26 +167,36 @@ Scintilla_get_col_from_position(Scintilla *self, PyObject *args, PyObject *kwarg
 }
 
 
+/* Copies text straight out of Scintilla's buffer into a new Python string,
+ * rather than copying it into a temporary buffer first. */
+static PyObject *
+Scintilla_copy_text(ScintillaObject *sci, gint start, gint end)
+{
+	const gchar *text;
+	gint len = sci_get_length(sci);
+
+	if (end < 0 || end > len)
+		end = len;
+	start = CLAMP(start, 0, end);
+	text = (const gchar *) scintilla_send_message(sci, SCI_GETCHARACTERPOINTER, 0, 0);
+	if (text == NULL)
+		Py_RETURN_NONE;
+	return PyString_FromStringAndSize(text + start, end - start);
+}
+
+
 static PyObject *
 Scintilla_get_contents(Scintilla *self, PyObject *args, PyObject *kwargs)
 {
 	gint len = -1;
-	gchar *text;
-	PyObject *py_text;
 	static gchar *kwlist[] = { "len", NULL };
 
 	SCI_RET_IF_FAIL(self);
 
 	if (PyArg_ParseTupleAndKeywords(args, kwargs, "|i", kwlist, &len))
 	{
-		if (len == -1)
-			len = sci_get_length(self->sci) + 1;
-		text = sci_get_contents(self->sci, len);
-		if (text == NULL)
-			Py_RETURN_NONE;
-		py_text = PyString_FromString(text);
-		g_free(text);
-		return py_text;
+		/* like sci_get_contents(), len includes the terminating NUL */
+		return Scintilla_copy_text(self->sci, 0, (len == -1) ? -1 : MAX(len - 1, 0));
 	}
 
 	Py_RETURN_NONE;
@@ -197,8 +207,6 @@ static PyObject *
 Scintilla_get_contents_range(Scintilla *self, PyObject *args, PyObject *kwargs)
 {
 	gint start = -1, end = -1;
-	gchar *text;
-	PyObject *py_text;
 	static gchar *kwlist[] = { "start", "end", NULL };
 
 	SCI_RET_IF_FAIL(self);
@@ -207,20 +215,28 @@ Scintilla_get_contents_range(Scintilla *self, PyObject *args, PyObject *kwargs)
 	{
 		if (start == -1)
 			start = 0;
-		if (end == -1)
-			end = sci_get_length(self->sci) + 1;
-		text = sci_get_contents_range(self->sci, start, end);
-		if (text == NULL)
-			Py_RETURN_NONE;
-		py_text = PyString_FromString(text);
-		g_free(text);
-		return py_text;
+		return Scintilla_copy_text(self->sci, start, end);
 	}
 
 	Py_RETURN_NONE;
 }
 
 
+static PyObject *
+Scintilla_get_contents_view(Scintilla *self, PyObject *args, PyObject *kwargs)
+{
+	gint start = 0, end = -1;
+	static gchar *kwlist[] = { "start", "end", NULL };
+
+	SCI_RET_IF_FAIL(self);
+
+	if (PyArg_ParseTupleAndKeywords(args, kwargs, "|ii", kwlist, &start, &end))
+		return (PyObject *) ContentsView_create_new_from_scintilla(self->sci, start, end);
+
+	Py_RETURN_NONE;
+}
+
+
 static PyObject *
 Scintilla_get_current_line(Scintilla *self)
 {
@@ -799,6 +815,9 @@ static PyMethodDef Scintilla_methods[] = {
 		"Gets all text inside a given text length." },
 	{ "get_contents_range", (PyCFunction) Scintilla_get_contents_range, METH_KEYWORDS,
 		"Gets text between start and end." },
+	{ "get_contents_view", (PyCFunction) Scintilla_get_contents_view, METH_KEYWORDS,
+		"Gets a read-only view of the text between start and end, without "
+		"copying it. The view is only valid until the document is modified." },
 	{ "get_current_line", (PyCFunction) Scintilla_get_current_line, METH_NOARGS,
 		"Gets current line number." },
 	{ "get_current_position", (PyCFunction) Scintilla_get_current_position, METH_NOARGS,
@@ -922,6 +941,10 @@ PyMODINIT_FUNC initscintilla(void)
 	if (PyType_Ready(&NotifyHeaderType) < 0)
 		return;
 
+	ContentsViewType.tp_new = PyType_GenericNew;
+	if (PyType_Ready(&ContentsViewType) < 0)
+		return;
+
 	m = Py_InitModule("scintilla", ScintillaModule_methods);
 
 	Py_INCREF(&ScintillaType);
@@ -933,6 +956,9 @@ PyMODINIT_FUNC initscintilla(void)
 	Py_INCREF(&NotifyHeaderType);
 	PyModule_AddObject(m, "NotifyHeader", (PyObject *)&NotifyHeaderType);
 
+	Py_INCREF(&ContentsViewType);
+	PyModule_AddObject(m, "ContentsView", (PyObject *)&ContentsViewType);
+
 
 	PyModule_AddIntConstant(m, "FLAG_WHOLE_WORD", SCFIND_WHOLEWORD);
 	PyModule_AddIntConstant(m, "FLAG_MATCH_CASE", SCFIND_MATCHCASE);
@@ -3,6 +3,7 @@
 
 extern PyTypeObject NotificationType;
 extern PyTypeObject NotifyHeaderType;
+extern PyTypeObject ContentsViewType;
 
 typedef struct
 {
@@ -16,6 +17,16 @@ typedef struct
     SCNotification *notif;
 } NotifyHeader;
 
+typedef struct
+{
+	PyObject_HEAD
+	ScintillaObject *sci;
+	const gchar *text;
+	gint start;
+	gint length;
+	guint generation;
+} ContentsView;
+
 typedef struct
 {
     PyObject_HEAD
@@ -28,5 +39,6 @@ PyMODINIT_FUNC init_geany_scintilla(void);
 Scintilla *Scintilla_create_new_from_scintilla(ScintillaObject *sci);
 Notification *Notification_create_new_from_scintilla_notification(SCNotification *notif);
 NotifyHeader *NotifyHeader_create_new_from_scintilla_notification(SCNotification *notif);
+ContentsView *ContentsView_create_new_from_scintilla(ScintillaObject *sci, gint start, gint end);
 
 #endif /* GEANYPY_SCINTILLA_H__ */
@@ -1,10 +1,56 @@
 #include "geanypy.h"
 
+/* Range of Scintilla notification codes that have a signal detail */
+#define NOTIFY_CODE_FIRST	SCN_STYLENEEDED
+#define NOTIFY_CODE_LAST	SCN_HOTSPOTRELEASECLICK
+#define NOTIFY_CODE_COUNT	(NOTIFY_CODE_LAST - NOTIFY_CODE_FIRST + 1)
+
+
 struct _SignalManager
 {
 	GeanyPlugin *geany_plugin;
 	PyObject *py_obj;
 	GObject *obj;
+	guint editor_notify_id;
+	GQuark notify_details[NOTIFY_CODE_COUNT];
+};
+
+
+/* Signal details for "editor-notify", so Python handlers can connect to
+ * e.g. "editor-notify::modified" and only be called for SCN_MODIFIED. */
+static const struct
+{
+	gint code;
+	const gchar *detail;
+}
+notify_details[] = {
+	{ SCN_STYLENEEDED, "style-needed" },
+	{ SCN_CHARADDED, "char-added" },
+	{ SCN_SAVEPOINTREACHED, "save-point-reached" },
+	{ SCN_SAVEPOINTLEFT, "save-point-left" },
+	{ SCN_MODIFYATTEMPTRO, "modify-attempt-ro" },
+	{ SCN_KEY, "key" },
+	{ SCN_DOUBLECLICK, "double-click" },
+	{ SCN_UPDATEUI, "update-ui" },
+	{ SCN_MODIFIED, "modified" },
+	{ SCN_MACRORECORD, "macro-record" },
+	{ SCN_MARGINCLICK, "margin-click" },
+	{ SCN_NEEDSHOWN, "need-shown" },
+	{ SCN_PAINTED, "painted" },
+	{ SCN_USERLISTSELECTION, "user-list-selection" },
+	{ SCN_URIDROPPED, "uri-dropped" },
+	{ SCN_DWELLSTART, "dwell-start" },
+	{ SCN_DWELLEND, "dwell-end" },
+	{ SCN_ZOOM, "zoom" },
+	{ SCN_HOTSPOTCLICK, "hot-spot-click" },
+	{ SCN_HOTSPOTDOUBLECLICK, "hot-spot-double-click" },
+	{ SCN_CALLTIPCLICK, "call-tip-click" },
+	{ SCN_AUTOCSELECTION, "auto-c-selection" },
+	{ SCN_INDICATORCLICK, "indicator-click" },
+	{ SCN_INDICATORRELEASE, "indicator-release" },
+	{ SCN_AUTOCCANCELLED, "autoc-cancelled" },
+	{ SCN_AUTOCCHARDELETED, "autoc-char-deleted" },
+	{ SCN_HOTSPOTRELEASECLICK, "hot-spot-release-click" }
 };
 
 
@@ -34,6 +80,7 @@ SignalManager *signal_manager_new(GeanyPlugin *geany_plugin)
 {
 	SignalManager *man;
 	PyObject *module;
+	guint i;
 
 	man = g_new0(SignalManager, 1);
 
@@ -63,6 +110,13 @@ SignalManager *signal_manager_new(GeanyPlugin *geany_plugin)
 	}
 	man->obj = pygobject_get(man->py_obj);
 
+	man->editor_notify_id = g_signal_lookup("editor-notify", G_OBJECT_TYPE(man->obj));
+	for (i = 0; i < G_N_ELEMENTS(notify_details); i++)
+	{
+		man->notify_details[notify_details[i].code - NOTIFY_CODE_FIRST] =
+			g_quark_from_static_string(notify_details[i].detail);
+	}
+
 	signal_manager_connect_signals(man);
 
 	return man;
@@ -174,10 +228,23 @@ static void on_document_save(GObject *geany_object, GeanyDocument *doc, SignalMa
 static gboolean on_editor_notify(GObject *geany_object, GeanyEditor *editor, SCNotification *nt, SignalManager *man)
 {
 	gboolean res = FALSE;
+	gint code = (gint) nt->nmhdr.code;
+	GQuark detail = 0;
 	PyObject *py_ed, *py_notif;
+
+	if (code >= NOTIFY_CODE_FIRST && code <= NOTIFY_CODE_LAST)
+		detail = man->notify_details[code - NOTIFY_CODE_FIRST];
+
+	/* Handlers connected without a detail match every detail, so this only
+	 * skips the notification if nobody at all is interested in it. Building
+	 * the Python objects is expensive, and most notifications are floods of
+	 * SCN_PAINTED and SCN_UPDATEUI. */
+	if (!g_signal_has_handler_pending(man->obj, man->editor_notify_id, detail, FALSE))
+		return FALSE;
+
 	py_ed = (PyObject *) Editor_create_new_from_geany_editor(editor);
 	py_notif = (PyObject *) Notification_create_new_from_scintilla_notification(nt);
-	g_signal_emit_by_name(man->obj, "editor-notify", py_ed, py_notif, &res);
+	g_signal_emit(man->obj, man->editor_notify_id, detail, py_ed, py_notif, &res);
 	Py_XDECREF(py_ed);
 	Py_XDECREF(py_notif);
 	return res;
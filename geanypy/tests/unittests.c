@@ -0,0 +1,245 @@
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+
+#include "geanypy.h"
+
+
+/* A stand-in for the Scintilla widget: a GObject with the "sci-notify" signal,
+ * whose text is reallocated on every edit, the way a growing document is. The
+ * old text is overwritten before it is freed, so reading it shows. */
+
+typedef struct
+{
+	GObject parent;
+	gchar *text;
+	gint length;
+} FakeSci;
+
+typedef GObjectClass FakeSciClass;
+
+static GType fake_sci_type = 0;
+
+
+static void
+fake_sci_finalize(GObject *object)
+{
+	g_free(((FakeSci *) object)->text);
+	G_OBJECT_CLASS(g_type_class_peek_parent(G_OBJECT_GET_CLASS(object)))->finalize(object);
+}
+
+
+static void
+fake_sci_class_init(GObjectClass *klass)
+{
+	klass->finalize = fake_sci_finalize;
+	g_signal_new("sci-notify", G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL,
+		g_cclosure_marshal_generic, G_TYPE_NONE, 2, G_TYPE_INT, G_TYPE_POINTER);
+}
+
+
+static ScintillaObject *
+fake_sci_new(const gchar *text)
+{
+	FakeSci *sci;
+
+	if (!fake_sci_type)
+	{
+		fake_sci_type = g_type_register_static_simple(G_TYPE_OBJECT, "FakeSci",
+			sizeof(FakeSciClass), (GClassInitFunc) fake_sci_class_init, sizeof(FakeSci), NULL, 0);
+	}
+	sci = g_object_new(fake_sci_type, NULL);
+	sci->text = g_strdup(text);
+	sci->length = strlen(text);
+	return (ScintillaObject *) sci;
+}
+
+
+static void
+fake_sci_insert(ScintillaObject *sci, gint pos, const gchar *text)
+{
+	FakeSci *fake = (FakeSci *) sci;
+	gint len = strlen(text);
+	gchar *grown = g_malloc(fake->length + len + 1);
+	SCNotification nt;
+
+	memcpy(grown, fake->text, pos);
+	memcpy(grown + pos, text, len);
+	memcpy(grown + pos + len, fake->text + pos, fake->length - pos + 1);
+	memset(fake->text, 'X', fake->length);
+	g_free(fake->text);
+	fake->text = grown;
+	fake->length += len;
+
+	memset(&nt, 0, sizeof nt);
+	nt.nmhdr.code = SCN_MODIFIED;
+	nt.modificationType = SC_MOD_INSERTTEXT;
+	nt.position = pos;
+	nt.length = len;
+	g_signal_emit_by_name(sci, "sci-notify", 0, &nt);
+}
+
+
+sptr_t
+scintilla_send_message(ScintillaObject *sci, unsigned int iMessage, uptr_t wParam, sptr_t lParam)
+{
+	FakeSci *fake = (FakeSci *) sci;
+
+	switch (iMessage)
+	{
+		case SCI_GETCHARACTERPOINTER: return (sptr_t) fake->text;
+		case SCI_GETLENGTH: return fake->length;
+	}
+	return 0;
+}
+
+
+gint
+sci_get_length(ScintillaObject *sci)
+{
+	return ((FakeSci *) sci)->length;
+}
+
+
+static gchar *
+get_range(ContentsView *view, gint start, gint end)
+{
+	PyObject *result = PyObject_CallMethod((PyObject *) view, "get_range", "ii", start, end);
+	gchar *text;
+
+	if (result == NULL)
+		return NULL;
+	text = g_strdup(PyString_AsString(result));
+	Py_DECREF(result);
+	return text;
+}
+
+
+static gboolean
+is_valid(ContentsView *view)
+{
+	PyObject *valid = PyObject_GetAttrString((PyObject *) view, "valid");
+	gboolean result = valid == Py_True;
+
+	Py_XDECREF(valid);
+	return result;
+}
+
+
+/* checks that the last call failed with RuntimeError, and clears it */
+static void
+check_stale_error(void)
+{
+	fail_unless(PyErr_Occurred() != NULL, "no exception raised");
+	fail_unless(PyErr_ExceptionMatches(PyExc_RuntimeError), "not a RuntimeError");
+	PyErr_Clear();
+}
+
+
+START_TEST(test_view_range)
+{
+	ScintillaObject *sci = fake_sci_new("hello, world");
+	ContentsView *view = ContentsView_create_new_from_scintilla(sci, 7, -1);
+	gchar *text;
+
+	fail_unless(view != NULL);
+	fail_unless(is_valid(view));
+	fail_unless(PyObject_Length((PyObject *) view) == 5);
+	text = get_range(view, 0, -1);
+	fail_unless(text && strcmp(text, "world") == 0, "got \"%s\"", text);
+	g_free(text);
+	text = get_range(view, 1, 3);
+	fail_unless(text && strcmp(text, "or") == 0, "got \"%s\"", text);
+	g_free(text);
+
+	Py_DECREF(view);
+	g_object_unref(sci);
+}
+END_TEST;
+
+
+/* a view taken before an edit that reallocates the text refuses to be read
+ * afterwards, while a memoryview taken before keeps reading its own copy */
+START_TEST(test_stale_view)
+{
+	ScintillaObject *sci = fake_sci_new("hello, world");
+	ContentsView *view = ContentsView_create_new_from_scintilla(sci, 0, 5);
+	PyObject *memory = PyMemoryView_FromObject((PyObject *) view);
+	PyObject *buffer = PyBuffer_FromObject((PyObject *) view, 0, Py_END_OF_BUFFER);
+	PyObject *bytes;
+
+	fail_unless(memory != NULL && buffer != NULL);
+	bytes = PyObject_Str(buffer);
+	fail_unless(bytes && strcmp(PyString_AsString(bytes), "hello") == 0);
+	Py_DECREF(bytes);
+
+	fake_sci_insert(sci, 0, "oh, ");
+	fail_unless(!is_valid(view));
+	fail_unless(PyObject_Length((PyObject *) view) == -1);
+	check_stale_error();
+	fail_unless(get_range(view, 0, -1) == NULL);
+	check_stale_error();
+	fail_unless(PyObject_Str(buffer) == NULL);
+	check_stale_error();
+	fail_unless(PyMemoryView_FromObject((PyObject *) view) == NULL);
+	check_stale_error();
+
+	bytes = PyObject_CallMethod(memory, "tobytes", NULL);
+	fail_unless(bytes && strcmp(PyString_AsString(bytes), "hello") == 0,
+		"memoryview reads \"%s\"", bytes ? PyString_AsString(bytes) : "");
+	Py_DECREF(bytes);
+
+	Py_DECREF(buffer);
+	Py_DECREF(memory);
+	Py_DECREF(view);
+	g_object_unref(sci);
+}
+END_TEST;
+
+
+START_TEST(test_destroyed_widget)
+{
+	ScintillaObject *sci = fake_sci_new("text");
+	ContentsView *view = ContentsView_create_new_from_scintilla(sci, 0, -1);
+
+	g_object_unref(sci);
+	fail_unless(!is_valid(view));
+	fail_unless(get_range(view, 0, -1) == NULL);
+	check_stale_error();
+	Py_DECREF(view);
+}
+END_TEST;
+
+Suite *
+my_suite(void)
+{
+	Suite *s = suite_create("GeanyPy");
+	TCase *tc_core = tcase_create("Core");
+	suite_add_tcase(s, tc_core);
+	tcase_add_test(tc_core, test_view_range);
+	tcase_add_test(tc_core, test_stale_view);
+	tcase_add_test(tc_core, test_destroyed_widget);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int nf;
+	Suite *s;
+	SRunner *sr;
+
+	Py_Initialize();
+	ContentsViewType.tp_new = PyType_GenericNew;
+	if (PyType_Ready(&ContentsViewType) < 0)
+		return EXIT_FAILURE;
+
+	s = my_suite();
+	sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	nf = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	Py_Finalize();
+	return (nf == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
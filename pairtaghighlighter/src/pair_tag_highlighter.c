@@ -13,9 +13,10 @@
 #include <string.h>
 #include "Scintilla.h"  /* for the SCNotification struct */
 #include "SciLexer.h"
+#include "tag_index.h"
 
 #define INDICATOR_TAGMATCH 9
-#define MAX_TAG_NAME 64
+#define TAG_INDEX_KEY "pair-tag-highlighter-index"
 
 #define MATCHING_PAIR_COLOR     0x00ff00    /* green */
 #define NONMATCHING_PAIR_COLOR  0xff0000    /* red */
@@ -37,77 +38,19 @@ PLUGIN_SET_TRANSLATABLE_INFO(LOCALEDIR, GETTEXT_PACKAGE, _("Pair Tag Highlighter
                             "1.1", "Volodymyr Kononenko <vm@kononenko.ws>")
 
 
-/* Searches tag brackets.
- * direction variable shows sets search direction:
- * TRUE  - to the right
- * FALSE - to the left
- * from the current cursor position to the start of the line.
- */
-static gint findBracket(ScintillaObject *sci, gint position, gint endOfSearchPos,
-                        gchar searchedBracket, gchar breakBracket, gboolean direction)
+/* The pointer stays valid until the document is modified. Scintilla closes
+ * its gap to return it, so it is only used to index a whole document. */
+static const gchar *get_document_text(ScintillaObject *sci)
 {
-    gint foundBracket = -1;
-    gint pos;
+    return (const gchar *) scintilla_send_message(sci, SCI_GETCHARACTERPOINTER, 0, 0);
+}
 
-    if(TRUE == direction)
-    {
-        /* search to the right */
-        for(pos=position; pos<=endOfSearchPos; pos++)
-        {
-            gchar charAtCurPosition = sci_get_char_at(sci, pos);
-            gchar charAtPrevPosition = sci_get_char_at(sci, pos-1);
-            gchar charAtNextPosition = sci_get_char_at(sci, pos+1);
-
-            if(charAtCurPosition == searchedBracket) {
-                if ('>' == searchedBracket) {
-                    if (('-' == charAtPrevPosition) || ('?' == charAtPrevPosition))
-                        continue;
-                } else if ('<' == searchedBracket) {
-                    if ('?' == charAtNextPosition)
-                        continue;
-                }
-                foundBracket = pos;
-                break;
-            } else if(charAtCurPosition == breakBracket) {
-                if ('<' == breakBracket) {
-                    if ('?' == charAtNextPosition)
-                        continue;
-                }
-                break;
-            }
-        }
-    }
-    else
-    {
-        /* search to the left */
-        for(pos=position-1; pos>=endOfSearchPos; pos--)
-        {
-            gchar charAtCurPosition = sci_get_char_at(sci, pos);
-            gchar charAtPrevPosition = sci_get_char_at(sci, pos+1);
-            gchar charAtNextPosition = sci_get_char_at(sci, pos-1);
-
-            if(charAtCurPosition == searchedBracket)
-            {
-                if ('<' == searchedBracket) {
-                    if ('?' == charAtPrevPosition)
-                        continue;
-                } else if ('>' == searchedBracket) {
-                    if (('-' == charAtNextPosition) || ('?' == charAtNextPosition))
-                        continue;
-                }
-                foundBracket = pos;
-                break;
-            } else if(charAtCurPosition == breakBracket) {
-                if ('>' == breakBracket) {
-                    if (('-' == charAtNextPosition) || ('?' == charAtNextPosition))
-                        continue;
-                }
-                break;
-            }
-        }
-    }
 
-    return foundBracket;
+/* Reads the part of the document an edit rescans, which only moves the gap
+ * if the range straddles it */
+static const gchar *get_char_range(gint start, gint length, gpointer sci)
+{
+    return (const gchar *) scintilla_send_message(sci, SCI_GETRANGEPOINTER, start, length);
 }
 
 
@@ -154,179 +97,33 @@ static void clear_previous_highlighting(ScintillaObject *sci, gint rangeStart, g
 }
 
 
-static gboolean is_tag_self_closing(ScintillaObject *sci, gint closingBracket)
+/* Returns the tag index of the document, scanning the document if needed */
+static TagIndex *get_tag_index(ScintillaObject *sci)
 {
-    gboolean isTagSelfClosing = FALSE;
-    gchar charBeforeBracket = sci_get_char_at(sci, closingBracket-1);
-
-    if('/' == charBeforeBracket)
-        isTagSelfClosing = TRUE;
-    return isTagSelfClosing;
-}
-
+    TagIndex *index = g_object_get_data(G_OBJECT(sci), TAG_INDEX_KEY);
 
-static gboolean is_tag_empty(gchar *tagName)
-{
-    const char *emptyTags[] = {"area", "base", "br", "col", "embed",
-                         "hr", "img", "input", "keygen", "link", "meta",
-                         "param", "source", "track", "wbr", "!DOCTYPE"};
-
-    int i;
-    for(i=0; i<(sizeof(emptyTags)/sizeof(emptyTags[0])); i++)
+    if(NULL == index)
     {
-        if(strcmp(tagName, emptyTags[i]) == 0)
-            return TRUE;
+        index = tag_index_new();
+        tag_index_build(index, get_document_text(sci), sci_get_length(sci));
+        g_object_set_data_full(G_OBJECT(sci), TAG_INDEX_KEY, index,
+                               (GDestroyNotify) tag_index_free);
     }
-
-    return FALSE;
-}
-
-
-static gboolean is_tag_opening(ScintillaObject *sci, gint openingBracket)
-{
-    gboolean isTagOpening = TRUE;
-    gchar charAfterBracket = sci_get_char_at(sci, openingBracket+1);
-
-    if('/' == charAfterBracket)
-        isTagOpening = FALSE;
-    return isTagOpening;
+    return index;
 }
 
 
-static void get_tag_name(ScintillaObject *sci, gint openingBracket, gint closingBracket,
-                    gchar tagName[], gboolean isTagOpening)
+static void update_tag_index(ScintillaObject *sci, SCNotification *nt)
 {
-    gint nameStart = openingBracket + (TRUE == isTagOpening ? 1 : 2);
-    gint nameEnd = nameStart;
-    gchar charAtCurPosition = sci_get_char_at(sci, nameStart);
+    TagIndex *index = g_object_get_data(G_OBJECT(sci), TAG_INDEX_KEY);
 
-    while(' ' != charAtCurPosition && '>' != charAtCurPosition &&
-        '\t' != charAtCurPosition && '\r' != charAtCurPosition && '\n' != charAtCurPosition)
+    if(NULL != index)
     {
-        charAtCurPosition = sci_get_char_at(sci, nameEnd);
-        nameEnd++;
-        if(nameEnd-nameStart > MAX_TAG_NAME)
-            break;
-    }
-    sci_get_text_range(sci, nameStart, nameEnd-1, tagName);
-}
-
+        gint inserted = (nt->modificationType & SC_MOD_INSERTTEXT) ? nt->length : 0;
+        gint deleted = (nt->modificationType & SC_MOD_DELETETEXT) ? nt->length : 0;
 
-static void findMatchingOpeningTag(ScintillaObject *sci, gchar *tagName, gint openingBracket)
-{
-    gint pos;
-    gint openingTagsCount = 0;
-    gint closingTagsCount = 1;
-
-    for(pos=openingBracket; pos>0; pos--)
-    {
-        /* are we inside tag? */
-        gint lineNumber = sci_get_line_from_position(sci, pos);
-        gint lineStart = sci_get_position_from_line(sci, lineNumber);
-        gint matchingOpeningBracket = findBracket(sci, pos, lineStart, '<', '\0', FALSE);
-        gint matchingClosingBracket = findBracket(sci, pos, lineStart, '>', '\0', FALSE);
-
-        if(-1 != matchingOpeningBracket && -1 != matchingClosingBracket
-            && (matchingClosingBracket > matchingOpeningBracket))
-        {
-            /* we are inside of some tag. Let us check what tag*/
-            gchar matchingTagName[MAX_TAG_NAME];
-            gboolean isMatchingTagOpening = is_tag_opening(sci, matchingOpeningBracket);
-            get_tag_name(sci, matchingOpeningBracket, matchingClosingBracket,
-                            matchingTagName, isMatchingTagOpening);
-            if(strcmp(tagName, matchingTagName) == 0)
-            {
-                if(TRUE == isMatchingTagOpening)
-                    openingTagsCount++;
-                else
-                    closingTagsCount++;
-            }
-            pos = matchingOpeningBracket+1;
-        }
-        /* Speed up search: if findBracket returns -1, that means start of line
-         * is reached. There is no need to go through the same positions again.
-         * Jump to the start of line */
-        else if(-1 == matchingOpeningBracket || -1 == matchingClosingBracket)
-        {
-            pos = lineStart;
-            continue;
-        }
-        if(openingTagsCount == closingTagsCount)
-        {
-            /* matching tag is found */
-            highlightedBrackets[2] = matchingOpeningBracket;
-            highlightedBrackets[3] = matchingClosingBracket;
-            highlight_matching_pair(sci);
-            return;
-        }
-    }
-    highlight_tag(sci, highlightedBrackets[0], highlightedBrackets[1],
-                  NONMATCHING_PAIR_COLOR);
-}
-
-
-static void findMatchingClosingTag(ScintillaObject *sci, gchar *tagName, gint closingBracket)
-{
-    gint pos;
-    gint linesInDocument = sci_get_line_count(sci);
-    gint endOfDocument = sci_get_position_from_line(sci, linesInDocument);
-    gint openingTagsCount = 1;
-    gint closingTagsCount = 0;
-
-    for(pos=closingBracket; pos<endOfDocument; pos++)
-    {
-        /* are we inside tag? */
-        gint lineNumber = sci_get_line_from_position(sci, pos);
-        gint lineEnd = sci_get_line_end_position(sci, lineNumber);
-        gint matchingOpeningBracket = findBracket(sci, pos, lineEnd, '<', '\0', TRUE);
-        gint matchingClosingBracket = findBracket(sci, pos, lineEnd, '>', '\0', TRUE);
-
-        if(-1 != matchingOpeningBracket && -1 != matchingClosingBracket
-            && (matchingClosingBracket > matchingOpeningBracket))
-        {
-            /* we are inside of some tag. Let us check what tag*/
-            gchar matchingTagName[64];
-            gboolean isMatchingTagOpening = is_tag_opening(sci, matchingOpeningBracket);
-            get_tag_name(sci, matchingOpeningBracket, matchingClosingBracket,
-                            matchingTagName, isMatchingTagOpening);
-            if(strcmp(tagName, matchingTagName) == 0)
-            {
-                if(TRUE == isMatchingTagOpening)
-                    openingTagsCount++;
-                else
-                    closingTagsCount++;
-            }
-            pos = matchingClosingBracket;
-        }
-
-        if(openingTagsCount == closingTagsCount)
-        {
-            /* matching tag is found */
-            highlightedBrackets[2] = matchingOpeningBracket;
-            highlightedBrackets[3] = matchingClosingBracket;
-            highlight_matching_pair(sci);
-            return;
-        }
-    }
-    highlight_tag(sci, highlightedBrackets[0], highlightedBrackets[1],
-                  NONMATCHING_PAIR_COLOR);
-}
-
-
-static void findMatchingTag(ScintillaObject *sci, gint openingBracket, gint closingBracket)
-{
-    gchar tagName[MAX_TAG_NAME];
-    gboolean isTagOpening = is_tag_opening(sci, openingBracket);
-
-    get_tag_name(sci, openingBracket, closingBracket, tagName, isTagOpening);
-
-    if(is_tag_self_closing(sci, closingBracket) || is_tag_empty(tagName)) {
-        highlight_tag(sci, openingBracket, closingBracket, EMPTY_TAG_COLOR);
-    } else {
-        if(isTagOpening)
-            findMatchingClosingTag(sci, tagName, closingBracket);
-        else
-            findMatchingOpeningTag(sci, tagName, openingBracket);
+        tag_index_update(index, get_char_range, sci, sci_get_length(sci),
+                         nt->position, inserted, deleted);
     }
 }
 
@@ -334,37 +131,52 @@ static void findMatchingTag(ScintillaObject *sci, gint openingBracket, gint clos
 static void run_tag_highlighter(ScintillaObject *sci)
 {
     gint position = sci_get_current_position(sci);
-    gint lineNumber = sci_get_current_line(sci);
-    gint lineStart = sci_get_position_from_line(sci, lineNumber);
-    gint lineEnd = sci_get_line_end_position(sci, lineNumber);
-    gint openingBracket = findBracket(sci, position, lineStart, '<', '>', FALSE);
-    gint closingBracket = findBracket(sci, position, lineEnd, '>', '<', TRUE);
+    TagIndex *index = get_tag_index(sci);
+    gint tag = tag_index_find_at(index, position);
+    const TagEntry *entry;
+    gint match;
     int i;
 
-    if(-1 == openingBracket || -1 == closingBracket)
+    if(-1 == tag)
     {
         clear_previous_highlighting(sci, highlightedBrackets[0], highlightedBrackets[1]);
         clear_previous_highlighting(sci, highlightedBrackets[2], highlightedBrackets[3]);
-        for(i=0; i<3; i++)
+        for(i=0; i<4; i++)
             highlightedBrackets[i] = 0;
         return;
     }
+    entry = tag_index_get(index, tag);
 
     /* If the cursor jumps from one tag into another, clear
      * previous highlighted tags*/
-    if(openingBracket != highlightedBrackets[0] ||
-        closingBracket != highlightedBrackets[1])
+    if(entry->start != highlightedBrackets[0] ||
+        entry->end != highlightedBrackets[1])
     {
         clear_previous_highlighting(sci, highlightedBrackets[0], highlightedBrackets[1]);
         clear_previous_highlighting(sci, highlightedBrackets[2], highlightedBrackets[3]);
     }
 
-    /* Don't run search on empty brackets <> */
-    if (closingBracket - openingBracket > 1) {
-        highlightedBrackets[0] = openingBracket;
-        highlightedBrackets[1] = closingBracket;
+    highlightedBrackets[0] = entry->start;
+    highlightedBrackets[1] = entry->end;
 
-        findMatchingTag(sci, openingBracket, closingBracket);
+    if(TAG_EMPTY == entry->kind)
+    {
+        highlight_tag(sci, entry->start, entry->end, EMPTY_TAG_COLOR);
+        return;
+    }
+
+    match = tag_index_get_match(index, tag);
+    if(-1 != match)
+    {
+        const TagEntry *matchEntry = tag_index_get(index, match);
+
+        highlightedBrackets[2] = matchEntry->start;
+        highlightedBrackets[3] = matchEntry->end;
+        highlight_matching_pair(sci);
+    }
+    else
+    {
+        highlight_tag(sci, entry->start, entry->end, NONMATCHING_PAIR_COLOR);
     }
 }
 
@@ -378,12 +190,19 @@ static gboolean on_editor_notify(GObject *obj, GeanyEditor *editor,
     lexer = sci_get_lexer(editor->sci);
     if((lexer != SCLEX_HTML) && (lexer != SCLEX_XML))
     {
+        /* drop the index, the filetype may have changed */
+        if(SCN_UPDATEUI == nt->nmhdr.code)
+            g_object_set_data(G_OBJECT(editor->sci), TAG_INDEX_KEY, NULL);
         return FALSE;
     }
 
     /* nmhdr is a structure containing information about the event */
     switch (nt->nmhdr.code)
     {
+        case SCN_MODIFIED:
+            if(nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT))
+                update_tag_index(editor->sci, nt);
+            break;
         case SCN_UPDATEUI:
             run_tag_highlighter(editor->sci);
             break;
@@ -409,10 +228,16 @@ void plugin_init(GeanyData *data)
 void plugin_cleanup(void)
 {
     GeanyDocument *doc = document_get_current();
+    guint i;
 
     if (doc)
     {
         clear_previous_highlighting(doc->editor->sci, highlightedBrackets[0], highlightedBrackets[1]);
         clear_previous_highlighting(doc->editor->sci, highlightedBrackets[2], highlightedBrackets[3]);
     }
+
+    foreach_document(i)
+    {
+        g_object_set_data(G_OBJECT(documents[i]->editor->sci), TAG_INDEX_KEY, NULL);
+    }
 }
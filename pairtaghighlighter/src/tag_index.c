@@ -0,0 +1,414 @@
+/*
+ * Pair Tag Highlighter
+ *
+ * index of the tags in a document, kept up to date from modifications
+ *
+ * Author:  Volodymyr Kononenko aka kvm
+ * Email:   vm@kononenko.ws
+ *
+ */
+
+#include <string.h>
+#include "tag_index.h"
+
+
+struct TagIndex
+{
+    TagEntry *tags;     /* sorted by position, never overlapping */
+    gint count;
+    gint size;
+    gboolean matchesValid;
+    GHashTable *nameIds;    /* tag name -> its id + 1 */
+    GPtrArray *names;       /* tag names by id, stored in nameChunk */
+    GStringChunk *nameChunk;
+    gint *lastOpening;  /* per tag name id, used while matching */
+    guint lastOpeningSize;
+};
+
+
+static void init_names(TagIndex *index)
+{
+    index->nameIds = g_hash_table_new(g_str_hash, g_str_equal);
+    index->names = g_ptr_array_new();
+    index->nameChunk = g_string_chunk_new(256);
+}
+
+
+static void free_names(TagIndex *index)
+{
+    g_hash_table_destroy(index->nameIds);
+    g_ptr_array_free(index->names, TRUE);
+    g_string_chunk_free(index->nameChunk);
+}
+
+
+TagIndex *tag_index_new(void)
+{
+    TagIndex *index = g_new0(TagIndex, 1);
+
+    init_names(index);
+    return index;
+}
+
+
+void tag_index_free(TagIndex *index)
+{
+    g_free(index->tags);
+    free_names(index);
+    g_free(index->lastOpening);
+    g_free(index);
+}
+
+
+/* Returns the id of tagName in this index, adding it if it is new. Ids are
+ * numbered from 0 without gaps, so they can index the matching table. */
+static guint intern_name(TagIndex *index, const gchar *tagName)
+{
+    gpointer id = g_hash_table_lookup(index->nameIds, tagName);
+    gchar *name;
+
+    if(NULL != id)
+        return GPOINTER_TO_UINT(id) - 1;
+
+    name = g_string_chunk_insert(index->nameChunk, tagName);
+    g_ptr_array_add(index->names, name);
+    g_hash_table_insert(index->nameIds, name, GUINT_TO_POINTER(index->names->len));
+    return index->names->len - 1;
+}
+
+
+/* Edits leave behind the names of tags that are gone. Once these outnumber
+ * the tags, the names still in use are interned again into fresh tables. */
+static void compact_names(TagIndex *index)
+{
+    GHashTable *oldIds = index->nameIds;
+    GPtrArray *oldNames = index->names;
+    GStringChunk *oldChunk = index->nameChunk;
+    gint i;
+
+    if(index->names->len <= 2 * (guint)index->count + 64)
+        return;
+
+    init_names(index);
+    for(i=0; i<index->count; i++)
+        index->tags[i].name = intern_name(index, g_ptr_array_index(oldNames, index->tags[i].name));
+
+    g_hash_table_destroy(oldIds);
+    g_ptr_array_free(oldNames, TRUE);
+    g_string_chunk_free(oldChunk);
+}
+
+
+static void reserve_tags(TagEntry **tags, gint *size, gint count)
+{
+    if(count > *size)
+    {
+        *size = MAX(count, MAX(2 * *size, 64));
+        *tags = g_renew(TagEntry, *tags, *size);
+    }
+}
+
+
+static gboolean is_tag_empty(const gchar *tagName)
+{
+    const char *emptyTags[] = {"area", "base", "br", "col", "embed",
+                         "hr", "img", "input", "keygen", "link", "meta",
+                         "param", "source", "track", "wbr", "!DOCTYPE"};
+
+    guint i;
+    for(i=0; i<G_N_ELEMENTS(emptyTags); i++)
+    {
+        if(strcmp(tagName, emptyTags[i]) == 0)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+
+/* Fills in tag from its text, from the opening '<' to the closing '>' */
+static void fill_tag(TagIndex *index, TagEntry *tag, const gchar *tagText,
+                     gint openingBracket, gint closingBracket)
+{
+    gchar tagName[MAX_TAG_NAME];
+    gint tagLength = closingBracket - openingBracket;
+    gboolean isTagOpening = ('/' != tagText[1]);
+    gint nameStart = isTagOpening ? 1 : 2;
+    gint nameEnd = nameStart;
+
+    while(nameEnd < tagLength && nameEnd - nameStart < MAX_TAG_NAME - 1)
+    {
+        gchar c = tagText[nameEnd];
+        if(' ' == c || '\t' == c || '\r' == c || '\n' == c || '/' == c)
+            break;
+        nameEnd++;
+    }
+    memcpy(tagName, tagText + nameStart, nameEnd - nameStart);
+    tagName[nameEnd - nameStart] = '\0';
+
+    tag->start = openingBracket;
+    tag->end = closingBracket;
+    tag->name = intern_name(index, tagName);
+    tag->match = -1;
+    tag->link = -1;
+    if('/' == tagText[tagLength-1] || is_tag_empty(tagName))
+        tag->kind = TAG_EMPTY;
+    else
+        tag->kind = isTagOpening ? TAG_OPENING : TAG_CLOSING;
+}
+
+
+/* The part of the document the scanner can see. Only the bytes around the
+ * scan are read, so an edit doesn't need the whole document in one piece. */
+typedef struct
+{
+    TagIndexReadFunc read;  /* NULL if window holds the whole document */
+    gpointer data;
+    gint length;            /* of the document */
+    const gchar *window;
+    gint windowStart;
+    gint windowEnd;
+} TagText;
+
+#define TEXT_AT(text, pos) ((text)->window[(pos) - (text)->windowStart])
+
+/* bytes read at least each time the scanner reaches the end of the window */
+#define SCAN_WINDOW 4096
+
+
+/* Makes the bytes in [start, end) of the document visible in the window */
+static void read_text(TagText *text, gint start, gint end)
+{
+    start = MAX(start, 0);
+    end = MIN(end, text->length);
+    if(NULL != text->window && start >= text->windowStart && end <= text->windowEnd)
+        return;
+
+    text->window = text->read(start, end - start, text->data);
+    text->windowStart = start;
+    text->windowEnd = end;
+}
+
+
+/* Scans text for tags starting at position from, appending them to tags.
+ * A tag is the last '<' before a '>', ignoring "<?" and "?>" of processing
+ * instructions and the "->" ending comments. Scanning stops after the
+ * first '>' at or after stopAfter, and the position of that '>' is
+ * returned, or length if the end of the text was reached. */
+static gint scan_tags(TagIndex *index, TagText *text, gint from, gint stopAfter,
+                      TagEntry **tags, gint *count, gint *size)
+{
+    gint length = text->length;
+    gint openingBracket = -1;
+    gint pos;
+
+    for(pos=from; pos<length; pos++)
+    {
+        gchar c;
+
+        /* keep the pending tag and the characters either side of pos in
+         * the window, reading more the longer the pending tag gets */
+        if(pos < text->windowStart + 1 || pos + 2 > text->windowEnd)
+        {
+            gint start = (-1 != openingBracket ? openingBracket : pos) - 1;
+            read_text(text, start, pos + 2 + MAX(SCAN_WINDOW, pos - start));
+        }
+        c = TEXT_AT(text, pos);
+
+        if('<' == c)
+        {
+            if(pos+1 < length && '?' == TEXT_AT(text, pos+1))
+                continue;
+            openingBracket = pos;
+        }
+        else if('>' == c)
+        {
+            if(pos > 0 && ('-' == TEXT_AT(text, pos-1) || '?' == TEXT_AT(text, pos-1)))
+                continue;
+            /* Don't index empty brackets <> */
+            if(-1 != openingBracket && pos - openingBracket > 1)
+            {
+                reserve_tags(tags, size, *count + 1);
+                fill_tag(index, &(*tags)[*count], &TEXT_AT(text, openingBracket),
+                         openingBracket, pos);
+                (*count)++;
+            }
+            openingBracket = -1;
+            if(pos >= stopAfter)
+                return pos;
+        }
+    }
+    return length;
+}
+
+
+void tag_index_build(TagIndex *index, const gchar *text, gint length)
+{
+    TagText wholeText = { NULL, NULL, length, text, 0, length };
+
+    index->count = 0;
+    index->matchesValid = FALSE;
+    g_hash_table_remove_all(index->nameIds);
+    g_ptr_array_set_size(index->names, 0);
+    g_string_chunk_clear(index->nameChunk);
+    scan_tags(index, &wholeText, 0, length, &index->tags, &index->count, &index->size);
+}
+
+
+/* Returns the first tag ending at or after position */
+static gint find_first_ending_after(TagIndex *index, gint position)
+{
+    gint low = 0, high = index->count;
+
+    while(low < high)
+    {
+        gint mid = low + (high - low) / 2;
+        if(index->tags[mid].end < position)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+
+/* Updates the index after inserted bytes replaced deleted bytes at position.
+ * The new document text, length bytes long, is read through read. Tags ending well before the change are left
+ * alone. Since every '>' resets the scanner, the text only needs to be
+ * rescanned up to the first '>' after the change whose preceding character
+ * was not touched; tags after that just move by the size of the change. */
+void tag_index_update(TagIndex *index, TagIndexReadFunc read, gpointer data,
+                      gint length, gint position, gint inserted, gint deleted)
+{
+    TagText text = { read, data, length, NULL, 0, 0 };
+    TagEntry *newTags = NULL;
+    gint newCount = 0, newSize = 0;
+    gint delta = inserted - deleted;
+    gint first, last, scanStart, stop, i;
+
+    first = find_first_ending_after(index, position - 1);
+    scanStart = first > 0 ? index->tags[first-1].end + 1 : 0;
+    stop = scan_tags(index, &text, scanStart, position + inserted + 1,
+                     &newTags, &newCount, &newSize);
+
+    if(stop >= length)
+        last = index->count;
+    else
+    {
+        last = first;
+        while(last < index->count && index->tags[last].end + delta <= stop)
+            last++;
+    }
+
+    /* replace the tags in [first, last) by the rescanned ones */
+    reserve_tags(&index->tags, &index->size, index->count - (last - first) + newCount);
+    if(index->count > last)
+        memmove(index->tags + first + newCount, index->tags + last,
+                (index->count - last) * sizeof(TagEntry));
+    if(newCount > 0)
+        memcpy(index->tags + first, newTags, newCount * sizeof(TagEntry));
+    index->count += newCount - (last - first);
+    g_free(newTags);
+
+    if(0 != delta)
+    {
+        for(i=first+newCount; i<index->count; i++)
+        {
+            index->tags[i].start += delta;
+            index->tags[i].end += delta;
+        }
+    }
+    index->matchesValid = FALSE;
+}
+
+
+gint tag_index_get_count(TagIndex *index)
+{
+    return index->count;
+}
+
+
+const TagEntry *tag_index_get(TagIndex *index, gint tag)
+{
+    g_return_val_if_fail(tag >= 0 && tag < index->count, NULL);
+    return &index->tags[tag];
+}
+
+
+const gchar *tag_index_get_name(TagIndex *index, gint tag)
+{
+    g_return_val_if_fail(tag >= 0 && tag < index->count, NULL);
+    return g_ptr_array_index(index->names, index->tags[tag].name);
+}
+
+
+/* Returns the tag the cursor at position is inside of, or -1 */
+gint tag_index_find_at(TagIndex *index, gint position)
+{
+    gint tag = find_first_ending_after(index, position);
+
+    if(tag < index->count && index->tags[tag].start < position)
+        return tag;
+    return -1;
+}
+
+
+/* Pairs every opening tag with the closing tag of the same name that
+ * balances it, the same way a stack of tags per name would. An edit can
+ * change the nesting of everything after it, so this goes through all the
+ * tags again, though not the text, the first time a pair is asked for. */
+static void compute_matches(TagIndex *index)
+{
+    gint i;
+
+    compact_names(index);
+    /* sized by the distinct names, which compacting may have made fewer */
+    if(index->names->len != index->lastOpeningSize)
+    {
+        guint j;
+
+        index->lastOpening = g_renew(gint, index->lastOpening, index->names->len);
+        for(j=index->lastOpeningSize; j<index->names->len; j++)
+            index->lastOpening[j] = -1;
+        index->lastOpeningSize = index->names->len;
+    }
+
+    for(i=0; i<index->count; i++)
+    {
+        TagEntry *tag = &index->tags[i];
+
+        tag->match = -1;
+        if(TAG_EMPTY == tag->kind)
+            continue;
+        if(TAG_OPENING == tag->kind)
+        {
+            tag->link = index->lastOpening[tag->name];
+            index->lastOpening[tag->name] = i;
+        }
+        else if(-1 != index->lastOpening[tag->name])
+        {
+            gint opening = index->lastOpening[tag->name];
+
+            index->lastOpening[tag->name] = index->tags[opening].link;
+            index->tags[opening].match = i;
+            tag->match = opening;
+        }
+    }
+    /* leave the table clean for the next time */
+    for(i=0; i<index->count; i++)
+    {
+        if(TAG_EMPTY != index->tags[i].kind)
+            index->lastOpening[index->tags[i].name] = -1;
+    }
+    index->matchesValid = TRUE;
+}
+
+
+gint tag_index_get_match(TagIndex *index, gint tag)
+{
+    g_return_val_if_fail(tag >= 0 && tag < index->count, -1);
+
+    if(!index->matchesValid)
+        compute_matches(index);
+    return index->tags[tag].match;
+}
@@ -0,0 +1,54 @@
+/*
+ * Pair Tag Highlighter
+ *
+ * index of the tags in a document, kept up to date from modifications
+ *
+ * Author:  Volodymyr Kononenko aka kvm
+ * Email:   vm@kononenko.ws
+ *
+ */
+
+#ifndef TAG_INDEX_H
+#define TAG_INDEX_H
+
+#include <glib.h>
+
+#define MAX_TAG_NAME 64
+
+typedef enum
+{
+    TAG_OPENING,
+    TAG_CLOSING,
+    TAG_EMPTY       /* self-closing like <br/>, or an empty HTML element like <br> */
+} TagKind;
+
+typedef struct
+{
+    gint start;     /* position of the opening '<' */
+    gint end;       /* position of the closing '>' */
+    guint name;     /* id of the name, only meaningful within its index */
+    TagKind kind;
+    gint match;     /* index of the matching tag, -1 if none */
+    gint link;      /* previous unmatched opening tag with the same name */
+} TagEntry;
+
+typedef struct TagIndex TagIndex;
+
+/* Returns length bytes of the document from start, valid until the next call */
+typedef const gchar *(*TagIndexReadFunc)(gint start, gint length, gpointer data);
+
+
+TagIndex *tag_index_new(void);
+void tag_index_free(TagIndex *index);
+
+void tag_index_build(TagIndex *index, const gchar *text, gint length);
+void tag_index_update(TagIndex *index, TagIndexReadFunc read, gpointer data,
+                      gint length, gint position, gint inserted, gint deleted);
+
+gint tag_index_get_count(TagIndex *index);
+const TagEntry *tag_index_get(TagIndex *index, gint tag);
+const gchar *tag_index_get_name(TagIndex *index, gint tag);
+gint tag_index_find_at(TagIndex *index, gint position);
+gint tag_index_get_match(TagIndex *index, gint tag);
+
+#endif
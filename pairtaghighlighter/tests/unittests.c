@@ -0,0 +1,366 @@
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+
+#include <glib.h>
+#include "tag_index.h"
+
+
+static TagIndex *
+index_text(const gchar *text)
+{
+	TagIndex *index = tag_index_new();
+	tag_index_build(index, text, strlen(text));
+	return index;
+}
+
+
+/* Returns the index of the tag starting at start, or -1 */
+static gint
+tag_at(TagIndex *index, gint start)
+{
+	gint i;
+	for (i = 0; i < tag_index_get_count(index); i++)
+	{
+		if (tag_index_get(index, i)->start == start)
+			return i;
+	}
+	return -1;
+}
+
+
+static gint
+match_start(TagIndex *index, gint start)
+{
+	gint match = tag_index_get_match(index, tag_at(index, start));
+	return match == -1 ? -1 : tag_index_get(index, match)->start;
+}
+
+
+/* The document as tag_index_update() reads it, recording what was read */
+typedef struct
+{
+	const gchar *text;
+	gint length;
+	gint bytesRead;
+} Document;
+
+
+static const gchar *
+read_document(gint start, gint length, gpointer data)
+{
+	Document *doc = data;
+
+	fail_unless(start >= 0 && length >= 0 && start + length <= doc->length,
+		    "read %d bytes at %d of %d", length, start, doc->length);
+	doc->bytesRead += length;
+	return doc->text + start;
+}
+
+
+static gint
+update_index(TagIndex *index, const gchar *text, gint length,
+	     gint position, gint inserted, gint deleted)
+{
+	Document doc = { text, length, 0 };
+
+	tag_index_update(index, read_document, &doc, length, position, inserted, deleted);
+	return doc.bytesRead;
+}
+
+
+/* Compares an index kept up to date with one built from scratch for text */
+static void
+check_same(TagIndex *index, const gchar *text)
+{
+	TagIndex *fresh = index_text(text);
+	gint i;
+
+	fail_unless(tag_index_get_count(index) == tag_index_get_count(fresh),
+		    "\"%s\": expected %d tags, get %d", text,
+		    tag_index_get_count(fresh), tag_index_get_count(index));
+	for (i = 0; i < tag_index_get_count(fresh); i++)
+	{
+		const TagEntry *a = tag_index_get(index, i);
+		const TagEntry *b = tag_index_get(fresh, i);
+		fail_unless(a->start == b->start && a->end == b->end &&
+			    strcmp(tag_index_get_name(index, i), tag_index_get_name(fresh, i)) == 0 &&
+			    a->kind == b->kind,
+			    "\"%s\": tag %d differs", text, i);
+		fail_unless(tag_index_get_match(index, i) == tag_index_get_match(fresh, i),
+			    "\"%s\": match of tag %d differs", text, i);
+	}
+	tag_index_free(fresh);
+}
+
+
+/* Applies an edit to text and to the index, and compares the index with
+ * one built from scratch */
+static void
+check_edit(const gchar *text, gint position, gint deleted, const gchar *inserted)
+{
+	GString *str = g_string_new(text);
+	TagIndex *index = index_text(text);
+
+	g_string_erase(str, position, deleted);
+	g_string_insert(str, position, inserted);
+	update_index(index, str->str, str->len, position, strlen(inserted), deleted);
+	check_same(index, str->str);
+	tag_index_free(index);
+	g_string_free(str, TRUE);
+}
+
+
+START_TEST(test_nested_pairs)
+{
+	TagIndex *index = index_text("<div><div><p>x</p></div></div>");
+
+	fail_unless(tag_index_get_count(index) == 6);
+	fail_unless(match_start(index, 0) == 24);
+	fail_unless(match_start(index, 5) == 18);
+	fail_unless(match_start(index, 18) == 5);
+	fail_unless(match_start(index, 10) == 14);
+	tag_index_free(index);
+}
+
+END_TEST;
+
+START_TEST(test_self_closing)
+{
+	TagIndex *index = index_text("<p><br><img src=\"a\"/><div/><div /></p>");
+
+	fail_unless(tag_index_get(index, tag_at(index, 3))->kind == TAG_EMPTY);
+	fail_unless(tag_index_get(index, tag_at(index, 7))->kind == TAG_EMPTY);
+	fail_unless(tag_index_get(index, tag_at(index, 21))->kind == TAG_EMPTY);
+	fail_unless(tag_index_get(index, tag_at(index, 27))->kind == TAG_EMPTY);
+	fail_unless(match_start(index, 21) == -1);
+	/* self-closing tags don't take part in the nesting */
+	fail_unless(match_start(index, 0) == 34);
+	tag_index_free(index);
+}
+
+END_TEST;
+
+START_TEST(test_malformed)
+{
+	TagIndex *index;
+
+	/* unclosed and stray closing tags */
+	index = index_text("<div><p>a</div></p></i>");
+	fail_unless(match_start(index, 0) == 9);
+	fail_unless(match_start(index, 5) == 15);
+	fail_unless(match_start(index, 19) == -1);
+	tag_index_free(index);
+
+	/* brackets that don't form tags */
+	index = index_text("a > b <c <d>< >e<>");
+	fail_unless(tag_index_get_count(index) == 2);
+	fail_unless(tag_at(index, 9) != -1);
+	fail_unless(tag_at(index, 12) != -1);
+	tag_index_free(index);
+
+	/* unterminated tag at the end */
+	index = index_text("<p>x</p><div class=");
+	fail_unless(tag_index_get_count(index) == 2);
+	tag_index_free(index);
+}
+
+END_TEST;
+
+START_TEST(test_processing_instructions)
+{
+	TagIndex *index = index_text("<p><?php echo 1 ?></p>");
+
+	fail_unless(tag_index_get_count(index) == 2);
+	fail_unless(match_start(index, 0) == 18);
+	tag_index_free(index);
+}
+
+END_TEST;
+
+START_TEST(test_find_at)
+{
+	TagIndex *index = index_text("ab<p>cd</p>");
+
+	fail_unless(tag_index_find_at(index, 2) == -1);
+	fail_unless(tag_index_find_at(index, 3) == 0);
+	fail_unless(tag_index_find_at(index, 4) == 0);
+	fail_unless(tag_index_find_at(index, 5) == -1);
+	fail_unless(tag_index_find_at(index, 8) == 1);
+	tag_index_free(index);
+}
+
+END_TEST;
+
+START_TEST(test_update)
+{
+	const gchar *text = "<ul>\n<li>one</li>\n<li>two</li>\n</ul>";
+
+	check_edit(text, 0, 0, "<html>");
+	check_edit(text, 5, 0, "<li>zero</li>\n");
+	check_edit(text, 5, 12, "");
+	check_edit(text, 9, 3, "1");
+	check_edit(text, 7, 0, " class=\"x\"");
+	check_edit(text, 4, 0, "<");
+	check_edit(text, 8, 1, "");
+	check_edit(text, 16, 0, "/");
+	check_edit(text, 15, 0, "-");
+	check_edit(text, 1, 0, "?");
+	check_edit(text, 0, strlen(text), "<p></p>");
+}
+
+END_TEST;
+
+START_TEST(test_update_random)
+{
+	const gchar chars[] = "<>/?-a b\n";
+	gint i, j;
+
+	srand(1);
+	for (i = 0; i < 2000; i++)
+	{
+		gchar text[40], inserted[4];
+		gint len = rand() % (sizeof(text) - 1);
+		gint position, deleted;
+
+		for (j = 0; j < len; j++)
+			text[j] = chars[rand() % (sizeof(chars) - 1)];
+		text[len] = '\0';
+		for (j = 0; j < (gint) sizeof(inserted) - 1; j++)
+			inserted[j] = chars[rand() % (sizeof(chars) - 1)];
+		inserted[rand() % sizeof(inserted)] = '\0';
+		position = rand() % (len + 1);
+		deleted = rand() % (len - position + 1);
+		check_edit(text, position, MIN(deleted, 3), inserted);
+	}
+}
+
+END_TEST;
+
+/* tag names are kept by the index, not interned for the life of the program */
+START_TEST(test_names)
+{
+	TagIndex *index = index_text("<div><ptl-unique-name></ptl-unique-name></div>");
+
+	fail_unless(strcmp(tag_index_get_name(index, 1), "ptl-unique-name") == 0);
+	fail_unless(match_start(index, 5) == 22);
+	fail_unless(g_quark_try_string("ptl-unique-name") == 0, "the name was interned globally");
+	tag_index_free(index);
+}
+
+END_TEST;
+
+/* typing a new name over and over leaves the names of the old ones behind,
+ * which mustn't upset the matching once they are dropped */
+START_TEST(test_names_replaced)
+{
+	GString *str = g_string_new("<div><p>text</p></div>");
+	TagIndex *index = index_text(str->str);
+	gchar *old = g_strdup("");
+	gint i;
+
+	for (i = 0; i < 1000; i++)
+	{
+		gchar *new = g_strdup_printf("<n%d></n%d>", i, i);
+
+		g_string_erase(str, 5, strlen(old));
+		g_string_insert(str, 5, new);
+		update_index(index, str->str, str->len, 5, strlen(new), strlen(old));
+		g_free(old);
+		old = new;
+		if (i % 7 == 0)
+			check_same(index, str->str);
+	}
+	check_same(index, str->str);
+	fail_unless(strcmp(tag_index_get_name(index, 1), "n999") == 0);
+	fail_unless(match_start(index, 0) == str->len - 6);
+	fail_unless(g_quark_try_string("n999") == 0, "the name was interned globally");
+
+	g_free(old);
+	tag_index_free(index);
+	g_string_free(str, TRUE);
+}
+
+END_TEST;
+
+/* an edit only reads the text around it, however long the document */
+START_TEST(test_update_reads_little)
+{
+	GString *str = g_string_new(NULL);
+	TagIndex *index;
+	gint i, position, bytesRead;
+
+	for (i = 0; i < 20000; i++)
+		g_string_append(str, "<li>item</li>\n");
+	index = index_text(str->str);
+
+	position = str->len / 2;
+	position = strchr(str->str + position, '\n') - str->str + 1;
+	g_string_insert(str, position, "<p>new</p>");
+	bytesRead = update_index(index, str->str, str->len, position, 10, 0);
+	fail_unless(bytesRead < 10000, "read %d bytes of %d", bytesRead, (gint) str->len);
+	check_same(index, str->str);
+
+	tag_index_free(index);
+	g_string_free(str, TRUE);
+}
+
+END_TEST;
+
+/* tags longer than what is read at a time */
+START_TEST(test_update_long_tag)
+{
+	GString *str = g_string_new("<div><a title=\"");
+	gint i;
+
+	for (i = 0; i < 30000; i++)
+		g_string_append_c(str, 'a' + i % 26);
+	g_string_append(str, "\">link</a></div>");
+
+	check_edit(str->str, 5, 0, "<p>");
+	check_edit(str->str, 20, 0, "x");
+	check_edit(str->str, 15000, 1, "");
+	check_edit(str->str, str->len - 17, 1, "");
+	check_edit(str->str, 7, 1, "");
+	check_edit(str->str, 5, 1, "");
+	g_string_free(str, TRUE);
+}
+
+END_TEST;
+
+Suite *
+my_suite(void)
+{
+	Suite *s = suite_create("PairTagHighlighter");
+	TCase *tc_core = tcase_create("tag_index");
+
+	suite_add_tcase(s, tc_core);
+	tcase_add_test(tc_core, test_nested_pairs);
+	tcase_add_test(tc_core, test_self_closing);
+	tcase_add_test(tc_core, test_malformed);
+	tcase_add_test(tc_core, test_processing_instructions);
+	tcase_add_test(tc_core, test_find_at);
+	tcase_add_test(tc_core, test_names);
+
+	TCase *tc_update = tcase_create("tag_index_update");
+	suite_add_tcase(s, tc_update);
+	tcase_add_test(tc_update, test_update);
+	tcase_add_test(tc_update, test_update_random);
+	tcase_add_test(tc_update, test_names_replaced);
+	tcase_add_test(tc_update, test_update_reads_little);
+	tcase_add_test(tc_update, test_update_long_tag);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int nf;
+	Suite *s = my_suite();
+	SRunner *sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	nf = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return (nf == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
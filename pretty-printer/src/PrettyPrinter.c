@@ -18,61 +18,77 @@
 
 #include "PrettyPrinter.h"
 
+/*======================= DEFINES ======================================================================*/
+
+#define SINK_CHUNK_SIZE 65536                                    /* the formatted XML is given to a sink in chunks of about this size */
+#define KEPT_CHARS 16                                            /* chars kept in the buffer after giving it to a sink, the formatting looks back at them */
+
+/*============================================ PRIVATE PROPERTIES ======================================*/
+
+/* those are variables that are shared by the functions of one pretty
+ * printing and shouldn't be altered. Each pretty printing has its own
+ * context, so that several can be done at the same time. */
+
+typedef struct
+{
+      int result;                                                /* result of the pretty printing */
+      char* xmlPrettyPrinted;                                    /* new buffer for the formatted XML */
+      int xmlPrettyPrintedLength;                                /* buffer size */
+      int xmlPrettyPrintedIndex;                                 /* buffer index (position of the next char to insert) */
+      const char* inputBuffer;                                   /* input buffer */
+      int inputBufferLength;                                     /* input buffer size */
+      int inputBufferIndex;                                      /* input buffer index (position of the next char to read into the input string) */
+      int currentDepth;                                          /* current depth (for indentation) */
+      char* currentNodeName;                                     /* current node name */
+      bool appendIndentation;                                    /* if the indentation must be added (with a line break before) */
+      bool lastNodeOpen;                                         /* defines if the last action was a not opening or not */
+      PrettyPrintingOptions* options;                            /* options of PrettyPrinting */
+      PrettyPrintingSink sink;                                   /* function receiving the formatted XML, NULL to keep it in the buffer */
+      void* sinkData;                                            /* data passed to the sink */
+}
+PrettyPrintingContext;
+
 /*======================= FUNCTIONS ====================================================================*/
 
 /* error reporting functions */
 static void PP_ERROR(const char* fmt, ...) G_GNUC_PRINTF(1,2);  /* prints an error message */
 
 /* xml pretty printing functions */
-static void putCharInBuffer(char charToAdd);                     /* put a char into the new char buffer */
-static void putCharsInBuffer(const char* charsToAdd);            /* put the chars into the new char buffer */
-static void putNextCharsInBuffer(int nbChars);                   /* put the next nbChars of the input buffer into the new buffer */
-static int readWhites(bool considerLineBreakAsWhite);            /* read the next whites into the input buffer */
-static char readNextChar(void);                                  /* read the next char into the input buffer; */
-static char getNextChar(void);                                   /* returns the next char but do not increase the input buffer index (use readNextChar for that) */
-static char getPreviousInsertedChar(void);                       /* returns the last inserted char into the new buffer */
-static bool isWhite(char c);                                     /* check if the specified char is a white */
-static bool isSpace(char c);                                     /* check if the specified char is a space */
-static bool isLineBreak(char c);                                 /* check if the specified char is a new line */
-static bool isQuote(char c);                                     /* check if the specified char is a quote (simple or double) */
-static int putNewLine(void);                                     /* put a new line into the new char buffer with the correct number of whites (indentation) */
-static bool isInlineNodeAllowed(void);                           /* check if it is possible to have an inline node */
-static bool isOnSingleLine(int skip, char stop1, char stop2);    /* check if the current node data is on one line (for inlining) */
-static void resetBackwardIndentation(bool resetLineBreak);       /* reset the indentation for the current depth (just reset the index in fact) */
+static int prettyPrint(PrettyPrintingContext* ctx, const char* xml, int length, PrettyPrintingOptions* ppOptions); /* process the pretty-printing with the context, the output buffer is allocated */
+static bool growBuffer(PrettyPrintingContext* ctx, int nbChars);                     /* grow the new char buffer so that nbChars more chars fit in */
+static void flushBuffer(PrettyPrintingContext* ctx);                                 /* give the new char buffer to the sink, if any, when it is big enough */
+static void putCharInBuffer(PrettyPrintingContext* ctx, char charToAdd);             /* put a char into the new char buffer */
+static void putCharsInBuffer(PrettyPrintingContext* ctx, const char* charsToAdd);    /* put the chars into the new char buffer */
+static void putBytesInBuffer(PrettyPrintingContext* ctx, const char* bytes, int nbBytes); /* put nbBytes chars into the new char buffer */
+static void putNextCharsInBuffer(PrettyPrintingContext* ctx, int nbChars);           /* put the next nbChars of the input buffer into the new buffer */
+static int readWhites(PrettyPrintingContext* ctx, bool considerLineBreakAsWhite);    /* read the next whites into the input buffer */
+static char readNextChar(PrettyPrintingContext* ctx);                                /* read the next char into the input buffer; */
+static char getNextChar(PrettyPrintingContext* ctx);                                 /* returns the next char but do not increase the input buffer index (use readNextChar for that) */
+static char getPreviousInsertedChar(PrettyPrintingContext* ctx);                     /* returns the last inserted char into the new buffer */
+static bool isWhite(char c);                                                         /* check if the specified char is a white */
+static bool isSpace(char c);                                                         /* check if the specified char is a space */
+static bool isLineBreak(char c);                                                     /* check if the specified char is a new line */
+static bool isQuote(char c);                                                         /* check if the specified char is a quote (simple or double) */
+static int putNewLine(PrettyPrintingContext* ctx);                                   /* put a new line into the new char buffer with the correct number of whites (indentation) */
+static bool isInlineNodeAllowed(PrettyPrintingContext* ctx);                         /* check if it is possible to have an inline node */
+static bool isOnSingleLine(PrettyPrintingContext* ctx, int skip, char stop1, char stop2); /* check if the current node data is on one line (for inlining) */
+static void resetBackwardIndentation(PrettyPrintingContext* ctx, bool resetLineBreak); /* reset the indentation for the current depth (just reset the index in fact) */
                                                              
 /* specific parsing functions */
-static int processElements(void);                                /* returns the number of elements processed */
-static void processElementAttribute(void);                       /* process on attribute of a node */
-static void processElementAttributes(void);                      /* process all the attributes of a node */
-static void processHeader(void);                                 /* process the header <?xml version="..." ?> */
-static void processNode(void);                                   /* process an XML node */
-static void processTextNode(void);                               /* process a text node */
-static void processComment(void);                                /* process a comment */
-static void processCDATA(void);                                  /* process a CDATA node */
-static void processDoctype(void);                                /* process a DOCTYPE node */
-static void processDoctypeElement(void);                         /* process a DOCTYPE ELEMENT node */
+static int processElements(PrettyPrintingContext* ctx);                              /* returns the number of elements processed */
+static void processElementAttribute(PrettyPrintingContext* ctx);                     /* process on attribute of a node */
+static void processElementAttributes(PrettyPrintingContext* ctx);                    /* process all the attributes of a node */
+static void processHeader(PrettyPrintingContext* ctx);                               /* process the header <?xml version="..." ?> */
+static void processNode(PrettyPrintingContext* ctx);                                 /* process an XML node */
+static void processTextNode(PrettyPrintingContext* ctx);                             /* process a text node */
+static void processComment(PrettyPrintingContext* ctx);                              /* process a comment */
+static void processCDATA(PrettyPrintingContext* ctx);                                /* process a CDATA node */
+static void processDoctype(PrettyPrintingContext* ctx);                              /* process a DOCTYPE node */
+static void processDoctypeElement(PrettyPrintingContext* ctx);                       /* process a DOCTYPE ELEMENT node */
 
 /* debug function */
-static void printError(const char *msg, ...) G_GNUC_PRINTF(1,2); /* just print a message like the printf method */
-static void printDebugStatus(void);                              /* just print some variables into the console for debugging */
-
-/*============================================ PRIVATE PROPERTIES ======================================*/
-
-/* those are variables that are shared by the functions and
- * shouldn't be altered. */
-
-static int result;                                                /* result of the pretty printing */
-static char* xmlPrettyPrinted;                                    /* new buffer for the formatted XML */
-static int xmlPrettyPrintedLength;                                /* buffer size */
-static int xmlPrettyPrintedIndex;                                 /* buffer index (position of the next char to insert) */
-static char* inputBuffer;                                         /* input buffer */
-static int inputBufferLength;                                     /* input buffer size */
-static int inputBufferIndex;                                      /* input buffer index (position of the next char to read into the input string) */
-static int currentDepth;                                          /* current depth (for indentation) */
-static char* currentNodeName;                                     /* current node name */
-static bool appendIndentation;                                /* if the indentation must be added (with a line break before) */
-static bool lastNodeOpen;                                     /* defines if the last action was a not opening or not */
-static PrettyPrintingOptions* options;                            /* options of PrettyPrinting */
+static void printError(PrettyPrintingContext* ctx, const char *msg, ...) G_GNUC_PRINTF(2,3); /* just print a message like the printf method */
+static void printDebugStatus(PrettyPrintingContext* ctx);                            /* just print some variables into the console for debugging */
 
 /*============================================ GENERAL FUNCTIONS =======================================*/
 
@@ -88,75 +104,118 @@ static void PP_ERROR(const char* fmt, ...)
 
 int processXMLPrettyPrinting(char** buffer, int* length, PrettyPrintingOptions* ppOptions)
 {
-    bool freeOptions;
+    PrettyPrintingContext context;
+    PrettyPrintingContext* ctx = &context;
     char* reallocated;
     
     /* empty buffer, nothing to process */
-    if (*length == 0) { return PRETTY_PRINTING_EMPTY_XML; }
     if (buffer == NULL || *buffer == NULL) { return PRETTY_PRINTING_EMPTY_XML; }
+    if (*length == 0) { return PRETTY_PRINTING_EMPTY_XML; }
+    
+    /* the formatted XML is kept in the buffer */
+    ctx->sink = NULL;
+    ctx->sinkData = NULL;
+    if (prettyPrint(ctx, *buffer, *length, ppOptions) == PRETTY_PRINTING_SYSTEM_ERROR) { return PRETTY_PRINTING_SYSTEM_ERROR; }
+    
+    /* close the buffer */
+    putCharInBuffer(ctx, '\0');
+    
+    /* adjust the final size */
+    reallocated = (char*)realloc(ctx->xmlPrettyPrinted, ctx->xmlPrettyPrintedIndex); 
+    if (reallocated == NULL) { PP_ERROR("Allocation error (reallocation size is %d)", ctx->xmlPrettyPrintedIndex); free(ctx->xmlPrettyPrinted); return PRETTY_PRINTING_SYSTEM_ERROR; }
+    ctx->xmlPrettyPrinted = reallocated;
+    
+    /* if success, then update the values */
+    if (ctx->result == PRETTY_PRINTING_SUCCESS)
+    {
+        free(*buffer);
+        *buffer = ctx->xmlPrettyPrinted;
+        *length = ctx->xmlPrettyPrintedIndex-2; /* the '\0' is not in the length */
+    }
+    /* else clean the other values */
+    else
+    {
+        free(ctx->xmlPrettyPrinted);
+    }
+    
+    /* and finally the result */
+    return ctx->result;
+}
+
+int processXMLPrettyPrintingToSink(const char* xml, int length, PrettyPrintingOptions* ppOptions, PrettyPrintingSink sink, void* sinkData)
+{
+    PrettyPrintingContext context;
+    PrettyPrintingContext* ctx = &context;
+    
+    /* empty buffer, nothing to process */
+    if (xml == NULL || length == 0) { return PRETTY_PRINTING_EMPTY_XML; }
+    
+    /* the formatted XML is given to the sink while processing */
+    ctx->sink = sink;
+    ctx->sinkData = sinkData;
+    if (prettyPrint(ctx, xml, length, ppOptions) == PRETTY_PRINTING_SYSTEM_ERROR) { return PRETTY_PRINTING_SYSTEM_ERROR; }
+    
+    /* the last chars */
+    if (ctx->result == PRETTY_PRINTING_SUCCESS && ctx->xmlPrettyPrintedIndex > 0)
+    {
+        sink(ctx->xmlPrettyPrinted, ctx->xmlPrettyPrintedIndex, sinkData);
+    }
+    
+    free(ctx->xmlPrettyPrinted);
+    return ctx->result;
+}
+
+int prettyPrint(PrettyPrintingContext* ctx, const char* xml, int length, PrettyPrintingOptions* ppOptions)
+{
+    bool freeOptions;
     
     /* initialize the variables */
-    result = PRETTY_PRINTING_SUCCESS;
+    ctx->result = PRETTY_PRINTING_SUCCESS;
     freeOptions = FALSE;
     if (ppOptions == NULL) 
     { 
         ppOptions = createDefaultPrettyPrintingOptions(); 
+        if (ppOptions == NULL) { return PRETTY_PRINTING_SYSTEM_ERROR; }
         freeOptions = TRUE; 
     }
     
-    options = ppOptions;
-    currentNodeName = NULL;
-    appendIndentation = FALSE;
-    lastNodeOpen = FALSE;
-    xmlPrettyPrintedIndex = 0;
-    inputBufferIndex = 0;
-    currentDepth = -1;
+    ctx->options = ppOptions;
+    ctx->currentNodeName = NULL;
+    ctx->appendIndentation = FALSE;
+    ctx->lastNodeOpen = FALSE;
+    ctx->xmlPrettyPrintedIndex = 0;
+    ctx->inputBufferIndex = 0;
+    ctx->currentDepth = -1;
     
-    inputBuffer = *buffer;
-    inputBufferLength = *length;
+    ctx->inputBuffer = xml;
+    ctx->inputBufferLength = length;
     
-    xmlPrettyPrintedLength = *length;
-    xmlPrettyPrinted = (char*)malloc(sizeof(char)*(*length));
-    if (xmlPrettyPrinted == NULL) { PP_ERROR("Allocation error (initialisation)"); return PRETTY_PRINTING_SYSTEM_ERROR; }
+    /* a sink receives the XML in chunks, the buffer doesn't need to hold all of it */
+    ctx->xmlPrettyPrintedLength = length;
+    if (ctx->sink != NULL && ctx->xmlPrettyPrintedLength > SINK_CHUNK_SIZE) { ctx->xmlPrettyPrintedLength = SINK_CHUNK_SIZE; }
+    ctx->xmlPrettyPrinted = (char*)malloc(sizeof(char)*ctx->xmlPrettyPrintedLength);
+    if (ctx->xmlPrettyPrinted == NULL) 
+    { 
+        PP_ERROR("Allocation error (initialisation)"); 
+        if (freeOptions) { free(ppOptions); }
+        return PRETTY_PRINTING_SYSTEM_ERROR; 
+    }
     
     /* go to the first char */
-    readWhites(TRUE);
+    readWhites(ctx, TRUE);
 
     /* process the pretty-printing */
-    processElements();
-    
-    /* close the buffer */
-    putCharInBuffer('\0');
-    
-    /* adjust the final size */
-    reallocated = (char*)realloc(xmlPrettyPrinted, xmlPrettyPrintedIndex); 
-    if (reallocated == NULL) { PP_ERROR("Allocation error (reallocation size is %d)", xmlPrettyPrintedIndex); return PRETTY_PRINTING_SYSTEM_ERROR; }
-    xmlPrettyPrinted = reallocated;
+    processElements(ctx);
     
     /* freeing the unused values */
-    if (freeOptions) { free(options); }
-    
-    /* if success, then update the values */
-    if (result == PRETTY_PRINTING_SUCCESS)
-    {
-        free(*buffer);
-        *buffer = xmlPrettyPrinted;
-        *length = xmlPrettyPrintedIndex-2; /* the '\0' is not in the length */
-    }
-    /* else clean the other values */
-    else
-    {
-        free(xmlPrettyPrinted);
-    }
+    if (freeOptions) { free(ctx->options); }
     
     /* updating the pointers for the using into the caller function */
-    xmlPrettyPrinted = NULL; /* avoid reference */
-    inputBuffer = NULL; /* avoid reference */
-    currentNodeName = NULL; /* avoid reference */
-    options = NULL; /* avoid reference */
+    ctx->inputBuffer = NULL; /* avoid reference */
+    ctx->currentNodeName = NULL; /* avoid reference */
+    ctx->options = NULL; /* avoid reference */
     
-    /* and finally the result */
-    return result;
+    return ctx->result;
 }
 
 PrettyPrintingOptions* createDefaultPrettyPrintingOptions(void)
@@ -189,84 +248,107 @@ PrettyPrintingOptions* createDefaultPrettyPrintingOptions(void)
     return defaultOptions;
 }
 
-void putNextCharsInBuffer(int nbChars)
+bool growBuffer(PrettyPrintingContext* ctx, int nbChars)
 {
-    int i;
-    for (i=0 ; i<nbChars ; ++i)
-    {
-        char c = readNextChar();
-        putCharInBuffer(c);
+    char* reallocated;
+    int newLength = ctx->xmlPrettyPrintedLength*2;
+    
+    /* the size is doubled, so that a big output needs only a few reallocations */
+    if (newLength < ctx->xmlPrettyPrintedIndex+nbChars) { newLength = ctx->xmlPrettyPrintedIndex+nbChars; }
+    
+    reallocated = (char*)realloc(ctx->xmlPrettyPrinted, newLength);
+    if (reallocated == NULL) 
+    { 
+        PP_ERROR("Allocation error (reallocation size is %d)", newLength); 
+        ctx->result = PRETTY_PRINTING_SYSTEM_ERROR;
+        return FALSE; 
     }
+    
+    ctx->xmlPrettyPrinted = reallocated;
+    ctx->xmlPrettyPrintedLength = newLength;
+    return TRUE;
 }
 
-void putCharInBuffer(char charToAdd)
+void flushBuffer(PrettyPrintingContext* ctx)
+{
+    int flushed = ctx->xmlPrettyPrintedIndex-KEPT_CHARS;
+    if (ctx->sink == NULL || flushed < SINK_CHUNK_SIZE) { return; }
+    
+    /* the last chars can still be changed, so they are kept */
+    ctx->sink(ctx->xmlPrettyPrinted, flushed, ctx->sinkData);
+    memmove(ctx->xmlPrettyPrinted, ctx->xmlPrettyPrinted+flushed, KEPT_CHARS);
+    ctx->xmlPrettyPrintedIndex = KEPT_CHARS;
+}
+
+void putNextCharsInBuffer(PrettyPrintingContext* ctx, int nbChars)
+{
+    putBytesInBuffer(ctx, ctx->inputBuffer+ctx->inputBufferIndex, nbChars);
+    ctx->inputBufferIndex += nbChars;
+}
+
+void putCharInBuffer(PrettyPrintingContext* ctx, char charToAdd)
 {
     /* check if the buffer is full and reallocation if needed */
-    if (xmlPrettyPrintedIndex >= xmlPrettyPrintedLength)
-    {
-        char* reallocated;
-        
-        if (charToAdd == '\0') { ++xmlPrettyPrintedLength; }
-        else { xmlPrettyPrintedLength += inputBufferLength; }
-        reallocated = (char*)realloc(xmlPrettyPrinted, xmlPrettyPrintedLength);
-        if (reallocated == NULL) { PP_ERROR("Allocation error (char was %c)", charToAdd); return; }
-        xmlPrettyPrinted = reallocated;
-    }
+    if (ctx->xmlPrettyPrintedIndex >= ctx->xmlPrettyPrintedLength && !growBuffer(ctx, 1)) { return; }
     
     /* putting the char and increase the index for the next one */
-    xmlPrettyPrinted[xmlPrettyPrintedIndex] = charToAdd;
-    ++xmlPrettyPrintedIndex;
+    ctx->xmlPrettyPrinted[ctx->xmlPrettyPrintedIndex] = charToAdd;
+    ++ctx->xmlPrettyPrintedIndex;
 }
 
-void putCharsInBuffer(const char* charsToAdd)
+void putCharsInBuffer(PrettyPrintingContext* ctx, const char* charsToAdd)
 {
-    int currentIndex = 0;
-    while (charsToAdd[currentIndex] != '\0')
-    {
-        putCharInBuffer(charsToAdd[currentIndex]);
-        ++currentIndex;
-    }
+    putBytesInBuffer(ctx, charsToAdd, strlen(charsToAdd));
+}
+
+void putBytesInBuffer(PrettyPrintingContext* ctx, const char* bytes, int nbBytes)
+{
+    /* check if the buffer is full and reallocation if needed */
+    if (ctx->xmlPrettyPrintedIndex+nbBytes > ctx->xmlPrettyPrintedLength && !growBuffer(ctx, nbBytes)) { return; }
+    
+    memcpy(ctx->xmlPrettyPrinted+ctx->xmlPrettyPrintedIndex, bytes, nbBytes);
+    ctx->xmlPrettyPrintedIndex += nbBytes;
 }
 
-char getPreviousInsertedChar(void)
+char getPreviousInsertedChar(PrettyPrintingContext* ctx)
 {
-    return xmlPrettyPrinted[xmlPrettyPrintedIndex-1];
+    return ctx->xmlPrettyPrinted[ctx->xmlPrettyPrintedIndex-1];
 }
 
-int putNewLine(void)
+int putNewLine(PrettyPrintingContext* ctx)
 {
     int spaces;
     int i;
     
-    putCharsInBuffer(options->newLineChars);
-    spaces = currentDepth*options->indentLength;
+    putCharsInBuffer(ctx, ctx->options->newLineChars);
+    spaces = ctx->currentDepth*ctx->options->indentLength;
     for(i=0 ; i<spaces ; ++i)
     {
-        putCharInBuffer(options->indentChar);
+        putCharInBuffer(ctx, ctx->options->indentChar);
     }
     
     return spaces;
 }
 
-char getNextChar(void)
+char getNextChar(PrettyPrintingContext* ctx)
 {
-    return inputBuffer[inputBufferIndex];
+    return ctx->inputBuffer[ctx->inputBufferIndex];
 }
 
-char readNextChar(void)
+char readNextChar(PrettyPrintingContext* ctx)
 {   
-    return inputBuffer[inputBufferIndex++];
+    return ctx->inputBuffer[ctx->inputBufferIndex++];
 }
 
-int readWhites(bool considerLineBreakAsWhite)
+int readWhites(PrettyPrintingContext* ctx, bool considerLineBreakAsWhite)
 {
     int counter = 0;
-    while(isWhite(inputBuffer[inputBufferIndex]) && 
-          (!isLineBreak(inputBuffer[inputBufferIndex]) || 
+    while(isWhite(ctx->inputBuffer[ctx->inputBufferIndex]) && 
+          (!isLineBreak(ctx->inputBuffer[ctx->inputBufferIndex]) || 
            considerLineBreakAsWhite))
     {
         ++counter;
-        ++inputBufferIndex;
+        ++ctx->inputBufferIndex;
     }
     
     return counter;
@@ -296,7 +378,7 @@ bool isLineBreak(char c)
             c == '\r');
 }
 
-bool isInlineNodeAllowed(void)
+bool isInlineNodeAllowed(PrettyPrintingContext* ctx)
 {
     int firstChar;
     int secondChar;
@@ -305,14 +387,14 @@ bool isInlineNodeAllowed(void)
     char currentChar;
     
     /* the last action was not an opening => inline not allowed */
-    if (!lastNodeOpen) { return FALSE; }
+    if (!ctx->lastNodeOpen) { return FALSE; }
     
-    firstChar = getNextChar(); /* should be '<' or we are in a text node */
-    secondChar = inputBuffer[inputBufferIndex+1]; /* should be '!' */
-    thirdChar = inputBuffer[inputBufferIndex+2]; /* should be '-' or '[' */
+    firstChar = getNextChar(ctx); /* should be '<' or we are in a text node */
+    secondChar = ctx->inputBuffer[ctx->inputBufferIndex+1]; /* should be '!' */
+    thirdChar = ctx->inputBuffer[ctx->inputBufferIndex+2]; /* should be '-' or '[' */
     
     /* loop through the content up to the next opening/closing node */
-    currentIndex = inputBufferIndex+1;
+    currentIndex = ctx->inputBufferIndex+1;
     if (firstChar == '<')
     {
         char closingComment = '-';
@@ -331,7 +413,7 @@ bool isInlineNodeAllowed(void)
         currentIndex += 3; /* that bypass meanless chars */
         while (loop)
         {
-            char current = inputBuffer[currentIndex];
+            char current = ctx->inputBuffer[currentIndex];
             if (current == closingComment && oldChar == closingComment) { loop = FALSE; } /* end of comment/cdata */
             oldChar = current;
             ++currentIndex;
@@ -340,20 +422,20 @@ bool isInlineNodeAllowed(void)
         /* okay now avoid blanks */
         /*  inputBuffer[index] is now '>' */
         ++currentIndex;
-        while (isWhite(inputBuffer[currentIndex])) { ++currentIndex; }
+        while (isWhite(ctx->inputBuffer[currentIndex])) { ++currentIndex; }
     }
     else
     {
         /* this is a text node. Simply loop to the next '<' */
-        while (inputBuffer[currentIndex] != '<') { ++currentIndex; }
+        while (ctx->inputBuffer[currentIndex] != '<') { ++currentIndex; }
     }
     
     /* check what do we have now */
-    currentChar = inputBuffer[currentIndex];
+    currentChar = ctx->inputBuffer[currentIndex];
     if (currentChar == '<')
     {
         /* check if that is a closing node */
-        currentChar = inputBuffer[currentIndex+1];
+        currentChar = ctx->inputBuffer[currentIndex+1];
         if (currentChar == '/')
         {
             /* as we are in a correct XML (so far...), if the node is  */
@@ -366,20 +448,20 @@ bool isInlineNodeAllowed(void)
     return FALSE;
 }
 
-bool isOnSingleLine(int skip, char stop1, char stop2)
+bool isOnSingleLine(PrettyPrintingContext* ctx, int skip, char stop1, char stop2)
 {
-    int currentIndex = inputBufferIndex+skip; /* skip the n first chars (in comment <!--) */
+    int currentIndex = ctx->inputBufferIndex+skip; /* skip the n first chars (in comment <!--) */
     bool onSingleLine = TRUE;
     
-    char oldChar = inputBuffer[currentIndex];
-    char currentChar = inputBuffer[currentIndex+1];
+    char oldChar = ctx->inputBuffer[currentIndex];
+    char currentChar = ctx->inputBuffer[currentIndex+1];
     while(onSingleLine && oldChar != stop1 && currentChar != stop2)
     {
         onSingleLine = !isLineBreak(oldChar);
         
         ++currentIndex;
         oldChar = currentChar;
-        currentChar = inputBuffer[currentIndex+1];
+        currentChar = ctx->inputBuffer[currentIndex+1];
         
         /**
          * A line break inside the node has been reached. But we should check
@@ -396,7 +478,7 @@ bool isOnSingleLine(int skip, char stop1, char stop2)
               
                 ++currentIndex;
                 oldChar = currentChar;
-                currentChar = inputBuffer[currentIndex+1];
+                currentChar = ctx->inputBuffer[currentIndex+1];
             }
             
             /* the end of the node has been reached with only whites. Then
@@ -408,13 +490,13 @@ bool isOnSingleLine(int skip, char stop1, char stop2)
     return onSingleLine;
 }
 
-void resetBackwardIndentation(bool resetLineBreak)
+void resetBackwardIndentation(PrettyPrintingContext* ctx, bool resetLineBreak)
 {
-    xmlPrettyPrintedIndex -= (currentDepth*options->indentLength);
+    ctx->xmlPrettyPrintedIndex -= (ctx->currentDepth*ctx->options->indentLength);
     if (resetLineBreak) 
     { 
-        int len = strlen(options->newLineChars);
-        xmlPrettyPrintedIndex -= len; 
+        int len = strlen(ctx->options->newLineChars);
+        ctx->xmlPrettyPrintedIndex -= len; 
     }
 }
 
@@ -428,50 +510,53 @@ void resetBackwardIndentation(bool resetLineBreak)
 /*-----------------------------------------------------------------------------------------------------------------------------------------*/
 /*#########################################################################################################################################*/
 
-int processElements(void)
+int processElements(PrettyPrintingContext* ctx)
 {
     int counter = 0;
     bool loop = TRUE;
-    ++currentDepth;
-    while (loop && result == PRETTY_PRINTING_SUCCESS)
+    ++ctx->currentDepth;
+    while (loop && ctx->result == PRETTY_PRINTING_SUCCESS)
     {
         bool indentBackward;
         char nextChar;
         
+        /* nothing before the last chars will be changed anymore */
+        flushBuffer(ctx);
+        
         /* strip unused whites */
-        readWhites(TRUE);
+        readWhites(ctx, TRUE);
         
-        nextChar = getNextChar();
+        nextChar = getNextChar(ctx);
         if (nextChar == '\0') { return 0; } /* no more data to read */
         
         /* put a new line with indentation */
-        if (appendIndentation) { putNewLine(); }
+        if (ctx->appendIndentation) { putNewLine(ctx); }
         
         /* always append indentation (but need to store the state) */
-        indentBackward = appendIndentation;
-        appendIndentation = TRUE; 
+        indentBackward = ctx->appendIndentation;
+        ctx->appendIndentation = TRUE; 
         
         /* okay what do we have now ? */
         if (nextChar != '<')
         { 
             /* a simple text node */
-            processTextNode(); 
+            processTextNode(ctx); 
             ++counter; 
         } 
         else /* some more check are needed */
         {
-            nextChar = inputBuffer[inputBufferIndex+1];
+            nextChar = ctx->inputBuffer[ctx->inputBufferIndex+1];
             if (nextChar == '!') 
             {
-                char oneMore = inputBuffer[inputBufferIndex+2];
-                if (oneMore == '-') { processComment(); ++counter; } /* a comment */
-                else if (oneMore == '[') { processCDATA(); ++counter; } /* cdata */
-                else if (oneMore == 'D') { processDoctype(); ++counter; } /* doctype <!DOCTYPE ... > */
-                else if (oneMore == 'E') { processDoctypeElement(); ++counter; } /* doctype element <!ELEMENT ... > */
+                char oneMore = ctx->inputBuffer[ctx->inputBufferIndex+2];
+                if (oneMore == '-') { processComment(ctx); ++counter; } /* a comment */
+                else if (oneMore == '[') { processCDATA(ctx); ++counter; } /* cdata */
+                else if (oneMore == 'D') { processDoctype(ctx); ++counter; } /* doctype <!DOCTYPE ... > */
+                else if (oneMore == 'E') { processDoctypeElement(ctx); ++counter; } /* doctype element <!ELEMENT ... > */
                 else 
                 { 
-                    printError("processElements : Invalid char '%c' afer '<!'", oneMore); 
-                    result = PRETTY_PRINTING_INVALID_CHAR_ERROR; 
+                    printError(ctx, "processElements : Invalid char '%c' afer '<!'", oneMore); 
+                    ctx->result = PRETTY_PRINTING_INVALID_CHAR_ERROR; 
                 }
             } 
             else if (nextChar == '/')
@@ -481,65 +566,59 @@ int processElements(void)
                 if (indentBackward) 
                 { 
                     /* INDEX HACKING */
-                    xmlPrettyPrintedIndex -= options->indentLength; 
+                    ctx->xmlPrettyPrintedIndex -= ctx->options->indentLength; 
                 } 
             }
             else if (nextChar == '?')
             {
                 /* this is a header */
-                processHeader();
+                processHeader(ctx);
             }
             else 
             {
                 /* a new node is open */
-                processNode();
+                processNode(ctx);
                 ++counter;
             } 
         }
     }
     
-    --currentDepth;
+    --ctx->currentDepth;
     return counter;
 }
 
-void processElementAttribute(void)
+void processElementAttribute(PrettyPrintingContext* ctx)
 {
     char quote;
     char value;
-    /* process the attribute name */
-    char nextChar = readNextChar();
-    while (nextChar != '=')
-    {
-        putCharInBuffer(nextChar);
-        nextChar = readNextChar();
-    }
+    int start = ctx->inputBufferIndex;
     
-    putCharInBuffer(nextChar); /* that's the '=' */
+    /* process the attribute name, up to the '=' */
+    while (getNextChar(ctx) != '=' && getNextChar(ctx) != '\0') { ++ctx->inputBufferIndex; }
+    ++ctx->inputBufferIndex;
     
-    /* read the simple quote or double quote and put it into the buffer */
-    quote = readNextChar();
-    putCharInBuffer(quote); 
+    /* read the simple quote or double quote */
+    quote = readNextChar(ctx);
     
     /* process until the last quote */
-    value = readNextChar();
-    while(value != quote)
+    value = readNextChar(ctx);
+    while(value != quote && value != '\0')
     {
-        putCharInBuffer(value);
-        value = readNextChar();
+        value = readNextChar(ctx);
     }
     
-    /* simply add the last quote */
-    putCharInBuffer(quote);
+    /* the attribute is left untouched, so simply copy it */
+    putBytesInBuffer(ctx, ctx->inputBuffer+start, ctx->inputBufferIndex-start);
 }
 
-void processElementAttributes(void)
+void processElementAttributes(PrettyPrintingContext* ctx)
 {
     bool loop = TRUE;
-    char current = getNextChar(); /* should not be a white */
+    char current = getNextChar(ctx); /* should not be a white */
     if (isWhite(current)) 
     { 
-        printError("processElementAttributes : first char shouldn't be a white"); 
-        result = PRETTY_PRINTING_INVALID_CHAR_ERROR; 
+        printError(ctx, "processElementAttributes : first char shouldn't be a white"); 
+        ctx->result = PRETTY_PRINTING_INVALID_CHAR_ERROR; 
         return; 
     }
     
@@ -547,48 +626,48 @@ void processElementAttributes(void)
     {
         char next;
         
-        readWhites(TRUE); /* strip the whites */
+        readWhites(ctx, TRUE); /* strip the whites */
         
-        next = getNextChar(); /* don't read the last char (processed afterwards) */
+        next = getNextChar(ctx); /* don't read the last char (processed afterwards) */
         if (next == '/') { loop = FALSE; } /* end of node */
         else if (next == '>') { loop = FALSE; } /* end of tag */
         else if (next == '?') { loop = FALSE; } /* end of header */
         else 
         { 
-            putCharInBuffer(' '); /* put only one space to separate attributes */
-            processElementAttribute(); 
+            putCharInBuffer(ctx, ' '); /* put only one space to separate attributes */
+            processElementAttribute(ctx); 
         }
     }
 }
 
-void processHeader(void)
+void processHeader(PrettyPrintingContext* ctx)
 {
-    int firstChar = inputBuffer[inputBufferIndex]; /* should be '<' */
-    int secondChar = inputBuffer[inputBufferIndex+1]; /* must be '?' */
+    int firstChar = ctx->inputBuffer[ctx->inputBufferIndex]; /* should be '<' */
+    int secondChar = ctx->inputBuffer[ctx->inputBufferIndex+1]; /* must be '?' */
     
     if (firstChar != '<') 
     { 
         /* what ?????? invalid xml !!! */ 
-        printError("processHeader : first char should be '<' (not '%c')", firstChar); 
-        result = PRETTY_PRINTING_INVALID_CHAR_ERROR; return; 
+        printError(ctx, "processHeader : first char should be '<' (not '%c')", firstChar); 
+        ctx->result = PRETTY_PRINTING_INVALID_CHAR_ERROR; return; 
     }
     
     if (secondChar == '?')
     { 
         /* puts the '<' and '?' chars into the new buffer */
-        putNextCharsInBuffer(2); 
+        putNextCharsInBuffer(ctx, 2); 
         
-        while(!isWhite(getNextChar())) { putNextCharsInBuffer(1); }
+        while(!isWhite(getNextChar(ctx))) { putNextCharsInBuffer(ctx, 1); }
         
-        readWhites(TRUE);
-        processElementAttributes(); 
+        readWhites(ctx, TRUE);
+        processElementAttributes(ctx); 
         
         /* puts the '?' and '>' chars into the new buffer */
-        putNextCharsInBuffer(2); 
+        putNextCharsInBuffer(ctx, 2); 
     }
 }
 
-void processNode(void)
+void processNode(PrettyPrintingContext* ctx)
 {
     char closeChar;
     int subElementsProcessed = 0;
@@ -596,22 +675,22 @@ void processNode(void)
     char* nodeName;
     int nodeNameLength = 0;
     int i;
-    int opening = readNextChar();
+    int opening = readNextChar(ctx);
     if (opening != '<') 
     { 
-        printError("processNode : The first char should be '<' (not '%c')", opening); 
-        result = PRETTY_PRINTING_INVALID_CHAR_ERROR; 
+        printError(ctx, "processNode : The first char should be '<' (not '%c')", opening); 
+        ctx->result = PRETTY_PRINTING_INVALID_CHAR_ERROR; 
         return; 
     }
     
-    putCharInBuffer(opening);
+    putCharInBuffer(ctx, opening);
     
     /* read the node name */
-    while (!isWhite(getNextChar()) && 
-           getNextChar() != '>' &&  /* end of the tag */
-           getNextChar() != '/') /* tag is being closed */
+    while (!isWhite(getNextChar(ctx)) && 
+           getNextChar(ctx) != '>' &&  /* end of the tag */
+           getNextChar(ctx) != '/') /* tag is being closed */
     {
-        putNextCharsInBuffer(1);
+        putNextCharsInBuffer(ctx, 1);
         ++nodeNameLength;
     }
 
@@ -621,76 +700,82 @@ void processNode(void)
     nodeName[nodeNameLength] = '\0';
     for (i=0 ; i<nodeNameLength ; ++i)
     {
-        int tempIndex = xmlPrettyPrintedIndex-nodeNameLength+i;
-        nodeName[i] = xmlPrettyPrinted[tempIndex];
+        int tempIndex = ctx->xmlPrettyPrintedIndex-nodeNameLength+i;
+        nodeName[i] = ctx->xmlPrettyPrinted[tempIndex];
     }
     
-    currentNodeName = nodeName; /* set the name for using in other methods */
-    lastNodeOpen = TRUE;
+    ctx->currentNodeName = nodeName; /* set the name for using in other methods */
+    ctx->lastNodeOpen = TRUE;
 
     /* process the attributes     */
-    readWhites(TRUE);
-    processElementAttributes();
+    readWhites(ctx, TRUE);
+    processElementAttributes(ctx);
     
     /* process the end of the tag */
     subElementsProcessed = 0;
-    nextChar = getNextChar(); /* should be either '/' or '>' */
+    nextChar = getNextChar(ctx); /* should be either '/' or '>' */
     if (nextChar == '/') /* the node is being closed immediatly */
     { 
         /* closing node directly */
-        if (options->emptyNodeStripping || !options->forceEmptyNodeSplit)
+        if (ctx->options->emptyNodeStripping || !ctx->options->forceEmptyNodeSplit)
         {
-            if (options->emptyNodeStrippingSpace) { putCharInBuffer(' '); }
-            putNextCharsInBuffer(2); 
+            if (ctx->options->emptyNodeStrippingSpace) { putCharInBuffer(ctx, ' '); }
+            putNextCharsInBuffer(ctx, 2); 
         }
         /* split the closing nodes */
         else
         {
-            readNextChar(); /* removing '/' */
-            readNextChar(); /* removing '>' */
+            readNextChar(ctx); /* removing '/' */
+            readNextChar(ctx); /* removing '>' */
             
-            putCharInBuffer('>');
-            if (!options->inlineText) 
+            putCharInBuffer(ctx, '>');
+            if (!ctx->options->inlineText) 
             {
                 /* no inline text => new line ! */
-                putNewLine(); 
+                putNewLine(ctx); 
             } 
             
-            putCharsInBuffer("</");
-            putCharsInBuffer(currentNodeName);
-            putCharInBuffer('>');
+            putCharsInBuffer(ctx, "</");
+            putCharsInBuffer(ctx, ctx->currentNodeName);
+            putCharInBuffer(ctx, '>');
         }
         
-        lastNodeOpen=FALSE; 
+        ctx->lastNodeOpen=FALSE; 
+        free(nodeName);
+        ctx->currentNodeName = NULL;
         return; 
     }
     else if (nextChar == '>') 
     { 
         /* the tag is just closed (maybe some content) */
-        putNextCharsInBuffer(1); 
-        subElementsProcessed = processElements();
+        putNextCharsInBuffer(ctx, 1); 
+        subElementsProcessed = processElements(ctx);
     } 
     else 
     { 
-        printError("processNode : Invalid character '%c'", nextChar);
-        result = PRETTY_PRINTING_INVALID_CHAR_ERROR; 
+        printError(ctx, "processNode : Invalid character '%c'", nextChar);
+        ctx->result = PRETTY_PRINTING_INVALID_CHAR_ERROR; 
+        free(nodeName);
+        ctx->currentNodeName = NULL;
         return; 
     }
     
     /* if the code reaches this area, then the processElements has been called and we must
      * close the opening tag */
-    closeChar = getNextChar();
+    closeChar = getNextChar(ctx);
     if (closeChar != '<') 
     { 
-        printError("processNode : Invalid character '%c' for closing tag (should be '<')", closeChar); 
-        result = PRETTY_PRINTING_INVALID_CHAR_ERROR; 
+        printError(ctx, "processNode : Invalid character '%c' for closing tag (should be '<')", closeChar); 
+        ctx->result = PRETTY_PRINTING_INVALID_CHAR_ERROR; 
+        free(nodeName);
+        ctx->currentNodeName = NULL;
         return; 
     }
     
     do
     {
-        closeChar = readNextChar();
-        putCharInBuffer(closeChar);
+        closeChar = readNextChar(ctx);
+        putCharInBuffer(ctx, closeChar);
     }
     while(closeChar != '>');
     
@@ -698,54 +783,54 @@ void processNode(void)
     if (subElementsProcessed == 0)
     {
         /* the node will be stripped */
-        if (options->emptyNodeStripping)
+        if (ctx->options->emptyNodeStripping)
         {
             /* because we have '<nodeName ...></nodeName>' */
-            xmlPrettyPrintedIndex -= nodeNameLength+4; 
-            resetBackwardIndentation(TRUE);
+            ctx->xmlPrettyPrintedIndex -= nodeNameLength+4; 
+            resetBackwardIndentation(ctx, TRUE);
             
-            if (options->emptyNodeStrippingSpace) { putCharInBuffer(' '); }
-            putCharsInBuffer("/>");
+            if (ctx->options->emptyNodeStrippingSpace) { putCharInBuffer(ctx, ' '); }
+            putCharsInBuffer(ctx, "/>");
         }
         /* the closing tag will be put on the same line */
-        else if (options->inlineText)
+        else if (ctx->options->inlineText)
         {
             /* correct the index because we have '</nodeName>' */
-            xmlPrettyPrintedIndex -= nodeNameLength+3; 
-            resetBackwardIndentation(TRUE);
+            ctx->xmlPrettyPrintedIndex -= nodeNameLength+3; 
+            resetBackwardIndentation(ctx, TRUE);
             
             /* rewrite the node name */
-            putCharsInBuffer("</");
-            putCharsInBuffer(currentNodeName);
-            putCharInBuffer('>');
+            putCharsInBuffer(ctx, "</");
+            putCharsInBuffer(ctx, ctx->currentNodeName);
+            putCharInBuffer(ctx, '>');
         }
     }
     
     /* the node is closed */
-    lastNodeOpen = FALSE;
+    ctx->lastNodeOpen = FALSE;
     
     /* freeeeeeee !!! */
     free(nodeName);
     nodeName = NULL;
-    currentNodeName = NULL;
+    ctx->currentNodeName = NULL;
 }
 
-void processComment(void)
+void processComment(PrettyPrintingContext* ctx)
 {
     char lastChar;
     bool loop = TRUE;
     char oldChar;
     bool inlineAllowed = FALSE;
-    if (options->inlineComment) { inlineAllowed = isInlineNodeAllowed(); }
-    if (inlineAllowed && !options->oneLineComment) { inlineAllowed = isOnSingleLine(4, '-', '-'); }
-    if (inlineAllowed) { resetBackwardIndentation(TRUE); }
+    if (ctx->options->inlineComment) { inlineAllowed = isInlineNodeAllowed(ctx); }
+    if (inlineAllowed && !ctx->options->oneLineComment) { inlineAllowed = isOnSingleLine(ctx, 4, '-', '-'); }
+    if (inlineAllowed) { resetBackwardIndentation(ctx, TRUE); }
     
-    putNextCharsInBuffer(4); /* add the chars '<!--' */
+    putNextCharsInBuffer(ctx, 4); /* add the chars '<!--' */
     
     oldChar = '-';
     while (loop)
     {
-        char nextChar = readNextChar();
+        char nextChar = readNextChar(ctx);
         if (oldChar == '-' && nextChar == '-') /* comment is being closed */
         {
             loop = FALSE;
@@ -753,107 +838,107 @@ void processComment(void)
         
         if (!isLineBreak(nextChar)) /* the comment simply continues */
         {
-            if (options->oneLineComment && isSpace(nextChar))
+            if (ctx->options->oneLineComment && isSpace(nextChar))
             {
                 /* removes all the unecessary spaces */
-                while(isSpace(getNextChar()))
+                while(isSpace(getNextChar(ctx)))
                 {
-                    nextChar = readNextChar();
+                    nextChar = readNextChar(ctx);
                 }
-                putCharInBuffer(' ');
+                putCharInBuffer(ctx, ' ');
                 oldChar = ' ';
             }
             else
             {
                 /* comment is left untouched */
-                putCharInBuffer(nextChar);
+                putCharInBuffer(ctx, nextChar);
                 oldChar = nextChar;
             }
             
-            if (!loop && options->alignComment) /* end of comment */
+            if (!loop && ctx->options->alignComment) /* end of comment */
             {
                 /* ensures the chars preceding the first '-' are all spaces (there are at least
                  * 5 spaces in front of the '-->' for the alignment with '<!--') */
-                bool onlySpaces = xmlPrettyPrinted[xmlPrettyPrintedIndex-3] == ' ' &&
-                                  xmlPrettyPrinted[xmlPrettyPrintedIndex-4] == ' ' &&
-                                  xmlPrettyPrinted[xmlPrettyPrintedIndex-5] == ' ' &&
-                                  xmlPrettyPrinted[xmlPrettyPrintedIndex-6] == ' ' &&
-                                  xmlPrettyPrinted[xmlPrettyPrintedIndex-7] == ' ';
+                bool onlySpaces = ctx->xmlPrettyPrinted[ctx->xmlPrettyPrintedIndex-3] == ' ' &&
+                                  ctx->xmlPrettyPrinted[ctx->xmlPrettyPrintedIndex-4] == ' ' &&
+                                  ctx->xmlPrettyPrinted[ctx->xmlPrettyPrintedIndex-5] == ' ' &&
+                                  ctx->xmlPrettyPrinted[ctx->xmlPrettyPrintedIndex-6] == ' ' &&
+                                  ctx->xmlPrettyPrinted[ctx->xmlPrettyPrintedIndex-7] == ' ';
                 
                 /* if all the preceding chars are white, then go for replacement */
                 if (onlySpaces)
                 {
-                    xmlPrettyPrintedIndex -= 7; /* remove indentation spaces */
-                    putCharsInBuffer("--"); /* reset the first chars of '-->' */
+                    ctx->xmlPrettyPrintedIndex -= 7; /* remove indentation spaces */
+                    putCharsInBuffer(ctx, "--"); /* reset the first chars of '-->' */
                 }
             }
         }
-        else if (!options->oneLineComment && !inlineAllowed) /* oh ! there is a line break */
+        else if (!ctx->options->oneLineComment && !inlineAllowed) /* oh ! there is a line break */
         {
             /* if the comments need to be aligned, just add 5 spaces */
-            if (options->alignComment) 
+            if (ctx->options->alignComment) 
             {
-                int read = readWhites(FALSE); /* strip the whites and new line */
-                if (nextChar == '\r' && read == 0 && getNextChar() == '\n') /* handles the \r\n return line */
+                int read = readWhites(ctx, FALSE); /* strip the whites and new line */
+                if (nextChar == '\r' && read == 0 && getNextChar(ctx) == '\n') /* handles the \r\n return line */
                 {
-                    readNextChar(); 
-                    readWhites(FALSE);
+                    readNextChar(ctx); 
+                    readWhites(ctx, FALSE);
                 }
               
-                putNewLine(); /* put a new indentation line */
-                putCharsInBuffer("     "); /* align with <!--  */
+                putNewLine(ctx); /* put a new indentation line */
+                putCharsInBuffer(ctx, "     "); /* align with <!--  */
                 oldChar = ' '; /* and update the last char */
             }
             else
             {
-                putCharInBuffer(nextChar);
+                putCharInBuffer(ctx, nextChar);
                 oldChar = nextChar;
             }
         }
         else /* the comments must be inlined */
         {
-            readWhites(TRUE); /* strip the whites and add a space if needed */
-            if (getPreviousInsertedChar() != ' ' &&
-                strncmp(xmlPrettyPrinted+xmlPrettyPrintedIndex-4, "<!--", 4) != 0) /* prevents adding a space at the beginning  */
+            readWhites(ctx, TRUE); /* strip the whites and add a space if needed */
+            if (getPreviousInsertedChar(ctx) != ' ' &&
+                strncmp(ctx->xmlPrettyPrinted+ctx->xmlPrettyPrintedIndex-4, "<!--", 4) != 0) /* prevents adding a space at the beginning  */
             { 
-                putCharInBuffer(' '); 
+                putCharInBuffer(ctx, ' '); 
                 oldChar = ' ';
             }
         }
     }
     
-    lastChar = readNextChar(); /* should be '>' */
+    lastChar = readNextChar(ctx); /* should be '>' */
     if (lastChar != '>') 
     { 
-        printError("processComment : last char must be '>' (not '%c')", lastChar); 
-        result = PRETTY_PRINTING_INVALID_CHAR_ERROR; 
+        printError(ctx, "processComment : last char must be '>' (not '%c')", lastChar); 
+        ctx->result = PRETTY_PRINTING_INVALID_CHAR_ERROR; 
         return; 
     }
-    putCharInBuffer(lastChar);
+    putCharInBuffer(ctx, lastChar);
     
-    if (inlineAllowed) { appendIndentation = FALSE; }
+    if (inlineAllowed) { ctx->appendIndentation = FALSE; }
     
     /* there vas no node open */
-    lastNodeOpen = FALSE;
+    ctx->lastNodeOpen = FALSE;
 }
 
-void processTextNode(void)
+void processTextNode(PrettyPrintingContext* ctx)
 {
     /* checks if inline is allowed */
     bool inlineTextAllowed = FALSE;
-    if (options->inlineText) { inlineTextAllowed = isInlineNodeAllowed(); }
-    if (inlineTextAllowed && !options->oneLineText) { inlineTextAllowed = isOnSingleLine(0, '<', '/'); }
-    if (inlineTextAllowed || !options->alignText) 
+    if (ctx->options->inlineText) { inlineTextAllowed = isInlineNodeAllowed(ctx); }
+    if (inlineTextAllowed && !ctx->options->oneLineText) { inlineTextAllowed = isOnSingleLine(ctx, 0, '<', '/'); }
+    if (inlineTextAllowed || !ctx->options->alignText) 
     { 
-        resetBackwardIndentation(TRUE); /* remove previous indentation */
-        if (!inlineTextAllowed) { putNewLine(); }
+        resetBackwardIndentation(ctx, TRUE); /* remove previous indentation */
+        if (!inlineTextAllowed) { putNewLine(ctx); }
     } 
    
     /* the leading whites are automatically stripped. So we re-add it */
-    if (!options->trimLeadingWhites)
+    if (!ctx->options->trimLeadingWhites)
     {
-        int backwardIndex = inputBufferIndex-1;
-        while (isSpace(inputBuffer[backwardIndex])) 
+        int backwardIndex = ctx->inputBufferIndex-1;
+        while (isSpace(ctx->inputBuffer[backwardIndex])) 
         { 
             --backwardIndex; /* backward rolling */
         } 
@@ -863,218 +948,226 @@ void processTextNode(void)
         ++backwardIndex;
         
         /* and then re-add the whites */
-        while (inputBuffer[backwardIndex] == ' ' || 
-               inputBuffer[backwardIndex] == '\t') 
+        while (ctx->inputBuffer[backwardIndex] == ' ' || 
+               ctx->inputBuffer[backwardIndex] == '\t') 
         {
-            putCharInBuffer(inputBuffer[backwardIndex]);
+            putCharInBuffer(ctx, ctx->inputBuffer[backwardIndex]);
             ++backwardIndex;
         }
     }
     
     /* process the text into the node */
-    while(getNextChar() != '<')
+    while(getNextChar(ctx) != '<')
     {
-        char nextChar = readNextChar();
+        char nextChar = readNextChar(ctx);
         if (isLineBreak(nextChar))
         {
-            if (options->oneLineText)
+            if (ctx->options->oneLineText)
             { 
-                readWhites(TRUE);
+                readWhites(ctx, TRUE);
               
                 /* as we can put text on one line, remove the line break 
                  * and replace it by a space but only if the previous 
                  * char wasn't a space */
-                if (getPreviousInsertedChar() != ' ') { putCharInBuffer(' '); }
+                if (getPreviousInsertedChar(ctx) != ' ') { putCharInBuffer(ctx, ' '); }
             }
-            else if (options->alignText)
+            else if (ctx->options->alignText)
             {
-                int read = readWhites(FALSE);
-                if (nextChar == '\r' && read == 0 && getNextChar() == '\n') /* handles the '\r\n' */
+                int read = readWhites(ctx, FALSE);
+                if (nextChar == '\r' && read == 0 && getNextChar(ctx) == '\n') /* handles the '\r\n' */
                 {
-                   nextChar = readNextChar();
-                   readWhites(FALSE);
+                   nextChar = readNextChar(ctx);
+                   readWhites(ctx, FALSE);
                 }
               
                 /* put a new line only if the closing tag is not reached */
-                if (getNextChar() != '<') 
+                if (getNextChar(ctx) != '<') 
                 {   
-                    putNewLine(); 
+                    putNewLine(ctx); 
                 } 
             }
             else
             {
-                putCharInBuffer(nextChar);
+                putCharInBuffer(ctx, nextChar);
             }
         }
         else
         {
-            putCharInBuffer(nextChar);
+            /* copy the text up to the next line break or tag at once */
+            int start = ctx->inputBufferIndex-1;
+            while (!isLineBreak(getNextChar(ctx)) && 
+                   getNextChar(ctx) != '<' && 
+                   getNextChar(ctx) != '\0')
+            {
+                ++ctx->inputBufferIndex;
+            }
+            putBytesInBuffer(ctx, ctx->inputBuffer+start, ctx->inputBufferIndex-start);
         }
     }
     
     /* strip the trailing whites */
-    if (options->trimTrailingWhites)
+    if (ctx->options->trimTrailingWhites)
     {
-        while(getPreviousInsertedChar() == ' ' || 
-              getPreviousInsertedChar() == '\t')
+        while(getPreviousInsertedChar(ctx) == ' ' || 
+              getPreviousInsertedChar(ctx) == '\t')
         {
-            --xmlPrettyPrintedIndex;
+            --ctx->xmlPrettyPrintedIndex;
         }
     }
     
     /* remove the indentation for the closing tag */
-    if (inlineTextAllowed) { appendIndentation = FALSE; }
+    if (inlineTextAllowed) { ctx->appendIndentation = FALSE; }
     
     /* there vas no node open */
-    lastNodeOpen = FALSE;
+    ctx->lastNodeOpen = FALSE;
 }
 
-void processCDATA(void)
+void processCDATA(PrettyPrintingContext* ctx)
 {
     char lastChar;
     bool loop = TRUE;
     char oldChar;
     bool inlineAllowed = FALSE;
-    if (options->inlineCdata) { inlineAllowed = isInlineNodeAllowed(); }
-    if (inlineAllowed && !options->oneLineCdata) { inlineAllowed = isOnSingleLine(9, ']', ']'); }
-    if (inlineAllowed) { resetBackwardIndentation(TRUE); }
+    if (ctx->options->inlineCdata) { inlineAllowed = isInlineNodeAllowed(ctx); }
+    if (inlineAllowed && !ctx->options->oneLineCdata) { inlineAllowed = isOnSingleLine(ctx, 9, ']', ']'); }
+    if (inlineAllowed) { resetBackwardIndentation(ctx, TRUE); }
     
-    putNextCharsInBuffer(9); /* putting the '<![CDATA[' into the buffer */
+    putNextCharsInBuffer(ctx, 9); /* putting the '<![CDATA[' into the buffer */
     
     oldChar = '[';
     while(loop)
     {
-        char nextChar = readNextChar();
-        char nextChar2 = getNextChar();
+        char nextChar = readNextChar(ctx);
+        char nextChar2 = getNextChar(ctx);
         if (oldChar == ']' && nextChar == ']' && nextChar2 == '>') { loop = FALSE; } /* end of cdata */
         
         if (!isLineBreak(nextChar)) /* the cdata simply continues */
         {
-            if (options->oneLineCdata && isSpace(nextChar))
+            if (ctx->options->oneLineCdata && isSpace(nextChar))
             {
                 /* removes all the unecessary spaces */
                 while(isSpace(nextChar2))
                 {
-                    nextChar = readNextChar();
-                    nextChar2 = getNextChar();
+                    nextChar = readNextChar(ctx);
+                    nextChar2 = getNextChar(ctx);
                 }
                 
-                putCharInBuffer(' ');
+                putCharInBuffer(ctx, ' ');
                 oldChar = ' ';
             }
             else
             {
                 /* comment is left untouched */
-                putCharInBuffer(nextChar);
+                putCharInBuffer(ctx, nextChar);
                 oldChar = nextChar;
             }
             
-            if (!loop && options->alignCdata) /* end of cdata */
+            if (!loop && ctx->options->alignCdata) /* end of cdata */
             {
                 /* ensures the chars preceding the first '-' are all spaces (there are at least
                  * 10 spaces in front of the ']]>' for the alignment with '<![CDATA[') */
-                bool onlySpaces = xmlPrettyPrinted[xmlPrettyPrintedIndex-3] == ' ' &&
-                                  xmlPrettyPrinted[xmlPrettyPrintedIndex-4] == ' ' &&
-                                  xmlPrettyPrinted[xmlPrettyPrintedIndex-5] == ' ' &&
-                                  xmlPrettyPrinted[xmlPrettyPrintedIndex-6] == ' ' &&
-                                  xmlPrettyPrinted[xmlPrettyPrintedIndex-7] == ' ' &&
-                                  xmlPrettyPrinted[xmlPrettyPrintedIndex-8] == ' ' &&
-                                  xmlPrettyPrinted[xmlPrettyPrintedIndex-9] == ' ' &&
-                                  xmlPrettyPrinted[xmlPrettyPrintedIndex-10] == ' ' &&
-                                  xmlPrettyPrinted[xmlPrettyPrintedIndex-11] == ' ';
+                bool onlySpaces = ctx->xmlPrettyPrinted[ctx->xmlPrettyPrintedIndex-3] == ' ' &&
+                                  ctx->xmlPrettyPrinted[ctx->xmlPrettyPrintedIndex-4] == ' ' &&
+                                  ctx->xmlPrettyPrinted[ctx->xmlPrettyPrintedIndex-5] == ' ' &&
+                                  ctx->xmlPrettyPrinted[ctx->xmlPrettyPrintedIndex-6] == ' ' &&
+                                  ctx->xmlPrettyPrinted[ctx->xmlPrettyPrintedIndex-7] == ' ' &&
+                                  ctx->xmlPrettyPrinted[ctx->xmlPrettyPrintedIndex-8] == ' ' &&
+                                  ctx->xmlPrettyPrinted[ctx->xmlPrettyPrintedIndex-9] == ' ' &&
+                                  ctx->xmlPrettyPrinted[ctx->xmlPrettyPrintedIndex-10] == ' ' &&
+                                  ctx->xmlPrettyPrinted[ctx->xmlPrettyPrintedIndex-11] == ' ';
                 
                 /* if all the preceding chars are white, then go for replacement */
                 if (onlySpaces)
                 {
-                    xmlPrettyPrintedIndex -= 11; /* remove indentation spaces */
-                    putCharsInBuffer("]]"); /* reset the first chars of '-->' */
+                    ctx->xmlPrettyPrintedIndex -= 11; /* remove indentation spaces */
+                    putCharsInBuffer(ctx, "]]"); /* reset the first chars of '-->' */
                 }
             }
         }
-        else if (!options->oneLineCdata && !inlineAllowed) /* line break */
+        else if (!ctx->options->oneLineCdata && !inlineAllowed) /* line break */
         {
             /* if the cdata need to be aligned, just add 9 spaces */
-            if (options->alignCdata) 
+            if (ctx->options->alignCdata) 
             {
-                int read = readWhites(FALSE); /* strip the whites and new line */
-                if (nextChar == '\r' && read == 0 && getNextChar() == '\n') /* handles the \r\n return line */
+                int read = readWhites(ctx, FALSE); /* strip the whites and new line */
+                if (nextChar == '\r' && read == 0 && getNextChar(ctx) == '\n') /* handles the \r\n return line */
                 {
-                    readNextChar(); 
-                    readWhites(FALSE);
+                    readNextChar(ctx); 
+                    readWhites(ctx, FALSE);
                 }
               
-                putNewLine(); /* put a new indentation line */
-                putCharsInBuffer("         "); /* align with <![CDATA[ */
+                putNewLine(ctx); /* put a new indentation line */
+                putCharsInBuffer(ctx, "         "); /* align with <![CDATA[ */
                 oldChar = ' '; /* and update the last char */
             }
             else
             {
-                putCharInBuffer(nextChar);
+                putCharInBuffer(ctx, nextChar);
                 oldChar = nextChar;
             }
         }
         else /* cdata are inlined */
         {
-            readWhites(TRUE); /* strip the whites and add a space if necessary */
-            if(getPreviousInsertedChar() != ' ' &&
-               strncmp(xmlPrettyPrinted+xmlPrettyPrintedIndex-9, "<![CDATA[", 9) != 0) /* prevents adding a space at the beginning  */
+            readWhites(ctx, TRUE); /* strip the whites and add a space if necessary */
+            if(getPreviousInsertedChar(ctx) != ' ' &&
+               strncmp(ctx->xmlPrettyPrinted+ctx->xmlPrettyPrintedIndex-9, "<![CDATA[", 9) != 0) /* prevents adding a space at the beginning  */
             { 
-                putCharInBuffer(' '); 
+                putCharInBuffer(ctx, ' '); 
                 oldChar = ' ';
             }
         }
     }
     
     /* if the cdata is inline, then all the trailing spaces are removed */
-    if (options->oneLineCdata)
+    if (ctx->options->oneLineCdata)
     {
-        xmlPrettyPrintedIndex -= 2; /* because of the last ']]' inserted */
-        while(isWhite(xmlPrettyPrinted[xmlPrettyPrintedIndex-1]))
+        ctx->xmlPrettyPrintedIndex -= 2; /* because of the last ']]' inserted */
+        while(isWhite(ctx->xmlPrettyPrinted[ctx->xmlPrettyPrintedIndex-1]))
         {
-            --xmlPrettyPrintedIndex;
+            --ctx->xmlPrettyPrintedIndex;
         }
-        putCharsInBuffer("]]");
+        putCharsInBuffer(ctx, "]]");
     }
     
     /* finalize the cdata */
-    lastChar = readNextChar(); /* should be '>' */
+    lastChar = readNextChar(ctx); /* should be '>' */
     if (lastChar != '>') 
     { 
-        printError("processCDATA : last char must be '>' (not '%c')", lastChar); 
-        result = PRETTY_PRINTING_INVALID_CHAR_ERROR; 
+        printError(ctx, "processCDATA : last char must be '>' (not '%c')", lastChar); 
+        ctx->result = PRETTY_PRINTING_INVALID_CHAR_ERROR; 
         return; 
     }
     
-    putCharInBuffer(lastChar);
+    putCharInBuffer(ctx, lastChar);
     
-    if (inlineAllowed) { appendIndentation = FALSE; }
+    if (inlineAllowed) { ctx->appendIndentation = FALSE; }
     
     /* there was no node open */
-    lastNodeOpen = FALSE;
+    ctx->lastNodeOpen = FALSE;
 }
 
-void processDoctype(void)
+void processDoctype(PrettyPrintingContext* ctx)
 {
     bool loop = TRUE;
     
-    putNextCharsInBuffer(9); /* put the '<!DOCTYPE' into the buffer */
+    putNextCharsInBuffer(ctx, 9); /* put the '<!DOCTYPE' into the buffer */
     
     while(loop)
     {
         int nextChar;
         
-        readWhites(TRUE);
-        putCharInBuffer(' '); /* only one space for the attributes */
+        readWhites(ctx, TRUE);
+        putCharInBuffer(ctx, ' '); /* only one space for the attributes */
         
-        nextChar = readNextChar();
+        nextChar = readNextChar(ctx);
         while(!isWhite(nextChar) && 
               !isQuote(nextChar) &&  /* begins a quoted text */
               nextChar != '=' && /* begins an attribute */
               nextChar != '>' &&  /* end of doctype */
               nextChar != '[') /* inner <!ELEMENT> types */
         {
-            putCharInBuffer(nextChar);
-            nextChar = readNextChar();
+            putCharInBuffer(ctx, nextChar);
+            nextChar = readNextChar(ctx);
         }
         
         if (isWhite(nextChar)) {} /* do nothing, just let the next loop do the job */
@@ -1084,13 +1177,13 @@ void processDoctype(void)
             
             if (nextChar == '=')
             {
-                putCharInBuffer(nextChar);
-                nextChar = readNextChar(); /* now we should have a quote */
+                putCharInBuffer(ctx, nextChar);
+                nextChar = readNextChar(ctx); /* now we should have a quote */
                 
                 if (!isQuote(nextChar)) 
                 { 
-                    printError("processDoctype : the next char should be a quote (not '%c')", nextChar); 
-                    result = PRETTY_PRINTING_INVALID_CHAR_ERROR; 
+                    printError(ctx, "processDoctype : the next char should be a quote (not '%c')", nextChar); 
+                    ctx->result = PRETTY_PRINTING_INVALID_CHAR_ERROR; 
                     return; 
                 }
             }
@@ -1099,33 +1192,33 @@ void processDoctype(void)
             quote = nextChar;
             do
             {
-                putCharInBuffer(nextChar);
-                nextChar = readNextChar();
+                putCharInBuffer(ctx, nextChar);
+                nextChar = readNextChar(ctx);
             }
             while (nextChar != quote);
-            putCharInBuffer(nextChar); /* now the last char is the last quote */
+            putCharInBuffer(ctx, nextChar); /* now the last char is the last quote */
         }
         else if (nextChar == '>') /* end of doctype */
         {
-            putCharInBuffer(nextChar);
+            putCharInBuffer(ctx, nextChar);
             loop = FALSE;
         }
         else /* the char is a '[' => not supported yet */
         {
-            printError("DOCTYPE inner ELEMENT is currently not supported by PrettyPrinter\n");
-            result = PRETTY_PRINTING_NOT_SUPPORTED_YET;
+            printError(ctx, "DOCTYPE inner ELEMENT is currently not supported by PrettyPrinter\n");
+            ctx->result = PRETTY_PRINTING_NOT_SUPPORTED_YET;
             loop = FALSE;
         }
     }
 }
 
-void processDoctypeElement(void)
+void processDoctypeElement(PrettyPrintingContext* ctx)
 {
-    printError("ELEMENT is currently not supported by PrettyPrinter\n");
-    result = PRETTY_PRINTING_NOT_SUPPORTED_YET;
+    printError(ctx, "ELEMENT is currently not supported by PrettyPrinter\n");
+    ctx->result = PRETTY_PRINTING_NOT_SUPPORTED_YET;
 }
 
-void printError(const char *msg, ...)
+void printError(PrettyPrintingContext* ctx, const char *msg, ...)
 {
     va_list va;
     va_start(va, msg);
@@ -1137,24 +1230,24 @@ void printError(const char *msg, ...)
     #endif
     va_end(va);
 
-    printDebugStatus();
+    printDebugStatus(ctx);
 }
 
-void printDebugStatus(void)
+void printDebugStatus(PrettyPrintingContext* ctx)
 {
     #ifdef HAVE_GLIB
     g_debug("\n===== INPUT =====\n%s\n=================\ninputLength = %d\ninputIndex = %d\noutputLength = %d\noutputIndex = %d\n", 
-            inputBuffer, 
-            inputBufferLength, 
-            inputBufferIndex,
-            xmlPrettyPrintedLength,
-            xmlPrettyPrintedIndex);
+            ctx->inputBuffer, 
+            ctx->inputBufferLength, 
+            ctx->inputBufferIndex,
+            ctx->xmlPrettyPrintedLength,
+            ctx->xmlPrettyPrintedIndex);
     #else
     PP_ERROR("\n===== INPUT =====\n%s\n=================\ninputLength = %d\ninputIndex = %d\noutputLength = %d\noutputIndex = %d\n", 
-            inputBuffer, 
-            inputBufferLength, 
-            inputBufferIndex,
-            xmlPrettyPrintedLength,
-            xmlPrettyPrintedIndex);
+            ctx->inputBuffer, 
+            ctx->inputBufferLength, 
+            ctx->inputBufferIndex,
+            ctx->xmlPrettyPrintedLength,
+            ctx->xmlPrettyPrintedIndex);
     #endif
 }
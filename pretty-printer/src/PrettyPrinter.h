@@ -82,9 +82,16 @@ typedef struct
 }
 PrettyPrintingOptions;
 
+/**
+ * A PrettyPrintingSink receives the formatted XML in chunks while it is 
+ * being processed. The data is not null-terminated.
+ */
+typedef void (*PrettyPrintingSink)(const char* data, int length, void* sinkData);
+
 /*========================================== FUNCTIONS =========================================================*/
 
 int processXMLPrettyPrinting(char** xml, int* length, PrettyPrintingOptions* ppOptions);    /* process the pretty-printing on a valid xml string (no check done !!!). The ppOptions ARE NOT FREE-ED after processing. The method returns 0 if the pretty-printing has been done. */
+int processXMLPrettyPrintingToSink(const char* xml, int length, PrettyPrintingOptions* ppOptions, PrettyPrintingSink sink, void* sinkData); /* same as processXMLPrettyPrinting, but the xml string is left untouched and the result is given to the sink while processing. The sink may have received a part of the result if an error is returned. */
 PrettyPrintingOptions* createDefaultPrettyPrintingOptions(void);                            /* creates a default PrettyPrintingOptions object */
 
 #endif
@@ -0,0 +1,326 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <check.h>
+
+#include <glib.h>
+#include "PrettyPrinter.h"
+
+
+#define SAMPLE_XML "<a><b>text</b><c></c><!-- x --></a>"
+
+#define THREADS 4
+#define THREAD_ITEMS 5000
+
+#define BENCHMARK_ITEMS 200000
+
+/* formats a copy of xml the way the plugin does, the result needs to be freed */
+static char* format(const char* xml, PrettyPrintingOptions* options, int* result)
+{
+    int length = strlen(xml)+1;
+    char* buffer = (char*)malloc(length);
+    
+    memcpy(buffer, xml, length);
+    *result = processXMLPrettyPrinting(&buffer, &length, options);
+    return buffer;
+}
+
+/* chunks given to a sink */
+typedef struct
+{
+    GString* text;
+    int chunks;
+}
+Collected;
+
+/* collects the chunks given to a sink */
+static void collect(const char* data, int length, void* sinkData)
+{
+    Collected* collected = (Collected*)sinkData;
+    
+    g_string_append_len(collected->text, data, length);
+    collected->chunks++;
+}
+
+/* generates an XML document with all the supported nodes */
+static GString* generate(int items, int seed)
+{
+    GString* xml = g_string_new("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<root>");
+    int i;
+    
+    for (i=0 ; i<items ; ++i)
+    {
+        g_string_append_printf(xml, "<item id=\"%d\" name='n%d'   kind=\"k%d\"><title>Title %d</title>", i, i, seed, i);
+        switch ((i+seed)%5)
+        {
+            case 0: g_string_append_printf(xml, "<!-- comment %d -->", i); break;
+            case 1: g_string_append_printf(xml, "<![CDATA[ raw <data> %d ]]>", i); break;
+            case 2: g_string_append(xml, "<empty></empty><e2/>"); break;
+            case 3: g_string_append(xml, "\n   some text\n   on lines  \n"); break;
+            case 4: g_string_append(xml, "<!--\n  multi\n  line\n     -->"); break;
+        }
+        g_string_append(xml, "</item>");
+    }
+    g_string_append(xml, "</root>");
+    
+    return xml;
+}
+
+START_TEST(test_format)
+{
+    int result;
+    char* formatted = format(SAMPLE_XML, NULL, &result);
+    
+    fail_unless(result == PRETTY_PRINTING_SUCCESS);
+    fail_unless(strcmp(formatted, "<a>\r\n  <b>text</b>\r\n  <c />\r\n  <!-- x -->\r\n</a>") == 0, "got %s", formatted);
+    free(formatted);
+}
+
+END_TEST;
+
+START_TEST(test_options)
+{
+    int result;
+    char* formatted;
+    PrettyPrintingOptions* options = createDefaultPrettyPrintingOptions();
+    
+    options->newLineChars = "\n";
+    options->indentChar = '\t';
+    options->indentLength = 1;
+    options->emptyNodeStripping = FALSE;
+    
+    formatted = format(SAMPLE_XML, options, &result);
+    fail_unless(result == PRETTY_PRINTING_SUCCESS);
+    fail_unless(strcmp(formatted, "<a>\n\t<b>text</b>\n\t<c></c>\n\t<!-- x -->\n</a>") == 0, "got %s", formatted);
+    
+    free(formatted);
+    free(options);
+}
+
+END_TEST;
+
+START_TEST(test_not_supported)
+{
+    int result;
+    const char* xml = "<!DOCTYPE a [<!ELEMENT a ANY>]><a/>";
+    char* formatted = format(xml, NULL, &result);
+    
+    /* the buffer is left untouched */
+    fail_unless(result == PRETTY_PRINTING_NOT_SUPPORTED_YET);
+    fail_unless(strcmp(formatted, xml) == 0);
+    free(formatted);
+}
+
+END_TEST;
+
+START_TEST(test_sink)
+{
+    GString* xml = generate(THREAD_ITEMS*4, 0);
+    Collected collected = { NULL, 0 };
+    int result;
+    char* formatted = format(xml->str, NULL, &result);
+    
+    fail_unless(result == PRETTY_PRINTING_SUCCESS);
+    
+    collected.text = g_string_new("");
+    result = processXMLPrettyPrintingToSink(xml->str, xml->len+1, NULL, collect, &collected);
+    fail_unless(result == PRETTY_PRINTING_SUCCESS);
+    
+    /* the same result, received in several chunks */
+    fail_unless(collected.chunks > 1);
+    fail_unless(strcmp(collected.text->str, formatted) == 0);
+    
+    free(formatted);
+    g_string_free(collected.text, TRUE);
+    g_string_free(xml, TRUE);
+}
+
+END_TEST;
+
+/* generates a document nested "depth" levels deep, with long names so that the formatting
+ * looks back further than the chars kept after a flush, and comments, CDATA, texts and empty
+ * nodes on every level. "shift" pads the root attribute, moving the flush points around */
+static GString* generate_nested(int depth, int shift)
+{
+    GString* xml = g_string_new("<?xml version=\"1.0\"?>\n<root pad=\"");
+    int i;
+    
+    for (i=0 ; i<shift ; ++i) { g_string_append_c(xml, 'p'); }
+    g_string_append(xml, "\">");
+    for (i=0 ; i<depth ; ++i)
+    {
+        g_string_append_printf(xml, "<nested_element_with_a_long_name_%d level=\"%d\">", i, i);
+        g_string_append_printf(xml, "<!-- comment at level %d -->", i);
+        g_string_append_printf(xml, "<![CDATA[ raw <data> at level %d ]]>", i);
+        g_string_append_printf(xml, "<text_node_with_a_long_name>text %d</text_node_with_a_long_name>", i);
+        g_string_append(xml, "<empty_node_with_a_long_name></empty_node_with_a_long_name>");
+        g_string_append(xml, "<!--\n  multi\n  line\n     -->");
+    }
+    for (i=depth-1 ; i>=0 ; --i)
+    {
+        g_string_append_printf(xml, "<![CDATA[ closing %d ]]><!-- closing %d -->", i, i);
+        g_string_append_printf(xml, "</nested_element_with_a_long_name_%d>", i);
+    }
+    g_string_append(xml, "</root>");
+    
+    return xml;
+}
+
+/* a deeply nested document, flushed several times at every possible offset
+ * near the comments and CDATA, gives the same result to a sink as in memory */
+START_TEST(test_sink_nested)
+{
+    PrettyPrintingOptions* options = createDefaultPrettyPrintingOptions();
+    int variant, shift;
+    
+    for (variant=0 ; variant<2 ; ++variant)
+    {
+        if (variant == 1)
+        {
+            options->newLineChars = "\n";
+            options->indentChar = '\t';
+            options->indentLength = 1;
+            options->emptyNodeStripping = FALSE;
+            options->inlineComment = FALSE;
+            options->inlineCdata = FALSE;
+        }
+        
+        for (shift=0 ; shift<64 ; ++shift)
+        {
+            GString* xml = generate_nested(150, shift);
+            Collected collected = { NULL, 0 };
+            int result;
+            char* formatted = format(xml->str, options, &result);
+            
+            fail_unless(result == PRETTY_PRINTING_SUCCESS);
+            
+            collected.text = g_string_new("");
+            result = processXMLPrettyPrintingToSink(xml->str, xml->len+1, options, collect, &collected);
+            fail_unless(result == PRETTY_PRINTING_SUCCESS);
+            fail_unless(collected.chunks > 2, "only %d chunks", collected.chunks);
+            fail_unless(strcmp(collected.text->str, formatted) == 0,
+                        "variant %d, shift %d: the sink result differs", variant, shift);
+            
+            free(formatted);
+            g_string_free(collected.text, TRUE);
+            g_string_free(xml, TRUE);
+        }
+    }
+    
+    free(options);
+}
+
+END_TEST;
+
+/* formats one of the generated documents, returning whether the result is the expected one */
+static gpointer formatting_thread_func(gpointer data)
+{
+    GString** documents = (GString**)data;
+    int result;
+    char* formatted = format(documents[0]->str, NULL, &result);
+    gboolean same = result == PRETTY_PRINTING_SUCCESS && strcmp(formatted, documents[1]->str) == 0;
+    
+    free(formatted);
+    return GINT_TO_POINTER(same);
+}
+
+START_TEST(test_threads)
+{
+    GString* documents[THREADS][2];
+    GThread* threads[THREADS];
+    int i;
+    
+    if (!g_thread_supported())
+        g_thread_init(NULL);
+    
+    /* expected results, formatted one after another */
+    for (i=0 ; i<THREADS ; ++i)
+    {
+        int result;
+        char* formatted;
+        
+        documents[i][0] = generate(THREAD_ITEMS, i);
+        formatted = format(documents[i][0]->str, NULL, &result);
+        fail_unless(result == PRETTY_PRINTING_SUCCESS);
+        documents[i][1] = g_string_new(formatted);
+        free(formatted);
+    }
+    
+    for (i=0 ; i<THREADS ; ++i)
+    {
+        threads[i] = g_thread_create(formatting_thread_func, documents[i], TRUE, NULL);
+    }
+    
+    for (i=0 ; i<THREADS ; ++i)
+    {
+        fail_unless(GPOINTER_TO_INT(g_thread_join(threads[i])), "thread %d result differs", i);
+        g_string_free(documents[i][0], TRUE);
+        g_string_free(documents[i][1], TRUE);
+    }
+}
+
+END_TEST;
+
+/* counts the chunks given to a sink */
+static void count(const char* data, int length, void* sinkData)
+{
+    *(long*)sinkData += length;
+}
+
+START_TEST(test_benchmark_throughput)
+{
+    GString* xml = generate(BENCHMARK_ITEMS, 0);
+    GTimer* timer = g_timer_new();
+    long total = 0;
+    int result;
+    char* formatted;
+    double elapsed;
+    
+    formatted = format(xml->str, NULL, &result);
+    elapsed = g_timer_elapsed(timer, NULL);
+    fail_unless(result == PRETTY_PRINTING_SUCCESS);
+    printf("%u bytes formatted in buffer at %.1f MB/s\n", (guint) xml->len, xml->len/elapsed/1e6);
+    
+    g_timer_start(timer);
+    result = processXMLPrettyPrintingToSink(xml->str, xml->len+1, NULL, count, &total);
+    elapsed = g_timer_elapsed(timer, NULL);
+    fail_unless(result == PRETTY_PRINTING_SUCCESS);
+    fail_unless(total == (long)strlen(formatted));
+    printf("%u bytes formatted to sink at %.1f MB/s\n", (guint) xml->len, xml->len/elapsed/1e6);
+    
+    free(formatted);
+    g_timer_destroy(timer);
+    g_string_free(xml, TRUE);
+}
+
+END_TEST;
+
+Suite *
+my_suite(void)
+{
+    Suite *s = suite_create("PrettyPrinter");
+    TCase *tc_core = tcase_create("Core");
+    tcase_set_timeout(tc_core, 60);
+    suite_add_tcase(s, tc_core);
+    tcase_add_test(tc_core, test_format);
+    tcase_add_test(tc_core, test_options);
+    tcase_add_test(tc_core, test_not_supported);
+    tcase_add_test(tc_core, test_sink);
+    tcase_add_test(tc_core, test_sink_nested);
+    tcase_add_test(tc_core, test_threads);
+    tcase_add_test(tc_core, test_benchmark_throughput);
+
+    return s;
+}
+
+int
+main(void)
+{
+    int nf;
+    Suite *s = my_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    nf = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (nf == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -856,48 +856,133 @@ static void break_relocate(GtkTreeIter *iter, const char *real_path, gint line)
 	g_free(location);
 }
 
-void breaks_delta(ScintillaObject *sci, const char *real_path, gint start, gint delta,
-	gboolean active)
-{
-	GtkTreeIter iter;
-	gboolean valid = scp_tree_store_get_iter_first(store, &iter);
+/* breakpoints by file and line, rebuilt on demand after the store changes */
+static LineMap *break_lines;
+static gboolean break_lines_valid = FALSE;
+static gboolean break_lines_moving = FALSE;
 
-	while (valid)
+static void on_break_lines_changed(G_GNUC_UNUSED GtkTreeModel *model)
+{
+	if (break_lines_valid && !break_lines_moving)
 	{
-		const char *file;
-		gint line;
-		gboolean enabled;
-		const char *location;
+		/* drop the references now, they would only slow down the store */
+		line_map_clear(break_lines);
+		break_lines_valid = FALSE;
+	}
+}
 
-		scp_tree_store_get(store, &iter, BREAK_FILE, &file, BREAK_LINE, &line,
-			BREAK_ENABLED, &enabled, BREAK_LOCATION, &location, -1);
+static void break_lines_update(void)
+{
+	if (!break_lines_valid)
+	{
+		GtkTreeIter iter;
+		gboolean valid = scp_tree_store_get_iter_first(store, &iter);
 
-		if (--line >= 0 && start <= line && !utils_filenamecmp(file, real_path))
+		while (valid)
 		{
-			if (active)
-			{
-				utils_move_mark(sci, line, start, delta, MARKER_BREAKPT + enabled);
-			}
-			else if (delta > 0 || start - delta <= line)
-			{
-				char *split = strchr(location, ':');
+			const char *file;
+			gint line;
 
-				line += delta + 1;
+			scp_tree_store_get(store, &iter, BREAK_FILE, &file, BREAK_LINE, &line, -1);
 
-				if (split && isdigit(split[1]))
-					break_relocate(&iter, real_path, line);
-				else
-					scp_tree_store_set(store, &iter, BREAK_LINE, line, -1);
-			}
-			else
+			if (file && --line >= 0)
 			{
-				sci_delete_marker_at_line(sci, start, MARKER_BREAKPT + enabled);
-				valid = scp_tree_store_remove(store, &iter);
-				continue;
+				GtkTreePath *path = scp_tree_store_get_path(store, &iter);
+
+				line_map_add(break_lines, file, line,
+					gtk_tree_row_reference_new(GTK_TREE_MODEL(store), path));
+				gtk_tree_path_free(path);
 			}
+
+			valid = scp_tree_store_iter_next(store, &iter);
 		}
 
-		valid = scp_tree_store_iter_next(store, &iter);
+		break_lines_valid = TRUE;
+	}
+}
+
+static gboolean break_lines_get_iter(GtkTreeIter *iter, GtkTreeRowReference *reference)
+{
+	GtkTreePath *path = gtk_tree_row_reference_get_path(reference);
+	gboolean valid = path && gtk_tree_model_get_iter(GTK_TREE_MODEL(store), iter, path);
+
+	gtk_tree_path_free(path);
+	return valid;
+}
+
+typedef struct _BreakDelta
+{
+	ScintillaObject *sci;
+	const char *real_path;
+	gint start;
+	gint delta;
+} BreakDelta;
+
+static void break_delta_mark(gint line, GtkTreeRowReference *reference, BreakDelta *bd)
+{
+	GtkTreeIter iter;
+
+	if (break_lines_get_iter(&iter, reference))
+	{
+		gboolean enabled;
+
+		scp_tree_store_get(store, &iter, BREAK_ENABLED, &enabled, -1);
+		utils_move_mark(bd->sci, line, bd->start, bd->delta, MARKER_BREAKPT + enabled);
+	}
+}
+
+static void break_delta_move(gint line, GtkTreeRowReference *reference, BreakDelta *bd)
+{
+	GtkTreeIter iter;
+
+	if (break_lines_get_iter(&iter, reference))
+	{
+		const char *location;
+		char *split;
+
+		scp_tree_store_get(store, &iter, BREAK_LOCATION, &location, -1);
+		split = strchr(location, ':');
+
+		if (split && isdigit(split[1]))
+			break_relocate(&iter, bd->real_path, line + 1);
+		else
+			scp_tree_store_set(store, &iter, BREAK_LINE, line + 1, -1);
+	}
+}
+
+static void break_delta_remove(G_GNUC_UNUSED gint line, GtkTreeRowReference *reference,
+	BreakDelta *bd)
+{
+	GtkTreeIter iter;
+
+	if (break_lines_get_iter(&iter, reference))
+	{
+		gboolean enabled;
+
+		scp_tree_store_get(store, &iter, BREAK_ENABLED, &enabled, -1);
+		sci_delete_marker_at_line(bd->sci, bd->start, MARKER_BREAKPT + enabled);
+		scp_tree_store_remove(store, &iter);
+	}
+}
+
+void breaks_delta(ScintillaObject *sci, const char *real_path, gint start, gint delta,
+	gboolean active)
+{
+	BreakDelta bd = { sci, real_path, start, delta };
+
+	break_lines_update();
+
+	if (active)
+	{
+		line_map_foreach(break_lines, real_path, start, (LineMapFunc) break_delta_mark,
+			&bd);
+	}
+	else
+	{
+		break_lines_moving = TRUE;
+		line_map_delta(break_lines, real_path, start, delta,
+			(LineMapFunc) break_delta_move, (LineMapFunc) break_delta_remove, &bd);
+		break_lines_moving = FALSE;
 	}
 }
 
@@ -1384,6 +1469,10 @@ void break_init(void)
 	view_set_sort_func(store, BREAK_ID, break_id_compare);
 	view_set_sort_func(store, BREAK_IGNORE, store_gint_compare);
 	view_set_sort_func(store, BREAK_LOCATION, break_location_compare);
+	break_lines = line_map_new((GDestroyNotify) gtk_tree_row_reference_free);
+	g_signal_connect(store, "row-inserted", G_CALLBACK(on_break_lines_changed), NULL);
+	g_signal_connect(store, "row-changed", G_CALLBACK(on_break_lines_changed), NULL);
+	g_signal_connect(store, "row-deleted", G_CALLBACK(on_break_lines_changed), NULL);
 
 	for (i = 0; i < EDITCOLS; i++)
 		block_cells[i] = get_object(break_cells[i + 1].name);
@@ -1404,4 +1493,5 @@ void break_init(void)
 void break_finalize(void)
 {
 	store_foreach(store, (GFunc) break_iter_unmark, NULL);
+	line_map_free(break_lines);
 }
@@ -27,18 +27,24 @@ typedef struct _MenuItem MenuItem;
 #define FRAME_ARGS '0' + (int) strlen(thread_id) - 1, thread_id, frame_id
 
 #include "break.h"
+#include "conbuf.h"
 #include "conterm.h"
 #include "debug.h"
+#include "delay.h"
 #include "gtk216.h"
 #include "inspect.h"
+#include "linemap.h"
 #include "local.h"
 #include "memory.h"
 #include "menu.h"
+#include "pagecache.h"
 #include "parse.h"
 #include "plugme.h"
 #include "prefs.h"
 #include "program.h"
+#include "recbuf.h"
 #include "register.h"
+#include "route.h"
 #include "stack.h"
 #include "scope.h"
 #include "store.h"
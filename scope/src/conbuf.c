@@ -0,0 +1,174 @@
+/*
+ *  conbuf.c
+ *
+ *  Copyright 2012 Dimitar Toshkov Zhekov <dimitar.zhekov@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "conbuf.h"
+
+/* pending console output: the text, split in runs of the same fd. Dropped lines are skipped
+   by advancing start instead of moving the rest of the text, so a flood of output costs a
+   single pass over it. */
+
+typedef struct _ConRun
+{
+	int fd;
+	gsize end;
+} ConRun;
+
+struct _ConBuf
+{
+	GString *text;
+	GArray *runs;
+	gsize start;       /* text before start is dropped */
+	guint first;       /* runs before first are dropped */
+	guint lines;       /* complete lines after start */
+	guint dropped;
+};
+
+ConBuf *con_buf_new(void)
+{
+	ConBuf *buf = g_new(ConBuf, 1);
+
+	buf->text = g_string_sized_new(0x1000);
+	buf->runs = g_array_new(FALSE, FALSE, sizeof(ConRun));
+	buf->start = 0;
+	buf->first = 0;
+	buf->lines = 0;
+	buf->dropped = 0;
+	return buf;
+}
+
+void con_buf_clear(ConBuf *buf)
+{
+	g_string_truncate(buf->text, 0);
+	g_array_set_size(buf->runs, 0);
+	buf->start = 0;
+	buf->first = 0;
+	buf->lines = 0;
+	buf->dropped = 0;
+}
+
+void con_buf_free(ConBuf *buf)
+{
+	g_string_free(buf->text, TRUE);
+	g_array_free(buf->runs, TRUE);
+	g_free(buf);
+}
+
+gboolean con_buf_empty(ConBuf *buf)
+{
+	return buf->start == buf->text->len && !buf->dropped;
+}
+
+static guint count_lines(const char *text, gsize length)
+{
+	const char *end = text + length;
+	guint lines = 0;
+
+	while ((text = memchr(text, '\n', end - text)) != NULL)
+	{
+		lines++;
+		text++;
+	}
+
+	return lines;
+}
+
+static void con_buf_drop(ConBuf *buf, guint count)
+{
+	const char *s = buf->text->str + buf->start;
+	const char *end = buf->text->str + buf->text->len;
+	ConRun *runs = (ConRun *) buf->runs->data;
+
+	buf->lines -= count;
+	buf->dropped += count;
+
+	while (count--)
+		s = (const char *) memchr(s, '\n', end - s) + 1;
+
+	buf->start = s - buf->text->str;
+
+	while (buf->first < buf->runs->len && runs[buf->first].end <= buf->start)
+		buf->first++;
+
+	if (buf->start >= 0x10000 && buf->start > buf->text->len / 2)
+	{
+		guint i;
+
+		g_string_erase(buf->text, 0, buf->start);
+		g_array_remove_range(buf->runs, 0, buf->first);
+		runs = (ConRun *) buf->runs->data;
+
+		for (i = 0; i < buf->runs->len; i++)
+			runs[i].end -= buf->start;
+
+		buf->start = 0;
+		buf->first = 0;
+	}
+}
+
+void con_buf_append(ConBuf *buf, int fd, const char *text, gint length, guint max_lines)
+{
+	guint count = buf->runs->len;
+
+	if (length == -1)
+		length = strlen(text);
+
+	if (!length)
+		return;
+
+	if (count > buf->first && g_array_index(buf->runs, ConRun, count - 1).fd == fd)
+		count--;
+	else
+		g_array_set_size(buf->runs, count + 1);
+
+	g_string_append_len(buf->text, text, length);
+	g_array_index(buf->runs, ConRun, count).fd = fd;
+	g_array_index(buf->runs, ConRun, count).end = buf->text->len;
+	buf->lines += count_lines(text, length);
+
+	if (max_lines && buf->lines > max_lines)
+		con_buf_drop(buf, buf->lines - max_lines);
+}
+
+guint con_buf_dropped(ConBuf *buf)
+{
+	return buf->dropped;
+}
+
+void con_buf_flush(ConBuf *buf, ConBufFunc func, gpointer gdata)
+{
+	gsize start = buf->start;
+	guint i;
+
+	for (i = buf->first; i < buf->runs->len; i++)
+	{
+		const ConRun *run = &g_array_index(buf->runs, ConRun, i);
+
+		if (run->end > start)
+		{
+			func(run->fd, buf->text->str + start, run->end - start, gdata);
+			start = run->end;
+		}
+	}
+
+	con_buf_clear(buf);
+}
@@ -0,0 +1,37 @@
+/*
+ *  conbuf.h
+ *
+ *  Copyright 2012 Dimitar Toshkov Zhekov <dimitar.zhekov@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONBUF_H
+
+typedef struct _ConBuf ConBuf;
+typedef void (*ConBufFunc)(int fd, const char *text, gint length, gpointer gdata);
+
+ConBuf *con_buf_new(void);
+void con_buf_clear(ConBuf *buf);
+void con_buf_free(ConBuf *buf);
+gboolean con_buf_empty(ConBuf *buf);
+/* drops the oldest complete lines while more than max_lines are pending, 0 = no limit */
+void con_buf_append(ConBuf *buf, int fd, const char *text, gint length, guint max_lines);
+/* lines dropped since the buffer was last flushed or cleared */
+guint con_buf_dropped(ConBuf *buf);
+/* calls func for each run of text with the same fd, in order, and clears the buffer */
+void con_buf_flush(ConBuf *buf, ConBufFunc func, gpointer gdata);
+
+#define CONBUF_H 1
+#endif
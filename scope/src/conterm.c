@@ -167,12 +167,14 @@ void on_vte_realize(VteTerminal *vte, G_GNUC_UNUSED gpointer gdata)
 
 static VteTerminal *debug_console = NULL;  /* NULL -> GtkTextView "context" */
 
-static void console_output(int fd, const char *text, gint length)
+static void console_write(int fd, const char *text, gint length,
+	G_GNUC_UNUSED gpointer gdata)
 {
 	static const char fd_colors[NFD] = { '6', '7', '1', '7', '5' };
 	static char setaf[5] = { '\033', '[', '3', '?', 'm' };
 	static int last_fd = -1;
-	gint i;
+	const char *end = text + length;
+	const char *s;
 
 	if (last_fd == 3 && fd != 0)
 		vte_terminal_feed(debug_console, "\r\n", 2);
@@ -184,39 +186,22 @@ static void console_output(int fd, const char *text, gint length)
 		last_fd = fd;
 	}
 
-	if (length == -1)
-		length = strlen(text);
-
-	for (i = 0; i < length; i++)
+	while ((s = memchr(text, '\n', end - text)) != NULL)
 	{
-		if (text[i] == '\n')
-		{
-			vte_terminal_feed(debug_console, text, i);
-			vte_terminal_feed(debug_console, "\r", 2);
-			length -= i;
-			text += i;
-			i = 0;
-		}
+		vte_terminal_feed(debug_console, text, s - text);
+		vte_terminal_feed(debug_console, "\r\n", 2);
+		text = s + 1;
 	}
 
-	vte_terminal_feed(debug_console, text, length);
-}
-
-static void console_output_nl(int fd, const char *text, gint length)
-{
-	dc_output(fd, text, length);
-	vte_terminal_feed(debug_console, "\r\n", 2);
+	vte_terminal_feed(debug_console, text, end - text);
 }
 #endif  /* G_OS_UNIX */
 
 static GtkTextView *debug_context;
 static GtkTextBuffer *context;
 static GtkTextTag *fd_tags[NFD];
-#define DC_LIMIT 32768  /* approx */
-#define DC_DELTA 6144
-static guint dc_chars = 0;
 
-void context_output(int fd, const char *text, gint length)
+static void context_write(int fd, const char *text, gint length, G_GNUC_UNUSED gpointer gdata)
 {
 	static int last_fd = -1;
 	GtkTextIter end;
@@ -230,10 +215,6 @@ void context_output(int fd, const char *text, gint length)
 	if (fd != last_fd)
 		last_fd = fd;
 
-	if (length == -1)
-		length = strlen(text);
-
-	dc_chars += length;
 	utf8 = g_locale_to_utf8(text, length, NULL, NULL, NULL);
 
 	if (utf8)
@@ -243,26 +224,76 @@ void context_output(int fd, const char *text, gint length)
 	}
 	else
 		gtk_text_buffer_insert_with_tags(context, &end, text, length, fd_tags[fd], NULL);
+}
+
+static void context_scroll(void)
+{
+	GtkTextIter end;
+	gint lines = gtk_text_buffer_get_line_count(context);
 
-	if (dc_chars > DC_LIMIT + (DC_DELTA / 2))
+	if (pref_debug_console_lines > 0 && lines > pref_debug_console_lines)
 	{
 		GtkTextIter start, delta;
 
 		gtk_text_buffer_get_start_iter(context, &start);
-		gtk_text_buffer_get_iter_at_offset(context, &delta, DC_DELTA);
+		gtk_text_buffer_get_iter_at_line(context, &delta, lines - pref_debug_console_lines);
 		gtk_text_buffer_delete(context, &start, &delta);
-		gtk_text_buffer_get_end_iter(context, &end);
-		dc_chars = gtk_text_buffer_get_char_count(context);
 	}
 
+	gtk_text_buffer_get_end_iter(context, &end);
 	gtk_text_buffer_place_cursor(context, &end);
-      gtk_text_view_scroll_mark_onscreen(debug_context, gtk_text_buffer_get_insert(context));
+	gtk_text_view_scroll_mark_onscreen(debug_context, gtk_text_buffer_get_insert(context));
+}
+
+/* The output is collected and written to the console on a timer, so that a flood of gdb
+   output does not block the main loop. If more than debug_console_lines arrive meanwhile,
+   the oldest ones are replaced by a marker. */
+static ConBuf *dc_buffer;
+static ConBufFunc dc_write;
+static guint dc_source_id = 0;
+
+static void dc_flush(void)
+{
+	guint dropped = con_buf_dropped(dc_buffer);
+
+	if (dropped)
+	{
+		char *marker = g_strdup_printf(_("[%u lines dropped]\n"), dropped);
+		dc_write(4, marker, strlen(marker), NULL);
+		g_free(marker);
+	}
+
+	con_buf_flush(dc_buffer, dc_write, NULL);
+#ifdef G_OS_UNIX
+	if (!debug_console)
+#endif
+		context_scroll();
+}
+
+static gboolean dc_flush_timeout(G_GNUC_UNUSED gpointer gdata)
+{
+	dc_source_id = 0;
+	dc_flush();
+	return FALSE;
+}
+
+static void dc_buffer_output(int fd, const char *text, gint length)
+{
+	con_buf_append(dc_buffer, fd, text, length, MAX(pref_debug_console_lines, 0));
+
+	if (pref_debug_console_delay <= 0)
+		dc_flush();
+	else if (!dc_source_id)
+	{
+		dc_source_id = plugin_timeout_add(geany_plugin, pref_debug_console_delay * 10,
+			dc_flush_timeout, NULL);
+	}
 }
 
-void context_output_nl(int fd, const char *text, gint length)
+static void dc_buffer_output_nl(int fd, const char *text, gint length)
 {
-	dc_output(fd, text, length);
-	dc_output(fd, "\n", 1);
+	dc_buffer_output(fd, text, length);
+	dc_buffer_output(fd, "\n", 1);
 }
 
 static gboolean on_console_button_3_press(G_GNUC_UNUSED GtkWidget *widget,
@@ -277,8 +308,8 @@ static gboolean on_console_button_3_press(G_GNUC_UNUSED GtkWidget *widget,
 	return FALSE;
 }
 
-void (*dc_output)(int fd, const char *text, gint length);
-void (*dc_output_nl)(int fd, const char *text, gint length);
+void (*dc_output)(int fd, const char *text, gint length) = dc_buffer_output;
+void (*dc_output_nl)(int fd, const char *text, gint length) = dc_buffer_output_nl;
 
 void dc_error(const char *format, ...)
 {
@@ -296,15 +327,20 @@ void dc_error(const char *format, ...)
 
 void dc_clear(void)
 {
+	con_buf_clear(dc_buffer);
+
+	if (dc_source_id)
+	{
+		g_source_remove(dc_source_id);
+		dc_source_id = 0;
+	}
+
 #ifdef G_OS_UNIX
 	if (debug_console)
 		vte_terminal_reset(debug_console, TRUE, TRUE);
 	else
 #endif
-	{
 		gtk_text_buffer_set_text(context, "", -1);
-		dc_chars = 0;
-	}
 }
 
 gboolean dc_update(void)
@@ -521,8 +557,7 @@ void conterm_init(void)
 		console = vte_terminal_new();
 		gtk_widget_show(console);
 		debug_console = VTE_TERMINAL(console);
-		dc_output = console_output;
-		dc_output_nl = console_output_nl;
+		dc_write = console_write;
 		g_signal_connect_after(debug_console, "realize", G_CALLBACK(on_vte_realize), NULL);
 		menu_connect("console_menu", &console_menu_info, console);
 	}
@@ -536,8 +571,7 @@ void conterm_init(void)
 		console = get_widget("debug_context");
 		context_apply_config(console);
 		debug_context = GTK_TEXT_VIEW(console);
-		dc_output = context_output;
-		dc_output_nl = context_output_nl;
+		dc_write = context_write;
 		context = gtk_text_view_get_buffer(debug_context);
 
 		for (i = 0; i < NFD; i++)
@@ -552,10 +586,15 @@ void conterm_init(void)
 
 	gtk_container_add(GTK_CONTAINER(get_widget("debug_window")), console);
 	g_signal_connect(console, "key-press-event", G_CALLBACK(on_console_key_press), NULL);
+	dc_buffer = con_buf_new();
 }
 
 void conterm_finalize(void)
 {
+	if (dc_source_id)
+		g_source_remove(dc_source_id);
+	con_buf_free(dc_buffer);
+
 #ifdef G_OS_UNIX
 	g_object_unref(program_terminal);
 	g_free(slave_pty_name);
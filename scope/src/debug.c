@@ -171,7 +171,7 @@ static void debug_send_commands(void)
 	}
 }
 
-static void pre_parse(char *string, gboolean overflow)
+static void pre_parse(char *string, gsize overflow, G_GNUC_UNUSED gpointer gdata)
 {
 	if (*string && strchr("~@&", *string))
 	{
@@ -190,7 +190,7 @@ static void pre_parse(char *string, gboolean overflow)
 		}
 
 		if (overflow)
-			dc_error("overflow");
+			dc_error("overflow, %" G_GSIZE_FORMAT " bytes dropped", overflow);
 		else if (!end)
 			dc_error("\" expected");
 		else if (g_str_has_prefix(string, "~^(Scope)#07"))
@@ -212,7 +212,7 @@ static void pre_parse(char *string, gboolean overflow)
 			dc_output_nl(1, string, -1);
 
 			if (overflow)
-				dc_error("overflow");
+				dc_error("overflow, %" G_GSIZE_FORMAT " bytes dropped", overflow);
 		}
 
 		if (*message == '^')
@@ -233,21 +233,19 @@ static void pre_parse(char *string, gboolean overflow)
 	}
 }
 
-static guint MAXLEN;
-static GString *received;
-static gboolean leading_receive;
-static char *reading_pos;
+/* gdb output, split into records as it arrives */
+static RecBuf *received;
 
 static gboolean source_prepare(G_GNUC_UNUSED GSource *source, gint *timeout)
 {
 	*timeout = -1;
-	return gdb_state != INACTIVE && reading_pos > received->str;
+	return gdb_state != INACTIVE && rec_buf_pending(received);
 }
 
 #ifdef G_OS_UNIX
 static gboolean source_check(G_GNUC_UNUSED GSource *source)
 {
-	return gdb_state != INACTIVE && (gdb_err.revents || reading_pos > received->str ||
+	return gdb_state != INACTIVE && (gdb_err.revents || rec_buf_pending(received) ||
 		gdb_out.revents || (commands->len && gdb_in.revents));
 }
 #else  /* G_OS_UNIX */
@@ -260,7 +258,7 @@ static gboolean peek_pipe(GPollFD *fd)
 
 static gboolean source_check(G_GNUC_UNUSED GSource *source)
 {
-	return gdb_state != INACTIVE && (reading_pos > received->str || peek_pipe(&gdb_err) ||
+	return gdb_state != INACTIVE && (rec_buf_pending(received) || peek_pipe(&gdb_err) ||
 		peek_pipe(&gdb_out) || (commands->len &&
 		GetTickCount() - last_send_ticks >= (guint) pref_gdb_send_interval * 10));
 }
@@ -275,7 +273,6 @@ static gboolean source_dispatch(G_GNUC_UNUSED GSource *source,
 	pid_t result;
 	ssize_t count;
 	char buffer[0x200];
-	char *pos;
 
 	/* show errors */
 	while ((count = read(gdb_err.fd, buffer, sizeof buffer - 1)) > 0)
@@ -284,47 +281,13 @@ static gboolean source_dispatch(G_GNUC_UNUSED GSource *source,
 	gdb_io_check(count, "read(gdb_err)", EINVAL);
 
 	/* receive */
-	count = read(gdb_out.fd, received->str + received->len, MAXLEN - received->len);
+	count = read(gdb_out.fd, rec_buf_reserve(received, REC_BUF_CHUNK), REC_BUF_CHUNK);
+	rec_buf_commit(received, count > 0 ? count : 0);
 
-	if (count > 0)
-		g_string_set_size(received, received->len + count);
-	else
+	if (count <= 0)
 		gdb_io_check(count, "read(gdb_out)", EINVAL);
 
-	while (pos = reading_pos, (reading_pos = strchr(pos, '\n')) != NULL)
-	{
-		if (leading_receive)
-		{
-		#ifdef G_OS_UNIX
-			*reading_pos++ = '\0';
-		#else
-			gboolean cr = reading_pos > received->str && reading_pos[-1] == '\r';
-			reading_pos[-cr]= '\0';
-			reading_pos++;
-		#endif
-			pre_parse(pos, FALSE);
-		}
-		else
-		{
-			reading_pos++;
-			leading_receive = TRUE;
-		}
-	}
-
-	g_string_erase(received, 0, pos - received->str);
-
-	if (G_UNLIKELY(received->len == MAXLEN))
-	{
-		if (leading_receive)
-		{
-			reading_pos = received->str + MAXLEN;
-			pre_parse(received->str, TRUE);
-		}
-		g_string_truncate(received, 0);
-		leading_receive = FALSE;
-	}
-
-	reading_pos = received->str;
+	rec_buf_split(received, pre_parse, NULL);
 	result = waitpid(gdb_pid, &status, WNOHANG);
 
 	if (result == 0)
@@ -538,9 +501,7 @@ static void load_program(void)
 			wait_result = 0;
 			wait_prompt = TRUE;
 			g_string_truncate(commands, 0);
-			g_string_truncate(received, 0);
-			reading_pos = received->str;
-			leading_receive = TRUE;
+			rec_buf_clear(received);
 
 			gdb_source = g_source_new(&gdb_source_funcs, sizeof(GSource));
 			g_source_set_can_recurse(gdb_source, TRUE);
@@ -753,8 +714,7 @@ char *debug_send_evaluate(char token, gint scid, const gchar *expr)
 void debug_init(void)
 {
 	commands = g_string_sized_new(0x3FFF);
-	received = g_string_sized_new(pref_gdb_buffer_length);
-	MAXLEN = received->allocated_len - 1;
+	received = rec_buf_new(MAX(pref_gdb_buffer_length, 0x3FFF));
 }
 
 void debug_finalize(void)
@@ -780,6 +740,6 @@ void debug_finalize(void)
 		statusbar_update_state(DS_INACTIVE);
 	}
 
-	g_string_free(received, TRUE);
+	rec_buf_free(received);
 	g_string_free(commands, TRUE);
 }
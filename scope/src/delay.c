@@ -0,0 +1,42 @@
+/*
+ *  delay.c
+ *
+ *  Copyright 2012 Dimitar Toshkov Zhekov <dimitar.zhekov@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+
+#include "delay.h"
+
+void update_delay_reset(UpdateDelay *delay)
+{
+	delay->delayed = FALSE;
+	delay->last = -1;
+}
+
+void update_delay_change(UpdateDelay *delay, gdouble now, gdouble interval)
+{
+	delay->token++;
+	delay->delayed = delay->last >= 0 && now - delay->last < interval;
+	delay->last = now;
+}
+
+gboolean update_delay_expired(UpdateDelay *delay, guint token)
+{
+	/* changed again meanwhile, wait some more */
+	delay->delayed = token != delay->token;
+	return !delay->delayed;
+}
@@ -0,0 +1,39 @@
+/*
+ *  delay.h
+ *
+ *  Copyright 2012 Dimitar Toshkov Zhekov <dimitar.zhekov@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DELAY_H
+
+/* Coalescing of quick context changes. Each change bumps the token; a change that comes
+   within the interval of the previous one marks the next refresh as delayed. A delayed
+   refresh armed with some token is due when no change arrived after arming it. */
+typedef struct _UpdateDelay
+{
+	guint token;
+	gboolean delayed;
+	gdouble last;  /* time of the last change, -1 for none */
+} UpdateDelay;
+
+void update_delay_reset(UpdateDelay *delay);
+/* registers a change at time now, in seconds */
+void update_delay_change(UpdateDelay *delay, gdouble now, gdouble interval);
+/* a delayed refresh armed with token fired; returns TRUE if it is due */
+gboolean update_delay_expired(UpdateDelay *delay, guint token);
+
+#define DELAY_H 1
+#endif
@@ -25,6 +25,10 @@
 void gtk_widget_set_visible(GtkWidget *widget, gboolean visible);
 #endif
 
+#if !GTK_CHECK_VERSION(2, 20, 0)
+#define gtk_widget_get_mapped(widget) GTK_WIDGET_MAPPED(widget)
+#endif
+
 void gtk216_init(void);
 void gtk216_finalize(void);
 
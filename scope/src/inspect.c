@@ -39,7 +39,8 @@ enum
 	INSPECT_EXPAND,
 	INSPECT_NUMCHILD,
 	INSPECT_FORMAT,
-	INSPECT_PATH_EXPR
+	INSPECT_PATH_EXPR,
+	INSPECT_INDEX
 };
 
 enum
@@ -65,91 +66,181 @@ static void append_stub(GtkTreeIter *parent, const gchar *text, gboolean expand)
 
 #define append_ellipsis(parent, expand) append_stub((parent), _("..."), (expand))
 
-static gboolean inspect_find_recursive(GtkTreeIter *iter, gint i, const char *key)
+/* rows are found by scid and by varobj name with the store indexes on these columns, which
+   follow the rows as they are changed, moved and deleted */
+static gboolean inspect_find(GtkTreeIter *iter, gboolean string, const char *key)
 {
-	do
+	if (string ? scp_tree_store_search(store, TRUE, FALSE, iter, NULL, INSPECT_VAR1, key) :
+		scp_tree_store_search(store, TRUE, FALSE, iter, NULL, INSPECT_SCID, atoi(key)))
 	{
-		gboolean flag = !key;
+		return TRUE;
+	}
 
-		if (flag)
-		{
-			gint scid;
+	if (!string)
+		dc_error("%s: i_scid not found", key);
 
-			scp_tree_store_get(store, iter, INSPECT_SCID, &scid, -1);
-			if (scid == i)
-				return TRUE;
-		}
-		else
-		{
-			const char *var1;
-			size_t len;
+	return FALSE;
+}
 
-			scp_tree_store_get(store, iter, INSPECT_VAR1, &var1, -1);
-			len = var1 ? strlen(var1) : 0;
+static gint inspect_get_scid(GtkTreeIter *iter)
+{
+	gint scid;
 
-			if (var1 && !strncmp(key, var1, len))
-			{
-				if (key[len] == '\0')
-					return TRUE;
+	scp_tree_store_get(store, iter, INSPECT_SCID, &scid, -1);
+	if (!scid)
+	{
+		scp_tree_store_set(store, iter, INSPECT_SCID, scid = ++scid_gen, -1);
+	}
 
-				flag = key[len] == '.' && key[len + 1];
-			}
-		}
+	return scid;
+}
+
+/* Children are listed in pages, when their placeholder row becomes visible. Placeholders have
+   no name and no var1, and hold the range of their page in start and count. */
+#define INSPECT_PAGE 100
+
+static gboolean inspect_is_page(GtkTreeIter *iter)
+{
+	const char *var1, *name;
+	gint count;
+
+	scp_tree_store_get(store, iter, INSPECT_VAR1, &var1, INSPECT_NAME, &name, INSPECT_COUNT,
+		&count, -1);
+	return !var1 && !name && count;
+}
+
+static void inspect_fetch_page(GtkTreeIter *iter)
+{
+	GtkTreeIter parent;
+	gint scid, from, count;
 
-		if (flag)
+	scp_tree_store_get(store, iter, INSPECT_SCID, &scid, INSPECT_START, &from,
+		INSPECT_COUNT, &count, -1);
+
+	/* a placeholder gets a scid when listed */
+	if (!scid && scp_tree_store_iter_parent(store, &parent, iter))
+	{
+		const char *var1;
+
+		scp_tree_store_get(store, &parent, INSPECT_VAR1, &var1, -1);
+
+		if (var1)
 		{
-			GtkTreeIter child;
+			char *s = g_strdup_printf("%d", from);
 
-			if (scp_tree_store_iter_children(store, &child, iter) &&
-				inspect_find_recursive(&child, i, key))
-			{
-				*iter = child;
-				return TRUE;
-			}
+			debug_send_format(N, "07%c%d%d-var-list-children 1 %s %d %d",
+				'0' + (int) strlen(s) - 1, from, inspect_get_scid(iter), var1, from,
+				from + count);
+			g_free(s);
 		}
-	} while (scp_tree_store_iter_next(store, iter));
-
-	return FALSE;
+	}
 }
 
-static gboolean inspect_find(GtkTreeIter *iter, gboolean string, const char *key)
+static gboolean inspect_iter_next_visible(GtkTreeIter *iter)
 {
-	if (scp_tree_store_get_iter_first(store, iter) &&
-		inspect_find_recursive(iter, atoi(key), string ? key : NULL))
+	GtkTreeIter next;
+	GtkTreePath *path = scp_tree_store_get_path(store, iter);
+	gboolean expanded = gtk_tree_view_row_expanded(tree, path);
+
+	gtk_tree_path_free(path);
+
+	if (expanded && scp_tree_store_iter_children(store, &next, iter))
 	{
+		*iter = next;
 		return TRUE;
 	}
 
-	if (!string)
-		dc_error("%s: i_scid not found", key);
+	for (;;)
+	{
+		next = *iter;
+
+		if (scp_tree_store_iter_next(store, &next))
+		{
+			*iter = next;
+			return TRUE;
+		}
+
+		if (!scp_tree_store_iter_parent(store, &next, iter))
+			return FALSE;
+
+		*iter = next;
+	}
+}
+
+static guint fetch_source_id = 0;
+
+static gboolean inspect_fetch_visible(G_GNUC_UNUSED gpointer gdata)
+{
+	GtkTreePath *start, *end;
+
+	fetch_source_id = 0;
+
+	if ((debug_state() & DS_VARIABLE) && gtk_tree_view_get_visible_range(tree, &start, &end))
+	{
+		GtkTreeIter iter;
+		gboolean valid = scp_tree_store_get_iter(store, &iter, start);
+
+		while (valid)
+		{
+			GtkTreePath *path;
+
+			if (inspect_is_page(&iter))
+				inspect_fetch_page(&iter);
+
+			path = scp_tree_store_get_path(store, &iter);
+			valid = gtk_tree_path_compare(path, end) < 0 && inspect_iter_next_visible(&iter);
+			gtk_tree_path_free(path);
+		}
+
+		gtk_tree_path_free(start);
+		gtk_tree_path_free(end);
+	}
 
 	return FALSE;
 }
 
-static gint inspect_get_scid(GtkTreeIter *iter)
+static void inspect_schedule_fetch(void)
 {
-	gint scid;
+	if (!fetch_source_id)
+		fetch_source_id = plugin_idle_add(geany_plugin, inspect_fetch_visible, NULL);
+}
 
-	scp_tree_store_get(store, iter, INSPECT_SCID, &scid, -1);
-	if (!scid)
-		scp_tree_store_set(store, iter, INSPECT_SCID, scid = ++scid_gen, -1);
+/* replaces the children of iter with placeholders for the expansion range */
+static void inspect_expand_pages(GtkTreeIter *iter)
+{
+	gint start, count, numchild, end, from;
 
-	return scid;
+	scp_tree_store_get(store, iter, INSPECT_START, &start, INSPECT_COUNT, &count,
+		INSPECT_NUMCHILD, &numchild, -1);
+	end = count ? MIN(start + count, numchild) : numchild;
+	scp_tree_store_clear_children(store, iter, FALSE);
+
+	if (start >= end)
+		append_stub(iter, _("no children in range"), FALSE);
+	else
+	{
+		if (start)
+			append_ellipsis(iter, FALSE);
+
+		for (from = start; from < end; from += INSPECT_PAGE)
+		{
+			scp_tree_store_append_with_values(store, NULL, iter, INSPECT_EXPR, _("..."),
+				INSPECT_START, from, INSPECT_COUNT, MIN(INSPECT_PAGE, end - from), -1);
+		}
+
+		if (end < numchild)
+			append_ellipsis(iter, FALSE);
+	}
 }
 
 static void inspect_expand(GtkTreeIter *iter)
 {
-	const char *var1;
-	gint scid, start, count, numchild;
-	char *s;
+	GtkTreePath *path = scp_tree_store_get_path(store, iter);
 
-	scid = inspect_get_scid(iter);
-	scp_tree_store_get(store, iter, INSPECT_VAR1, &var1, INSPECT_START, &start,
-		INSPECT_COUNT, &count, INSPECT_NUMCHILD, &numchild, -1);
-	s = g_strdup_printf("%d", start);
-	debug_send_format(N, "07%c%d%d-var-list-children 1 %s %d %d", '0' + (int) strlen(s) - 1,
-		start, scid, var1, start, count ? start + count : numchild);
-	g_free(s);
+	inspect_expand_pages(iter);
+	gtk_tree_view_expand_row(tree, path, FALSE);
+	gtk_tree_path_free(path);
+	inspect_schedule_fetch();
 }
 
 static void on_jump_to_menu_item_activate(GtkMenuItem *menuitem, G_GNUC_UNUSED gpointer gdata)
@@ -330,23 +421,66 @@ void on_inspect_assign(GArray *nodes)
 	views_data_dirty(DS_BUSY);
 }
 
-static void inspect_node_append(const ParseNode *node, GtkTreeIter *parent)
+typedef struct _InspectPage
+{
+	GtkTreeIter parent;
+	gint position;
+	gint index;
+} InspectPage;
+
+static void inspect_node_insert(const ParseNode *node, InspectPage *page)
 {
 	GArray *nodes = (GArray *) node->value;
 	ParseVariable var;
 
 	if (node->type == PT_VALUE || !parse_variable(nodes, &var, "numchild"))
-		append_stub(parent, _("invalid data"), FALSE);
+	{
+		scp_tree_store_insert_with_values(store, NULL, &page->parent, page->position,
+			INSPECT_EXPR, _("invalid data"), -1);
+	}
 	else
 	{
 		GtkTreeIter iter;
 
-		scp_tree_store_append(store, &iter, parent);
+		scp_tree_store_insert_with_values(store, &iter, &page->parent, page->position,
+			INSPECT_INDEX, page->index, -1);
 		inspect_variable_store(&iter, &var);
 		scp_tree_store_set(store, &iter, INSPECT_EXPR, var.expr ? var.expr : var.name,
 			INSPECT_HB_MODE, var.hb_mode, INSPECT_FORMAT, FORMAT_NATURAL, -1);
 		parse_variable_free(&var);
 	}
+
+	page->position++;
+	page->index++;
+}
+
+/* limits -var-update to the listed children, unless they are all listed */
+static void inspect_update_range(GtkTreeIter *parent)
+{
+	gint n = scp_tree_store_iter_n_children(store, parent);
+	gint first = -1, last = -1, numchild, i;
+	const char *var1;
+	GtkTreeIter iter;
+
+	for (i = 0; i < n && first == -1; i++)
+	{
+		scp_tree_store_iter_nth_child(store, &iter, parent, i);
+		scp_tree_store_get(store, &iter, INSPECT_VAR1, &var1, INSPECT_INDEX, &first, -1);
+		if (!var1)
+			first = -1;
+	}
+
+	for (i = n - 1; i >= 0 && last == -1; i--)
+	{
+		scp_tree_store_iter_nth_child(store, &iter, parent, i);
+		scp_tree_store_get(store, &iter, INSPECT_VAR1, &var1, INSPECT_INDEX, &last, -1);
+		last = var1 ? last + 1 : -1;
+	}
+
+	scp_tree_store_get(store, parent, INSPECT_VAR1, &var1, INSPECT_NUMCHILD, &numchild, -1);
+
+	if (first != -1 && (first || last < numchild))
+		debug_send_format(N, "04-var-set-update-range %s %d %d", var1, first, last);
 }
 
 void on_inspect_children(GArray *nodes)
@@ -357,44 +491,28 @@ void on_inspect_children(GArray *nodes)
 	iff (strlen(token) >= size + 1, "bad token")
 	{
 		GtkTreeIter iter;
+		InspectPage page;
 
-		if (inspect_find(&iter, FALSE, token + size))
+		if (inspect_find(&iter, FALSE, token + size) &&
+			scp_tree_store_iter_parent(store, &page.parent, &iter))
 		{
-			gint from;
-			GtkTreePath *path = scp_tree_store_get_path(store, &iter);
-
 			token[size] = '\0';
-			from = atoi(token + 1);
-			scp_tree_store_clear_children(store, &iter, FALSE);
+			page.index = atoi(token + 1);
 
-			if ((nodes = parse_find_array(nodes, "children")) == NULL)
-				append_stub(&iter, _("no children in range"), FALSE);
+			if ((nodes = parse_find_array(nodes, "children")) == NULL || !nodes->len)
+			{
+				scp_tree_store_set(store, &iter, INSPECT_EXPR, _("no children in range"),
+					INSPECT_COUNT, 0, -1);
+			}
 			else
 			{
-				gint numchild, end;
-				const char *var1;
-
-				if (from)
-					append_ellipsis(&iter, FALSE);
-
-				scp_tree_store_get(store, &iter, INSPECT_VAR1, &var1,
-					INSPECT_NUMCHILD, &numchild, -1);
-
-				parse_foreach(nodes, (GFunc) inspect_node_append, &iter);
-				end = from + nodes->len;
-
-				if (nodes->len && (from || end < numchild))
-				{
-					debug_send_format(N, "04-var-set-update-range %s %d %d", var1,
-						from, end);
-				}
-
-				if (nodes->len ? end < numchild : !from)
-					append_ellipsis(&iter, FALSE);
+				/* the placeholder gives way to the children */
+				page.position = scp_tree_store_iter_tell(store, &iter);
+				scp_tree_store_remove(store, &iter);
+				parse_foreach(nodes, (GFunc) inspect_node_insert, &page);
+				inspect_update_range(&page.parent);
+				inspect_schedule_fetch();
 			}
-
-			gtk_tree_view_expand_row(tree, path, FALSE);
-			gtk_tree_path_free(path);
 		}
 	}
 }
@@ -564,6 +682,7 @@ gboolean inspects_update(void)
 	else
 		debug_send_command(F, "040-var-update 1 *");
 
+	inspect_schedule_fetch();
 	return TRUE;
 }
 
@@ -739,7 +858,9 @@ static gboolean inspect_load(GKeyFile *config, const char *section)
 		frame && inspect_frame_valid(frame) && (unsigned) start <= EXPAND_MAX &&
 		(unsigned) count <= EXPAND_MAX && (unsigned) format < FORMAT_COUNT)
 	{
-		scp_tree_store_append_with_values(store, NULL, NULL, INSPECT_EXPR, expr,
+		GtkTreeIter iter;
+
+		scp_tree_store_append_with_values(store, &iter, NULL, INSPECT_EXPR, expr,
 			INSPECT_PATH_EXPR, expr, INSPECT_HB_MODE, hb_mode, INSPECT_SCID, ++scid_gen,
 			INSPECT_NAME, name, INSPECT_FRAME, frame, INSPECT_RUN_APPLY, run_apply,
 			INSPECT_START, start, INSPECT_COUNT, count, INSPECT_EXPAND, expand,
@@ -1051,13 +1172,20 @@ static gboolean inspect_test_expand_row(G_GNUC_UNUSED GtkTreeView *tree_view,
 		return FALSE;
 
 	if (debug_state() & DS_VARIABLE)
-		inspect_expand(iter);
-	else
-		plugin_blink();
+	{
+		inspect_expand_pages(iter);
+		return FALSE;
+	}
 
+	plugin_blink();
 	return TRUE;
 }
 
+static void on_inspect_view_changed(void)
+{
+	inspect_schedule_fetch();
+}
+
 static gboolean on_inspect_key_press(G_GNUC_UNUSED GtkWidget *widget, GdkEventKey *event,
 	G_GNUC_UNUSED gpointer gdata)
 {
@@ -1143,6 +1271,13 @@ void inspect_init(void)
 	g_signal_connect(tree, "key-press-event", G_CALLBACK(on_inspect_key_press), NULL);
 	g_signal_connect(tree, "button-press-event", G_CALLBACK(on_inspect_button_press), NULL);
 	g_signal_connect(tree, "drag-motion", G_CALLBACK(on_inspect_drag_motion), NULL);
+	g_signal_connect_swapped(tree, "row-expanded", G_CALLBACK(on_inspect_view_changed), NULL);
+	g_signal_connect_swapped(tree, "size-allocate", G_CALLBACK(on_inspect_view_changed),
+		NULL);
+	g_signal_connect_swapped(gtk_tree_view_get_vadjustment(tree), "value-changed",
+		G_CALLBACK(on_inspect_view_changed), NULL);
+	g_signal_connect_swapped(gtk_tree_view_get_vadjustment(tree), "changed",
+		G_CALLBACK(on_inspect_view_changed), NULL);
 
 	g_signal_connect(store, "row-inserted", G_CALLBACK(on_inspect_row_inserted), NULL);
 	g_signal_connect(store, "row-changed", G_CALLBACK(on_inspect_row_changed), NULL);
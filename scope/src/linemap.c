@@ -0,0 +1,191 @@
+/*
+ *  linemap.c
+ *
+ *  Copyright 2012 Dimitar Toshkov Zhekov <dimitar.zhekov@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+
+#include "linemap.h"
+
+/* per file, an array of entries sorted by line, so that an edit only touches the entries
+   at or after the edited line */
+
+typedef struct _LineEntry
+{
+	gint line;
+	gpointer data;
+} LineEntry;
+
+struct _LineMap
+{
+	GHashTable *files;
+	GDestroyNotify destroy;
+};
+
+static gchar *line_map_key(const char *file)
+{
+#ifdef G_OS_WIN32
+	return g_utf8_casefold(file, -1);  /* as utils_filenamecmp() */
+#else
+	return g_strdup(file);
+#endif
+}
+
+static void line_entries_free(GArray *entries, GDestroyNotify destroy)
+{
+	if (destroy)
+	{
+		guint i;
+
+		for (i = 0; i < entries->len; i++)
+			destroy(g_array_index(entries, LineEntry, i).data);
+	}
+
+	g_array_free(entries, TRUE);
+}
+
+static gboolean line_map_remove_file(G_GNUC_UNUSED gpointer key, gpointer value, gpointer gdata)
+{
+	line_entries_free((GArray *) value, ((LineMap *) gdata)->destroy);
+	return TRUE;
+}
+
+LineMap *line_map_new(GDestroyNotify destroy)
+{
+	LineMap *map = g_new(LineMap, 1);
+
+	map->files = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	map->destroy = destroy;
+	return map;
+}
+
+void line_map_clear(LineMap *map)
+{
+	g_hash_table_foreach_remove(map->files, line_map_remove_file, map);
+}
+
+void line_map_free(LineMap *map)
+{
+	line_map_clear(map);
+	g_hash_table_destroy(map->files);
+	g_free(map);
+}
+
+gboolean line_map_empty(LineMap *map)
+{
+	return !g_hash_table_size(map->files);
+}
+
+static GArray *line_map_lookup(LineMap *map, const char *file)
+{
+	gchar *key = line_map_key(file);
+	GArray *entries = (GArray *) g_hash_table_lookup(map->files, key);
+
+	g_free(key);
+	return entries;
+}
+
+/* index of the first entry with line >= start */
+static guint line_entries_find(GArray *entries, gint start)
+{
+	guint low = 0, high = entries->len;
+
+	while (low < high)
+	{
+		guint mid = (low + high) / 2;
+
+		if (g_array_index(entries, LineEntry, mid).line < start)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+void line_map_add(LineMap *map, const char *file, gint line, gpointer data)
+{
+	gchar *key = line_map_key(file);
+	GArray *entries = (GArray *) g_hash_table_lookup(map->files, key);
+	LineEntry entry = { line, data };
+
+	if (entries)
+		g_free(key);
+	else
+	{
+		entries = g_array_new(FALSE, FALSE, sizeof(LineEntry));
+		g_hash_table_insert(map->files, key, entries);
+	}
+
+	g_array_insert_val(entries, line_entries_find(entries, line + 1), entry);
+}
+
+void line_map_foreach(LineMap *map, const char *file, gint start, LineMapFunc func,
+	gpointer gdata)
+{
+	GArray *entries = line_map_lookup(map, file);
+
+	if (entries)
+	{
+		guint i;
+
+		for (i = line_entries_find(entries, start); i < entries->len; i++)
+		{
+			LineEntry *entry = &g_array_index(entries, LineEntry, i);
+			func(entry->line, entry->data, gdata);
+		}
+	}
+}
+
+void line_map_delta(LineMap *map, const char *file, gint start, gint delta,
+	LineMapFunc moved, LineMapFunc removed, gpointer gdata)
+{
+	GArray *entries = line_map_lookup(map, file);
+
+	if (entries)
+	{
+		guint first = line_entries_find(entries, start);
+		guint i;
+
+		if (delta < 0)
+		{
+			/* the entries on the deleted lines go away */
+			guint last = line_entries_find(entries, start - delta);
+
+			for (i = first; i < last; i++)
+			{
+				LineEntry *entry = &g_array_index(entries, LineEntry, i);
+
+				if (removed)
+					removed(entry->line, entry->data, gdata);
+				if (map->destroy)
+					map->destroy(entry->data);
+			}
+
+			g_array_remove_range(entries, first, last - first);
+		}
+
+		for (i = first; i < entries->len; i++)
+		{
+			LineEntry *entry = &g_array_index(entries, LineEntry, i);
+
+			entry->line += delta;
+			if (moved)
+				moved(entry->line, entry->data, gdata);
+		}
+	}
+}
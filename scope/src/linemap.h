@@ -0,0 +1,38 @@
+/*
+ *  linemap.h
+ *
+ *  Copyright 2012 Dimitar Toshkov Zhekov <dimitar.zhekov@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LINEMAP_H
+
+typedef struct _LineMap LineMap;
+typedef void (*LineMapFunc)(gint line, gpointer data, gpointer gdata);
+
+LineMap *line_map_new(GDestroyNotify destroy);
+void line_map_clear(LineMap *map);
+void line_map_free(LineMap *map);
+gboolean line_map_empty(LineMap *map);
+void line_map_add(LineMap *map, const char *file, gint line, gpointer data);
+/* calls func for the entries of file with line >= start, in line order */
+void line_map_foreach(LineMap *map, const char *file, gint start, LineMapFunc func,
+	gpointer gdata);
+/* delta lines inserted (> 0) or deleted (< 0) at start */
+void line_map_delta(LineMap *map, const char *file, gint start, gint delta,
+	LineMapFunc moved, LineMapFunc removed, gpointer gdata);
+
+#define LINEMAP_H 1
+#endif
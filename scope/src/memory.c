@@ -34,29 +34,38 @@ enum
 static ScpTreeStore *store;
 static GtkTreeSelection *selection;
 
+static gboolean memory_format_line(guint64 addr, GString *bytes, GString *ascii);
+
 static void on_memory_bytes_edited(G_GNUC_UNUSED GtkCellRendererText *renderer, gchar *path_str,
 	gchar *new_text, G_GNUC_UNUSED gpointer gdata)
 {
 	if (*new_text && (debug_state() & DS_VARIABLE))
 	{
 		GtkTreeIter iter;
-		const char *addr, *bytes;
+		guint64 addr;
+		GString *bytes = g_string_new(NULL);
 		guint i;
 
 		scp_tree_store_get_iter_from_string(store, &iter, path_str);
-		scp_tree_store_get(store, &iter, MEMORY_ADDR, &addr, MEMORY_BYTES, &bytes, -1);
-
-		for (i = 0; bytes[i]; i++)
-			if (!(isxdigit(bytes[i]) ? isxdigit(new_text[i]) : new_text[i] == ' '))
-				break;
+		scp_tree_store_get(store, &iter, MEMORY_ADDR, &addr, -1);
 
-		if (bytes[i] || new_text[i])
-			dc_error("memory: invalid format");
-		else
+		iff (memory_format_line(addr, bytes, NULL), "memory: unknown bytes")
 		{
-			utils_strchrepl(new_text, ' ', '\0');
-			debug_send_format(T, "07-data-write-memory-bytes 0x%s%s", addr, new_text);
+			for (i = 0; bytes->str[i]; i++)
+				if (!(isxdigit(bytes->str[i]) ? isxdigit(new_text[i]) : new_text[i] == ' '))
+					break;
+
+			if (bytes->str[i] || new_text[i])
+				dc_error("memory: invalid format");
+			else
+			{
+				utils_strchrepl(new_text, ' ', '\0');
+				debug_send_format(T, "07-data-write-memory-bytes 0x%" G_GINT64_MODIFIER "x %s",
+					addr, new_text);
+			}
 		}
+
+		g_string_free(bytes, TRUE);
 	}
 	else
 		plugin_blink();
@@ -132,79 +141,172 @@ static void memory_configure(void)
 	bytes_per_line = groups_per_line * bytes_per_group;
 }
 
+/* The rows hold only their address, and are formatted from a cache of pages when drawn, so
+   only the pages of the visible rows are read from gdb. Scrolling near either end of the
+   range extends it, and past MAX_BYTES the opposite end is dropped. */
 static guint64 memory_start;
 static guint memory_count = 0;
-#define MAX_BYTES (124 * MAX_BYTES_PER_LINE)
+#define MAX_BYTES 0x100000
+
+static PageCache *memory_cache;
+static guint memory_request_id = 0;
+static guint memory_retry_id = 0;
+static GtkTreeView *memory_tree;
 
-static void write_block(guint64 start, const char *contents, guint count, const char *maddr)
+static const char hex_digits[] = "0123456789abcdef";
+static gchar *memory_chars[0x100];
+
+static void memory_send_run(guint id, guint64 start, guint count,
+	G_GNUC_UNUSED gpointer gdata)
 {
-	if (!memory_count)
-		memory_start = start;
-	else if (memory_count < MAX_BYTES)
-		memory_count = start - memory_start;
+	debug_send_format(T, "09%u-data-read-memory-bytes 0x%" G_GINT64_MODIFIER "x %u", id,
+		start, count);
+}
 
-	while (memory_count < MAX_BYTES)
-	{
-		GtkTreeIter iter;
-		char *addr = g_strdup_printf(addr_format, start);
-		GString *bytes = g_string_sized_new(bytes_per_line * 3);
-		GString *ascii = g_string_new(" ");
-		gint n = 0;
+static gboolean memory_send_requests(G_GNUC_UNUSED gpointer gdata)
+{
+	page_cache_send(memory_cache, memory_send_run, NULL);
+	memory_request_id = 0;
+	return FALSE;
+}
 
-		while (n < bytes_per_line)
-		{
-			char locale;
-			gchar *utf8;
+static void memory_request_pages(void)
+{
+	if (page_cache_queued(memory_cache) && !memory_request_id)
+		memory_request_id = plugin_idle_add(geany_plugin, memory_send_requests, NULL);
+}
+
+/* Returns FALSE if some byte of the line at addr is unknown */
+static gboolean memory_format_line(guint64 addr, GString *bytes, GString *ascii)
+{
+	gboolean read = (debug_state() & DS_VARIABLE) != 0;
+	gboolean known = TRUE;
+	gint n;
 
-			g_string_append_len(bytes, contents, 2);
-			contents += 2;
-			memory_count++;
-			locale = strtol(bytes->str + bytes->len - 2, NULL, 16);
-			utf8 = locale >= 0x20 ? g_locale_to_utf8(&locale, 1, NULL, NULL, NULL) : NULL;
+	if (bytes)
+		g_string_truncate(bytes, 0);
+	if (ascii)
+		g_string_assign(ascii, " ");
+
+	for (n = 0; n < bytes_per_line; n++, addr++)
+	{
+		if (addr - memory_start < memory_count)
+		{
+			gint value = page_cache_byte(memory_cache, addr, read);
 
-			if (utf8)
+			if (value >= 0)
 			{
-				g_string_append(ascii, utf8);
-				g_free(utf8);
+				if (bytes)
+				{
+					g_string_append_c(bytes, hex_digits[value >> 4]);
+					g_string_append_c(bytes, hex_digits[value & 0x0F]);
+				}
+				if (ascii)
+					g_string_append(ascii, memory_chars[value]);
 			}
 			else
-				g_string_append_c(ascii, '.');  /* 0xfffd? */
+			{
+				if (bytes)
+					g_string_append(bytes, "??");
+				if (ascii)
+					g_string_append_c(ascii, '?');
+				known = FALSE;
+			}
+		}
+		else if (bytes)
+			g_string_append(bytes, "  ");
 
-			if (++n % bytes_per_group == 0)
-				g_string_append_c(bytes, ' ');
+		if (bytes && (n + 1) % bytes_per_group == 0)
+			g_string_append_c(bytes, ' ');
+	}
 
-			if (!--count)
-				break;
-		}
+	memory_request_pages();
+	return known;
+}
 
-		while (n < bytes_per_line)
-		{
-			g_string_append(bytes, "  ");
+static void memory_addr_cell_data_func(G_GNUC_UNUSED GtkTreeViewColumn *column,
+	GtkCellRenderer *cell, GtkTreeModel *model, GtkTreeIter *iter,
+	G_GNUC_UNUSED gpointer gdata)
+{
+	guint64 addr;
+	char text[MAX_POINTER_SIZE * 2 + 3];
 
-			if (++n % bytes_per_group == 0)
-				g_string_append_c(bytes, ' ');
-		}
+	gtk_tree_model_get(model, iter, MEMORY_ADDR, &addr, -1);
+	g_snprintf(text, sizeof text, addr_format, addr);
+	g_object_set(cell, "text", text, NULL);
+}
+
+static void memory_line_cell_data_func(G_GNUC_UNUSED GtkTreeViewColumn *column,
+	GtkCellRenderer *cell, GtkTreeModel *model, GtkTreeIter *iter, gpointer gdata)
+{
+	static GString *text = NULL;
+	guint64 addr;
 
-		scp_tree_store_append_with_values(store, &iter, NULL, MEMORY_ADDR, addr,
-			MEMORY_BYTES, bytes->str, MEMORY_ASCII, ascii->str, -1);
-		if (!g_strcmp0(addr, maddr))
-			gtk_tree_selection_select_iter(selection, &iter);
+	if (!text)
+		text = g_string_sized_new(MAX_BYTES_PER_LINE * 6);
 
-		g_free(addr);
-		g_string_free(bytes, TRUE);
-		g_string_free(ascii, TRUE);
+	gtk_tree_model_get(model, iter, MEMORY_ADDR, &addr, -1);
+	if (GPOINTER_TO_INT(gdata) == MEMORY_BYTES)
+		memory_format_line(addr, text, NULL);
+	else
+		memory_format_line(addr, NULL, text);
+	g_object_set(cell, "text", text->str, NULL);
+}
 
-		if (!count)
-			break;
+static void memory_append_lines(guint count)
+{
+	guint lines = (memory_count + bytes_per_line - 1) / bytes_per_line;
+	guint64 addr = memory_start + (guint64) lines * bytes_per_line;
+
+	memory_count = count;
+	for (; lines < (count + bytes_per_line - 1) / bytes_per_line; lines++)
+	{
+		scp_tree_store_append_with_values(store, NULL, NULL, MEMORY_ADDR, addr, -1);
+		addr += bytes_per_line;
+	}
+}
 
-		start += bytes_per_line;
+static void memory_rebuild(guint64 maddr, gboolean select)
+{
+	guint count = memory_count;
+	GtkTreeIter iter;
+
+	/* avoid a tree view update per row */
+	g_object_ref(store);
+	gtk_tree_view_set_model(memory_tree, NULL);
+	store_clear(store);
+	memory_count = 0;
+	memory_append_lines(count);
+	gtk_tree_view_set_model(memory_tree, GTK_TREE_MODEL(store));
+	g_object_unref(store);
+
+	if (select && maddr - memory_start < memory_count &&
+		scp_tree_store_iter_nth_child(store, &iter, NULL, (maddr - memory_start) /
+		bytes_per_line))
+	{
+		gtk_tree_selection_select_iter(selection, &iter);
 	}
+}
+
+static void memory_reconfigure(void)
+{
+	if (pref_memory_bytes_per_line != back_bytes_per_line)
+	{
+		GtkTreeIter iter;
+		guint64 maddr = 0;
+		gboolean select = gtk_tree_selection_get_selected(selection, NULL, &iter);
+
+		if (select)
+			scp_tree_store_get(store, &iter, MEMORY_ADDR, &maddr, -1);
 
-	if (count)
-		dc_error("memory: too much data");
+		memory_configure();
+		memory_rebuild(maddr, select);
+		gtk_tree_view_column_queue_resize(get_column("memory_bytes_column"));
+		gtk_tree_view_column_queue_resize(get_column("memory_ascii_column"));
+	}
 }
 
-static void memory_node_read(const ParseNode *node, const char *maddr)
+static void memory_node_range(const ParseNode *node, guint64 *range)
 {
 	iff (node->type == PT_ARRAY, "memory: contains value")
 	{
@@ -222,7 +324,17 @@ static void memory_node_read(const ParseNode *node, const char *maddr)
 				start += g_ascii_strtoull(offset, NULL, 0);
 
 			iff (count, "memory: contents too short")
-				write_block(start, contents, count, maddr);
+			{
+				if (range)
+				{
+					if (!range[1] || start < range[0])
+						range[0] = start;
+					if (start + count > range[1])
+						range[1] = start + count;
+				}
+				else if (!page_cache_store(memory_cache, start, contents))
+					dc_error("memory: invalid contents");
+			}
 		}
 	}
 }
@@ -231,46 +343,224 @@ void on_memory_read_bytes(GArray *nodes)
 {
 	if (pointer_size <= MAX_POINTER_SIZE)
 	{
-		GtkTreeIter iter;
-		char *maddr = NULL;
+		GArray *blocks = parse_lead_array(nodes);
+		const char *token = parse_grab_token(nodes);
 
-		if (gtk_tree_selection_get_selected(selection, NULL, &iter))
-			gtk_tree_model_get((GtkTreeModel *) store, &iter, MEMORY_ADDR, &maddr, -1);
+		if (token)
+		{
+			/* pages read for the view, unless cleared meanwhile */
+			if (page_cache_received(memory_cache, atoi(token)))
+			{
+				parse_foreach(blocks, (GFunc) memory_node_range, NULL);
+				gtk_widget_queue_draw(GTK_WIDGET(memory_tree));
+			}
+		}
+		else
+		{
+			/* a new range read by the user */
+			guint64 range[2] = { 0, 0 };
+			GtkTreeIter iter;
+			guint64 maddr = 0;
+			gboolean select = gtk_tree_selection_get_selected(selection, NULL, &iter);
 
-		store_clear(store);
-		memory_count = 0;
+			if (select)
+				scp_tree_store_get(store, &iter, MEMORY_ADDR, &maddr, -1);
 
-		if (pref_memory_bytes_per_line != back_bytes_per_line)
-		{
-			memory_configure();
-			gtk_tree_view_column_queue_resize(get_column("memory_bytes_column"));
-			gtk_tree_view_column_queue_resize(get_column("memory_ascii_column"));
+			parse_foreach(blocks, (GFunc) memory_node_range, range);
+			if (range[1] > range[0])
+			{
+				if (range[1] - range[0] > MAX_BYTES)
+				{
+					dc_error("memory: too much data");
+					range[1] = range[0] + MAX_BYTES;
+				}
+
+				page_cache_clear(memory_cache);
+				parse_foreach(blocks, (GFunc) memory_node_range, NULL);
+
+				if (pref_memory_bytes_per_line != back_bytes_per_line)
+				{
+					memory_configure();
+					gtk_tree_view_column_queue_resize(get_column("memory_bytes_column"));
+					gtk_tree_view_column_queue_resize(get_column("memory_ascii_column"));
+				}
+
+				memory_start = range[0];
+				memory_count = range[1] - range[0];
+				memory_rebuild(maddr, select);
+			}
 		}
+	}
+}
+
+#define MEMORY_RETRY_DELAY 1000
+
+static gboolean memory_retry(G_GNUC_UNUSED gpointer gdata)
+{
+	memory_retry_id = 0;
+
+	/* the visible failed pages are read again when drawn */
+	if (page_cache_retry(memory_cache))
+		gtk_widget_queue_draw(GTK_WIDGET(memory_tree));
+
+	return FALSE;
+}
 
-		parse_foreach(parse_lead_array(nodes), (GFunc) memory_node_read, maddr);
-		g_free(maddr);
+void on_memory_read_error(GArray *nodes)
+{
+	if (page_cache_failed(memory_cache, atoi(parse_grab_token(nodes))))
+	{
+		/* a failed run is split into pages at once, a failed page is retried later */
+		memory_request_pages();
+		if (!memory_retry_id)
+		{
+			memory_retry_id = plugin_timeout_add(geany_plugin, MEMORY_RETRY_DELAY,
+				memory_retry, NULL);
+		}
 	}
 }
 
 void memory_clear(void)
 {
 	store_clear(store);
+	memory_count = 0;
+	page_cache_clear(memory_cache);
 }
 
 gboolean memory_update(void)
 {
 	if (memory_count)
 	{
-		debug_send_format(T, "04-data-read-memory-bytes 0x%" G_GINT64_MODIFIER "x %u",
-			memory_start, memory_count);
+		/* the visible pages are read again when drawn */
+		page_cache_clear(memory_cache);
+		memory_reconfigure();
+		gtk_widget_queue_draw(GTK_WIDGET(memory_tree));
 	}
 	return TRUE;
 }
 
+/* removes count lines from the start or the end of the range */
+static void memory_remove_lines(guint count, gboolean start)
+{
+	guint lines = (memory_count + bytes_per_line - 1) / bytes_per_line;
+	GtkTreeIter iter;
+	guint i;
+
+	for (i = 0; i < count; i++)
+		if (scp_tree_store_iter_nth_child(store, &iter, NULL, start ? 0 : lines - i - 1))
+			scp_tree_store_remove(store, &iter);
+
+	if (start)
+	{
+		memory_start += (guint64) count * bytes_per_line;
+		memory_count -= count * bytes_per_line;
+	}
+	else
+		memory_count = (lines - count) * bytes_per_line;
+}
+
+static gboolean memory_extending = FALSE;
+
+/* extends the range by a page before or after it, keeping the visible lines in view */
+static void memory_extend(gboolean back)
+{
+	guint lines = (memory_count + bytes_per_line - 1) / bytes_per_line;
+	guint max_lines = MAX_BYTES / bytes_per_line;
+	GtkTreePath *path;
+	gint first = -1, shift = 0;
+
+	if (gtk_tree_view_get_visible_range(memory_tree, &path, NULL))
+	{
+		first = gtk_tree_path_get_indices(path)[0];
+		gtk_tree_path_free(path);
+	}
+
+	if (back)
+	{
+		guint count = MIN((guint64) (MEMORY_PAGE + bytes_per_line - 1) / bytes_per_line,
+			memory_start / bytes_per_line);
+
+		if (!count)
+			return;
+
+		if (lines + count > max_lines)
+			memory_remove_lines(lines + count - max_lines, FALSE);
+
+		for (shift = 0; shift < (gint) count; shift++)
+		{
+			memory_start -= bytes_per_line;
+			scp_tree_store_prepend_with_values(store, NULL, NULL, MEMORY_ADDR, memory_start,
+				-1);
+		}
+		memory_count += count * bytes_per_line;
+	}
+	else
+	{
+		guint64 room = G_MAXUINT64 - (memory_start + memory_count - 1);
+		guint count = memory_count + (guint) MIN(room, MEMORY_PAGE);
+
+		if (!room)
+			return;
+
+		lines = (count + bytes_per_line - 1) / bytes_per_line;
+		if (lines > max_lines)
+		{
+			shift = max_lines - lines;
+			memory_remove_lines(lines - max_lines, TRUE);
+			count -= (lines - max_lines) * bytes_per_line;
+		}
+		memory_append_lines(count);
+	}
+
+	if (shift && first >= 0)
+	{
+		path = gtk_tree_path_new_from_indices(MAX(first + shift, 0), -1);
+		memory_extending = TRUE;
+		gtk_tree_view_scroll_to_cell(memory_tree, path, NULL, TRUE, 0, 0);
+		memory_extending = FALSE;
+		gtk_tree_path_free(path);
+	}
+
+	gtk_widget_queue_draw(GTK_WIDGET(memory_tree));
+}
+
+static void on_memory_adjustment_value_changed(GtkAdjustment *adjustment,
+	G_GNUC_UNUSED gpointer gdata)
+{
+	static gdouble last_value = 0;
+	gdouble value = gtk_adjustment_get_value(adjustment);
+	gdouble page_size = gtk_adjustment_get_page_size(adjustment);
+
+	if (memory_count && !memory_extending)
+	{
+		if (value + page_size * 2 >= gtk_adjustment_get_upper(adjustment))
+			memory_extend(FALSE);
+		else if (value < last_value && value <= gtk_adjustment_get_lower(adjustment) +
+			page_size)
+		{
+			memory_extend(TRUE);
+		}
+	}
+
+	last_value = gtk_adjustment_get_value(adjustment);
+}
+
+static gboolean on_memory_scroll_event(G_GNUC_UNUSED GtkWidget *widget,
+	GdkEventScroll *event, GtkAdjustment *adjustment)
+{
+	/* already at the top, no value change */
+	if (memory_count && event->direction == GDK_SCROLL_UP &&
+		gtk_adjustment_get_value(adjustment) <= gtk_adjustment_get_lower(adjustment))
+	{
+		memory_extend(TRUE);
+	}
+
+	return FALSE;
+}
+
 static void on_memory_refresh(G_GNUC_UNUSED const MenuItem *menu_item)
 {
-	debug_send_format(T, "-data-read-memory-bytes 0x%" G_GINT64_MODIFIER "x %u",
-		memory_start, memory_count);
+	memory_update();
 }
 
 static void on_memory_read(G_GNUC_UNUSED const MenuItem *menu_item)
@@ -296,23 +586,27 @@ static void on_memory_read(G_GNUC_UNUSED const MenuItem *menu_item)
 static void on_memory_copy(G_GNUC_UNUSED const MenuItem *menu_item)
 {
 	GtkTreeIter iter;
-	const char *addr, *bytes;
-	const gchar *ascii;
+	guint64 addr;
+	GString *bytes = g_string_new(NULL);
+	GString *ascii = g_string_new(NULL);
 	gchar *string;
 
 	gtk_tree_selection_get_selected(selection, NULL, &iter);
-	scp_tree_store_get(store, &iter, MEMORY_ADDR, &addr, MEMORY_BYTES, &bytes,
-		MEMORY_ASCII, &ascii, -1);
-	string = g_strdup_printf("%s%s%s", addr, bytes, ascii);
+	scp_tree_store_get(store, &iter, MEMORY_ADDR, &addr, -1);
+	memory_format_line(addr, bytes, ascii);
+	string = g_strdup_printf(addr_format, addr);
+	g_string_prepend(ascii, bytes->str);
+	g_string_prepend(ascii, string);
 	gtk_clipboard_set_text(gtk_widget_get_clipboard(menu_item->widget,
-		GDK_SELECTION_CLIPBOARD), string, -1);
+		GDK_SELECTION_CLIPBOARD), ascii->str, -1);
 	g_free(string);
+	g_string_free(bytes, TRUE);
+	g_string_free(ascii, TRUE);
 }
 
 static void on_memory_clear(G_GNUC_UNUSED const MenuItem *menu_item)
 {
-	store_clear(store);
-	memory_count = 0;
+	memory_clear();
 }
 
 static void on_memory_group_display(const MenuItem *menu_item)
@@ -329,7 +623,7 @@ static void on_memory_group_update(const MenuItem *menu_item)
 	back_bytes_per_line = 0;
 
 	if (memory_count)
-		on_memory_refresh(menu_item);
+		memory_update();
 }
 
 #define DS_FRESHABLE (DS_VRIABLE | DS_EXTRA_2)
@@ -371,6 +665,21 @@ static gboolean on_memory_key_press(G_GNUC_UNUSED GtkWidget *widget, GdkEventKey
 		return TRUE;
 	}
 
+	if (memory_count && (event->keyval == GDK_Up || event->keyval == GDK_KP_Up ||
+		event->keyval == GDK_Page_Up || event->keyval == GDK_KP_Page_Up))
+	{
+		GtkTreePath *path;
+
+		gtk_tree_view_get_cursor(memory_tree, &path, NULL);
+		if (path)
+		{
+			/* moving up from the first line */
+			if (!gtk_tree_path_get_indices(path)[0])
+				memory_extend(TRUE);
+			gtk_tree_path_free(path);
+		}
+	}
+
 	return FALSE;
 }
 
@@ -378,6 +687,32 @@ void memory_init(void)
 {
 	GtkWidget *tree = GTK_WIDGET(view_connect("memory_view", &store, &selection,
 		memory_cells, "memory_window", NULL));
+	GtkScrolledWindow *scrolled = GTK_SCROLLED_WINDOW(get_widget("memory_window"));
+	guint i;
+
+	memory_tree = GTK_TREE_VIEW(tree);
+	gtk_tree_view_column_set_cell_data_func(get_column("memory_addr_column"),
+		GTK_CELL_RENDERER(get_object("memory_addr")), memory_addr_cell_data_func, NULL, NULL);
+	gtk_tree_view_column_set_cell_data_func(get_column("memory_bytes_column"),
+		GTK_CELL_RENDERER(get_object("memory_bytes")), memory_line_cell_data_func,
+		GINT_TO_POINTER(MEMORY_BYTES), NULL);
+	gtk_tree_view_column_set_cell_data_func(get_column("memory_ascii_column"),
+		GTK_CELL_RENDERER(get_object("memory_ascii")), memory_line_cell_data_func,
+		GINT_TO_POINTER(MEMORY_ASCII), NULL);
+	g_signal_connect(gtk_scrolled_window_get_vadjustment(scrolled), "value-changed",
+		G_CALLBACK(on_memory_adjustment_value_changed), NULL);
+
+	memory_cache = page_cache_new();
+
+	for (i = 0; i < 0x100; i++)
+	{
+		char locale = i;
+
+		memory_chars[i] = i >= 0x20 && i < 0x80 ?
+			g_locale_to_utf8(&locale, 1, NULL, NULL, NULL) : NULL;
+		if (!memory_chars[i])
+			memory_chars[i] = g_strdup(".");  /* 0xfffd? */
+	}
 
 	memory_font = *pref_memory_font ? pref_memory_font : pref_vte_font;
 	ui_widget_modify_font_from_string(tree, memory_font);
@@ -385,6 +720,8 @@ void memory_init(void)
 		G_CALLBACK(on_memory_bytes_editing_started), NULL);
 	g_signal_connect(tree, "key-press-event", G_CALLBACK(on_memory_key_press),
 		(gpointer) menu_item_find(memory_menu_items, "memory_read"));
+	g_signal_connect(tree, "scroll-event", G_CALLBACK(on_memory_scroll_event),
+		gtk_scrolled_window_get_vadjustment(scrolled));
 
 	pointer_size = sizeof(void *) > sizeof &memory_init ? sizeof(void *) :
 		sizeof &memory_init;
@@ -402,5 +739,11 @@ void memory_init(void)
 
 void memory_finalize(void)
 {
+	guint i;
+
+	for (i = 0; i < 0x100; i++)
+		g_free(memory_chars[i]);
+
+	page_cache_free(memory_cache);
 	g_free(addr_format);
 }
@@ -20,6 +20,7 @@
 #ifndef MEMORY_H
 
 void on_memory_read_bytes(GArray *nodes);
+void on_memory_read_error(GArray *nodes);
 void on_memory_modified(GArray *nodes);
 
 void memory_clear(void);
@@ -0,0 +1,298 @@
+/*
+ *  pagecache.c
+ *
+ *  Copyright 2013 Dimitar Toshkov Zhekov <dimitar.zhekov@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+
+#include "pagecache.h"
+
+enum
+{
+	PAGE_QUEUED,
+	PAGE_SENT,
+	PAGE_READ,
+	PAGE_FAILED,
+	PAGE_RETRY
+};
+
+typedef struct _MemoryPage
+{
+	guint64 start;
+	guchar bytes[MEMORY_PAGE];
+	guchar known[MEMORY_PAGE / 8];
+	gint state;
+	gboolean single;  /* failed as part of a run, read alone */
+	guint failures;
+} MemoryPage;
+
+typedef struct _PageRun
+{
+	guint id;
+	guint64 start;
+	guint count;
+} PageRun;
+
+struct _PageCache
+{
+	GHashTable *pages;
+	GArray *queued;     /* page starts */
+	GArray *sent;       /* runs waiting for a reply */
+	guint last_id;
+	MemoryPage *last;   /* the last page looked up */
+};
+
+#define page_of(addr) ((addr) & ~(guint64) (MEMORY_PAGE - 1))
+
+static gint8 hex_values[0x100];
+
+PageCache *page_cache_new(void)
+{
+	PageCache *cache = g_new(PageCache, 1);
+	guint i;
+
+	cache->pages = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, g_free);
+	cache->queued = g_array_new(FALSE, FALSE, sizeof(guint64));
+	cache->sent = g_array_new(FALSE, FALSE, sizeof(PageRun));
+	cache->last_id = 0;
+	cache->last = NULL;
+
+	for (i = 0; i < 0x100; i++)
+		hex_values[i] = g_ascii_xdigit_value(i);
+
+	return cache;
+}
+
+void page_cache_clear(PageCache *cache)
+{
+	g_hash_table_remove_all(cache->pages);
+	g_array_set_size(cache->queued, 0);
+	g_array_set_size(cache->sent, 0);
+	cache->last = NULL;
+}
+
+void page_cache_free(PageCache *cache)
+{
+	g_hash_table_destroy(cache->pages);
+	g_array_free(cache->queued, TRUE);
+	g_array_free(cache->sent, TRUE);
+	g_free(cache);
+}
+
+static MemoryPage *page_lookup(PageCache *cache, guint64 start)
+{
+	if (!cache->last || cache->last->start != start)
+	{
+		MemoryPage *mp = (MemoryPage *) g_hash_table_lookup(cache->pages, &start);
+
+		if (!mp)
+			return NULL;
+
+		cache->last = mp;
+	}
+
+	return cache->last;
+}
+
+static MemoryPage *page_new(PageCache *cache, guint64 start, gint state)
+{
+	MemoryPage *mp = g_new0(MemoryPage, 1);
+
+	mp->start = start;
+	mp->state = state;
+	g_hash_table_insert(cache->pages, &mp->start, mp);
+	return cache->last = mp;
+}
+
+static void page_queue(PageCache *cache, MemoryPage *mp)
+{
+	mp->state = PAGE_QUEUED;
+	g_array_append_val(cache->queued, mp->start);
+}
+
+gint page_cache_byte(PageCache *cache, guint64 addr, gboolean read)
+{
+	MemoryPage *mp = page_lookup(cache, page_of(addr));
+	guint offset = addr & (MEMORY_PAGE - 1);
+
+	if (!mp)
+	{
+		if (!read)
+			return -1;
+
+		page_queue(cache, mp = page_new(cache, page_of(addr), PAGE_QUEUED));
+	}
+	else if (mp->state == PAGE_RETRY && read)
+		page_queue(cache, mp);
+
+	return mp->known[offset >> 3] & (1 << (offset & 7)) ? mp->bytes[offset] : -1;
+}
+
+gboolean page_cache_queued(PageCache *cache)
+{
+	return cache->queued->len != 0;
+}
+
+static gint page_compare(const guint64 *page1, const guint64 *page2)
+{
+	return *page1 < *page2 ? -1 : *page1 > *page2;
+}
+
+void page_cache_send(PageCache *cache, PageCacheFunc func, gpointer gdata)
+{
+	const guint64 *page = (const guint64 *) cache->queued->data;
+	const guint64 *end = page + cache->queued->len;
+
+	g_array_sort(cache->queued, (GCompareFunc) page_compare);
+
+	while (page < end)
+	{
+		MemoryPage *mp = page_lookup(cache, *page);
+		PageRun run = { ++cache->last_id, *page, 1 };
+
+		mp->state = PAGE_SENT;
+		if (!mp->single)
+		{
+			while (page + 1 < end && page[1] == *page + MEMORY_PAGE &&
+				!(mp = page_lookup(cache, page[1]))->single)
+			{
+				mp->state = PAGE_SENT;
+				run.count++;
+				page++;
+			}
+		}
+
+		g_array_append_val(cache->sent, run);
+		func(run.id, run.start, run.count * MEMORY_PAGE, gdata);
+		page++;
+	}
+
+	g_array_set_size(cache->queued, 0);
+}
+
+/* removes the run id from the sent runs into run */
+static gboolean page_run_take(PageCache *cache, guint id, PageRun *run)
+{
+	guint i;
+
+	for (i = 0; i < cache->sent->len; i++)
+	{
+		if (g_array_index(cache->sent, PageRun, i).id == id)
+		{
+			*run = g_array_index(cache->sent, PageRun, i);
+			g_array_remove_index(cache->sent, i);
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+gboolean page_cache_received(PageCache *cache, guint id)
+{
+	PageRun run;
+
+	if (page_run_take(cache, id, &run))
+	{
+		guint i;
+
+		for (i = 0; i < run.count; i++)
+			page_lookup(cache, run.start + i * MEMORY_PAGE)->state = PAGE_READ;
+
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+gboolean page_cache_failed(PageCache *cache, guint id)
+{
+	PageRun run;
+
+	if (page_run_take(cache, id, &run))
+	{
+		MemoryPage *mp;
+		guint i;
+
+		if (run.count > 1)
+		{
+			/* some of the pages may be readable */
+			for (i = 0; i < run.count; i++)
+			{
+				mp = page_lookup(cache, run.start + i * MEMORY_PAGE);
+				mp->single = TRUE;
+				page_queue(cache, mp);
+			}
+		}
+		else
+		{
+			mp = page_lookup(cache, run.start);
+			mp->state = PAGE_FAILED;
+			mp->failures++;
+		}
+
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+guint page_cache_retry(PageCache *cache)
+{
+	GHashTableIter iter;
+	MemoryPage *mp;
+	guint count = 0;
+
+	g_hash_table_iter_init(&iter, cache->pages);
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *) &mp))
+	{
+		if (mp->state == PAGE_FAILED && mp->failures <= PAGE_RETRIES)
+		{
+			mp->state = PAGE_RETRY;
+			count++;
+		}
+	}
+
+	return count;
+}
+
+gboolean page_cache_store(PageCache *cache, guint64 addr, const char *contents)
+{
+	MemoryPage *mp = NULL;
+
+	for (; contents[0] && contents[1]; contents += 2, addr++)
+	{
+		gint high = hex_values[(guchar) contents[0]];
+		gint low = hex_values[(guchar) contents[1]];
+		guint offset = addr & (MEMORY_PAGE - 1);
+
+		if ((high | low) < 0)
+			return FALSE;
+
+		if (!mp || !offset)
+		{
+			mp = page_lookup(cache, page_of(addr));
+			if (!mp)
+				mp = page_new(cache, page_of(addr), PAGE_READ);
+		}
+
+		mp->bytes[offset] = high << 4 | low;
+		mp->known[offset >> 3] |= 1 << (offset & 7);
+	}
+
+	return !*contents;
+}
@@ -0,0 +1,51 @@
+/*
+ *  pagecache.h
+ *
+ *  Copyright 2013 Dimitar Toshkov Zhekov <dimitar.zhekov@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PAGECACHE_H
+
+/* Cache of target memory, read from gdb a page at a time. A page that is not cached is
+   queued for reading when first asked for; the queued pages are sent as runs of consecutive
+   pages, each with an id to match the reply. A run that fails is queued again page by page,
+   and a single page that fails is retried on request, up to PAGE_RETRIES times. */
+typedef struct _PageCache PageCache;
+typedef void (*PageCacheFunc)(guint id, guint64 start, guint count, gpointer gdata);
+
+#define MEMORY_PAGE 0x400
+#define PAGE_RETRIES 3
+
+PageCache *page_cache_new(void);
+/* drops all pages; replies to the runs sent before are ignored */
+void page_cache_clear(PageCache *cache);
+void page_cache_free(PageCache *cache);
+/* returns the byte at addr, or -1 if unknown; with read, an uncached page is queued */
+gint page_cache_byte(PageCache *cache, guint64 addr, gboolean read);
+gboolean page_cache_queued(PageCache *cache);
+/* calls func for each run of queued pages, with count in bytes, and marks them as sent */
+void page_cache_send(PageCache *cache, PageCacheFunc func, gpointer gdata);
+/* the run id was read; returns FALSE if it's unknown, i.e. sent before a clear */
+gboolean page_cache_received(PageCache *cache, guint id);
+/* the run id failed; returns FALSE if it's unknown */
+gboolean page_cache_failed(PageCache *cache, guint id);
+/* makes the failed pages with retries left readable again; returns their count */
+guint page_cache_retry(PageCache *cache);
+/* stores the hex contents at addr; returns FALSE if they are invalid */
+gboolean page_cache_store(PageCache *cache, guint64 addr, const char *contents);
+
+#define PAGECACHE_H 1
+#endif
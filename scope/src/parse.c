@@ -63,15 +63,6 @@ static void on_data_modified(G_GNUC_UNUSED GArray *nodes)
 	views_data_dirty(DS_BUSY);
 }
 
-typedef struct _ParseRoute
-{
-	const char *prefix;
-	void (*callback)(GArray *nodes);
-	char mark;
-	char newline;
-	guint args;
-} ParseRoute;
-
 static const ParseRoute parse_routes[] =
 {
 	{ "*running,",                    on_thread_running,       '\0', '\0', 0 },
@@ -128,6 +119,7 @@ static const ParseRoute parse_routes[] =
 	{ "^error,",                      on_debug_load_error,     '1',  '\n', 0 },
 	{ "^error,",                      on_tooltip_error,        '3',  '\0', 0 },
 	{ "^error",                       on_quiet_error,          '4',  '\0', 0 },
+	{ "^error",                       on_memory_read_error,    '9',  '\0', 0 },
 	{ "^error,",                      on_watch_error,          '6',  '\t', 0 },
 	{ "^error,",                      on_debug_error,          '\0', '\n', 0 },
 	{ NULL, NULL, '\0', '\0', 0 }
@@ -234,16 +226,13 @@ static char *parse_text(GArray *nodes, char *text, char end, char newline)
 	return *text == end ? text + (end != '\0') : parse_error(", or end expected");
 }
 
+static RouteTable *parse_route_table;
+
 void parse_message(char *message, const char *token)
 {
-	const ParseRoute *route;
-
-	for (route = parse_routes; route->prefix; route++)
-		if (g_str_has_prefix(message, route->prefix))
-			if (!route->mark || (token && (route->mark == '*' || route->mark == *token)))
-				break;
+	const ParseRoute *route = route_table_find(parse_route_table, message, token);
 
-	if (route->callback)
+	if (route && route->callback)
 	{
 		GArray *nodes = g_array_new(FALSE, FALSE, sizeof(ParseNode));
 		const char *comma = strchr(route->prefix, ',');
@@ -623,9 +612,11 @@ void parse_init(void)
 	errors = g_string_sized_new(MAXLEN);
 	parse_modes = SCP_TREE_STORE(get_object("parse_mode_store"));
 	scp_tree_store_set_sort_column_id(parse_modes, MODE_NAME, GTK_SORT_ASCENDING);
+	parse_route_table = route_table_new(parse_routes);
 }
 
 void parse_finalize(void)
 {
 	g_string_free(errors, TRUE);
+	route_table_free(parse_route_table);
 }
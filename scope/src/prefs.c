@@ -39,9 +39,13 @@ gboolean pref_var_update_bug;
 gboolean pref_auto_view_source;
 gboolean pref_keep_exec_point;
 gint pref_visual_beep_length;
+gint pref_views_update_delay;
+gboolean pref_views_update_stats;
 #ifdef G_OS_UNIX
 gboolean pref_debug_console_vte;
 #endif
+gint pref_debug_console_delay;
+gint pref_debug_console_lines;
 
 gint pref_sci_marker_first;
 static gint pref_sci_marker_1st;
@@ -227,7 +231,7 @@ void prefs_init(void)
 	group = stash_group_new("scope");
 	stash_group_add_string(group, &pref_gdb_executable, "gdb_executable", "gdb");
 	stash_group_add_boolean(group, &pref_gdb_async_mode, "gdb_async_mode", FALSE);
-	stash_group_add_integer(group, &pref_gdb_buffer_length, "gdb_buffer_length", 32767);
+	stash_group_add_integer(group, &pref_gdb_buffer_length, "gdb_buffer_length", 0xFFFFF);
 	stash_group_add_integer(group, &pref_gdb_wait_death, "gdb_wait_death", 20);
 #ifndef G_OS_UNIX
 	stash_group_add_integer(group, &pref_gdb_send_interval, "gdb_send_interval", 5);
@@ -237,9 +241,13 @@ void prefs_init(void)
 	stash_group_add_boolean(group, &pref_auto_view_source, "auto_view_source", FALSE);
 	stash_group_add_boolean(group, &pref_keep_exec_point, "keep_exec_point", FALSE);
 	stash_group_add_integer(group, &pref_visual_beep_length, "visual_beep_length", 25);
+	stash_group_add_integer(group, &pref_views_update_delay, "views_update_delay", 10);
+	stash_group_add_boolean(group, &pref_views_update_stats, "views_update_stats", FALSE);
 #ifdef G_OS_UNIX
 	stash_group_add_boolean(group, &pref_debug_console_vte, "debug_console_vte", TRUE);
 #endif
+	stash_group_add_integer(group, &pref_debug_console_delay, "debug_console_delay", 4);
+	stash_group_add_integer(group, &pref_debug_console_lines, "debug_console_lines", 1000);
 	stash_group_add_integer(group, &pref_sci_marker_1st, "sci_marker_first", 17);
 	stash_group_add_integer(group, &pref_sci_caret_policy, "sci_caret_policy", CARET_SLOP |
 		CARET_JUMPS | CARET_EVEN);
@@ -32,9 +32,13 @@ extern gboolean pref_var_update_bug;
 extern gboolean pref_auto_view_source;
 extern gboolean pref_keep_exec_point;
 extern gint pref_visual_beep_length;
+extern gint pref_views_update_delay;
+extern gboolean pref_views_update_stats;
 #ifdef G_OS_UNIX
 extern gboolean pref_debug_console_vte;
 #endif
+extern gint pref_debug_console_delay;
+extern gint pref_debug_console_lines;
 
 extern gint pref_sci_marker_first;
 extern gint pref_sci_caret_policy;
@@ -0,0 +1,137 @@
+/*
+ *  recbuf.c
+ *
+ *  Copyright 2012 Dimitar Toshkov Zhekov <dimitar.zhekov@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "recbuf.h"
+
+/* The records before reading_pos are split, and there is no '\n' before scan_pos. The split
+   head of the text is dropped only when it is at least half of it, so the rest is moved
+   rarely. */
+struct _RecBuf
+{
+	GString *text;
+	gsize max_length;
+	gsize reading_pos;
+	gsize scan_pos;
+	gsize dropped;  /* bytes of the current record over max_length */
+};
+
+RecBuf *rec_buf_new(gsize max_length)
+{
+	RecBuf *buf = g_new0(RecBuf, 1);
+
+	buf->text = g_string_sized_new(REC_BUF_CHUNK);
+	buf->max_length = max_length;
+	return buf;
+}
+
+void rec_buf_clear(RecBuf *buf)
+{
+	g_string_truncate(buf->text, 0);
+	buf->reading_pos = buf->scan_pos = 0;
+	buf->dropped = 0;
+}
+
+void rec_buf_free(RecBuf *buf)
+{
+	g_string_free(buf->text, TRUE);
+	g_free(buf);
+}
+
+gboolean rec_buf_pending(RecBuf *buf)
+{
+	return buf->scan_pos < buf->text->len;
+}
+
+char *rec_buf_reserve(RecBuf *buf, gsize length)
+{
+	gsize len = buf->text->len;
+
+	g_string_set_size(buf->text, len + length);
+	g_string_truncate(buf->text, len);
+	return buf->text->str + len;
+}
+
+void rec_buf_commit(RecBuf *buf, gsize count)
+{
+	g_string_set_size(buf->text, buf->text->len + count);
+}
+
+void rec_buf_split(RecBuf *buf, RecBufFunc func, gpointer gdata)
+{
+	char *end;
+
+	/* func may split recursively, so each record is passed as a copy, and the text and
+	   positions are re-read after each call */
+	while ((end = memchr(buf->text->str + buf->scan_pos, '\n',
+		buf->text->len - buf->scan_pos)) != NULL)
+	{
+		gsize length = end - buf->text->str - buf->reading_pos;
+		gsize dropped = buf->dropped;
+		char *record;
+
+		if (length > buf->max_length)
+		{
+			dropped += length - buf->max_length;
+			length = buf->max_length;
+		}
+	#ifndef G_OS_UNIX
+		else if (length && end[-1] == '\r')
+			length--;
+	#endif
+		record = g_strndup(buf->text->str + buf->reading_pos, length);
+		buf->reading_pos = buf->scan_pos = end + 1 - buf->text->str;
+		buf->dropped = 0;
+		func(record, dropped, gdata);
+		g_free(record);
+	}
+
+	buf->scan_pos = buf->text->len;
+
+	/* keep the head of a long record only */
+	if (buf->text->len - buf->reading_pos > buf->max_length)
+	{
+		buf->dropped += buf->text->len - buf->reading_pos - buf->max_length;
+		g_string_truncate(buf->text, buf->reading_pos + buf->max_length);
+		buf->scan_pos = buf->text->len;
+	}
+
+	if (buf->reading_pos == buf->text->len)
+	{
+		/* give back the memory of a huge record */
+		if (buf->text->allocated_len > REC_BUF_CHUNK * 4)
+		{
+			g_string_free(buf->text, TRUE);
+			buf->text = g_string_sized_new(REC_BUF_CHUNK);
+		}
+		else
+			g_string_truncate(buf->text, 0);
+
+		buf->reading_pos = buf->scan_pos = 0;
+	}
+	else if (buf->reading_pos >= REC_BUF_CHUNK || buf->reading_pos > buf->text->len / 2)
+	{
+		g_string_erase(buf->text, 0, buf->reading_pos);
+		buf->scan_pos -= buf->reading_pos;
+		buf->reading_pos = 0;
+	}
+}
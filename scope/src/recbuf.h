@@ -0,0 +1,43 @@
+/*
+ *  recbuf.h
+ *
+ *  Copyright 2012 Dimitar Toshkov Zhekov <dimitar.zhekov@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RECBUF_H
+
+/* Splits the text received in chunks into '\n' terminated records. A record can be of any
+   length, but only the first max_length bytes are kept, and the rest is reported as
+   dropped. */
+typedef struct _RecBuf RecBuf;
+typedef void (*RecBufFunc)(char *record, gsize dropped, gpointer gdata);
+
+#define REC_BUF_CHUNK 0x10000
+
+RecBuf *rec_buf_new(gsize max_length);
+void rec_buf_clear(RecBuf *buf);
+void rec_buf_free(RecBuf *buf);
+/* TRUE if there is received text not yet split */
+gboolean rec_buf_pending(RecBuf *buf);
+/* returns room for length more bytes, and adds the count of them actually filled */
+char *rec_buf_reserve(RecBuf *buf, gsize length);
+void rec_buf_commit(RecBuf *buf, gsize count);
+/* calls func for each complete record, which it may modify; func may receive and split
+   more text into the same buffer */
+void rec_buf_split(RecBuf *buf, RecBufFunc func, gpointer gdata);
+
+#define RECBUF_H 1
+#endif
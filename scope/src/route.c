@@ -0,0 +1,140 @@
+/*
+ *  route.c
+ *
+ *  Copyright 2012 Dimitar Toshkov Zhekov <dimitar.zhekov@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <glib.h>
+
+#include "route.h"
+
+/* Routes with results are hashed by their prefix up to the first '=', which is either the
+   record class and comma, or the class and first result name. A message can only match the
+   routes from the lists for these two parts of it and the few routes without results, which
+   are merged back in table order. */
+struct _RouteTable
+{
+	GHashTable *lists;
+	GPtrArray *bare;
+};
+
+static void route_list_free(GPtrArray *routes)
+{
+	g_ptr_array_free(routes, TRUE);
+}
+
+RouteTable *route_table_new(const ParseRoute *routes)
+{
+	RouteTable *table = g_new(RouteTable, 1);
+	const ParseRoute *route;
+
+	table->lists = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify) route_list_free);
+	table->bare = g_ptr_array_new();
+
+	for (route = routes; route->prefix; route++)
+	{
+		const char *comma = strchr(route->prefix, ',');
+		const char *equal;
+		char *key;
+		GPtrArray *list;
+
+		if (!comma)
+		{
+			g_ptr_array_add(table->bare, (gpointer) route);
+			continue;
+		}
+
+		equal = strchr(comma, '=');
+		key = equal ? g_strndup(route->prefix, equal - route->prefix) : g_strdup(route->prefix);
+		list = (GPtrArray *) g_hash_table_lookup(table->lists, key);
+
+		if (list)
+			g_free(key);
+		else
+		{
+			list = g_ptr_array_new();
+			g_hash_table_insert(table->lists, key, list);
+		}
+
+		g_ptr_array_add(list, (gpointer) route);
+	}
+
+	return table;
+}
+
+static GPtrArray *route_list_lookup(RouteTable *table, char *message, size_t len)
+{
+	char c = message[len];
+	GPtrArray *list;
+
+	message[len] = '\0';
+	list = (GPtrArray *) g_hash_table_lookup(table->lists, message);
+	message[len] = c;
+	return list;
+}
+
+enum { ROUTE_BARE, ROUTE_COMMA, ROUTE_RESULT, ROUTE_LISTS };
+
+const ParseRoute *route_table_find(RouteTable *table, char *message, const char *token)
+{
+	const char *comma = strchr(message, ',');
+	const char *equal = comma ? strchr(comma, '=') : NULL;
+	GPtrArray *lists[ROUTE_LISTS];
+	guint next[ROUTE_LISTS] = { 0, 0, 0 };
+
+	lists[ROUTE_BARE] = table->bare;
+	lists[ROUTE_COMMA] = comma ? route_list_lookup(table, message, comma + 1 - message) :
+		NULL;
+	lists[ROUTE_RESULT] = equal && equal > comma + 1 ?
+		route_list_lookup(table, message, equal - message) : NULL;
+
+	for (;;)
+	{
+		const ParseRoute *route = NULL;
+		gint i, list = 0;
+
+		for (i = 0; i < ROUTE_LISTS; i++)
+		{
+			if (lists[i] && next[i] < lists[i]->len)
+			{
+				const ParseRoute *first = g_ptr_array_index(lists[i], next[i]);
+
+				if (!route || first < route)
+				{
+					route = first;
+					list = i;
+				}
+			}
+		}
+
+		if (!route)
+			return NULL;
+
+		next[list]++;
+		if (g_str_has_prefix(message, route->prefix))
+			if (!route->mark || (token && (route->mark == '*' || route->mark == *token)))
+				return route;
+	}
+}
+
+void route_table_free(RouteTable *table)
+{
+	g_hash_table_destroy(table->lists);
+	g_ptr_array_free(table->bare, TRUE);
+	g_free(table);
+}
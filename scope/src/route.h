@@ -0,0 +1,43 @@
+/*
+ *  route.h
+ *
+ *  Copyright 2012 Dimitar Toshkov Zhekov <dimitar.zhekov@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ROUTE_H
+
+/* A route sends the records starting with prefix to callback. With a mark, only the records
+   with a token starting with the mark, or with any token for '*', are routed. The first
+   matching route in the table wins. */
+typedef struct _ParseRoute
+{
+	const char *prefix;
+	void (*callback)(GArray *nodes);
+	char mark;
+	char newline;
+	guint args;
+} ParseRoute;
+
+typedef struct _RouteTable RouteTable;
+
+/* routes is terminated by a NULL prefix, and must outlive the table */
+RouteTable *route_table_new(const ParseRoute *routes);
+/* returns the first route matching message and token, or NULL */
+const ParseRoute *route_table_find(RouteTable *table, char *message, const char *token);
+void route_table_free(RouteTable *table);
+
+#define ROUTE_H 1
+#endif
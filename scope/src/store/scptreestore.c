@@ -54,6 +54,7 @@ struct _AElem
 {
 	AElem *parent;
 	GPtrArray *children;
+	guint index;  /* position in parent->children, may be outdated */
 	ScpTreeData data[1];
 };
 
@@ -72,6 +73,7 @@ struct _ScpTreeStorePrivate
 	guint sublevel_reserved;
 	gboolean sublevel_discard;
 	gboolean columns_dirty;
+	GHashTable **indexes;  /* per column, NULL if not indexed */
 };
 
 #define VALID_ITER(iter, store) \
@@ -85,6 +87,269 @@ struct _ScpTreeStorePrivate
 #define ITER_ELEM(iter) ((AElem *) ITER_ARRAY(iter)->pdata[ITER_INDEX(iter)])
 #define ELEM_SIZE(n_columns) (sizeof(AElem) + ((n_columns) - 1) * sizeof(ScpTreeData))
 
+#define scp_data_string(data) ((data)->v_string ? (data)->v_string : "")
+
+/* Index */
+
+static guint scp_index_string_hash(const gchar *key)
+{
+	return key ? g_str_hash(key) : 0;
+}
+
+static gboolean scp_index_string_equal(const gchar *a, const gchar *b)
+{
+	return !g_strcmp0(a, b);
+}
+
+static guint scp_index_int64_hash(const gint64 *key)
+{
+	return (guint) (*key ^ (*key >> 32));
+}
+
+static gboolean scp_index_int64_equal(const gint64 *a, const gint64 *b)
+{
+	return *a == *b;
+}
+
+static gboolean scp_index_type(GType type)
+{
+	switch (scp_tree_data_get_fundamental_type(type))
+	{
+		case G_TYPE_STRING  :
+		case G_TYPE_INT     :
+		case G_TYPE_ENUM    :
+		case G_TYPE_UINT    :
+		case G_TYPE_FLAGS   :
+		case G_TYPE_BOOLEAN :
+		case G_TYPE_LONG    :
+		case G_TYPE_ULONG   :
+		case G_TYPE_CHAR    :
+		case G_TYPE_UCHAR   :
+		case G_TYPE_INT64   :
+		case G_TYPE_UINT64  : return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* all non-string index keys are compared as gint64 */
+static gint64 scp_index_value(const ScpTreeData *data, GType type)
+{
+	switch (scp_tree_data_get_fundamental_type(type))
+	{
+		case G_TYPE_INT     :
+		case G_TYPE_ENUM    : return data->v_int;
+		case G_TYPE_UINT    :
+		case G_TYPE_FLAGS   : return data->v_uint;
+		case G_TYPE_BOOLEAN : return data->v_int != 0;
+		case G_TYPE_LONG    : return data->v_long;
+		case G_TYPE_ULONG   : return (gint64) data->v_ulong;
+		case G_TYPE_CHAR    : return data->v_char;
+		case G_TYPE_UCHAR   : return data->v_uchar;
+		case G_TYPE_INT64   : return data->v_int64;
+		case G_TYPE_UINT64  : return (gint64) data->v_uint64;
+	}
+
+	return 0;
+}
+
+static gpointer scp_index_key(ScpTreeStorePrivate *priv, AElem *elem, gint column)
+{
+	ScpTreeDataHeader *header = priv->headers + column;
+	ScpTreeData *data = elem->data + column;
+	gint64 *value;
+
+	if (scp_tree_data_get_fundamental_type(header->type) == G_TYPE_STRING)
+	{
+		return header->utf8_collate ? g_utf8_collate_key(scp_data_string(data), -1) :
+			g_strdup(data->v_string);
+	}
+
+	value = g_new(gint64, 1);
+	*value = scp_index_value(data, header->type);
+	return value;
+}
+
+/* The index maps each key to a list of the elements with that key. The first element
+   is never changed when adding, so that the lists can be updated in place. */
+static void scp_index_add(ScpTreeStore *store, AElem *elem, gint column)
+{
+	GHashTable *index = store->priv->indexes[column];
+	gpointer key = scp_index_key(store->priv, elem, column);
+	GSList *elems = (GSList *) g_hash_table_lookup(index, key);
+
+	if (elems)
+	{
+		elems->next = g_slist_prepend(elems->next, elem);
+		g_free(key);
+	}
+	else
+		g_hash_table_insert(index, key, g_slist_prepend(NULL, elem));
+}
+
+static void scp_index_remove(ScpTreeStore *store, AElem *elem, gint column)
+{
+	GHashTable *index = store->priv->indexes[column];
+	gpointer key = scp_index_key(store->priv, elem, column);
+	gpointer orig_key;
+	GSList *elems;
+
+	if (g_hash_table_lookup_extended(index, key, &orig_key, (gpointer *) &elems))
+	{
+		if (elems->data != elem)
+			elems->next = g_slist_remove(elems->next, elem);
+		else if (!elems->next)
+			g_hash_table_remove(index, key);
+		else
+		{
+			g_hash_table_steal(index, key);
+			g_hash_table_insert(index, orig_key, elems->next);
+			g_slist_free_1(elems);
+		}
+	}
+
+	g_free(key);
+}
+
+#define scp_index_column(priv, elem, column) \
+	((priv)->indexes && (priv)->indexes[column] && (elem)->parent)
+
+static void scp_index_element(ScpTreeStore *store, AElem *elem, gboolean add)
+{
+	ScpTreeStorePrivate *priv = store->priv;
+	guint i;
+
+	for (i = 0; i < priv->n_columns; i++)
+	{
+		if (priv->indexes[i])
+		{
+			if (add)
+				scp_index_add(store, elem, i);
+			else
+				scp_index_remove(store, elem, i);
+		}
+	}
+}
+
+static void scp_index_array(ScpTreeStore *store, GPtrArray *array, gint column)
+{
+	if (array)
+	{
+		guint i;
+
+		for (i = 0; i < array->len; i++)
+		{
+			AElem *elem = (AElem *) array->pdata[i];
+
+			scp_index_add(store, elem, column);
+			scp_index_array(store, elem->children, column);
+		}
+	}
+}
+
+static void scp_index_create(ScpTreeStore *store, gint column)
+{
+	ScpTreeStorePrivate *priv = store->priv;
+
+	if (scp_tree_data_get_fundamental_type(priv->headers[column].type) == G_TYPE_STRING)
+	{
+		priv->indexes[column] = g_hash_table_new_full((GHashFunc) scp_index_string_hash,
+			(GEqualFunc) scp_index_string_equal, g_free, (GDestroyNotify) g_slist_free);
+	}
+	else
+	{
+		priv->indexes[column] = g_hash_table_new_full((GHashFunc) scp_index_int64_hash,
+			(GEqualFunc) scp_index_int64_equal, g_free, (GDestroyNotify) g_slist_free);
+	}
+
+	scp_index_array(store, priv->root->children, column);
+}
+
+static void scp_index_destroy(ScpTreeStore *store, gint column)
+{
+	g_hash_table_destroy(store->priv->indexes[column]);
+	store->priv->indexes[column] = NULL;
+}
+
+static void scp_indexes_free(ScpTreeStore *store)
+{
+	ScpTreeStorePrivate *priv = store->priv;
+
+	if (priv->indexes)
+	{
+		guint i;
+
+		for (i = 0; i < priv->n_columns; i++)
+			if (priv->indexes[i])
+				scp_index_destroy(store, i);
+
+		g_free(priv->indexes);
+		priv->indexes = NULL;
+	}
+}
+
+static guint scp_elem_index(AElem *elem)
+{
+	GPtrArray *array = elem->parent->children;
+
+	if (elem->index >= array->len || array->pdata[elem->index] != elem)
+	{
+		guint i;
+
+		for (i = 0; i < array->len; i++)
+			((AElem *) array->pdata[i])->index = i;
+	}
+
+	return elem->index;
+}
+
+static gboolean scp_elem_within(AElem *elem, AElem *parent, gboolean sublevels)
+{
+	if (sublevels)
+	{
+		while ((elem = elem->parent) != NULL)
+			if (elem == parent)
+				return TRUE;
+
+		return FALSE;
+	}
+
+	return elem->parent == parent;
+}
+
+static gint scp_elem_depth(AElem *elem)
+{
+	gint depth = 0;
+
+	while ((elem = elem->parent) != NULL)
+		depth++;
+
+	return depth;
+}
+
+/* whether a comes before b in the linear (depth-first) order */
+static gboolean scp_elem_precedes(AElem *a, AElem *b)
+{
+	gint depth_a = scp_elem_depth(a);
+	gint depth_b = scp_elem_depth(b);
+
+	for (; depth_a > depth_b; depth_a--)
+		if ((a = a->parent) == b)
+			return FALSE;
+
+	for (; depth_b > depth_a; depth_b--)
+		if ((b = b->parent) == a)
+			return TRUE;
+
+	while (a->parent != b->parent)
+	{
+		a = a->parent;
+		b = b->parent;
+	}
+
+	return scp_elem_index(a) < scp_elem_index(b);
+}
+
 /* Store */
 
 static void scp_ptr_array_insert_val(GPtrArray *array, guint index, gpointer data)
@@ -101,9 +366,10 @@ static void scp_free_array(ScpTreeStore *store, GPtrArray *array)
 {
 	if (array)
 	{
-		guint i;
+		gint i;
 
-		for (i = 0; i < array->len; i++)
+		/* last first, which removes them from the index lists in O(1) */
+		for (i = (gint) array->len - 1; i >= 0; i--)
 			scp_free_element(store, (AElem *) array->pdata[i]);
 		g_ptr_array_free(array, TRUE);
 	}
@@ -116,6 +382,9 @@ static void scp_free_element(ScpTreeStore *store, AElem *elem)
 
 	scp_free_array(store, elem->children);
 
+	if (priv->indexes && elem->parent)
+		scp_index_element(store, elem, FALSE);
+
 	for (i = 0; i < priv->n_columns; i++)
 		scp_tree_data_free(elem->data + i, priv->headers[i].type);
 
@@ -167,6 +436,8 @@ gboolean scp_tree_store_set_column_types(ScpTreeStore *store, gint n_columns, GT
 	g_return_val_if_fail(SCP_IS_TREE_STORE(store), FALSE);
 	g_return_val_if_fail(!priv->columns_dirty, FALSE);
 
+	scp_indexes_free(store);
+
 	if (priv->headers)
 		scp_tree_data_headers_free(priv->n_columns, priv->headers);
 
@@ -361,6 +632,7 @@ static void scp_set_vector(ScpTreeStore *store, AElem *elem, gboolean *changed,
 	for (i = 0; i < n_values; i++)
 	{
 		gint column = columns[i];
+		gboolean indexed;
 
 		if ((guint) column >= priv->n_columns)
 		{
@@ -369,9 +641,15 @@ static void scp_set_vector(ScpTreeStore *store, AElem *elem, gboolean *changed,
 			break;
 		}
 
+		if ((indexed = scp_index_column(priv, elem, column)) != FALSE)
+			scp_index_remove(store, elem, column);
+
 		if (scp_set_value(store, elem, column, values + i))
 			*changed = TRUE;
 
+		if (indexed)
+			scp_index_add(store, elem, column);
+
 		if (column == priv->sort_column_id)
 			*sort_changed = TRUE;
 	}
@@ -388,6 +666,8 @@ static void scp_set_valist(ScpTreeStore *store, AElem *elem, gboolean *changed,
 
 	while ((column = va_arg(ap, int)) != -1)
 	{
+		gboolean indexed;
+
 		if ((guint) column >= priv->n_columns)
 		{
 			g_warning("%s: Invalid column number %d added to iter (remember to end "
@@ -395,9 +675,15 @@ static void scp_set_valist(ScpTreeStore *store, AElem *elem, gboolean *changed,
 			break;
 		}
 
+		if ((indexed = scp_index_column(priv, elem, column)) != FALSE)
+			scp_index_remove(store, elem, column);
+
 		scp_tree_data_from_stack(elem->data + column, priv->headers[column].type, ap, TRUE);
 		*changed = TRUE;
 
+		if (indexed)
+			scp_index_add(store, elem, column);
+
 		if (column == priv->sort_column_id)
 			*sort_changed = TRUE;
 	}
@@ -561,6 +847,10 @@ static gboolean scp_insert_element(ScpTreeStore *store, GtkTreeIter *iter, AElem
 	if (priv->sort_func)
 		scp_sort_element(store, iter, FALSE);
 
+	elem->index = ITER_INDEX(iter);
+	if (priv->indexes)
+		scp_index_element(store, elem, TRUE);
+
 	priv->columns_dirty = TRUE;
 	path = scp_tree_store_get_path(store, iter);
 	gtk_tree_model_row_inserted(SCP_TREE_MODEL(store), path, iter);
@@ -1135,7 +1425,17 @@ static void scp_copy_element(ScpTreeStore *store, GtkTreeIter *src_iter,
 	guint i;
 
 	for (i = 0; i < priv->n_columns; i++)
+	{
+		gboolean indexed = scp_index_column(priv, dest, i);
+
+		if (indexed)
+			scp_index_remove(store, dest, i);
+
 		scp_tree_data_copy(elem->data + i, dest->data + i, priv->headers[i].type);
+
+		if (indexed)
+			scp_index_add(store, dest, i);
+	}
 	gtk_tree_model_row_changed(SCP_TREE_MODEL(store), path, dest_iter);
 	gtk_tree_path_free(path);
 
@@ -1384,6 +1684,7 @@ typedef struct _GSListSubParserData
 	const gchar *name;
 	GArray *types;
 	GArray *collates;
+	GArray *indexes;
 } GSListSubParserData;
 
 static void tree_model_start_element(G_GNUC_UNUSED GMarkupParseContext *context,
@@ -1400,6 +1701,7 @@ static void tree_model_start_element(G_GNUC_UNUSED GMarkupParseContext *context,
 		{
 			GType type = gtk_builder_get_type_from_name(data->builder, values[i]);
 			gboolean collate = g_type_is_a(type, G_TYPE_STRING);
+			gboolean indexed = FALSE;
 
 			if (type == G_TYPE_INVALID)
 			{
@@ -1409,9 +1711,10 @@ static void tree_model_start_element(G_GNUC_UNUSED GMarkupParseContext *context,
 
 			g_array_append_val(data->types, type);
 			g_array_append_val(data->collates, collate);
+			g_array_append_val(data->indexes, indexed);
 			type_processed = TRUE;
 		}
-		else if (!strcmp(names[i], "utf8_collate"))
+		else if (!strcmp(names[i], "utf8_collate") || !strcmp(names[i], "indexed"))
 		{
 			GValue value = G_VALUE_INIT;
 			GError *error = NULL;
@@ -1430,7 +1733,9 @@ static void tree_model_start_element(G_GNUC_UNUSED GMarkupParseContext *context,
 			}
 			else
 			{
-				g_array_index(data->collates, gboolean, data->collates->len - 1) =
+				GArray *array = *names[i] == 'u' ? data->collates : data->indexes;
+
+				g_array_index(array, gboolean, array->len - 1) =
 					g_value_get_boolean(&value);
 				g_value_unset(&value);
 			}
@@ -1453,8 +1758,13 @@ static void tree_model_end_element(G_GNUC_UNUSED GMarkupParseContext *context,
 			(GType *) data->types->data);
 
 		for (i = 0; i < data->collates->len; i++)
+		{
 			if (g_array_index(data->collates, gboolean, i))
 				scp_tree_store_set_utf8_collate(SCP_TREE_STORE(data->object), i, TRUE);
+
+			if (g_array_index(data->indexes, gboolean, i))
+				scp_tree_store_set_indexed(SCP_TREE_STORE(data->object), i, TRUE);
+		}
 	}
 }
 
@@ -1478,6 +1788,7 @@ static gboolean scp_tree_store_buildable_custom_tag_start(GtkBuildable *buildabl
 		parser_data->name = gtk_buildable_get_name(buildable);
 		parser_data->types = g_array_new(FALSE, FALSE, sizeof(GType));
 		parser_data->collates = g_array_new(FALSE, FALSE, sizeof(gboolean));
+		parser_data->indexes = g_array_new(FALSE, FALSE, sizeof(gboolean));
 		*parser = tree_model_parser;
 		*user_data = parser_data;
 		return TRUE;
@@ -1496,6 +1807,7 @@ static void scp_tree_store_buildable_custom_finished(G_GNUC_UNUSED GtkBuildable
 
 		g_array_free(data->types, TRUE);
 		g_array_free(data->collates, TRUE);
+		g_array_free(data->indexes, TRUE);
 		g_slice_free(GSListSubParserData, data);
 	}
 }
@@ -1523,6 +1835,12 @@ void scp_tree_store_set_utf8_collate(ScpTreeStore *store, gint column, gboolean
 		{
 			priv->headers[column].utf8_collate = collate;
 
+			if (priv->indexes && priv->indexes[column])
+			{
+				scp_index_destroy(store, column);
+				scp_index_create(store, column);
+			}
+
 			if (priv->sort_func && (priv->sort_column_id == column ||
 				priv->sort_func != scp_tree_model_compare_func))
 			{
@@ -1543,7 +1861,38 @@ gboolean scp_tree_store_get_utf8_collate(ScpTreeStore *store, gint column)
 	return priv->headers[column].utf8_collate;
 }
 
-#define scp_data_string(data) ((data)->v_string ? (data)->v_string : "")
+void scp_tree_store_set_indexed(ScpTreeStore *store, gint column, gboolean indexed)
+{
+	ScpTreeStorePrivate *priv = store->priv;
+
+	g_return_if_fail(SCP_IS_TREE_STORE(store));
+	g_return_if_fail((guint) column < priv->n_columns);
+
+	if (!scp_index_type(priv->headers[column].type))
+	{
+		if (indexed)
+			g_warning("%s: Attempt to index a column of unsupported type\n", G_STRFUNC);
+	}
+	else if (indexed)
+	{
+		if (!priv->indexes)
+			priv->indexes = g_new0(GHashTable *, priv->n_columns);
+
+		if (!priv->indexes[column])
+			scp_index_create(store, column);
+	}
+	else if (priv->indexes && priv->indexes[column])
+		scp_index_destroy(store, column);
+}
+
+gboolean scp_tree_store_get_indexed(ScpTreeStore *store, gint column)
+{
+	ScpTreeStorePrivate *priv = store->priv;
+
+	g_return_val_if_fail(SCP_IS_TREE_STORE(store), FALSE);
+	g_return_val_if_fail((guint) column < priv->n_columns, FALSE);
+	return priv->indexes && priv->indexes[column];
+}
 
 gint scp_tree_store_compare_func(ScpTreeStore *store, GtkTreeIter *a, GtkTreeIter *b,
 	gpointer data)
@@ -1664,11 +2013,48 @@ static gboolean scp_binary_search(GPtrArray *array, gint column, ScpTreeData *da
 	return FALSE;
 }
 
+static gboolean scp_index_search(ScpTreeStore *store, AElem *parent, gint column,
+	ScpTreeData *data, GType type, GtkTreeIter *iter, gboolean sublevels)
+{
+	gint64 value;
+	gpointer key;
+	GSList *elems;
+	AElem *found = NULL;
+
+	if (type == G_TYPE_NONE || scp_tree_data_get_fundamental_type(type) == G_TYPE_STRING)
+		key = data->v_string;
+	else
+	{
+		value = scp_index_value(data, type);
+		key = &value;
+	}
+
+	for (elems = (GSList *) g_hash_table_lookup(store->priv->indexes[column], key); elems;
+		elems = elems->next)
+	{
+		AElem *elem = (AElem *) elems->data;
+
+		if (scp_elem_within(elem, parent, sublevels) &&
+			(!found || scp_elem_precedes(elem, found)))
+		{
+			found = elem;
+		}
+	}
+
+	if (found)
+	{
+		iter->user_data = found->parent->children;
+		iter->user_data2 = GINT_TO_POINTER(scp_elem_index(found));
+	}
+
+	return found != NULL;
+}
+
 gboolean scp_tree_store_search(ScpTreeStore *store, gboolean sublevels, gboolean linear_order,
 	GtkTreeIter *iter, GtkTreeIter *parent, gint column, ...)
 {
 	ScpTreeStorePrivate *priv = store->priv;
-	GPtrArray *array;
+	AElem *parent_elem;
 	GType type;
 	va_list ap;
 	ScpTreeData data;
@@ -1679,7 +2065,7 @@ gboolean scp_tree_store_search(ScpTreeStore *store, gboolean sublevels, gboolean
 	g_return_val_if_fail((guint) column < priv->n_columns, FALSE);
 	g_return_val_if_fail(sublevels == FALSE || priv->sublevels == TRUE, FALSE);
 
-	array = (parent ? ITER_ELEM(parent) : priv->root)->children;
+	parent_elem = parent ? ITER_ELEM(parent) : priv->root;
 	type = priv->headers[column].type;
 	iter->stamp = priv->stamp;
 	iter->user_data = NULL;
@@ -1693,10 +2079,19 @@ gboolean scp_tree_store_search(ScpTreeStore *store, gboolean sublevels, gboolean
 		data.v_string = g_utf8_collate_key(scp_data_string(&data), -1);
 	}
 
-	found = !linear_order && column == priv->sort_column_id &&
-		priv->sort_func == scp_tree_model_compare_func ?
-		scp_binary_search(array, column, &data, type, iter, sublevels) :
-		scp_linear_search(array, column, &data, type, iter, sublevels);
+	if (priv->indexes && priv->indexes[column])
+		found = scp_index_search(store, parent_elem, column, &data, type, iter, sublevels);
+	else if (!linear_order && column == priv->sort_column_id &&
+		priv->sort_func == scp_tree_model_compare_func)
+	{
+		found = scp_binary_search(parent_elem->children, column, &data, type, iter,
+			sublevels);
+	}
+	else
+	{
+		found = scp_linear_search(parent_elem->children, column, &data, type, iter,
+			sublevels);
+	}
 
 	if (type == G_TYPE_NONE)
 		g_free(data.v_string);
@@ -1871,6 +2266,7 @@ static GObject *scp_tree_store_constructor(GType type, guint n_construct_propert
 	priv->sublevel_reserved = 0;
 	priv->sublevel_discard = FALSE;
 	priv->columns_dirty = FALSE;
+	priv->indexes = NULL;
 	return object;
 }
 
@@ -1956,6 +2352,7 @@ static void scp_tree_store_finalize(GObject *object)
 	ScpTreeStore *store = SCP_TREE_STORE(object);
 	ScpTreeStorePrivate *priv = store->priv;
 
+	scp_indexes_free(store);
 	scp_free_array(store, priv->root->children);
 	g_free(priv->root);
 	g_ptr_array_free(priv->roar, TRUE);
@@ -593,23 +593,55 @@ void threads_clear(void)
 	thread_count = 0;
 }
 
+/* thread lines by file, rebuilt on demand after the store changes */
+static LineMap *thread_lines;
+static gboolean thread_lines_valid = FALSE;
+
+static void on_thread_lines_changed(G_GNUC_UNUSED GtkTreeModel *model)
+{
+	thread_lines_valid = FALSE;
+}
+
+typedef struct _ThreadDelta
+{
+	ScintillaObject *sci;
+	gint start;
+	gint delta;
+} ThreadDelta;
+
+static void thread_delta_mark(gint line, G_GNUC_UNUSED gpointer data, ThreadDelta *td)
+{
+	utils_move_mark(td->sci, line, td->start, td->delta, MARKER_EXECUTE);
+}
+
 void threads_delta(ScintillaObject *sci, const char *real_path, gint start, gint delta)
 {
-	GtkTreeIter iter;
-	gboolean valid = scp_tree_store_get_iter_first(store, &iter);
+	ThreadDelta td = { sci, start, delta };
 
-	while (valid)
+	if (!thread_lines_valid)
 	{
-		const char *file;
-		gint line;
+		GtkTreeIter iter;
+		gboolean valid = scp_tree_store_get_iter_first(store, &iter);
 
-		scp_tree_store_get(store, &iter, THREAD_FILE, &file, THREAD_LINE, &line, -1);
+		line_map_clear(thread_lines);
+
+		while (valid)
+		{
+			const char *file;
+			gint line;
 
-		if (--line >= 0 && start <= line && !utils_filenamecmp(file, real_path))
-			utils_move_mark(sci, line, start, delta, MARKER_EXECUTE);
+			scp_tree_store_get(store, &iter, THREAD_FILE, &file, THREAD_LINE, &line, -1);
 
-		valid = scp_tree_store_iter_next(store, &iter);
+			if (file && --line >= 0)
+				line_map_add(thread_lines, file, line, NULL);
+
+			valid = scp_tree_store_iter_next(store, &iter);
+		}
+
+		thread_lines_valid = TRUE;
 	}
+
+	line_map_foreach(thread_lines, real_path, start, (LineMapFunc) thread_delta_mark, &td);
 }
 
 gboolean threads_update(void)
@@ -882,6 +914,10 @@ void thread_init(void)
 	view_set_sort_func(store, THREAD_PID, thread_ident_compare);
 	view_set_sort_func(store, THREAD_GROUP_ID, thread_ident_compare);
 	view_set_sort_func(store, THREAD_TARGET_ID, thread_ident_compare);
+	thread_lines = line_map_new(NULL);
+	g_signal_connect(store, "row-inserted", G_CALLBACK(on_thread_lines_changed), NULL);
+	g_signal_connect(store, "row-changed", G_CALLBACK(on_thread_lines_changed), NULL);
+	g_signal_connect(store, "row-deleted", G_CALLBACK(on_thread_lines_changed), NULL);
 	gtk_widget_set_has_tooltip(GTK_WIDGET(tree), TRUE);
 	g_signal_connect(tree, "query-tooltip", G_CALLBACK(on_view_query_base_tooltip),
 		get_column("thread_base_name_column"));
@@ -907,4 +943,5 @@ void thread_finalize(void)
 {
 	store_foreach(store, (GFunc) thread_iter_unmark, NULL);
 	set_gdb_thread(NULL, FALSE);
+	line_map_free(thread_lines);
 }
@@ -97,21 +97,41 @@ void view_dirty(ViewIndex index)
 	views[index].dirty = TRUE;
 }
 
+/* Refreshing the views after a stop keeps gdb busy, which makes fast stepping slow. Changes
+   of the context that come in quicker than pref_views_update_delay are coalesced: the refresh
+   is postponed, and postponed again if yet another change arrives meanwhile. */
+static GTimer *update_timer;
+static guint update_source_id = 0;
+static UpdateDelay update_delay = { 0, FALSE, -1 };
+static gdouble update_first = -1;  /* the oldest change not refreshed yet, -1 for none */
+static guint update_coalesced = 0;
+
+static struct _UpdateStats
+{
+	guint count;
+	guint coalesced;
+	gdouble total;
+	gdouble max;
+} update_stats;
+
 void views_context_dirty(DebugState state, gboolean frame_only)
 {
 	ViewIndex i;
+	gdouble now = g_timer_elapsed(update_timer, NULL);
 
 	for (i = 0; i < VIEW_COUNT; i++)
 		if (views[i].context >= (frame_only ? VC_FRAME : VC_DATA))
 			view_dirty(i);
 
+	update_delay_change(&update_delay, now, pref_views_update_delay / 100.0);
+
+	if (update_first < 0)
+		update_first = now;
+	else
+		update_coalesced++;
+
 	if (state != DS_BUSY)
-	{
-		if (option_update_all_views)
-			views_update(state);
-		else
-			views_sidebar_update(gtk_notebook_get_current_page(geany_sidebar), state);
-	}
+		views_update(state);
 }
 
 #ifdef G_OS_UNIX
@@ -132,23 +152,73 @@ void views_clear(void)
 		if (view->clear)
 			view->clear();
 	}
+
+	if (update_source_id)
+	{
+		g_source_remove(update_source_id);
+		update_source_id = 0;
+	}
+
+	if (pref_views_update_stats && update_stats.count)
+	{
+		gchar *text = g_strdup_printf(_("views refreshed %u times, %u changes coalesced, "
+			"%.0f ms average, %.0f ms max"), update_stats.count, update_stats.coalesced,
+			update_stats.total / update_stats.count * 1000, update_stats.max * 1000);
+		dc_output_nl(4, text, -1);
+		g_free(text);
+	}
+
+	memset(&update_stats, 0, sizeof update_stats);
+	update_delay_reset(&update_delay);
+	update_first = -1;
+	update_coalesced = 0;
 }
 
-void views_update(DebugState state)
+static GtkWidget *debug_panel;
+
+/* hidden views stay dirty and are updated when shown */
+static gboolean view_visible(ViewIndex index)
 {
+	switch (index)
+	{
+		case VIEW_INSPECT : return gtk_widget_get_mapped(inspect_page);
+		case VIEW_REGISTERS : return gtk_widget_get_mapped(register_page);
+		case VIEW_TOOLTIP :
+		case VIEW_POPMENU : return TRUE;
+		default : return index == view_current && gtk_widget_get_mapped(debug_panel);
+	}
+}
+
+static void views_update_settled(void)
+{
+	gdouble latency = g_timer_elapsed(update_timer, NULL) - update_first;
+
+	update_stats.count++;
+	update_stats.coalesced += update_coalesced;
+	update_stats.total += latency;
+	update_stats.max = MAX(update_stats.max, latency);
+
+	if (pref_views_update_stats)
+	{
+		gchar *text = g_strdup_printf(_("views refreshed in %.0f ms, %u changes coalesced"),
+			latency * 1000, update_coalesced);
+		dc_output_nl(4, text, -1);
+		g_free(text);
+	}
+
+	update_first = -1;
+	update_coalesced = 0;
+}
+
+static void views_refresh(DebugState state)
+{
+	update_delay.delayed = FALSE;
+
 	if (option_update_all_views)
 	{
 		ViewIndex i;
 		gboolean skip_frame = FALSE;
 
-		if (thread_state == THREAD_QUERY_FRAME)
-		{
-			if (!views[VIEW_THREADS].dirty)
-				thread_query_frame('4');
-
-			thread_state = THREAD_STOPPED;
-		}
-
 		for (i = 0; i < VIEW_COUNT; i++)
 		{
 			if (views[i].dirty && (!skip_frame || views[i].context != VC_FRAME))
@@ -162,18 +232,56 @@ void views_update(DebugState state)
 	}
 	else
 	{
-		if (thread_state == THREAD_QUERY_FRAME)
-		{
-			if (view_current != VIEW_THREADS || !views[VIEW_THREADS].dirty)
-				thread_query_frame('4');
+		if (view_visible(view_current))
+			view_update(view_current, state);
+		view_update(VIEW_TOOLTIP, state);
+		if (view_visible(VIEW_INSPECT))
+			view_update(VIEW_INSPECT, state);
+		else if (view_visible(VIEW_REGISTERS))
+			view_update(VIEW_REGISTERS, state);
+	}
+
+	/* nothing more to send for the current context */
+	if (update_first >= 0 && debug_state() != DS_BUSY)
+		views_update_settled();
+}
+
+static gboolean views_update_timeout(gpointer gdata)
+{
+	DebugState state = debug_state();
+
+	update_source_id = 0;
+	update_delay_expired(&update_delay, GPOINTER_TO_UINT(gdata));
+
+	if (state & DS_SENDABLE)
+		views_update(state);
+
+	return FALSE;
+}
 
-			thread_state = THREAD_STOPPED;
+void views_update(DebugState state)
+{
+	if (thread_state == THREAD_QUERY_FRAME)
+	{
+		if ((!option_update_all_views && !view_visible(VIEW_THREADS)) ||
+			!views[VIEW_THREADS].dirty)
+		{
+			thread_query_frame('4');
 		}
 
-		view_update(view_current, state);
-		view_update(VIEW_TOOLTIP, state);
-		views_sidebar_update(gtk_notebook_get_current_page(geany_sidebar), state);
+		thread_state = THREAD_STOPPED;
+	}
+
+	if (update_source_id)
+		return;
+
+	if (update_delay.delayed && pref_views_update_delay > 0)
+	{
+		update_source_id = plugin_timeout_add(geany_plugin, pref_views_update_delay * 10,
+			views_update_timeout, GUINT_TO_POINTER(update_delay.token));
 	}
+	else
+		views_refresh(state);
 }
 
 gboolean view_stack_update(void)
@@ -604,6 +712,17 @@ static void on_geany_sidebar_switch_page(G_GNUC_UNUSED GtkNotebook *notebook,
 	views_sidebar_update(page_num, debug_state());
 }
 
+static void on_view_mapped(G_GNUC_UNUSED GtkWidget *widget, gpointer gdata)
+{
+	DebugState state = debug_state();
+
+	if (state != DS_BUSY)
+	{
+		ViewIndex index = GPOINTER_TO_INT(gdata);
+		view_update(index == VIEW_COUNT ? view_current : index, state);
+	}
+}
+
 static gulong switch_sidebar_page_id;
 
 void views_init(void)
@@ -645,10 +764,22 @@ void views_init(void)
 	gtk_notebook_append_page(geany_sidebar, inspect_page, get_widget("inspect_label"));
 	register_page = get_widget("register_page");
 	gtk_notebook_append_page(geany_sidebar, register_page, get_widget("register_label"));
+
+	debug_panel = get_widget("debug_panel");
+	g_signal_connect(debug_panel, "map", G_CALLBACK(on_view_mapped),
+		GINT_TO_POINTER(VIEW_COUNT));
+	g_signal_connect(inspect_page, "map", G_CALLBACK(on_view_mapped),
+		GINT_TO_POINTER(VIEW_INSPECT));
+	g_signal_connect(register_page, "map", G_CALLBACK(on_view_mapped),
+		GINT_TO_POINTER(VIEW_REGISTERS));
+	update_timer = g_timer_new();
 }
 
 void views_finalize(void)
 {
+	if (update_source_id)
+		g_source_remove(update_source_id);
+	g_timer_destroy(update_timer);
 	g_signal_handler_disconnect(geany_sidebar, switch_sidebar_page_id);
 	gtk_widget_destroy(GTK_WIDGET(command_dialog));
 	gtk_widget_destroy(inspect_page);
@@ -0,0 +1,1641 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <check.h>
+
+#include <gtk/gtk.h>
+#ifdef G_OS_UNIX
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+#include "conbuf.h"
+#include "delay.h"
+#include "linemap.h"
+#include "pagecache.h"
+#include "recbuf.h"
+#include "route.h"
+#include "store/scptreestore.h"
+
+
+/* Collects the entries the map reports as "line:data" */
+static void
+collect(gint line, gpointer data, gpointer gdata)
+{
+	GString *str = gdata;
+	g_string_append_printf(str, "%s%d:%s", str->len ? " " : "", line, (const char *) data);
+}
+
+
+static gchar *
+entries(LineMap *map, const char *file, gint start)
+{
+	GString *str = g_string_new(NULL);
+	line_map_foreach(map, file, start, collect, str);
+	return g_string_free(str, FALSE);
+}
+
+
+static void
+check_entries(LineMap *map, const char *file, const char *expected)
+{
+	gchar *result = entries(map, file, 0);
+	fail_unless(strcmp(result, expected) == 0, "%s: expected \"%s\", got \"%s\"",
+		    file, expected, result);
+	g_free(result);
+}
+
+
+static LineMap *
+sample_map(void)
+{
+	LineMap *map = line_map_new(NULL);
+
+	line_map_add(map, "/a.c", 20, "a20");
+	line_map_add(map, "/a.c", 5, "a5");
+	line_map_add(map, "/b.c", 10, "b10");
+	line_map_add(map, "/a.c", 10, "a10");
+	line_map_add(map, "/b.c", 3, "b3");
+	return map;
+}
+
+
+START_TEST(test_add)
+{
+	LineMap *map = sample_map();
+	gchar *result;
+
+	check_entries(map, "/a.c", "5:a5 10:a10 20:a20");
+	check_entries(map, "/b.c", "3:b3 10:b10");
+	check_entries(map, "/c.c", "");
+
+	result = entries(map, "/a.c", 10);
+	fail_unless(strcmp(result, "10:a10 20:a20") == 0);
+	g_free(result);
+	result = entries(map, "/a.c", 21);
+	fail_unless(strcmp(result, "") == 0);
+	g_free(result);
+
+	/* entries on the same line keep their order of addition */
+	line_map_add(map, "/a.c", 10, "a10b");
+	check_entries(map, "/a.c", "5:a5 10:a10 10:a10b 20:a20");
+	line_map_free(map);
+}
+
+END_TEST;
+
+START_TEST(test_insert)
+{
+	LineMap *map = sample_map();
+	GString *moved = g_string_new(NULL);
+
+	line_map_delta(map, "/a.c", 10, 3, collect, NULL, moved);
+	fail_unless(strcmp(moved->str, "13:a10 23:a20") == 0, "moved \"%s\"", moved->str);
+	check_entries(map, "/a.c", "5:a5 13:a10 23:a20");
+	/* other files are not affected */
+	check_entries(map, "/b.c", "3:b3 10:b10");
+
+	line_map_delta(map, "/b.c", 0, 1, NULL, NULL, NULL);
+	check_entries(map, "/b.c", "4:b3 11:b10");
+	check_entries(map, "/a.c", "5:a5 13:a10 23:a20");
+
+	/* after the last entry */
+	line_map_delta(map, "/a.c", 24, 10, NULL, NULL, NULL);
+	check_entries(map, "/a.c", "5:a5 13:a10 23:a20");
+	/* unknown file */
+	line_map_delta(map, "/c.c", 0, 10, NULL, NULL, NULL);
+	check_entries(map, "/c.c", "");
+
+	g_string_free(moved, TRUE);
+	line_map_free(map);
+}
+
+END_TEST;
+
+typedef struct
+{
+	GString *moved;
+	GString *removed;
+} Changes;
+
+
+static void
+on_moved(gint line, gpointer data, gpointer gdata)
+{
+	collect(line, data, ((Changes *) gdata)->moved);
+}
+
+
+static void
+on_removed(gint line, gpointer data, gpointer gdata)
+{
+	collect(line, data, ((Changes *) gdata)->removed);
+}
+
+
+START_TEST(test_delete)
+{
+	LineMap *map = sample_map();
+	Changes changes = { g_string_new(NULL), g_string_new(NULL) };
+
+	/* lines 8 and 9 go away, nothing on them */
+	line_map_delta(map, "/a.c", 8, -2, on_moved, on_removed, &changes);
+	fail_unless(changes.removed->len == 0);
+	fail_unless(strcmp(changes.moved->str, "8:a10 18:a20") == 0);
+	check_entries(map, "/a.c", "5:a5 8:a10 18:a20");
+
+	/* lines 8..17 go away, with the entry on 8 */
+	g_string_truncate(changes.moved, 0);
+	line_map_delta(map, "/a.c", 8, -10, on_moved, on_removed, &changes);
+	fail_unless(strcmp(changes.removed->str, "8:a10") == 0, "removed \"%s\"",
+		    changes.removed->str);
+	fail_unless(strcmp(changes.moved->str, "8:a20") == 0, "moved \"%s\"",
+		    changes.moved->str);
+	check_entries(map, "/a.c", "5:a5 8:a20");
+	check_entries(map, "/b.c", "3:b3 10:b10");
+
+	g_string_truncate(changes.removed, 0);
+	line_map_delta(map, "/b.c", 2, -2, NULL, on_removed, &changes);
+	fail_unless(strcmp(changes.removed->str, "3:b3") == 0);
+	check_entries(map, "/b.c", "8:b10");
+	check_entries(map, "/a.c", "5:a5 8:a20");
+
+	g_string_free(changes.moved, TRUE);
+	g_string_free(changes.removed, TRUE);
+	line_map_free(map);
+}
+
+END_TEST;
+
+static gint destroyed;
+
+static void
+count_destroy(G_GNUC_UNUSED gpointer data)
+{
+	destroyed++;
+}
+
+START_TEST(test_destroy)
+{
+	LineMap *map = line_map_new(count_destroy);
+
+	destroyed = 0;
+	line_map_add(map, "/a.c", 1, NULL);
+	line_map_add(map, "/a.c", 2, NULL);
+	line_map_add(map, "/b.c", 2, NULL);
+	line_map_delta(map, "/a.c", 1, -1, NULL, NULL, NULL);
+	fail_unless(destroyed == 1);
+	line_map_clear(map);
+	fail_unless(destroyed == 3);
+	fail_unless(line_map_empty(map));
+	line_map_add(map, "/a.c", 1, NULL);
+	line_map_free(map);
+	fail_unless(destroyed == 4);
+}
+
+END_TEST;
+
+#define RANDOM_FILES 3
+#define RANDOM_ENTRIES 50
+
+static const char *random_files[RANDOM_FILES] = { "/a.c", "/b.c", "/c.c" };
+static gint random_lines[RANDOM_FILES][RANDOM_ENTRIES];
+
+
+/* Checks an entry against the expected lines, gdata points to the previous line */
+static void
+check_random(gint line, gpointer data, gpointer gdata)
+{
+	gint *args = gdata;  /* file, previous line, count */
+
+	fail_unless(line >= args[1], "entries out of order");
+	fail_unless(random_lines[args[0]][GPOINTER_TO_INT(data)] == line,
+		    "%s: entry %d at %d, expected %d", random_files[args[0]],
+		    GPOINTER_TO_INT(data), line, random_lines[args[0]][GPOINTER_TO_INT(data)]);
+	args[1] = line;
+	args[2]++;
+}
+
+
+START_TEST(test_random)
+{
+	LineMap *map = line_map_new(NULL);
+	gint i, j, k;
+
+	srand(1);
+	for (k = 0; k < RANDOM_FILES; k++)
+	{
+		for (j = 0; j < RANDOM_ENTRIES; j++)
+		{
+			random_lines[k][j] = rand() % 200;
+			line_map_add(map, random_files[k], random_lines[k][j], GINT_TO_POINTER(j));
+		}
+	}
+
+	for (i = 0; i < 1000; i++)
+	{
+		gint start = rand() % 220;
+		gint delta = rand() % 21 - 10;
+
+		/* the same edit, applied the way breaks_delta() used to */
+		k = rand() % RANDOM_FILES;
+		for (j = 0; j < RANDOM_ENTRIES; j++)
+		{
+			gint *line = &random_lines[k][j];
+
+			if (*line >= start)
+				*line = delta > 0 || start - delta <= *line ? *line + delta : -1;
+		}
+		line_map_delta(map, random_files[k], start, delta, NULL, NULL, NULL);
+
+		for (k = 0; k < RANDOM_FILES; k++)
+		{
+			gint args[3] = { k, 0, 0 };
+			gint count = 0;
+
+			for (j = 0; j < RANDOM_ENTRIES; j++)
+				count += random_lines[k][j] >= 0;
+			line_map_foreach(map, random_files[k], 0, check_random, args);
+			fail_unless(args[2] == count, "%s: expected %d entries, got %d",
+				    random_files[k], count, args[2]);
+		}
+	}
+	line_map_free(map);
+}
+
+END_TEST;
+
+/* ScpTreeStore indexes */
+
+enum
+{
+	STORE_ID,
+	STORE_NUM
+};
+
+
+static ScpTreeStore *
+store_new(gboolean sublevels, gboolean indexed)
+{
+	ScpTreeStore *store = scp_tree_store_new(sublevels, 2, G_TYPE_STRING, G_TYPE_INT);
+
+	scp_tree_store_set_indexed(store, STORE_ID, indexed);
+	scp_tree_store_set_indexed(store, STORE_NUM, indexed);
+	return store;
+}
+
+
+/* Returns the path of the row found as a string, or NULL */
+static gchar *
+search_num(ScpTreeStore *store, gboolean sublevels, GtkTreeIter *parent, gint num)
+{
+	GtkTreeIter iter;
+
+	if (scp_tree_store_search(store, sublevels, FALSE, &iter, parent, STORE_NUM, num))
+		return gtk_tree_model_get_string_from_iter(GTK_TREE_MODEL(store), &iter);
+	return NULL;
+}
+
+
+static void
+check_search(ScpTreeStore *store, gboolean sublevels, GtkTreeIter *parent, gint num,
+	     const gchar *expected)
+{
+	gchar *path = search_num(store, sublevels, parent, num);
+
+	fail_unless(!g_strcmp0(path, expected), "%d: expected %s, got %s", num,
+		    expected ? expected : "none", path ? path : "none");
+	g_free(path);
+}
+
+
+START_TEST(test_index_search)
+{
+	ScpTreeStore *store = store_new(FALSE, TRUE);
+	GtkTreeIter iter, iter1;
+
+	scp_tree_store_append_with_values(store, &iter, NULL, STORE_ID, "a", STORE_NUM, 1, -1);
+	scp_tree_store_append_with_values(store, NULL, NULL, STORE_ID, "b", STORE_NUM, 2, -1);
+	scp_tree_store_append_with_values(store, &iter1, NULL, STORE_ID, "c", STORE_NUM, 3, -1);
+	fail_unless(scp_tree_store_get_indexed(store, STORE_ID));
+	fail_unless(scp_tree_store_search(store, FALSE, FALSE, &iter1, NULL, STORE_ID, "b"));
+	fail_unless(scp_tree_store_iter_tell(store, &iter1) == 1);
+	fail_if(scp_tree_store_search(store, FALSE, FALSE, &iter1, NULL, STORE_ID, "d"));
+
+	/* duplicates: the first one in order */
+	scp_tree_store_set(store, &iter, STORE_NUM, 2, -1);
+	check_search(store, FALSE, NULL, 2, "0");
+	check_search(store, FALSE, NULL, 1, NULL);
+	scp_tree_store_remove(store, &iter);
+	check_search(store, FALSE, NULL, 2, "0");
+	check_search(store, FALSE, NULL, 3, "1");
+
+	/* moving rows doesn't touch the index */
+	scp_tree_store_get_iter_first(store, &iter);
+	scp_tree_store_iter_nth_child(store, &iter1, NULL, 1);
+	scp_tree_store_swap(store, &iter, &iter1);
+	check_search(store, FALSE, NULL, 3, "0");
+	scp_tree_store_prepend_with_values(store, NULL, NULL, STORE_NUM, 2, -1);
+	check_search(store, FALSE, NULL, 2, "0");
+	check_search(store, FALSE, NULL, 3, "1");
+
+	scp_tree_store_set_indexed(store, STORE_NUM, FALSE);
+	fail_if(scp_tree_store_get_indexed(store, STORE_NUM));
+	check_search(store, FALSE, NULL, 3, "1");
+	g_object_unref(store);
+}
+
+END_TEST;
+
+START_TEST(test_index_sublevels)
+{
+	ScpTreeStore *store = store_new(TRUE, TRUE);
+	GtkTreeIter iter, iter1, child;
+
+	scp_tree_store_append_with_values(store, &iter, NULL, STORE_NUM, 1, -1);
+	scp_tree_store_append_with_values(store, &child, &iter, STORE_NUM, 5, -1);
+	scp_tree_store_append_with_values(store, NULL, &iter, STORE_NUM, 5, -1);
+	scp_tree_store_append_with_values(store, &iter1, NULL, STORE_NUM, 5, -1);
+
+	check_search(store, FALSE, NULL, 5, "1");
+	check_search(store, TRUE, NULL, 5, "0:0");
+	check_search(store, FALSE, &iter, 5, "0:0");
+	check_search(store, TRUE, &iter1, 5, NULL);
+	scp_tree_store_remove(store, &child);
+	check_search(store, TRUE, NULL, 5, "0:0");
+	/* removing a row removes its children from the index */
+	scp_tree_store_remove(store, &iter);
+	check_search(store, TRUE, NULL, 5, "0");
+	scp_tree_store_clear(store);
+	check_search(store, TRUE, NULL, 5, NULL);
+	g_object_unref(store);
+}
+
+END_TEST;
+
+START_TEST(test_index_collate)
+{
+	ScpTreeStore *store = store_new(FALSE, TRUE);
+	GtkTreeIter iter;
+
+	scp_tree_store_append_with_values(store, NULL, NULL, STORE_ID, "b", -1);
+	scp_tree_store_append_with_values(store, NULL, NULL, STORE_ID, NULL, -1);
+	fail_unless(scp_tree_store_search(store, FALSE, FALSE, &iter, NULL, STORE_ID, "b"));
+	/* collated strings treat NULL as "" */
+	fail_unless(scp_tree_store_search(store, FALSE, FALSE, &iter, NULL, STORE_ID, ""));
+	scp_tree_store_set_utf8_collate(store, STORE_ID, FALSE);
+	fail_if(scp_tree_store_search(store, FALSE, FALSE, &iter, NULL, STORE_ID, ""));
+	fail_unless(scp_tree_store_search(store, FALSE, FALSE, &iter, NULL, STORE_ID, NULL));
+	fail_unless(scp_tree_store_iter_tell(store, &iter) == 1);
+	g_object_unref(store);
+}
+
+END_TEST;
+
+/* Returns a random row of store, or NULL for the top level */
+static gchar *
+random_path(ScpTreeStore *store)
+{
+	GString *path = g_string_new(NULL);
+	GtkTreeIter iter, *parent = NULL;
+	gint count;
+
+	while ((count = scp_tree_store_iter_n_children(store, parent)) > 0 && rand() % 3)
+	{
+		gint n = rand() % count;
+
+		scp_tree_store_iter_nth_child(store, &iter, parent, n);
+		g_string_append_printf(path, "%s%d", path->len ? ":" : "", n);
+		parent = &iter;
+	}
+
+	return g_string_free(path, !path->len);
+}
+
+
+static gboolean
+get_iter(ScpTreeStore *store, GtkTreeIter *iter, const gchar *path)
+{
+	return path && gtk_tree_model_get_iter_from_string(GTK_TREE_MODEL(store), iter, path);
+}
+
+
+START_TEST(test_index_random)
+{
+	ScpTreeStore *stores[2] = { store_new(TRUE, TRUE), store_new(TRUE, FALSE) };
+	gint i, k;
+
+	srand(1);
+	for (i = 0; i < 20000; i++)
+	{
+		gchar *path = random_path(stores[0]);
+		gint op = rand() % 10;
+		gint num = rand() % 20;
+		gint position = rand() % 4;
+		gboolean sublevels = rand() % 2;
+		gchar *results[2];
+
+		for (k = 0; k < 2; k++)
+		{
+			GtkTreeIter iter, iter1;
+			gboolean valid = get_iter(stores[k], &iter, path);
+
+			results[k] = NULL;
+			if (op < 4 || (op < 6 && !valid))
+			{
+				gint count = scp_tree_store_iter_n_children(stores[k],
+					valid ? &iter : NULL);
+
+				scp_tree_store_insert_with_values(stores[k], NULL, valid ? &iter : NULL,
+					MIN(position, count), STORE_NUM, num, -1);
+			}
+			else if (op < 6)
+				scp_tree_store_remove(stores[k], &iter);
+			else if (op < 7 && valid)
+				scp_tree_store_set(stores[k], &iter, STORE_NUM, num, -1);
+			else if (op < 8 && valid)
+			{
+				iter1 = iter;
+				if (scp_tree_store_iter_seek(stores[k], &iter1, -1))
+					scp_tree_store_swap(stores[k], &iter, &iter1);
+			}
+			else
+				results[k] = search_num(stores[k], sublevels, valid ? &iter : NULL, num);
+		}
+
+		fail_unless(!g_strcmp0(results[0], results[1]), "search %d under %s: %s, expected %s",
+			    num, path ? path : "top", results[0] ? results[0] : "none",
+			    results[1] ? results[1] : "none");
+		g_free(results[0]);
+		g_free(results[1]);
+		g_free(path);
+
+		if (scp_tree_store_iter_n_children(stores[0], NULL) > 30)
+		{
+			for (k = 0; k < 2; k++)
+			{
+				GtkTreeIter iter;
+
+				scp_tree_store_get_iter_first(stores[k], &iter);
+				scp_tree_store_remove(stores[k], &iter);
+			}
+		}
+	}
+
+	g_object_unref(stores[0]);
+	g_object_unref(stores[1]);
+}
+
+END_TEST;
+
+#define LARGE_STORE_ROWS 100000
+
+/* linear searches through 100k rows would take minutes and time out */
+START_TEST(test_index_large)
+{
+	ScpTreeStore *store = store_new(FALSE, TRUE);
+	GtkTreeIter iter;
+	gchar id[16];
+	gint i;
+
+	for (i = 0; i < LARGE_STORE_ROWS; i++)
+	{
+		g_snprintf(id, sizeof id, "%d", i);
+		scp_tree_store_append_with_values(store, NULL, NULL, STORE_ID, id, STORE_NUM,
+			LARGE_STORE_ROWS - i, -1);
+	}
+
+	for (i = 0; i < LARGE_STORE_ROWS; i++)
+	{
+		g_snprintf(id, sizeof id, "%d", i);
+		fail_unless(scp_tree_store_search(store, FALSE, FALSE, &iter, NULL, STORE_ID, id));
+		fail_unless(scp_tree_store_iter_tell(store, &iter) == i);
+		fail_unless(scp_tree_store_search(store, FALSE, FALSE, &iter, NULL, STORE_NUM,
+			LARGE_STORE_ROWS - i));
+		fail_unless(scp_tree_store_iter_tell(store, &iter) == i);
+	}
+
+	/* every removal from the front outdates the positions */
+	for (i = 0; i < 1000; i++)
+	{
+		scp_tree_store_get_iter_first(store, &iter);
+		scp_tree_store_remove(store, &iter);
+		g_snprintf(id, sizeof id, "%d", LARGE_STORE_ROWS - 1);
+		fail_unless(scp_tree_store_search(store, FALSE, FALSE, &iter, NULL, STORE_ID, id));
+		fail_unless(scp_tree_store_iter_tell(store, &iter) == LARGE_STORE_ROWS - i - 2);
+	}
+
+	g_object_unref(store);
+}
+
+END_TEST;
+
+/* Fills parent with LARGE_STORE_ROWS children, like listed varobjs: all with the same num,
+   and without id except for every 100th */
+static void
+append_shared(ScpTreeStore *store, GtkTreeIter *parent)
+{
+	gchar id[16];
+	gint i;
+
+	for (i = 0; i < LARGE_STORE_ROWS; i++)
+	{
+		g_snprintf(id, sizeof id, "%d", i);
+		scp_tree_store_append_with_values(store, NULL, parent, STORE_ID,
+			i % 100 ? NULL : id, STORE_NUM, 0, -1);
+	}
+}
+
+
+/* removing many rows with the same key must not search the key list for each one */
+START_TEST(test_index_shared)
+{
+	ScpTreeStore *store = store_new(TRUE, TRUE);
+	GtkTreeIter iter, parent;
+
+	scp_tree_store_set_utf8_collate(store, STORE_ID, FALSE);
+	scp_tree_store_append_with_values(store, &parent, NULL, STORE_ID, "top", STORE_NUM, 1,
+		-1);
+	append_shared(store, &parent);
+	fail_unless(scp_tree_store_search(store, TRUE, FALSE, &iter, NULL, STORE_ID, "500"));
+	fail_unless(scp_tree_store_iter_tell(store, &iter) == 500);
+	check_search(store, TRUE, NULL, 0, "0:0");
+
+	/* the removed rows are gone from the index */
+	scp_tree_store_clear_children(store, &parent, FALSE);
+	fail_if(scp_tree_store_search(store, TRUE, FALSE, &iter, NULL, STORE_ID, "500"));
+	check_search(store, TRUE, NULL, 0, NULL);
+	check_search(store, TRUE, NULL, 1, "0");
+
+	append_shared(store, &parent);
+	scp_tree_store_remove(store, &parent);
+	fail_if(scp_tree_store_search(store, TRUE, FALSE, &iter, NULL, STORE_ID, "500"));
+	fail_if(scp_tree_store_search(store, TRUE, FALSE, &iter, NULL, STORE_ID, "top"));
+	check_search(store, TRUE, NULL, 0, NULL);
+	g_object_unref(store);
+}
+
+END_TEST;
+
+/* Collects the flushed runs as "fd:text" */
+static void
+collect_runs(int fd, const char *text, gint length, gpointer gdata)
+{
+	g_string_append_printf(gdata, "%d:%.*s|", fd, length, text);
+}
+
+
+static void
+check_flush(ConBuf *buf, guint dropped, const char *expected)
+{
+	GString *str = g_string_new(NULL);
+
+	fail_unless(con_buf_dropped(buf) == dropped, "expected %u dropped, got %u", dropped,
+		    con_buf_dropped(buf));
+	con_buf_flush(buf, collect_runs, str);
+	fail_unless(strcmp(str->str, expected) == 0, "expected \"%s\", got \"%s\"",
+		    expected, str->str);
+	fail_unless(con_buf_empty(buf));
+	g_string_free(str, TRUE);
+}
+
+
+START_TEST(test_con_buf_runs)
+{
+	ConBuf *buf = con_buf_new();
+
+	fail_unless(con_buf_empty(buf));
+	con_buf_append(buf, 0, "cmd\n", -1, 0);
+	con_buf_append(buf, 1, "out", -1, 0);
+	con_buf_append(buf, 1, "put\n", -1, 0);
+	con_buf_append(buf, 1, "", -1, 0);
+	con_buf_append(buf, 3, "(gdb) ", 6, 0);
+	fail_unless(!con_buf_empty(buf));
+	check_flush(buf, 0, "0:cmd\n|1:output\n|3:(gdb) |");
+	check_flush(buf, 0, "");
+
+	con_buf_append(buf, 2, "error", -1, 0);
+	con_buf_clear(buf);
+	fail_unless(con_buf_empty(buf));
+	con_buf_free(buf);
+}
+
+END_TEST;
+
+START_TEST(test_con_buf_drop)
+{
+	ConBuf *buf = con_buf_new();
+
+	con_buf_append(buf, 1, "a\nb\n", -1, 3);
+	con_buf_append(buf, 2, "c\nd", -1, 3);
+	check_flush(buf, 0, "1:a\nb\n|2:c\nd|");
+
+	/* whole runs and part of a run are dropped, incomplete lines are kept */
+	con_buf_append(buf, 1, "a\n", -1, 2);
+	con_buf_append(buf, 2, "b\nc", -1, 2);
+	con_buf_append(buf, 1, "\nd\ne", -1, 2);
+	check_flush(buf, 2, "2:c|1:\nd\ne|");
+
+	con_buf_append(buf, 1, "a\nb\nc\n", -1, 1);
+	fail_unless(!con_buf_empty(buf));
+	con_buf_clear(buf);
+	check_flush(buf, 0, "");
+	con_buf_free(buf);
+}
+
+END_TEST;
+
+#define FLOOD_LINES 200000
+#define FLOOD_LIMIT 100
+
+typedef struct _FloodCheck
+{
+	gint next;     /* expected number of the next line */
+	GString *line;
+} FloodCheck;
+
+static void
+check_flood_run(G_GNUC_UNUSED int fd, const char *text, gint length, gpointer gdata)
+{
+	FloodCheck *check = gdata;
+	const char *end = text + length;
+	const char *s;
+
+	while ((s = memchr(text, '\n', end - text)) != NULL)
+	{
+		g_string_append_len(check->line, text, s - text);
+		fail_unless(atoi(check->line->str) == check->next, "expected line %d, got \"%s\"",
+			    check->next, check->line->str);
+		check->next++;
+		g_string_truncate(check->line, 0);
+		text = s + 1;
+	}
+
+	g_string_append_len(check->line, text, end - text);
+}
+
+static void
+flood_flush(ConBuf *buf, FloodCheck *check, guint *dropped)
+{
+	guint count = con_buf_dropped(buf);
+
+	if (count)
+	{
+		/* the first line dropped is the rest of the last line flushed, if any */
+		g_string_truncate(check->line, 0);
+		check->next += count;
+		*dropped += count;
+	}
+
+	con_buf_flush(buf, check_flood_run, check);
+}
+
+/* a child process writes numbered lines as fast as it can, while the buffer is flushed
+   every few reads; whatever is dropped, the lines seen must be consecutive between the
+   drops, and all lines must be accounted for */
+START_TEST(test_con_buf_flood)
+{
+#ifdef G_OS_UNIX
+	ConBuf *buf = con_buf_new();
+	FloodCheck check = { 0, g_string_new(NULL) };
+	guint dropped = 0, reads = 0;
+	char buffer[0x1000];
+	int fds[2];
+	pid_t pid;
+	ssize_t count;
+
+	fail_unless(pipe(fds) == 0);
+	pid = fork();
+	fail_unless(pid != -1);
+
+	if (pid == 0)
+	{
+		GString *out = g_string_new(NULL);
+		gint i;
+
+		close(fds[0]);
+		for (i = 0; i < FLOOD_LINES; i++)
+		{
+			g_string_append_printf(out, "%d\n", i);
+
+			/* not aligned to lines */
+			if (out->len >= 1000)
+			{
+				if (write(fds[1], out->str, 1000) != 1000)
+					_exit(1);
+				g_string_erase(out, 0, 1000);
+			}
+		}
+		_exit(write(fds[1], out->str, out->len) != (ssize_t) out->len);
+	}
+
+	close(fds[1]);
+	while ((count = read(fds[0], buffer, sizeof buffer)) > 0)
+	{
+		con_buf_append(buf, 1, buffer, count, FLOOD_LIMIT);
+
+		if (++reads % 16 == 0)
+		{
+			flood_flush(buf, &check, &dropped);
+		}
+	}
+	close(fds[0]);
+	waitpid(pid, NULL, 0);
+
+	flood_flush(buf, &check, &dropped);
+	fail_unless(check.next == FLOOD_LINES);
+	fail_unless(check.line->len == 0);
+	fail_unless(dropped > 0);
+	g_string_free(check.line, TRUE);
+	con_buf_free(buf);
+#endif
+}
+
+END_TEST;
+
+/* drives an UpdateDelay the way views_update() and its timeout do, on a simulated clock:
+   a refresh is done at once unless delayed, and a delayed one arms a single timeout */
+#define DELAY_INTERVAL 0.1
+
+typedef struct _DelaySim
+{
+	UpdateDelay delay;
+	gboolean armed;
+	guint armed_token;
+	gdouble fire_at;
+	guint refreshes;
+	gdouble refreshed_at;
+} DelaySim;
+
+
+static void
+delay_sim_update(DelaySim *sim, gdouble now)
+{
+	if (sim->armed)
+		return;
+
+	if (sim->delay.delayed)
+	{
+		sim->armed = TRUE;
+		sim->armed_token = sim->delay.token;
+		sim->fire_at = now + DELAY_INTERVAL;
+	}
+	else
+	{
+		sim->refreshes++;
+		sim->refreshed_at = now;
+	}
+}
+
+
+/* fires the timeouts due until the given time */
+static void
+delay_sim_run(DelaySim *sim, gdouble until)
+{
+	guint fired = 0;
+
+	while (sim->armed && sim->fire_at <= until)
+	{
+		gdouble now = sim->fire_at;
+
+		sim->armed = FALSE;
+		update_delay_expired(&sim->delay, sim->armed_token);
+		delay_sim_update(sim, now);
+		fail_unless(++fired < 1000, "the delayed refresh never settles");
+	}
+}
+
+
+static void
+delay_sim_change(DelaySim *sim, gdouble now)
+{
+	delay_sim_run(sim, now);
+	update_delay_change(&sim->delay, now, DELAY_INTERVAL);
+	delay_sim_update(sim, now);
+}
+
+
+START_TEST(test_delay_burst)
+{
+	DelaySim sim = { { 0, FALSE, -1 }, FALSE, 0, 0, 0, 0 };
+	gdouble now = 0;
+	gint i;
+
+	/* an isolated change refreshes at once */
+	delay_sim_change(&sim, now);
+	fail_unless(sim.refreshes == 1 && !sim.armed);
+
+	/* a burst of quick steps ends in exactly one more refresh, after the last step */
+	for (i = 1; i <= 50; i++)
+	{
+		now = i * 0.01;
+		delay_sim_change(&sim, now);
+	}
+	fail_unless(sim.refreshes == 1, "refreshed %u times during the burst", sim.refreshes);
+	delay_sim_run(&sim, now + 10);
+	fail_unless(sim.refreshes == 2, "expected 2 refreshes, got %u", sim.refreshes);
+	fail_unless(!sim.armed && !sim.delay.delayed);
+	fail_unless(sim.refreshed_at >= now + DELAY_INTERVAL);
+
+	/* and after settling, the next isolated change refreshes at once again */
+	now += 20;
+	delay_sim_change(&sim, now);
+	fail_unless(sim.refreshes == 3 && sim.refreshed_at == now);
+
+	update_delay_reset(&sim.delay);
+	fail_unless(!sim.delay.delayed && sim.delay.last < 0);
+}
+
+END_TEST;
+
+/* Collects the records as "dropped:record" */
+static void
+collect_records(char *record, gsize dropped, gpointer gdata)
+{
+	g_ptr_array_add(gdata, g_strdup_printf("%u:%s", (guint) dropped, record));
+}
+
+
+static void
+rec_feed(RecBuf *buf, const char *text, gsize length)
+{
+	memcpy(rec_buf_reserve(buf, length), text, length);
+	rec_buf_commit(buf, length);
+}
+
+
+static void
+check_records(GPtrArray *records, const char **expected)
+{
+	guint i;
+
+	for (i = 0; i < records->len && expected[i]; i++)
+		fail_unless(!strcmp(records->pdata[i], expected[i]), "record %u: expected \"%s\", "
+			    "got \"%s\"", i, expected[i], (char *) records->pdata[i]);
+
+	fail_unless(i == records->len && !expected[i], "expected %u records, got %u",
+		    g_strv_length((gchar **) expected), records->len);
+}
+
+
+static const char rec_transcript[] =
+	"=thread-group-added,id=\"i1\"\n"
+	"~\"Reading symbols from \\\"a.out\\\"...\\n\"\n"
+	"^done,value=\"\\\"x\\\\ny\\\", 1\"\n"
+	"\n"
+	"*stopped,reason=\"end-stepping-range\",thread-id=\"1\"\n";
+
+static const char *rec_expected[] =
+{
+	"0:=thread-group-added,id=\"i1\"",
+	"0:~\"Reading symbols from \\\"a.out\\\"...\\n\"",
+	"0:^done,value=\"\\\"x\\\\ny\\\", 1\"",
+	"0:",
+	"0:*stopped,reason=\"end-stepping-range\",thread-id=\"1\"",
+	NULL
+};
+
+
+/* the transcript split in two at every position, including inside escaped strings and
+   right before and after each '\n' */
+START_TEST(test_rec_buf_chunks)
+{
+	gsize length = strlen(rec_transcript);
+	const char *escape = strstr(rec_transcript, "\\\"a.out");
+	gsize i;
+
+	fail_unless(escape != NULL);
+	for (i = 0; i <= length; i++)
+	{
+		RecBuf *buf = rec_buf_new(0x3FFF);
+		GPtrArray *records = g_ptr_array_new_with_free_func(g_free);
+
+		rec_feed(buf, rec_transcript, i);
+		rec_buf_split(buf, collect_records, records);
+		if (i == (gsize) (escape + 1 - rec_transcript))
+			fail_unless(records->len == 1 && rec_buf_pending(buf) == FALSE);
+		rec_feed(buf, rec_transcript + i, length - i);
+		fail_unless(rec_buf_pending(buf) == (i < length));
+		rec_buf_split(buf, collect_records, records);
+		fail_unless(!rec_buf_pending(buf));
+		check_records(records, rec_expected);
+		g_ptr_array_free(records, TRUE);
+		rec_buf_free(buf);
+	}
+}
+
+END_TEST;
+
+/* a record is passed only when complete; several records in one chunk are passed in order */
+START_TEST(test_rec_buf_partial)
+{
+	RecBuf *buf = rec_buf_new(0x3FFF);
+	GPtrArray *records = g_ptr_array_new_with_free_func(g_free);
+	const char *expected[] = { "0:^done", "0:^error,msg=\"a\"", "0:*running", NULL };
+	gsize i;
+
+	for (i = 0; i < 7; i++)
+	{
+		rec_feed(buf, "^done,v" + i, 1);
+		rec_buf_split(buf, collect_records, records);
+		fail_unless(records->len == 0 && !rec_buf_pending(buf));
+	}
+
+	rec_buf_clear(buf);
+	rec_feed(buf, "^done\n^error,msg=\"a\"\n*run", 25);
+	rec_buf_split(buf, collect_records, records);
+	fail_unless(records->len == 2);
+	rec_feed(buf, "ning\n", 5);
+	rec_buf_split(buf, collect_records, records);
+	check_records(records, expected);
+
+	/* one byte at a time */
+	g_ptr_array_set_size(records, 0);
+	for (i = 0; rec_transcript[i]; i++)
+	{
+		rec_feed(buf, rec_transcript + i, 1);
+		rec_buf_split(buf, collect_records, records);
+	}
+	check_records(records, rec_expected);
+	g_ptr_array_free(records, TRUE);
+	rec_buf_free(buf);
+}
+
+END_TEST;
+
+/* only the head of a long record is kept, even when it arrives in many chunks */
+START_TEST(test_rec_buf_overflow)
+{
+	RecBuf *buf = rec_buf_new(16);
+	GPtrArray *records = g_ptr_array_new_with_free_func(g_free);
+	const char *text = "^done,memory=[{contents=\"0011223344\"}]\n^done\n";
+	const char *expected[] = { "22:^done,memory=[{c", "0:^done", NULL };
+	gsize length = strlen(text), i;
+
+	for (i = 0; i < length; i += 7)
+	{
+		rec_feed(buf, text + i, MIN(7, length - i));
+		rec_buf_split(buf, collect_records, records);
+	}
+	check_records(records, expected);
+	g_ptr_array_free(records, TRUE);
+	rec_buf_free(buf);
+}
+
+END_TEST;
+
+#define REC_HUGE_LENGTH (REC_BUF_CHUNK * 5)
+
+typedef struct _RecNested
+{
+	RecBuf *buf;
+	GPtrArray *records;
+	gchar *huge;
+} RecNested;
+
+
+/* receives more output while parsing, like scope waiting for a reply */
+static void
+collect_nested(char *record, gsize dropped, gpointer gdata)
+{
+	RecNested *nested = gdata;
+
+	if (strlen(record) == REC_HUGE_LENGTH)
+		strcpy(record, "huge");
+	collect_records(record, dropped, nested->records);
+	if (!strcmp(record, "a"))
+	{
+		rec_feed(nested->buf, "d\n", 2);
+		rec_feed(nested->buf, nested->huge, REC_HUGE_LENGTH);
+		rec_feed(nested->buf, "\ne\n", 3);
+		rec_buf_split(nested->buf, collect_nested, nested);
+	}
+}
+
+
+/* a nested split passes the pending records first, and may give back the text memory */
+START_TEST(test_rec_buf_nested)
+{
+	RecNested nested = { rec_buf_new(REC_HUGE_LENGTH), g_ptr_array_new_with_free_func(g_free),
+		g_malloc(REC_HUGE_LENGTH) };
+	const char *expected[] = { "0:a", "0:b", "0:c", "0:d", "0:huge", "0:e", "0:f", NULL };
+
+	memset(nested.huge, 'x', REC_HUGE_LENGTH);
+	rec_feed(nested.buf, "a\nb\nc\n", 6);
+	rec_buf_split(nested.buf, collect_nested, &nested);
+	rec_feed(nested.buf, "f\n", 2);
+	rec_buf_split(nested.buf, collect_nested, &nested);
+	check_records(nested.records, expected);
+	g_free(nested.huge);
+	g_ptr_array_free(nested.records, TRUE);
+	rec_buf_free(nested.buf);
+}
+
+END_TEST;
+
+#define REC_RANDOM_RECORDS 5000
+#define REC_RANDOM_MAX 1000
+
+/* random records, some over the limit, in random chunks up to the read size */
+START_TEST(test_rec_buf_random)
+{
+	RecBuf *buf = rec_buf_new(REC_RANDOM_MAX);
+	GPtrArray *records = g_ptr_array_new_with_free_func(g_free);
+	GPtrArray *expected = g_ptr_array_new_with_free_func(g_free);
+	GString *text = g_string_new(NULL);
+	gsize i;
+
+	srand(3);
+	for (i = 0; i < REC_RANDOM_RECORDS; i++)
+	{
+		gsize length = rand() % 8 ? rand() % 200 : rand() % (REC_RANDOM_MAX * 3);
+		gsize start = text->len;
+		gsize k;
+
+		for (k = 0; k < length; k++)
+			g_string_append_c(text, "^done,\"\\x= "[rand() % 11]);
+
+		g_ptr_array_add(expected, g_strdup_printf("%u:%.*s", (guint) (length > REC_RANDOM_MAX ?
+			length - REC_RANDOM_MAX : 0), REC_RANDOM_MAX, text->str + start));
+		g_string_append_c(text, '\n');
+	}
+	g_ptr_array_add(expected, NULL);
+
+	for (i = 0; i < text->len; )
+	{
+		gsize length = MIN((gsize) (rand() % 3 ? rand() % 300 : rand() % REC_BUF_CHUNK) + 1,
+			text->len - i);
+
+		rec_feed(buf, text->str + i, length);
+		rec_buf_split(buf, collect_records, records);
+		i += length;
+	}
+
+	check_records(records, (const char **) expected->pdata);
+	g_string_free(text, TRUE);
+	g_ptr_array_free(expected, TRUE);
+	g_ptr_array_free(records, TRUE);
+	rec_buf_free(buf);
+}
+
+END_TEST;
+
+static void
+route_nop(G_GNUC_UNUSED GArray *nodes)
+{
+}
+
+
+/* the routes of parse.c */
+static const ParseRoute test_routes[] =
+{
+	{ "*running,",                      route_nop, '\0', '\0', 0 },
+	{ "*stopped,reason=\"exited",       NULL,      '\0', '\0', 0 },
+	{ "*stopped,reason=\"breakpoint",   route_nop, '\0', '\0', 0 },
+	{ "*stopped,",                      route_nop, '\0', '\0', 0 },
+	{ "=thread-created,",               route_nop, '\0', '\0', 0 },
+	{ "=thread-exited,",                route_nop, '\0', '\0', 0 },
+	{ "=thread-selected,id=\"",         route_nop, '\0', '\0', 1 },
+	{ "=thread-group-started,id=\"",    route_nop, '\0', '\0', 1 },
+	{ "=thread-group-exited,id=\"",     route_nop, '\0', '\0', 1 },
+	{ "=thread-group-added,id=\"",      route_nop, '\0', '\0', 1 },
+	{ "=thread-group-removed,id=\"",    route_nop, '\0', '\0', 1 },
+	{ "=breakpoint-created,bkpt={",     route_nop, '\0', '\0', 1 },
+	{ "=breakpoint-modified,bkpt={",    route_nop, '\0', '\0', 1 },
+	{ "=breakpoint-deleted,id=\"",      route_nop, '\0', '\0', 1 },
+	{ "^done,bkpt={",                   route_nop, '\0', '\0', 1 },
+	{ "^done,wpt={",                    route_nop, '\0', '\0', 1 },
+	{ "^done,hw-awpt={",                route_nop, '\0', '\0', 1 },
+	{ "^done,hw-rwpt={",                route_nop, '\0', '\0', 1 },
+	{ "^done,threads=[",                route_nop, '2',  '\0', 1 },
+	{ "^done,threads=[",                route_nop, '\0', '\0', 1 },
+	{ "^done,new-thread-id=\"",         route_nop, '\0', '\0', 1 },
+	{ "^done,BreakpointTable={",        route_nop, '\0', '\0', 1 },
+	{ "^done,frame={",                  route_nop, '2',  '\0', 0 },
+	{ "^done,frame={",                  route_nop, '4',  '\0', 0 },
+	{ "^done,stack=[",                  route_nop, '*',  '\0', 1 },
+	{ "^done,stack-args=[",             route_nop, '*',  '\0', 1 },
+	{ "^done,variables=[",              route_nop, '*',  '\0', 1 },
+	{ "^done,line=\"",                  route_nop, '2',  '\0', 2 },
+	{ "^done,value=\"",                 route_nop, '2',  '\0', 1 },
+	{ "^done,value=\"",                 route_nop, '3',  '\0', 1 },
+	{ "^done,value=\"",                 route_nop, '4',  '\0', 1 },
+	{ "^done,value=\"",                 route_nop, '6',  '\0', 1 },
+	{ "^done,value=\"",                 route_nop, '7',  '\0', 1 },
+	{ "^done,value=\"",                 route_nop, '8',  '\0', 1 },
+	{ "^done,name=\"",                  route_nop, '7',  '\0', 1 },
+	{ "^done,format=\"",                route_nop, '7',  '\0', 1 },
+	{ "^done,numchild=\"",              route_nop, '7',  '\0', 2 },
+	{ "^done,ndeleted=\"",              route_nop, '7',  '\0', 0 },
+	{ "^done,path_expr=\"",             route_nop, '4',  '\0', 1 },
+	{ "^done,changelist=[",             route_nop, '\0', '\0', 1 },
+	{ "^done,memory=[",                 route_nop, '\0', '\0', 1 },
+	{ "^done,features=[",               route_nop, '5',  '\0', 1 },
+	{ "^done,features=[",               route_nop, '7',  '\0', 1 },
+	{ "^done,register-names=[",         route_nop, '\0', '\0', 1 },
+	{ "^done,changed-registers=[",      route_nop, '\0', '\0', 1 },
+	{ "^done,register-values=[",        route_nop, '*',  '\0', 1 },
+	{ "^running",                       route_nop, '1',  '\0', 0 },
+	{ "^done",                          route_nop, '1',  '\0', 0 },
+	{ "^done",                          route_nop, '2',  '\0', 0 },
+	{ "^done",                          route_nop, '5',  '\0', 0 },
+	{ "^done",                          route_nop, '7',  '\0', 0 },
+	{ "^error,",                        route_nop, '1',  '\n', 0 },
+	{ "^error,",                        route_nop, '3',  '\0', 0 },
+	{ "^error",                         route_nop, '4',  '\0', 0 },
+	{ "^error,",                        route_nop, '6',  '\t', 0 },
+	{ "^error,",                        route_nop, '\0', '\n', 0 },
+	{ NULL, NULL, '\0', '\0', 0 }
+};
+
+
+/* Returns the route for message the way parse.c did before the table was hashed */
+static const ParseRoute *
+route_linear(const char *message, const char *token)
+{
+	const ParseRoute *route;
+
+	for (route = test_routes; route->prefix; route++)
+		if (g_str_has_prefix(message, route->prefix))
+			if (!route->mark || (token && (route->mark == '*' || route->mark == *token)))
+				return route;
+
+	return NULL;
+}
+
+
+static const ParseRoute *
+route_find(RouteTable *table, const char *message, const char *token)
+{
+	gchar *text = g_strdup(message);
+	const ParseRoute *route = route_table_find(table, text, token);
+
+	fail_unless(!strcmp(text, message), "%s: message modified", message);
+	g_free(text);
+	return route;
+}
+
+
+/* Checks that message with token goes to the first route with prefix and mark */
+static void
+check_route(RouteTable *table, const char *message, const char *token, const char *prefix,
+	    char mark)
+{
+	const ParseRoute *route = route_find(table, message, token);
+	const ParseRoute *expected;
+
+	for (expected = test_routes; prefix && expected->prefix; expected++)
+		if (!strcmp(expected->prefix, prefix) && expected->mark == mark)
+			break;
+
+	fail_unless(!prefix || expected->prefix, "%s: no such route", prefix);
+	fail_unless(route == (prefix ? expected : NULL), "%s %s: got %s %c, expected %s %c",
+		    message, token ? token : "-", route ? route->prefix : "none",
+		    route && route->mark ? route->mark : '-', prefix ? prefix : "none",
+		    mark ? mark : '-');
+}
+
+
+START_TEST(test_route_unknown)
+{
+	RouteTable *table = route_table_new(test_routes);
+
+	check_route(table, "", NULL, NULL, 0);
+	check_route(table, "^exit", NULL, NULL, 0);
+	check_route(table, "^connected", "1", NULL, 0);
+	check_route(table, "*stopped", NULL, NULL, 0);
+	check_route(table, "=library-loaded,id=\"/lib/libc.so\"", NULL, NULL, 0);
+	check_route(table, "=cmd-param-changed,param=\"print pretty\"", NULL, NULL, 0);
+	check_route(table, "@\"output, of=the program\\n\"", NULL, NULL, 0);
+	check_route(table, "&\"warning,\"", NULL, NULL, 0);
+	/* known record classes, but neither the token nor the result name match */
+	check_route(table, "^done,value=\"1\"", "9", NULL, 0);
+	check_route(table, "^done,stack=[]", NULL, NULL, 0);
+	check_route(table, "^running", NULL, NULL, 0);
+	route_table_free(table);
+}
+
+END_TEST;
+
+START_TEST(test_route_records)
+{
+	RouteTable *table = route_table_new(test_routes);
+
+	/* async records, without tokens */
+	check_route(table, "*running,thread-id=\"all\"", NULL, "*running,", 0);
+	check_route(table, "*stopped,reason=\"exited-normally\"", NULL,
+		    "*stopped,reason=\"exited", 0);
+	check_route(table, "*stopped,reason=\"breakpoint-hit\",bkptno=\"1\"", NULL,
+		    "*stopped,reason=\"breakpoint", 0);
+	check_route(table, "*stopped,reason=\"end-stepping-range\",thread-id=\"1\"", NULL,
+		    "*stopped,", 0);
+	check_route(table, "*stopped,thread-id=\"1\"", NULL, "*stopped,", 0);
+	check_route(table, "=thread-created,id=\"2\",group-id=\"i1\"", NULL,
+		    "=thread-created,", 0);
+	check_route(table, "=thread-selected,id=\"2\"", NULL, "=thread-selected,id=\"", 0);
+	check_route(table, "=breakpoint-modified,bkpt={number=\"1\"}", NULL,
+		    "=breakpoint-modified,bkpt={", 0);
+
+	/* result records, by token */
+	check_route(table, "^done,threads=[]", "21", "^done,threads=[", '2');
+	check_route(table, "^done,threads=[]", "01", "^done,threads=[", 0);
+	check_route(table, "^done,threads=[]", NULL, "^done,threads=[", 0);
+	check_route(table, "^done,value=\"1\"", "7012", "^done,value=\"", '7');
+	check_route(table, "^done,value=\"1\"", "3", "^done,value=\"", '3');
+	check_route(table, "^done,stack=[frame={level=\"0\"}]", "9", "^done,stack=[", '*');
+	check_route(table, "^done,frame={level=\"0\"}", "4", "^done,frame={", '4');
+	check_route(table, "^done,features=[\"async\"]", "7", "^done,features=[", '7');
+	/* falling back to the routes without results, in table order */
+	check_route(table, "^done,value=\"1\"", "1", "^done", '1');
+	check_route(table, "^done,frame={level=\"0\"}", "5", "^done", '5');
+	check_route(table, "^done", "7", "^done", '7');
+	check_route(table, "^running", "1", "^running", '1');
+	check_route(table, "^error,msg=\"x\"", "3", "^error,", '3');
+	check_route(table, "^error,msg=\"x\"", "4", "^error", '4');
+	check_route(table, "^error,msg=\"x\"", "6", "^error,", '6');
+	check_route(table, "^error,msg=\"x\"", NULL, "^error,", 0);
+	route_table_free(table);
+}
+
+END_TEST;
+
+/* commas, '=' and escaped quotes in the values don't change the route */
+START_TEST(test_route_escaped)
+{
+	RouteTable *table = route_table_new(test_routes);
+
+	check_route(table, "^error,msg=\"No symbol \\\"a,b=c\\\" in current context.\"", "4",
+		    "^error", '4');
+	check_route(table, "^error,msg=\"No symbol \\\"a,b=c\\\" in current context.\"", NULL,
+		    "^error,", 0);
+	check_route(table, "^done,value=\"\\\"a=b\\\", c\"", "2", "^done,value=\"", '2');
+	check_route(table, "^done,value=\"{x = 1, y = \\\"=,\\\"}\"", "8", "^done,value=\"",
+		    '8');
+	check_route(table, "=thread-selected,id=\"1\",frame={args=[{name=\"s\","
+		    "value=\"\\\"x,y=z\\\"\"}]}", NULL, "=thread-selected,id=\"", 0);
+	check_route(table, "*stopped,reason=\"signal-received\",signal-meaning=\"a, b=c\"", NULL,
+		    "*stopped,", 0);
+	/* stream records holding the text of other records */
+	check_route(table, "~\"^done,value=\\\"1\\\"\\n\"", "2", NULL, 0);
+	check_route(table, "~\"*stopped,reason=\\\"exited\\\"\"", NULL, NULL, 0);
+	route_table_free(table);
+}
+
+END_TEST;
+
+static const char *route_classes[] =
+{
+	"^done", "^error", "^running", "^exit", "*running", "*stopped", "=thread-created",
+	"=thread-selected", "=breakpoint-modified", "=library-loaded", "~\"text", "@\"x"
+};
+
+static const char *route_results[] =
+{
+	"", ",", ",value=\"1\"", ",value", ",threads=[]", ",frame={}", ",msg=\"a,b=c\"",
+	",reason=\"exited\"", ",reason=\"breakpoint-hit\"", ",id=\"1\"", ",bkpt={", ",=x",
+	",reason=\"end\",value=\"2\"", ",stack=", ",stack-args=[]", ",features=[\"a=b\"]"
+};
+
+#define ROUTE_RECORDS (G_N_ELEMENTS(route_classes) * G_N_ELEMENTS(route_results))
+
+/* Fills records with every class and result, and returns them in a string chunk */
+static GStringChunk *
+route_records(const char *records[ROUTE_RECORDS])
+{
+	GStringChunk *chunk = g_string_chunk_new(4096);
+	guint c, r;
+
+	for (c = 0; c < G_N_ELEMENTS(route_classes); c++)
+	{
+		for (r = 0; r < G_N_ELEMENTS(route_results); r++)
+		{
+			gchar *record = g_strconcat(route_classes[c], route_results[r], NULL);
+
+			records[c * G_N_ELEMENTS(route_results) + r] =
+				g_string_chunk_insert(chunk, record);
+			g_free(record);
+		}
+	}
+
+	return chunk;
+}
+
+
+/* the hashed table picks the same route as the linear scan, for any record and token */
+START_TEST(test_route_linear)
+{
+	RouteTable *table = route_table_new(test_routes);
+	const char *records[ROUTE_RECORDS];
+	GStringChunk *chunk = route_records(records);
+	const char *tokens[] = { NULL, "0", "1", "2", "3", "4", "5", "6", "7", "8", "9" };
+	guint i, k;
+
+	for (i = 0; i < ROUTE_RECORDS; i++)
+	{
+		for (k = 0; k < G_N_ELEMENTS(tokens); k++)
+		{
+			const ParseRoute *route = route_find(table, records[i], tokens[k]);
+			const ParseRoute *expected = route_linear(records[i], tokens[k]);
+
+			fail_unless(route == expected, "%s %s: got %s, expected %s", records[i],
+				    tokens[k] ? tokens[k] : "-", route ? route->prefix : "none",
+				    expected ? expected->prefix : "none");
+		}
+	}
+
+	g_string_chunk_free(chunk);
+	route_table_free(table);
+}
+
+END_TEST;
+
+#define BENCHMARK_ROUTES 1000000
+
+/* a transcript of what scope receives while stepping with the views open */
+static const char *route_transcript[][2] =
+{
+	{ "*running,thread-id=\"all\"", NULL },
+	{ "*stopped,reason=\"end-stepping-range\",frame={addr=\"0x1\"},thread-id=\"1\"", NULL },
+	{ "^done,threads=[{id=\"1\",state=\"stopped\"}],current-thread-id=\"1\"", "0" },
+	{ "^done,stack=[frame={level=\"0\",addr=\"0x1\"}]", "9" },
+	{ "^done,variables=[{name=\"i\",value=\"1\"}]", "9" },
+	{ "^done,changelist=[{name=\"var1\",value=\"2\",in_scope=\"true\"}]", NULL },
+	{ "^done,value=\"{x = 1, y = 2}\"", "6" },
+	{ "^done,changed-registers=[\"0\",\"1\"]", NULL },
+	{ "^done,register-values=[{number=\"0\",value=\"0x1\"}]", "2" },
+	{ "^done,memory=[{begin=\"0x1\",contents=\"00\"}]", NULL },
+	{ "^error,msg=\"No symbol \\\"q\\\" in current context.\"", "6" },
+	{ "=breakpoint-modified,bkpt={number=\"1\",times=\"2\"}", NULL }
+};
+
+
+static gdouble
+route_benchmark(RouteTable *table)
+{
+	GTimer *timer = g_timer_new();
+	gchar *records[G_N_ELEMENTS(route_transcript)];
+	guint i, routed = 0;
+	gdouble elapsed;
+
+	for (i = 0; i < G_N_ELEMENTS(route_transcript); i++)
+		records[i] = g_strdup(route_transcript[i][0]);
+
+	g_timer_start(timer);
+	for (i = 0; i < BENCHMARK_ROUTES; i++)
+	{
+		guint n = i % G_N_ELEMENTS(route_transcript);
+		const char *token = route_transcript[n][1];
+
+		routed += (table ? route_table_find(table, records[n], token) :
+			route_linear(records[n], token)) != NULL;
+	}
+	elapsed = g_timer_elapsed(timer, NULL);
+
+	fail_unless(routed == BENCHMARK_ROUTES, "%u records not routed",
+		    BENCHMARK_ROUTES - routed);
+	for (i = 0; i < G_N_ELEMENTS(route_transcript); i++)
+		g_free(records[i]);
+	g_timer_destroy(timer);
+	return elapsed;
+}
+
+
+START_TEST(test_route_benchmark)
+{
+	RouteTable *table = route_table_new(test_routes);
+	gdouble hashed = route_benchmark(table);
+	gdouble linear = route_benchmark(NULL);
+
+	printf("%d records routed in %.1f ms, %.1f ms with a linear scan\n", BENCHMARK_ROUTES,
+	       hashed * 1000, linear * 1000);
+	route_table_free(table);
+}
+
+END_TEST;
+
+/* Collects the runs sent as "id:start:count" */
+static void
+collect_page_runs(guint id, guint64 start, guint count, gpointer gdata)
+{
+	g_ptr_array_add(gdata, g_strdup_printf("%u:%x:%x", id, (guint) start, count));
+}
+
+
+static GPtrArray *
+send_runs(PageCache *cache)
+{
+	GPtrArray *runs = g_ptr_array_new_with_free_func(g_free);
+
+	page_cache_send(cache, collect_page_runs, runs);
+	fail_unless(!page_cache_queued(cache));
+	return runs;
+}
+
+
+START_TEST(test_page_store)
+{
+	PageCache *cache = page_cache_new();
+	static const char contents[] = "00017f80A0fFC3";
+	guint i;
+
+	/* decoded across the page boundary, in any case */
+	fail_unless(page_cache_store(cache, MEMORY_PAGE - 3, contents));
+	for (i = 0; i < sizeof contents / 2; i++)
+	{
+		gint value = page_cache_byte(cache, MEMORY_PAGE - 3 + i, FALSE);
+		guint expected;
+
+		sscanf(contents + i * 2, "%2x", &expected);
+		fail_unless(value == (gint) expected, "byte %u: expected %02x, got %d", i,
+			expected, value);
+	}
+	fail_unless(page_cache_byte(cache, MEMORY_PAGE - 4, FALSE) == -1);
+	fail_unless(page_cache_byte(cache, MEMORY_PAGE - 3 + i, FALSE) == -1);
+	/* the stored pages are not read again */
+	fail_unless(page_cache_byte(cache, MEMORY_PAGE, TRUE) == 0x80);
+	fail_unless(page_cache_byte(cache, MEMORY_PAGE + 0x100, TRUE) == -1);
+	fail_unless(!page_cache_queued(cache));
+
+	/* invalid contents stop the decoding */
+	fail_unless(!page_cache_store(cache, 0x10000, "12x456"));
+	fail_unless(page_cache_byte(cache, 0x10000, FALSE) == 0x12);
+	fail_unless(page_cache_byte(cache, 0x10001, FALSE) == -1);
+	fail_unless(!page_cache_store(cache, 0x10010, "123"));
+	fail_unless(page_cache_byte(cache, 0x10010, FALSE) == 0x12);
+	fail_unless(page_cache_byte(cache, 0x10011, FALSE) == -1);
+
+	page_cache_clear(cache);
+	fail_unless(page_cache_byte(cache, MEMORY_PAGE, FALSE) == -1);
+	page_cache_free(cache);
+}
+
+END_TEST;
+
+START_TEST(test_page_runs)
+{
+	PageCache *cache = page_cache_new();
+	static const char *expected[] = { "1:0:c00", "2:1400:400", NULL };
+	GPtrArray *runs;
+
+	/* unknown pages are queued once, only if read */
+	fail_unless(page_cache_byte(cache, 0x10, FALSE) == -1);
+	fail_unless(!page_cache_queued(cache));
+	fail_unless(page_cache_byte(cache, 0x1400, TRUE) == -1);
+	fail_unless(page_cache_byte(cache, 0x800, TRUE) == -1);
+	fail_unless(page_cache_byte(cache, 0x10, TRUE) == -1);
+	fail_unless(page_cache_byte(cache, 0x7FF, TRUE) == -1);
+	fail_unless(page_cache_byte(cache, 0x400, TRUE) == -1);
+	fail_unless(page_cache_byte(cache, 0x20, TRUE) == -1);
+
+	/* and sent as runs of consecutive pages */
+	runs = send_runs(cache);
+	check_records(runs, expected);
+	g_ptr_array_free(runs, TRUE);
+	fail_unless(page_cache_byte(cache, 0x10, TRUE) == -1);
+	fail_unless(!page_cache_queued(cache), "a sent page was queued again");
+
+	fail_unless(page_cache_received(cache, 2));
+	fail_unless(page_cache_store(cache, 0x1400, "55"));
+	fail_unless(page_cache_byte(cache, 0x1400, TRUE) == 0x55);
+	fail_unless(page_cache_byte(cache, 0x1401, TRUE) == -1);
+	fail_unless(!page_cache_queued(cache), "a read page was queued again");
+	fail_unless(!page_cache_received(cache, 2));
+
+	/* the replies to runs sent before a clear are ignored */
+	page_cache_clear(cache);
+	fail_unless(!page_cache_received(cache, 1));
+	fail_unless(!page_cache_failed(cache, 1));
+	fail_unless(page_cache_byte(cache, 0x10, TRUE) == -1);
+	runs = send_runs(cache);
+	fail_unless(runs->len == 1 && !strcmp(runs->pdata[0], "3:0:400"));
+	g_ptr_array_free(runs, TRUE);
+	page_cache_free(cache);
+}
+
+END_TEST;
+
+START_TEST(test_page_failed)
+{
+	PageCache *cache = page_cache_new();
+	static const char *expected[] = { "2:0:400", "3:400:400", "4:800:400", NULL };
+	GPtrArray *runs;
+	guint i;
+
+	for (i = 0; i < 3; i++)
+		page_cache_byte(cache, i * MEMORY_PAGE, TRUE);
+	runs = send_runs(cache);
+	fail_unless(runs->len == 1 && !strcmp(runs->pdata[0], "1:0:c00"));
+	g_ptr_array_free(runs, TRUE);
+
+	/* a failed run is read again page by page */
+	fail_unless(page_cache_failed(cache, 1));
+	fail_unless(page_cache_queued(cache));
+	runs = send_runs(cache);
+	check_records(runs, expected);
+	g_ptr_array_free(runs, TRUE);
+	fail_unless(page_cache_received(cache, 2));
+	fail_unless(page_cache_received(cache, 4));
+	fail_unless(page_cache_failed(cache, 3));
+	fail_unless(page_cache_retry(cache) == 1);
+
+	/* a failed page is read again on request, up to PAGE_RETRIES times */
+	for (i = 1; i <= PAGE_RETRIES; i++)
+	{
+		fail_unless(page_cache_byte(cache, 0x500, TRUE) == -1);
+		fail_unless(page_cache_queued(cache), "failure %u: not queued", i);
+		runs = send_runs(cache);
+		fail_unless(runs->len == 1);
+		g_ptr_array_free(runs, TRUE);
+		fail_unless(page_cache_failed(cache, 4 + i));
+		fail_unless(page_cache_byte(cache, 0x500, TRUE) == -1);
+		fail_unless(!page_cache_queued(cache), "failure %u: queued before a retry", i);
+		fail_unless(page_cache_retry(cache) == (i < PAGE_RETRIES));
+	}
+
+	/* the read pages are not affected */
+	fail_unless(page_cache_byte(cache, 0x10, TRUE) == -1);
+	fail_unless(page_cache_byte(cache, 0x810, TRUE) == -1);
+	fail_unless(!page_cache_queued(cache));
+
+	/* a clear drops the failures */
+	page_cache_clear(cache);
+	page_cache_byte(cache, 0x500, TRUE);
+	fail_unless(page_cache_queued(cache));
+	page_cache_free(cache);
+}
+
+END_TEST;
+
+Suite *
+my_suite(void)
+{
+	Suite *s = suite_create("Scope");
+	TCase *tc_core = tcase_create("line_map");
+	TCase *tc_store = tcase_create("scp_tree_store");
+	TCase *tc_conbuf = tcase_create("con_buf");
+	TCase *tc_delay = tcase_create("update_delay");
+	TCase *tc_recbuf = tcase_create("rec_buf");
+	TCase *tc_route = tcase_create("route_table");
+	TCase *tc_pagecache = tcase_create("page_cache");
+
+	suite_add_tcase(s, tc_core);
+	tcase_add_test(tc_core, test_add);
+	tcase_add_test(tc_core, test_insert);
+	tcase_add_test(tc_core, test_delete);
+	tcase_add_test(tc_core, test_destroy);
+	tcase_add_test(tc_core, test_random);
+
+	suite_add_tcase(s, tc_store);
+	tcase_add_test(tc_store, test_index_search);
+	tcase_add_test(tc_store, test_index_sublevels);
+	tcase_add_test(tc_store, test_index_collate);
+	tcase_add_test(tc_store, test_index_random);
+	tcase_add_test(tc_store, test_index_large);
+	tcase_add_test(tc_store, test_index_shared);
+
+	suite_add_tcase(s, tc_conbuf);
+	tcase_add_test(tc_conbuf, test_con_buf_runs);
+	tcase_add_test(tc_conbuf, test_con_buf_drop);
+	tcase_add_test(tc_conbuf, test_con_buf_flood);
+
+	suite_add_tcase(s, tc_delay);
+	tcase_add_test(tc_delay, test_delay_burst);
+
+	suite_add_tcase(s, tc_recbuf);
+	tcase_add_test(tc_recbuf, test_rec_buf_chunks);
+	tcase_add_test(tc_recbuf, test_rec_buf_partial);
+	tcase_add_test(tc_recbuf, test_rec_buf_overflow);
+	tcase_add_test(tc_recbuf, test_rec_buf_nested);
+	tcase_add_test(tc_recbuf, test_rec_buf_random);
+
+	suite_add_tcase(s, tc_route);
+	tcase_add_test(tc_route, test_route_unknown);
+	tcase_add_test(tc_route, test_route_records);
+	tcase_add_test(tc_route, test_route_escaped);
+	tcase_add_test(tc_route, test_route_linear);
+	tcase_add_test(tc_route, test_route_benchmark);
+
+	suite_add_tcase(s, tc_pagecache);
+	tcase_add_test(tc_pagecache, test_page_store);
+	tcase_add_test(tc_pagecache, test_page_runs);
+	tcase_add_test(tc_pagecache, test_page_failed);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int nf;
+	Suite *s;
+	SRunner *sr;
+
+#if !GLIB_CHECK_VERSION(2, 36, 0)
+	g_type_init();
+#endif
+	s = my_suite();
+	sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	nf = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return (nf == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}